@@ -0,0 +1,135 @@
+#include "AlarmEngine.h"
+#include <stdio.h>
+
+size_t AlarmEngine::compile(const std::vector<std::string>& channelKeys, const std::vector<Definition>& definitions) {
+    table.clear();
+    names.clear();
+    statuses.clear();
+    lastMs = INT64_MIN;
+    activeRules = activeOutputs = 0;
+    eventHead = eventCount = 0;
+    dropped = 0;
+
+    for (size_t d = 0; d < definitions.size(); ++d) {
+        const Definition& def = definitions[d];
+        bool hasRate = !isnan(def.rateAbove);
+        bool hasLevel = !isnan(def.above) || !isnan(def.below);
+
+        std::string name = def.name;
+        if (name.empty()) {
+            char condition[48];
+            if (hasRate) {
+                snprintf(condition, sizeof(condition), " rate > %g/s", def.rateAbove);
+            } else if (!isnan(def.above) && !isnan(def.below)) {
+                snprintf(condition, sizeof(condition), " outside %g..%g", def.below, def.above);
+            } else if (!isnan(def.above)) {
+                snprintf(condition, sizeof(condition), " > %g", def.above);
+            } else {
+                snprintf(condition, sizeof(condition), " < %g", def.below);
+            }
+            name = def.key + condition;
+        }
+        names.push_back(name);
+
+        size_t index = 0;
+        while (index < channelKeys.size() && channelKeys[index] != def.key) ++index;
+
+        Status status = Status::Ok;
+        if (index >= channelKeys.size()) {
+            status = Status::UnknownKey;
+        } else if (!hasRate && !hasLevel) {
+            status = Status::NoCondition;
+        } else if ((hasRate && hasLevel) || (!isnan(def.above) && !isnan(def.below) && def.below >= def.above)) {
+            status = Status::Conflict;
+        } else if (table.size() >= kMaxRules) {
+            status = Status::TooMany;
+        }
+        statuses.push_back(status);
+        if (status != Status::Ok) continue;
+
+        Rule r;
+        r.index = static_cast<uint16_t>(index);
+        r.definition = static_cast<uint16_t>(d);
+        r.rate = hasRate;
+        r.output = def.output;
+        r.active = false;
+        r.low = (hasRate || isnan(def.below)) ? -INFINITY : def.below;
+        r.high = hasRate ? def.rateAbove : (isnan(def.above) ? INFINITY : def.above);
+        r.hysteresis = def.hysteresis > 0.0f ? def.hysteresis : 0.0f;
+        r.minDurationMs = def.minDurationMs;
+        r.sinceMs = INT64_MIN;
+        r.last = NAN;
+        table.push_back(r);
+    }
+    return table.size();
+}
+
+/// <summary>
+/// One pass over the flat table. The band test, hysteresis and duration are
+/// selects on the rule's state; a branch is only taken for a state change.
+/// </summary>
+size_t AlarmEngine::evaluate(int64_t timestampMs, const float* values) {
+    int64_t dtMs = lastMs == INT64_MIN ? 0 : timestampMs - lastMs;
+    float perSecond = dtMs > 0 ? 1000.0f / static_cast<float>(dtMs) : NAN;   // NAN: no rate on the first sample
+    lastMs = timestampMs;
+
+    size_t changes = 0;
+    for (Rule& r : table) {
+        float v = values[r.index];
+        float x = r.rate ? fabsf(v - r.last) * perSecond : v;
+        r.last = v;
+
+        // Raised: the band shrinks by the hysteresis, so clearing needs a clear margin
+        float shrink = r.active ? r.hysteresis : 0.0f;
+        bool outside = (x < r.low + shrink) | (x > r.high - shrink);
+        bool valid = x == x;
+        bool holds = valid ? outside : r.sinceMs != INT64_MIN;   // NAN neither starts nor ends a violation
+        r.sinceMs = holds ? (r.sinceMs == INT64_MIN ? timestampMs : r.sinceMs) : INT64_MIN;
+        int64_t heldMs = holds ? timestampMs - r.sinceMs : -1;
+        bool raised = valid ? heldMs >= static_cast<int64_t>(r.minDurationMs) : r.active;
+
+        if (raised != r.active) {
+            r.active = raised;
+            activeRules += raised ? 1 : -1;
+            if (r.output) activeOutputs += raised ? 1 : -1;
+            queue({ timestampMs, r.definition, raised, x });
+            ++changes;
+        }
+    }
+    return changes;
+}
+
+void AlarmEngine::queue(const Event& event) {
+    if (eventCount == kMaxEvents) {
+        ++dropped;
+        return;
+    }
+    events[(eventHead + eventCount) % kMaxEvents] = event;
+    ++eventCount;
+}
+
+bool AlarmEngine::popEvent(Event& out) {
+    if (eventCount == 0) return false;
+    out = events[eventHead];
+    eventHead = (eventHead + 1) % kMaxEvents;
+    --eventCount;
+    return true;
+}
+
+bool AlarmEngine::isActive(size_t rule) const {
+    for (const Rule& r : table) {
+        if (r.definition == rule) return r.active;
+    }
+    return false;
+}
+
+const char* AlarmEngine::statusName(Status status) {
+    switch (status) {
+        case Status::Ok: return "ok";
+        case Status::UnknownKey: return "unknown channel";
+        case Status::NoCondition: return "no above/below/rate_above";
+        case Status::Conflict: return "conflicting limits";
+        case Status::TooMany: return "too many rules";
+    }
+    return "?";
+}
@@ -0,0 +1,162 @@
+#ifndef ALARM_ENGINE_H
+#define ALARM_ENGINE_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Threshold alarms evaluated on every sample, right after the registers were
+/// read and the derived channels computed, so a voltage leaving its band is
+/// known within the cycle instead of by post-processing the logs.
+///
+/// The rules from config.json are compiled at load into one flat table: each
+/// entry names a value index and an allowed band [low, high] (an "above"
+/// limit has low = -inf, a "below" limit high = +inf, rate rules look at
+/// |dvalue/dt| instead of the value). evaluate() runs the same few compares
+/// and selects for every entry; only a state change takes a branch. A raised
+/// alarm clears once the value is back inside the band by the hysteresis, a
+/// condition must hold for the minimum duration before it raises, and a NAN
+/// (failed read) changes neither the state nor a running duration.
+///
+/// State changes go to a small event queue that the caller drains outside
+/// the cycle (event log on the SD card). This header has no Arduino dependencies.
+/// </summary>
+class AlarmEngine {
+public:
+    static constexpr size_t kMaxRules = 64;      ///< Entries in the rule table
+    static constexpr size_t kMaxEvents = 32;     ///< State changes queued until drained
+
+    /// <summary>
+    /// One rule as configured.
+    /// </summary>
+    struct Definition {
+        std::string name;               ///< Shown in the event log (default: key and condition)
+        std::string key;                ///< Channel the rule watches
+        float above = NAN;              ///< Raise when the value exceeds this
+        float below = NAN;              ///< Raise when the value drops under this
+        float rateAbove = NAN;          ///< Raise when |change per second| exceeds this
+        float hysteresis = 0.0f;        ///< Distance back inside the band needed to clear
+        uint32_t minDurationMs = 0;     ///< Condition must hold this long before raising
+        bool output = false;            ///< Drives the alarm output while raised
+    };
+
+    /// <summary>
+    /// Compile result of one rule.
+    /// </summary>
+    enum class Status : uint8_t {
+        Ok,
+        UnknownKey,     ///< Key is not a channel
+        NoCondition,    ///< Neither above, below nor rate_above
+        Conflict,       ///< rate_above combined with above/below, or below >= above
+        TooMany         ///< Beyond kMaxRules
+    };
+
+    /// <summary>
+    /// One state change.
+    /// </summary>
+    struct Event {
+        int64_t timestampMs;
+        uint16_t rule;                  ///< Index into the definitions
+        bool raised;                    ///< True when raised, false when cleared
+        float value;                    ///< Value (or rate) that caused the change
+    };
+
+    /// <summary>
+    /// Compiles the rules; replaces the previous table and clears all state.
+    /// </summary>
+    /// <param name="channelKeys">Keys of the channels, in value order</param>
+    /// <param name="definitions">Rules, in config order</param>
+    /// <returns>Number of rules that compiled</returns>
+    size_t compile(const std::vector<std::string>& channelKeys, const std::vector<Definition>& definitions);
+
+    /// <summary>
+    /// Checks every rule against one sample.
+    /// </summary>
+    /// <param name="timestampMs">Sample time</param>
+    /// <param name="values">Channel values in value order</param>
+    /// <returns>Number of state changes (queued as events)</returns>
+    size_t evaluate(int64_t timestampMs, const float* values);
+
+    /// <summary>
+    /// Takes the oldest queued state change.
+    /// </summary>
+    /// <returns>False if none is queued</returns>
+    bool popEvent(Event& out);
+
+    /// <summary>
+    /// True while at least one raised rule drives the alarm output.
+    /// </summary>
+    bool outputActive() const { return activeOutputs > 0; }
+
+    /// <summary>
+    /// Number of rules currently raised.
+    /// </summary>
+    size_t activeCount() const { return activeRules; }
+
+    /// <summary>
+    /// Rule state for listings.
+    /// </summary>
+    bool isActive(size_t rule) const;
+
+    /// <summary>
+    /// Name of rule i (as configured, or derived from key and condition).
+    /// </summary>
+    const std::string& name(size_t rule) const { return names[rule]; }
+
+    /// <summary>
+    /// Compile status of rule i.
+    /// </summary>
+    Status status(size_t rule) const { return rule < statuses.size() ? statuses[rule] : Status::UnknownKey; }
+
+    /// <summary>
+    /// Text for a status, for warnings.
+    /// </summary>
+    static const char* statusName(Status status);
+
+    /// <summary>
+    /// Number of configured rules (compiled or not).
+    /// </summary>
+    size_t ruleCount() const { return statuses.size(); }
+
+    /// <summary>
+    /// State changes lost because the queue was full (since compile).
+    /// </summary>
+    uint32_t droppedEvents() const { return dropped; }
+
+private:
+    /// <summary>
+    /// One entry of the flat rule table (hot data only).
+    /// </summary>
+    struct Rule {
+        uint16_t index;                 ///< Value index
+        uint16_t definition;            ///< Index into names / statuses
+        bool rate;                      ///< Checks |dvalue/dt| instead of the value
+        bool output;                    ///< Drives the alarm output
+        bool active;                    ///< Currently raised
+        float low;                      ///< Band the value must stay in
+        float high;
+        float hysteresis;
+        uint32_t minDurationMs;
+        int64_t sinceMs;                ///< Start of the current violation (INT64_MIN = none)
+        float last;                     ///< Previous value (rate rules)
+    };
+
+    void queue(const Event& event);
+
+    std::vector<Rule> table;
+    std::vector<std::string> names;
+    std::vector<Status> statuses;
+    int64_t lastMs = INT64_MIN;          ///< Previous sample time (rate rules)
+    size_t activeRules = 0;
+    size_t activeOutputs = 0;
+
+    Event events[kMaxEvents];
+    size_t eventHead = 0;                ///< Next event to pop
+    size_t eventCount = 0;
+    uint32_t dropped = 0;
+};
+
+#endif // ALARM_ENGINE_H
@@ -0,0 +1,231 @@
+#include "BurstCapture.h"
+#include <math.h>
+#include <time.h>
+
+// Upper bound for pre/post windows, keeps the ring within a few tens of KB
+static const uint16_t MAX_WINDOW_SAMPLES = 2000;
+
+/// <summary>
+/// Resolves burst keys and trigger rules and allocates the pre-trigger ring.
+/// </summary>
+bool BurstCapture::begin(const BurstSettings& burst, const std::vector<RegisterConfig>& allRegisters,
+                         RtcManager* rtcManager, StorageManager* storageManager, ModbusManager* modbusManager) {
+    rtc = rtcManager;
+    storage = storageManager;
+    modbus = modbusManager;
+    settings = burst;
+    enabled = false;
+    registers.clear();
+    rules.clear();
+
+    if (!settings.enabled) return false;
+
+    for (const auto& key : settings.keys) {
+        bool found = false;
+        for (const auto& reg : allRegisters) {
+            if (reg.key == key) {
+                registers.push_back(reg);
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            Serial.printf("[BurstCapture][WARN] Unknown burst register '%s', ignored.\n", key.c_str());
+            storage->logError(ErrorCode::Config, "Burst register not found in register list: " + key);
+        }
+    }
+
+    for (const auto& trigger : settings.triggers) {
+        bool found = false;
+        for (size_t i = 0; i < registers.size(); ++i) {
+            if (registers[i].key == trigger.key) {
+                rules.push_back({ i, trigger.kind, trigger.threshold });
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            Serial.printf("[BurstCapture][WARN] Trigger key '%s' is not a burst register, ignored.\n", trigger.key.c_str());
+            storage->logError(ErrorCode::Config, "Burst trigger key is not a burst register: " + trigger.key);
+        }
+    }
+
+    if (registers.empty() || rules.empty()) {
+        Serial.println("[BurstCapture] No usable burst registers or triggers, burst capture disabled.");
+        return false;
+    }
+
+    if (settings.preSamples > MAX_WINDOW_SAMPLES) settings.preSamples = MAX_WINDOW_SAMPLES;
+    if (settings.postSamples > MAX_WINDOW_SAMPLES) settings.postSamples = MAX_WINDOW_SAMPLES;
+    if (!settings.eventFolder.endsWith("/")) settings.eventFolder += "/";
+
+    columns = registers.size();
+    capacity = static_cast<size_t>(settings.preSamples) + settings.postSamples + 1;
+    timestamps.assign(capacity, 0);
+    values.assign(capacity * columns, NAN);
+    head = 0;
+    filled = 0;
+    state = State::Armed;
+    enabled = true;
+
+    Serial.printf("[BurstCapture] Armed: %u register(s), %u rule(s), ring of %u rows (%u bytes).\n",
+                  (unsigned)columns, (unsigned)rules.size(), (unsigned)capacity,
+                  (unsigned)(capacity * (sizeof(int64_t) + columns * sizeof(float))));
+    return true;
+}
+
+/// <summary>
+/// Reads the burst registers into the ring and advances the head.
+/// </summary>
+size_t BurstCapture::sampleRow() {
+    size_t row = head;
+    modbus->readInto(registers, rowValues(row));
+    timestamps[row] = rtc->nowMs();
+
+    head = (head + 1) % capacity;
+    if (filled < capacity) filled++;
+    return row;
+}
+
+/// <summary>
+/// Checks the trigger rules on a freshly written row.
+/// </summary>
+const BurstCapture::Rule* BurstCapture::checkTriggers(size_t row) const {
+    const float* now = rowValues(row);
+    size_t prevRow = (row + capacity - 1) % capacity;
+    const float* prev = filled >= 2 ? rowValues(prevRow) : nullptr;
+
+    for (const auto& rule : rules) {
+        float v = now[rule.column];
+        if (isnan(v)) continue;
+
+        switch (rule.kind) {
+            case BurstTrigger::Kind::Above:
+                if (v > rule.threshold) return &rule;
+                break;
+            case BurstTrigger::Kind::Below:
+                if (v < rule.threshold) return &rule;
+                break;
+            case BurstTrigger::Kind::RateAbove: {
+                if (!prev || isnan(prev[rule.column])) break;
+                int64_t dtMs = timestamps[row] - timestamps[prevRow];
+                if (dtMs <= 0) break;
+                float rate = fabsf(v - prev[rule.column]) * 1000.0f / static_cast<float>(dtMs);
+                if (rate > rule.threshold) return &rule;
+                break;
+            }
+        }
+    }
+    return nullptr;
+}
+
+/// <summary>
+/// Creates the event folder if needed and opens "evt_YYYYMMDD_HHMMSS_mmm.json".
+/// </summary>
+bool BurstCapture::openEventFile() {
+    String folder = settings.eventFolder.substring(0, settings.eventFolder.length() - 1);
+    if (folder.length() > 0 && !SD.exists(folder)) {
+        SD.mkdir(folder);
+    }
+
+    time_t t = static_cast<time_t>(triggerMs / 1000);
+    struct tm tm_info;
+    localtime_r(&t, &tm_info);
+
+    char name[48];
+    size_t n = strftime(name, sizeof(name), "evt_%Y%m%d_%H%M%S", &tm_info);
+    snprintf(name + n, sizeof(name) - n, "_%03u.json", (unsigned)(triggerMs % 1000));
+
+    String path = settings.eventFolder + name;
+    eventFile = SD.open(path, FILE_WRITE);
+    if (!eventFile) {
+        Serial.printf("[BurstCapture][ERROR] Cannot create event file %s\n", path.c_str());
+        storage->logError(ErrorCode::FileOpen, "Failed to create burst event file.");
+        return false;
+    }
+
+    Serial.printf("[BurstCapture] Writing %u row(s) to %s\n", (unsigned)filled, path.c_str());
+    return true;
+}
+
+/// <summary>
+/// Writes up to kRowsPerDumpStep rows, then finishes the event.
+/// </summary>
+void BurstCapture::dumpStep() {
+    bool ok = true;
+    for (size_t n = 0; n < kRowsPerDumpStep && dumpRemaining > 0; ++n) {
+        if (!storage->writeJSONLine(eventFile, timestamps[dumpNext], rowValues(dumpNext), columns, registers)) {
+            ok = false;
+            break;
+        }
+        dumpNext = (dumpNext + 1) % capacity;
+        dumpRemaining--;
+    }
+
+    if (!ok) {
+        Serial.println("[BurstCapture][ERROR] Event file write failed, event truncated.");
+        storage->logError(ErrorCode::FileWrite, "Burst event file write failed.");
+        dumpRemaining = 0;
+    }
+
+    if (dumpRemaining == 0) {
+        eventFile.close();
+        eventCount++;
+        filled = 0;     // Next event starts with a fresh pre-trigger window
+        holdoffStart = millis();
+        state = State::Holdoff;
+        Serial.printf("[BurstCapture] Event #%lu stored.\n", (unsigned long)eventCount);
+    }
+}
+
+/// <summary>
+/// Advances the capture state machine by one step.
+/// </summary>
+void BurstCapture::poll() {
+    if (!enabled) return;
+
+    switch (state) {
+        case State::Armed: {
+            size_t row = sampleRow();
+            const Rule* fired = checkTriggers(row);
+            if (fired) {
+                triggerMs = timestamps[row];
+                postRemaining = settings.postSamples;
+                state = State::Triggered;
+                Serial.printf("[BurstCapture] Trigger on '%s' (value %.3f).\n",
+                              registers[fired->column].key.c_str(), rowValues(row)[fired->column]);
+            }
+            break;
+        }
+
+        case State::Triggered:
+            if (postRemaining > 0) {
+                sampleRow();
+                postRemaining--;
+            }
+            if (postRemaining == 0) {
+                if (openEventFile()) {
+                    dumpNext = (head + capacity - filled) % capacity;
+                    dumpRemaining = filled;
+                    state = State::Dumping;
+                } else {
+                    filled = 0;
+                    holdoffStart = millis();
+                    state = State::Holdoff;
+                }
+            }
+            break;
+
+        case State::Dumping:
+            dumpStep();
+            break;
+
+        case State::Holdoff:
+            // Keep sampling so the pre-trigger window is full when re-armed
+            sampleRow();
+            if (millis() - holdoffStart >= settings.holdoffMs) {
+                state = State::Armed;
+            }
+            break;
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef BURST_CAPTURE_H
+#define BURST_CAPTURE_H
+
+#include <SD.h>
+#include <vector>
+#include "ConfigManager.h"
+#include "RtcManager.h"
+#include "StorageManager.h"
+#include "ModbusManager.h"
+
+/// <summary>
+/// Triggered high-rate capture of a small register subset.
+///
+/// Between slow logging cycles the burst registers are polled as fast as the
+/// bus allows into a RAM ring holding pre + post + 1 rows. When a trigger rule
+/// fires (threshold above/below, or |rate of change| per second above a limit),
+/// post-trigger rows are collected and the whole window is written to its own
+/// event file, a few rows per call, so the slow log keeps running alongside.
+///
+/// States: Armed → Triggered (collecting post rows) → Dumping → Holdoff → Armed.
+/// Fast polling pauses while an event is being dumped.
+/// </summary>
+class BurstCapture {
+public:
+    /// <summary>
+    /// Resolves the configured keys against the register list and allocates the ring.
+    /// </summary>
+    /// <param name="settings">Burst settings from the configuration</param>
+    /// <param name="allRegisters">Complete register list (burst keys must be in it)</param>
+    /// <returns>True if burst capture is enabled and ready</returns>
+    bool begin(const BurstSettings& settings, const std::vector<RegisterConfig>& allRegisters,
+               RtcManager* rtc, StorageManager* storage, ModbusManager* modbus);
+
+    /// <summary>
+    /// Returns true if burst capture is active.
+    /// </summary>
+    bool isEnabled() const { return enabled; }
+
+    /// <summary>
+    /// Returns true while an event is being collected or written to the card.
+    /// </summary>
+    bool isCapturing() const { return state == State::Triggered || state == State::Dumping; }
+
+    /// <summary>
+    /// Performs one step: a fast read with trigger evaluation, or part of an event dump.
+    /// Call on every loop() iteration.
+    /// </summary>
+    void poll();
+
+private:
+    enum class State : uint8_t { Armed, Triggered, Dumping, Holdoff };
+
+    /// <summary>
+    /// Trigger rule resolved to a column of the burst subset.
+    /// </summary>
+    struct Rule {
+        size_t column;
+        BurstTrigger::Kind kind;
+        float threshold;
+    };
+
+    static const size_t kRowsPerDumpStep = 32;   ///< Rows written to SD per poll()
+
+    /// <summary>
+    /// Reads the burst registers into the next ring row.
+    /// </summary>
+    /// <returns>Index of the written row</returns>
+    size_t sampleRow();
+
+    /// <summary>
+    /// Evaluates all trigger rules against the newest row.
+    /// </summary>
+    /// <returns>Rule that fired, or nullptr</returns>
+    const Rule* checkTriggers(size_t row) const;
+
+    /// <summary>
+    /// Opens the event file named after the trigger time.
+    /// </summary>
+    bool openEventFile();
+
+    /// <summary>
+    /// Writes the next block of rows to the event file, closes it when done.
+    /// </summary>
+    void dumpStep();
+
+    float* rowValues(size_t row) { return &values[row * columns]; }
+    const float* rowValues(size_t row) const { return &values[row * columns]; }
+
+    RtcManager* rtc = nullptr;
+    StorageManager* storage = nullptr;
+    ModbusManager* modbus = nullptr;
+
+    bool enabled = false;
+    BurstSettings settings;                 ///< Copy of the burst configuration
+    std::vector<RegisterConfig> registers;  ///< Burst register subset
+    std::vector<Rule> rules;                ///< Resolved trigger rules
+    size_t columns = 0;                     ///< Values per row
+
+    std::vector<int64_t> timestamps;        ///< Ring: sample time per row (epoch ms)
+    std::vector<float> values;              ///< Ring: row-major values
+    size_t capacity = 0;                    ///< Rows in the ring
+    size_t head = 0;                        ///< Next row to write
+    size_t filled = 0;                      ///< Valid rows in the ring
+
+    State state = State::Armed;
+    size_t postRemaining = 0;               ///< Rows still to collect after the trigger
+    int64_t triggerMs = 0;                  ///< Time of the triggering row
+    size_t dumpNext = 0;                    ///< Next row to write in Dumping state
+    size_t dumpRemaining = 0;               ///< Rows left to write
+    unsigned long holdoffStart = 0;         ///< millis() when the last event finished
+    File eventFile;                         ///< Open event file while dumping
+    uint32_t eventCount = 0;                ///< Events captured since boot
+};
+
+#endif // BURST_CAPTURE_H
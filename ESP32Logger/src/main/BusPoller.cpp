@@ -0,0 +1,144 @@
+#include "BusPoller.h"
+
+/// <summary>
+/// All buses at once, as at startup.
+/// </summary>
+void BusPoller::begin(ConfigManager* cfg) {
+    size_t count = prepare(cfg);
+    for (size_t b = 0; b < count; ++b) openBus(b);
+}
+
+/// <summary>
+/// Closes the buses beyond the configured count and resets the capture
+/// buffer; the configured buses stay as they are until openBus().
+/// </summary>
+size_t BusPoller::prepare(ConfigManager* cfg) {
+    config = cfg;
+    busCount = config->getBusCount();
+    if (busCount > ConfigManager::kMaxBuses) busCount = ConfigManager::kMaxBuses;
+    if (!done) done = xSemaphoreCreateCounting(ConfigManager::kMaxBuses, 0);
+    for (size_t b = busCount; b < ConfigManager::kMaxBuses; ++b) buses[b].end();
+
+    // Raw traffic capture: each bus records one cycle, the cycles wait here for the card
+    const CaptureSettings& capture = config->getCaptureSettings();
+    captureLimit = capture.enabled ? capture.bufferBytes : 0;
+    captured.clear();
+    captureDropped = 0;
+    if (captureLimit > 0) {
+        captured.reserve(captureLimit);
+        uint8_t header[RtuCapture::kHeaderSize];
+        RtuCapture::encodeHeader(header);
+        captured.insert(captured.end(), header, header + sizeof(header));
+    } else {
+        captured.shrink_to_fit();
+    }
+    Serial.printf("[BusPoller] %u bus(es), polled concurrently.\n", (unsigned)busCount);
+    return busCount;
+}
+
+/// <summary>
+/// Bus 0 runs in the caller, so a single-bus configuration creates no task.
+/// Bus tasks get the caller's priority and may run on either core.
+/// </summary>
+void BusPoller::openBus(size_t b) {
+    if (b >= busCount) return;
+    buses[b].begin(config->getModbusSettings(b), b);
+    buses[b].setConfig(config);
+    buses[b].setAddressOffset(config->isAddressOffsetEnabled());
+    buses[b].setCapture(captureLimit);
+
+    Worker& w = workers[b];
+    if (b == 0 || w.task) return;
+    w.owner = this;
+    w.bus = b;
+    char name[12];
+    snprintf(name, sizeof(name), "rs485-%u", (unsigned)b);
+    if (xTaskCreate(workerMain, name, kTaskStackBytes, &w, uxTaskPriorityGet(nullptr), &w.task) != pdPASS) {
+        w.task = nullptr;
+        Serial.printf("[BusPoller][ERROR] Cannot create the task of bus %u, it is read sequentially.\n", (unsigned)b);
+    }
+}
+
+void BusPoller::setTransformers(float vtr, float ctr) {
+    for (size_t b = 0; b < busCount; ++b) buses[b].setTransformers(vtr, ctr);
+}
+
+void BusPoller::workerMain(void* arg) {
+    Worker* w = static_cast<Worker*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        unsigned long startedUs = micros();
+        w->failed = w->owner->buses[w->bus].readAll(*w->owner->jobRegs, w->owner->jobOut, false);
+        w->elapsedUs = micros() - startedUs;
+        xSemaphoreGive(w->owner->done);
+    }
+}
+
+/// <summary>
+/// Starts the bus tasks, reads bus 0, then waits for every task. There is no
+/// timeout on the wait: each request is bounded by the master's response
+/// timeout, and a task must not write into the vector after we returned.
+/// </summary>
+uint32_t BusPoller::readAll(const std::vector<RegisterConfig>& regs, float* out, int64_t timestampMs) {
+    jobRegs = &regs;
+    jobOut = out;
+    if (captureLimit > 0) {
+        for (size_t b = 0; b < busCount; ++b) buses[b].getCapture().setRecording(true);
+    }
+
+    size_t started = 0;
+    for (size_t b = 1; b < busCount; ++b) {
+        if (!workers[b].task) continue;
+        xTaskNotifyGive(workers[b].task);
+        ++started;
+    }
+
+    unsigned long startedUs = micros();
+    uint32_t failed = buses[0].readAll(regs, out, true);
+    uint32_t busZeroUs = micros() - startedUs;
+
+    // Buses without a task (creation failed) are read here, after bus 0
+    for (size_t b = 1; b < busCount; ++b) {
+        if (workers[b].task) continue;
+        unsigned long sequentialUs = micros();
+        workers[b].failed = buses[b].readAll(regs, out, false);
+        workers[b].elapsedUs = micros() - sequentialUs;
+    }
+
+    for (size_t i = 0; i < started; ++i) {
+        xSemaphoreTake(done, portMAX_DELAY);
+    }
+    if (captureLimit > 0) collectCapture(timestampMs);
+
+    // Per-bus timing only in debug mode: the USB port may carry the binary live stream
+    bool verbose = config->isDebugEnabled();
+    for (size_t b = 1; b < busCount; ++b) {
+        failed += workers[b].failed;
+        if (verbose) Serial.printf("[BusPoller] Bus %u: %u register(s) in %.1f ms, %lu failed request(s) (bus 0: %.1f ms).\n",
+                                   (unsigned)b, (unsigned)config->getBusRegisterCount(b), workers[b].elapsedUs / 1000.0f,
+                                   (unsigned long)workers[b].failed, busZeroUs / 1000.0f);
+    }
+    return failed;
+}
+
+void BusPoller::collectCapture(int64_t timestampMs) {
+    size_t size = RtuCapture::kSampleSize;
+    bool complete = true;
+    for (size_t b = 0; b < busCount; ++b) {
+        CaptureTransport& capture = buses[b].getCapture();
+        capture.setRecording(false);
+        size += capture.size();
+        complete = complete && !capture.overflowed();
+    }
+
+    if (!complete || captured.size() + size > captureLimit) {
+        for (size_t b = 0; b < busCount; ++b) buses[b].getCapture().clear();
+        ++captureDropped;
+        return;
+    }
+
+    uint8_t sample[RtuCapture::kSampleSize];
+    RtuCapture::encodeSample(timestampMs, sample);
+    captured.insert(captured.end(), sample, sample + sizeof(sample));
+    for (size_t b = 0; b < busCount; ++b) buses[b].getCapture().take(captured);
+}
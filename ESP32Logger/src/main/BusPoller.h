@@ -0,0 +1,129 @@
+#ifndef BUS_POLLER_H
+#define BUS_POLLER_H
+
+#include <Arduino.h>
+#include "ConfigManager.h"
+#include "ModbusManager.h"
+
+/// <summary>
+/// Polls all RS485 buses of one sample at the same time.
+///
+/// Bus 0 is read in the calling task (with the usual debug output), every
+/// further bus by a FreeRTOS task of its own. readAll() wakes the bus tasks,
+/// reads bus 0 and returns once every bus is done, so all values of a sample
+/// are taken in the same window and share its timestamp; each bus writes only
+/// its own register range of the value vector. The cycle lasts as long as the
+/// slowest bus instead of the sum of all buses.
+///
+/// Bus tasks are created on the first begin() that needs them and kept across
+/// configuration reloads; between samples they sleep on a task notification.
+///
+/// With capture enabled every bus records its traffic during readAll(); the
+/// cycle is then appended to one capture buffer (sample record, then bus by
+/// bus) that the caller writes to the card in idle time.
+/// </summary>
+class BusPoller {
+public:
+    /// <summary>
+    /// Opens every configured bus and starts the missing bus tasks.
+    /// Buses no longer configured are closed. Not while readAll() runs.
+    /// </summary>
+    void begin(ConfigManager* config);
+
+    /// <summary>
+    /// First part of begin() for a caller that opens the buses one at a time
+    /// (configuration reload): closes the buses no longer configured and sets
+    /// up the capture buffer. Not while readAll() runs.
+    /// </summary>
+    /// <returns>Number of buses to open with openBus()</returns>
+    size_t prepare(ConfigManager* config);
+
+    /// <summary>
+    /// Opens one bus after prepare() and starts its task if it has none yet.
+    /// </summary>
+    void openBus(size_t bus);
+
+    /// <summary>
+    /// Number of open buses.
+    /// </summary>
+    size_t getBusCount() const { return busCount; }
+
+    /// <summary>
+    /// Modbus manager of a bus (bus 0 also serves discovery, transformer
+    /// reads, burst capture and the console).
+    /// </summary>
+    ModbusManager* getBus(size_t bus) { return &buses[bus]; }
+    const ModbusManager* getBus(size_t bus) const { return &buses[bus]; }
+
+    /// <summary>
+    /// Sets the transformer ratios on every bus.
+    /// </summary>
+    void setTransformers(float vtr, float ctr);
+
+    /// <summary>
+    /// Reads every bus concurrently into one value vector.
+    /// </summary>
+    /// <param name="regs">Configured registers (grouped by bus)</param>
+    /// <param name="out">regs.size() values; NAN where a read failed</param>
+    /// <param name="timestampMs">Sample time, recorded with the captured traffic</param>
+    /// <returns>Number of failed requests on all buses</returns>
+    uint32_t readAll(const std::vector<RegisterConfig>& regs, float* out, int64_t timestampMs);
+
+    /// <summary>
+    /// Captured records of complete cycles not written yet (RtuCapture format).
+    /// </summary>
+    const std::vector<uint8_t>& getCaptured() const { return captured; }
+
+    /// <summary>
+    /// Empties the capture buffer once it was written.
+    /// </summary>
+    void clearCaptured() { captured.clear(); }
+
+    /// <summary>
+    /// Capture buffer size (0 = capture disabled).
+    /// </summary>
+    size_t getCaptureLimit() const { return captureLimit; }
+
+    /// <summary>
+    /// Cycles left out of the capture because a buffer was full (since begin()).
+    /// </summary>
+    uint32_t getCaptureDropped() const { return captureDropped; }
+
+private:
+    /// <summary>
+    /// Bus task state.
+    /// </summary>
+    struct Worker {
+        BusPoller* owner = nullptr;
+        size_t bus = 0;
+        TaskHandle_t task = nullptr;
+        uint32_t failed = 0;        ///< Failed requests of the last read
+        uint32_t elapsedUs = 0;     ///< Duration of the last read
+    };
+
+    /// <summary>
+    /// Bus task: waits for a notification, reads its bus, reports completion.
+    /// </summary>
+    static void workerMain(void* arg);
+
+    /// <summary>
+    /// Stops recording and appends the cycle to the capture buffer, or drops
+    /// it entirely if it does not fit, so the file only holds whole cycles.
+    /// </summary>
+    void collectCapture(int64_t timestampMs);
+
+    static constexpr uint32_t kTaskStackBytes = 4096;
+
+    ConfigManager* config = nullptr;
+    ModbusManager buses[ConfigManager::kMaxBuses];
+    Worker workers[ConfigManager::kMaxBuses];
+    size_t busCount = 0;
+    SemaphoreHandle_t done = nullptr;                   ///< Given once per finished bus task
+    const std::vector<RegisterConfig>* jobRegs = nullptr; ///< Registers of the running read
+    float* jobOut = nullptr;                            ///< Value vector of the running read
+    size_t captureLimit = 0;                            ///< Capture buffer size per bus and for the cycles
+    std::vector<uint8_t> captured;                      ///< Complete cycles not written yet
+    uint32_t captureDropped = 0;                        ///< Cycles that did not fit
+};
+
+#endif // BUS_POLLER_H
@@ -0,0 +1,50 @@
+#include "BusTiming.h"
+
+namespace BusTiming {
+
+uint8_t bitsPerChar(const Line& line) {
+    return static_cast<uint8_t>(1 + line.dataBits + (line.parity == 'N' ? 0 : 1) + line.stopBits);
+}
+
+uint32_t charTimeUs(const Line& line) {
+    if (line.baud == 0) return 0;
+    return static_cast<uint32_t>((static_cast<uint64_t>(bitsPerChar(line)) * 1000000 + line.baud - 1) / line.baud);
+}
+
+uint32_t frameGapUs(const Line& line) {
+    if (line.baud > 19200) return 1750;
+    return (charTimeUs(line) * 7 + 1) / 2;
+}
+
+uint32_t frameUs(const Line& line, size_t bytes) {
+    return static_cast<uint32_t>(bytes) * charTimeUs(line) + frameGapUs(line);
+}
+
+uint32_t readTransactionUs(const Line& line, uint16_t count, uint32_t turnaroundUs) {
+    return frameUs(line, kReadRequestBytes) + turnaroundUs + frameUs(line, kReadResponseOverhead + 2u * count);
+}
+
+uint32_t turnaroundFromMeasured(const Line& line, uint16_t count, uint32_t elapsedUs) {
+    uint32_t wire = readTransactionUs(line, count, 0);
+    return elapsedUs > wire ? elapsedUs - wire : 0;
+}
+
+Estimate estimate(const Line& line, const RegisterMap::ReadPlan& plan, uint32_t turnaroundUs, uint32_t timeoutUs,
+                  uint32_t intervalMs) {
+    Estimate e;
+    uint64_t cycle = 0;
+    uint64_t worst = 0;
+    for (size_t i = 0; i < plan.blockCount; ++i) {
+        uint16_t count = plan.blocks[i].count;
+        e.bytes += static_cast<uint32_t>(kReadRequestBytes + kReadResponseOverhead + 2u * count);
+        cycle += readTransactionUs(line, count, turnaroundUs);
+        worst += frameUs(line, kReadRequestBytes) + timeoutUs;
+    }
+    e.transactions = static_cast<uint32_t>(plan.blockCount);
+    e.cycleUs = static_cast<uint32_t>(cycle > UINT32_MAX ? UINT32_MAX : cycle);
+    e.worstCaseUs = static_cast<uint32_t>(worst > UINT32_MAX ? UINT32_MAX : worst);
+    e.utilization = intervalMs ? static_cast<float>(cycle) / (intervalMs * 1000.0f) : 0.0f;
+    return e;
+}
+
+} // namespace BusTiming
@@ -0,0 +1,87 @@
+#ifndef BUS_TIMING_H
+#define BUS_TIMING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "RegisterMap.h"
+
+/// <summary>
+/// Wire-time model of Modbus RTU read transactions (function 0x03).
+/// This header has no Arduino dependencies.
+///
+/// One transaction = request frame + slave turnaround + response frame, each
+/// frame followed by the 3.5-character silence that ends an RTU frame
+/// (fixed 1750 us above 19200 baud, as the Modbus serial line spec recommends).
+/// A character is start bit + data bits + optional parity bit + stop bits.
+/// </summary>
+namespace BusTiming {
+
+constexpr size_t kReadRequestBytes = 8;        ///< Slave, function, start, count, CRC
+constexpr size_t kReadResponseOverhead = 5;    ///< Slave, function, byte count, CRC
+constexpr uint32_t kResponseTimeoutUs = 2000000;  ///< RtuMaster's default response timeout
+
+/// <summary>
+/// Serial line parameters.
+/// </summary>
+struct Line {
+    uint32_t baud;
+    uint8_t dataBits;
+    char parity;          ///< 'N', 'E' or 'O'
+    uint8_t stopBits;
+};
+
+/// <summary>
+/// Predicted cost of one poll cycle.
+/// </summary>
+struct Estimate {
+    uint32_t transactions = 0;   ///< Read requests per cycle
+    uint32_t bytes = 0;          ///< Request and response bytes per cycle
+    uint32_t cycleUs = 0;        ///< Nominal bus time per cycle
+    uint32_t worstCaseUs = 0;    ///< Bus time if every request runs into the response timeout
+    float utilization = 0.0f;    ///< cycleUs / interval
+};
+
+/// <summary>
+/// Bits per character on the wire.
+/// </summary>
+uint8_t bitsPerChar(const Line& line);
+
+/// <summary>
+/// Time of one character in microseconds.
+/// </summary>
+uint32_t charTimeUs(const Line& line);
+
+/// <summary>
+/// Silence that terminates a frame (3.5 characters, 1750 us above 19200 baud).
+/// </summary>
+uint32_t frameGapUs(const Line& line);
+
+/// <summary>
+/// Time to send a frame of the given size including the trailing silence.
+/// </summary>
+uint32_t frameUs(const Line& line, size_t bytes);
+
+/// <summary>
+/// Duration of one read of count registers.
+/// </summary>
+uint32_t readTransactionUs(const Line& line, uint16_t count, uint32_t turnaroundUs);
+
+/// <summary>
+/// Slave turnaround derived from a measured transaction duration (never negative).
+/// </summary>
+uint32_t turnaroundFromMeasured(const Line& line, uint16_t count, uint32_t elapsedUs);
+
+/// <summary>
+/// Evaluates the block reads of one poll cycle against the polling interval.
+/// </summary>
+/// <param name="line">Serial line parameters</param>
+/// <param name="plan">Block read plan of the cycle</param>
+/// <param name="turnaroundUs">Slave turnaround (configured or measured)</param>
+/// <param name="timeoutUs">Master's response timeout</param>
+/// <param name="intervalMs">Polling interval</param>
+Estimate estimate(const Line& line, const RegisterMap::ReadPlan& plan, uint32_t turnaroundUs, uint32_t timeoutUs,
+                  uint32_t intervalMs);
+
+} // namespace BusTiming
+
+#endif // BUS_TIMING_H
@@ -0,0 +1,43 @@
+#ifndef BUS_TRANSPORT_H
+#define BUS_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+/// Byte transport of one half-duplex RS485 bus, as seen by RtuMaster.
+/// On the logger it is a UART with a DE/RE pin (UartTransport), on a PC a
+/// serial device or pty (RTULogTools' SerialBus), so the same master code is
+/// exercised on both.
+/// This header has no Arduino dependencies.
+/// </summary>
+class BusTransport {
+public:
+    virtual ~BusTransport() {}
+
+    /// <summary>
+    /// Sends a frame and returns once it has left the line driver (the bus is
+    /// switched back to receive).
+    /// </summary>
+    /// <returns>False if not all bytes could be sent</returns>
+    virtual bool write(const uint8_t* data, size_t len) = 0;
+
+    /// <summary>
+    /// Waits for one received byte. May sleep (yield to other tasks) while waiting.
+    /// </summary>
+    /// <param name="timeoutUs">Longest wait</param>
+    /// <returns>The byte, or -1 on timeout</returns>
+    virtual int readByte(uint32_t timeoutUs) = 0;
+
+    /// <summary>
+    /// Drops everything received so far.
+    /// </summary>
+    virtual void discardInput() = 0;
+
+    /// <summary>
+    /// Monotonic clock in microseconds (wraps).
+    /// </summary>
+    virtual uint32_t nowUs() = 0;
+};
+
+#endif // BUS_TRANSPORT_H
@@ -0,0 +1,83 @@
+#include "CaptureTransport.h"
+#include <string.h>
+
+void CaptureTransport::begin(BusTransport* t, uint8_t index, size_t bufferBytes) {
+    inner = t;
+    bus = index;
+    limit = bufferBytes;
+    recording = false;
+    overflow = false;
+    open = false;
+    buffer.clear();
+    if (limit == 0) {
+        buffer.shrink_to_fit();
+    } else {
+        buffer.reserve(limit);
+    }
+}
+
+void CaptureTransport::setRecording(bool enabled) {
+    if (!enabled) close();
+    recording = enabled && limit > 0;
+}
+
+void CaptureTransport::take(std::vector<uint8_t>& out) {
+    out.insert(out.end(), buffer.begin(), buffer.end());
+    clear();
+}
+
+void CaptureTransport::clear() {
+    buffer.clear();
+    overflow = false;
+}
+
+/// <summary>
+/// The clock is read after the inner write returned, i.e. once the frame has
+/// left the driver, which is where the master starts its response timeout.
+/// </summary>
+bool CaptureTransport::write(const uint8_t* data, size_t len) {
+    bool sent = inner->write(data, len);
+    if (!recording) return sent;
+
+    close();
+    current.bus = bus;
+    current.requestUs = inner->nowUs();
+    current.firstUs = 0;
+    current.lastUs = 0;
+    current.requestLength = static_cast<uint8_t>(len < RtuCapture::kMaxFrame ? len : RtuCapture::kMaxFrame);
+    current.responseLength = 0;
+    memcpy(request, data, current.requestLength);
+    open = true;
+    return sent;
+}
+
+int CaptureTransport::readByte(uint32_t timeoutUs) {
+    int c = inner->readByte(timeoutUs);
+    if (c >= 0 && open && current.responseLength < RtuCapture::kMaxFrame) {
+        uint32_t atUs = inner->nowUs() - current.requestUs;
+        if (current.responseLength == 0) current.firstUs = atUs;
+        current.lastUs = atUs;
+        response[current.responseLength++] = static_cast<uint8_t>(c);
+    }
+    return c;
+}
+
+void CaptureTransport::discardInput() {
+    inner->discardInput();
+    close();
+}
+
+void CaptureTransport::close() {
+    if (!open) return;
+    open = false;
+    size_t size = RtuCapture::transactionSize(current.requestLength, current.responseLength);
+    if (buffer.size() + size > limit) {
+        overflow = true;
+        return;
+    }
+    current.request = request;
+    current.response = response;
+    size_t at = buffer.size();
+    buffer.resize(at + size);   // Within the reservation, no allocation
+    RtuCapture::encodeTransaction(current, buffer.data() + at);
+}
@@ -0,0 +1,80 @@
+#ifndef CAPTURE_TRANSPORT_H
+#define CAPTURE_TRANSPORT_H
+
+#include "BusTransport.h"
+#include "RtuCapture.h"
+#include <vector>
+
+/// <summary>
+/// Transport decorator that records the traffic of a bus as RtuCapture
+/// transaction records while passing every call through unchanged.
+///
+/// A transaction opens with write() and collects every byte readByte()
+/// returns until the next write() or discardInput(), with the arrival time
+/// of the first and last byte; bytes the master never reads are not seen.
+/// Records go to a buffer reserved by begin(), so recording allocates
+/// nothing; a record that does not fit is dropped and marks the buffer as
+/// overflowed. The owner collects the buffer between requests (take()).
+/// This header has no Arduino dependencies.
+/// </summary>
+class CaptureTransport : public BusTransport {
+public:
+    /// <summary>
+    /// Wraps a transport. Recording starts switched off.
+    /// </summary>
+    /// <param name="inner">Transport that carries the traffic</param>
+    /// <param name="bus">Bus index written into the records</param>
+    /// <param name="bufferBytes">Record buffer to reserve (0 = never record)</param>
+    void begin(BusTransport* inner, uint8_t bus, size_t bufferBytes);
+
+    /// <summary>
+    /// Switches recording on or off. Switching off closes the open transaction.
+    /// </summary>
+    void setRecording(bool enabled);
+
+    bool isRecording() const { return recording; }
+
+    /// <summary>
+    /// Appends the recorded bytes to out and empties the buffer (its
+    /// reservation is kept). Switch recording off first, so the open
+    /// transaction is included.
+    /// </summary>
+    void take(std::vector<uint8_t>& out);
+
+    /// <summary>
+    /// Drops the recorded bytes and the overflow mark.
+    /// </summary>
+    void clear();
+
+    /// <summary>
+    /// Recorded bytes not taken yet (open transaction excluded).
+    /// </summary>
+    size_t size() const { return buffer.size(); }
+
+    /// <summary>
+    /// True if a record was dropped since the last take() or clear().
+    /// </summary>
+    bool overflowed() const { return overflow; }
+
+    bool write(const uint8_t* data, size_t len) override;
+    int readByte(uint32_t timeoutUs) override;
+    void discardInput() override;
+    uint32_t nowUs() override { return inner ? inner->nowUs() : 0; }
+
+private:
+    void close();
+
+    BusTransport* inner = nullptr;
+    uint8_t bus = 0;
+    size_t limit = 0;                    ///< Reserved buffer size
+    bool recording = false;
+    bool overflow = false;               ///< A record was dropped since take()
+    std::vector<uint8_t> buffer;         ///< Encoded records
+
+    bool open = false;                   ///< A transaction is being collected
+    RtuCapture::Transaction current;
+    uint8_t request[RtuCapture::kMaxFrame];
+    uint8_t response[RtuCapture::kMaxFrame];
+};
+
+#endif // CAPTURE_TRANSPORT_H
@@ -1,4 +1,49 @@
 #include "ConfigManager.h"
+#include "LogFrame.h"
+#include "Trace.h"
+#include <algorithm>
+
+// Flash-resident register map generated by rtulog-regmap (optional)
+#if defined(__has_include)
+#if __has_include("CompiledConfig.h")
+#include "CompiledConfig.h"
+#define HAS_COMPILED_CONFIG 1
+#endif
+#endif
+
+/// <summary>
+/// CRC32 of the whole file, compared with the CRC the compiled map was generated from.
+/// </summary>
+static uint32_t fileCrc(File& file) {
+    uint8_t buf[256];
+    uint32_t crc = 0;
+    size_t n;
+    while ((n = file.read(buf, sizeof(buf))) > 0) {
+        crc = LogFrame::crc32(buf, n, crc);
+    }
+    return crc;
+}
+
+/// <summary>
+/// Reads the line and UART settings of one bus ("communication" or an entry of "buses").
+/// </summary>
+static void parseBusSettings(JsonObject obj, ModbusSettings& s, uint8_t defaultUart, int8_t defaultRx,
+                             int8_t defaultTx, int8_t defaultDeRe) {
+    s.slave_id = obj["modbus_id"] | 1;
+    s.baudrate = obj["baudrate"] | 9600;
+    String parityStr = obj["parity"] | "N";
+    s.parity = parityStr.charAt(0);
+    s.stop_bits = obj["stop_bits"] | 1;
+    s.data_bits = obj["data_bits"] | 8;
+
+    // Slave response delay assumed by the schedule check until it has been measured
+    s.turnaround_us = (obj["turnaround_ms"] | 10.0f) * 1000.0f;
+
+    s.uart = obj["uart"] | defaultUart;
+    s.rx_pin = obj["rx_pin"] | defaultRx;
+    s.tx_pin = obj["tx_pin"] | defaultTx;
+    s.de_re_pin = obj["de_re_pin"] | defaultDeRe;
+}
 
 /// <summary>
 /// Returns the configured polling interval in milliseconds.
@@ -45,38 +90,77 @@ bool ConfigManager::isDebugEnabled() {
 /// <summary>
 /// Loads configuration from "/config/config.json" on the SD card.
 /// Initializes communication settings, polling interval, transformer ratios,
-/// Modbus register definitions, and logging configuration.
+/// Modbus register definitions, and logging configuration. Without the file
+/// (compiled map builds) every section takes its defaults, bus 0 and the
+/// transformers the compiled map's values.
 /// </summary>
 void ConfigManager::load() {
+    TRACE_SCOPE("config.load", 0);
     Serial.println("[ConfigManager] Attempting to open /config/config.json...");
+    validRanges.clear();  // Discovery runs again for the (possibly different) device
 
     File file = SD.open("/config/config.json", FILE_READ);
+    bool useCompiled = false;
+    bool compiledOnly = false;      // No file: compiled map, every other section at its default
+
+#ifdef HAS_COMPILED_CONFIG
+    if (!file) {
+        Serial.println("[ConfigManager][WARN] config.json not found, using the compiled register map and default settings.");
+        if (storage) storage->logError(ErrorCode::Config, "Config load failed: cannot open config.json, compiled map used");
+        useCompiled = compiledOnly = true;
+    } else {
+        uint32_t crc = fileCrc(file);
+        file.seek(0);
+        useCompiled = (crc == CompiledConfig::kSourceCrc);
+        if (useCompiled) {
+            Serial.println("[ConfigManager] config.json matches the compiled register map, register list skipped.");
+        } else {
+            Serial.printf("[ConfigManager] config.json differs from the compiled register map (CRC %08lX, map %08lX) → using the card's registers.\n",
+                          (unsigned long)crc, (unsigned long)CompiledConfig::kSourceCrc);
+        }
+    }
+#else
     if (!file) {
         Serial.println("[ConfigManager][ERROR] Failed to open config.json!");
-        if (storage) storage->logError("Config load failed: cannot open config.json");
+        if (storage) storage->logError(ErrorCode::Config, "Config load failed: cannot open config.json");
         return;
     }
+#endif
 
-    Serial.println("[ConfigManager] config.json opened successfully.");
-
-    const size_t capacity = 8192;
-    DynamicJsonDocument doc(capacity);
+    // Without the register list the rest of the file fits a much smaller document.
+    // Without a file the document stays empty, so every section below takes its
+    // defaults and nothing of the previous load survives a reload.
+    DynamicJsonDocument doc(compiledOnly ? 64 : useCompiled ? 2048 : 8192);
+    if (!compiledOnly) {
+        Serial.println("[ConfigManager] config.json opened successfully.");
 
-    DeserializationError error = deserializeJson(doc, file);
-    file.close(); // Important: close file after deserialization
+        DeserializationError error;
+        if (useCompiled) {
+            StaticJsonDocument<64> filter;
+            filter["*"] = true;
+            filter["registers"] = false;
+            error = deserializeJson(doc, file, DeserializationOption::Filter(filter));
+        } else {
+            error = deserializeJson(doc, file);
+        }
+        file.close(); // Important: close file after deserialization
 
-    if (error) {
-        Serial.println("[ConfigManager][ERROR] JSON deserialization failed:");
-        Serial.println(error.c_str());
-        if (storage) {
-            String msg = "Config load failed: invalid JSON format - ";
-            msg += error.c_str();
-            storage->logError(msg);
+        if (error) {
+            Serial.println("[ConfigManager][ERROR] JSON deserialization failed:");
+            Serial.println(error.c_str());
+            if (storage) {
+                String msg = "Config load failed: invalid JSON format - ";
+                msg += error.c_str();
+                storage->logError(ErrorCode::Config, msg);
+            }
+            return;
         }
-        return;
+
+        Serial.println("[ConfigManager] JSON deserialized successfully.");
     }
 
-    Serial.println("[ConfigManager] JSON deserialized successfully.");
+    // Device model (names the cached discovery map)
+    deviceName = doc["device"] | "";
 
     // Debug flag
     debugEnabled = doc["debug"] | false;
@@ -86,25 +170,55 @@ void ConfigManager::load() {
     pollingInterval = doc["logging"]["interval_ms"] | 1000;
     Serial.printf("[ConfigManager] Polling interval set to %lu ms.\n", pollingInterval);
 
-    // Modbus communication settings
+    // Flush interval for staged samples
+    flushInterval = doc["logging"]["flush_interval_ms"] | 0;
+    Serial.printf("[ConfigManager] Flush interval set to %lu ms.\n", flushInterval);
+
+    // Modbus communication settings (bus 0, UART1 on the original pins)
     JsonObject comm = doc["communication"];
-    modbusSettings.slave_id = comm["modbus_id"] | 1;
-    modbusSettings.baudrate = comm["baudrate"] | 9600;
-    String parityStr = comm["parity"] | "N";
-    modbusSettings.parity = parityStr.charAt(0);
-    modbusSettings.stop_bits = comm["stop_bits"] | 1;
-    modbusSettings.data_bits = comm["data_bits"] | 8;
+    buses.assign(1, Bus());
+    parseBusSettings(comm, buses[0].settings, 1, 17, 16, 4);
 
     // Addressing mode
     String addrMode = comm["addressing_mode"] | "0-based";
     addressOffsetEnabled = (addrMode == "1-based");
 
+    // Unused registers a block read may span (0 = only merge adjacent registers)
+    maxBlockGap = comm["max_block_gap"] | 0;
+
+    // Further RS485 buses (optional), each on its own UART and polled by its own task
+    for (JsonObject extra : doc["buses"].as<JsonArray>()) {
+        if (buses.size() == kMaxBuses) {
+            Serial.printf("[ConfigManager][WARN] At most %u buses are supported, further entries ignored.\n",
+                          (unsigned)kMaxBuses);
+            if (storage) storage->logError(ErrorCode::Config, "Too many buses configured, extra entries ignored.");
+            break;
+        }
+        Bus bus;
+        parseBusSettings(extra, bus.settings, 2, 25, 26, 27);
+        buses.push_back(bus);
+    }
+
+    // Each bus needs a UART of its own; a bus without one stays closed (its values are NAN)
+    for (size_t b = 0; b < buses.size(); ++b) {
+        ModbusSettings& mb = buses[b].settings;
+        bool shared = false;
+        for (size_t o = 0; o < b; ++o) shared |= buses[o].settings.uart == mb.uart;
+        if (mb.uart < 1 || mb.uart > 2 || shared) {
+            Serial.printf("[ConfigManager][ERROR] Bus %u: UART%u is %s, bus disabled.\n", (unsigned)b, mb.uart,
+                          shared ? "used by another bus" : "not available (use 1 or 2)");
+            if (storage) storage->logError(ErrorCode::Config, "Bus disabled: invalid or shared UART.");
+            mb.uart = 0;
+        }
+    }
+
     Serial.printf("[ConfigManager] Modbus settings loaded:\n");
-    Serial.printf("  - Slave ID: %d\n", modbusSettings.slave_id);
-    Serial.printf("  - Baudrate: %ld\n", modbusSettings.baudrate);
-    Serial.printf("  - Parity: %c\n", modbusSettings.parity);
-    Serial.printf("  - Stop bits: %d\n", modbusSettings.stop_bits);
-    Serial.printf("  - Data bits: %d\n", modbusSettings.data_bits);
+    for (size_t b = 0; b < buses.size(); ++b) {
+        const ModbusSettings& mb = buses[b].settings;
+        Serial.printf("  - Bus %u: UART%u (RX %d, TX %d, DE/RE %d), slave ID %d, %ld baud, %d%c%d\n",
+                      (unsigned)b, mb.uart, mb.rx_pin, mb.tx_pin, mb.de_re_pin, mb.slave_id,
+                      mb.baudrate, mb.data_bits, mb.parity, mb.stop_bits);
+    }
     Serial.printf("[ConfigManager] Addressing mode: %s (offset %s)\n", addrMode.c_str(), addressOffsetEnabled ? "-1" : "0");
 
     // Transformer ratios and optional register mapping
@@ -117,64 +231,476 @@ void ConfigManager::load() {
     Serial.printf("[ConfigManager] Transformer register addresses: VTR=%u, CTR=%u\n", vtrRegister, ctrRegister);
 
     // Register definitions
-    if (!doc.containsKey("registers")) {
+    if (useCompiled) {
+        loadCompiled(!compiledOnly);    // Without a file the bus 0 and transformer settings come from the map too
+    } else if (!doc.containsKey("registers")) {
         Serial.println("[ConfigManager][ERROR] Missing 'registers' key in JSON.");
         return;
+    } else {
+        JsonArray regs = doc["registers"];
+        Serial.printf("[ConfigManager] Found %d register(s).\n", regs.size());
+        registers.clear();
+        compiledMap = false;
+
+        for (JsonObject reg : regs) {
+            RegisterConfig r;
+            r.key = reg["key"].as<String>();
+            r.name = reg["name"].as<String>();
+            r.description = reg["description"].as<String>();
+            r.register_address = reg["register"] | 0;
+            r.type = reg["type"] | "UINT16";
+            r.unit = reg["unit"].as<String>();
+            r.scaling = reg["scaling"].as<String>();
+            r.access = reg["access"].as<String>();
+            r.length = reg["length"] | 1;
+            r.bus = reg["bus"] | 0;
+
+            if (r.bus >= buses.size()) {
+                Serial.printf("[ConfigManager][ERROR] Register '%s' is on bus %u, which is not configured; ignored.\n",
+                              r.key.c_str(), r.bus);
+                if (storage) storage->logError(ErrorCode::Config, "Register on an unconfigured bus ignored: " + r.key);
+                continue;
+            }
+
+            if (!RegisterMap::parseType(r.type.c_str(), r.dataType)) {
+                Serial.printf("[ConfigManager][WARN] Register '%s' has unknown type '%s', read as UINT16.\n",
+                              r.key.c_str(), r.type.c_str());
+                if (storage) storage->logError(ErrorCode::Config, "Unknown register type, read as UINT16: " + r.key);
+            }
+            if (r.length < RegisterMap::wordCount(r.dataType)) r.length = RegisterMap::wordCount(r.dataType);
+            if (!r.scale.compile(r.scaling.c_str())) {
+                Serial.printf("[ConfigManager][WARN] Register '%s' has an invalid scaling expression '%s', values will be NAN.\n",
+                              r.key.c_str(), r.scaling.c_str());
+                if (storage) storage->logError(ErrorCode::Config, "Invalid scaling expression: " + r.key);
+            }
+            registers.push_back(r);
+
+            Serial.printf("  - [%s] %s @ %d (%s) bus %u, scaling: %s\n",
+                          r.key.c_str(), r.name.c_str(),
+                          r.register_address, r.type.c_str(), r.bus,
+                          r.scaling.c_str());
+        }
     }
+    assignBuses();
+    buildReadPlan();
 
-    JsonArray regs = doc["registers"];
-    Serial.printf("[ConfigManager] Found %d register(s).\n", regs.size());
-    registers.clear();
+    // Derived channels (optional), computed from the registers of each sample
+    buildChannels(doc["derived"]);
 
-    for (JsonObject reg : regs) {
-        RegisterConfig r;
-        r.key = reg["key"].as<String>();
-        r.name = reg["name"].as<String>();
-        r.description = reg["description"].as<String>();
-        r.register_address = reg["register"] | 0;
-        r.type = reg["type"].as<String>();
-        r.unit = reg["unit"].as<String>();
-        r.scaling = reg["scaling"].as<String>();
-        r.access = reg["access"].as<String>();
-        r.length = reg["length"] | 1;
-        registers.push_back(r);
+    // Alarm rules (optional), checked on every sample after the derived channels
+    buildAlarms(doc["alarms"]);
+
+    // Burst capture (optional)
+    burstSettings = BurstSettings();
+    JsonObject burst = doc["burst"];
+    if (!burst.isNull()) {
+        burstSettings.enabled = burst["enabled"] | false;
+        burstSettings.preSamples = burst["pre_samples"] | 200;
+        burstSettings.postSamples = burst["post_samples"] | 200;
+        burstSettings.holdoffMs = burst["holdoff_ms"] | 10000UL;
+        burstSettings.eventFolder = burst["event_folder"] | "/events/";
+
+        for (JsonVariant key : burst["registers"].as<JsonArray>()) {
+            burstSettings.keys.push_back(key.as<String>());
+        }
+
+        for (JsonObject rule : burst["triggers"].as<JsonArray>()) {
+            BurstTrigger t;
+            t.key = rule["key"].as<String>();
+            if (rule.containsKey("above")) {
+                t.kind = BurstTrigger::Kind::Above;
+                t.threshold = rule["above"].as<float>();
+            } else if (rule.containsKey("below")) {
+                t.kind = BurstTrigger::Kind::Below;
+                t.threshold = rule["below"].as<float>();
+            } else if (rule.containsKey("rate_above")) {
+                t.kind = BurstTrigger::Kind::RateAbove;
+                t.threshold = rule["rate_above"].as<float>();
+            } else {
+                Serial.printf("[ConfigManager][WARN] Burst trigger on '%s' has no condition, ignored.\n", t.key.c_str());
+                if (storage) storage->logError(ErrorCode::Config, "Burst trigger without above/below/rate_above ignored.");
+                continue;
+            }
+            burstSettings.triggers.push_back(t);
+        }
+
+        Serial.printf("[ConfigManager] Burst capture: %s, %u register(s), %u trigger(s), %u pre / %u post samples\n",
+                      burstSettings.enabled ? "enabled" : "disabled",
+                      (unsigned)burstSettings.keys.size(), (unsigned)burstSettings.triggers.size(),
+                      burstSettings.preSamples, burstSettings.postSamples);
+    }
+
+    // Live stream on the USB serial port (optional)
+    streamSettings = StreamSettings();
+    JsonObject stream = doc["stream"];
+    if (!stream.isNull()) {
+        streamSettings.enabled = stream["enabled"] | false;
+        streamSettings.schemaIntervalMs = stream["schema_interval_ms"] | 10000UL;
+        Serial.printf("[ConfigManager] Live stream: %s\n", streamSettings.enabled ? "enabled" : "disabled");
+    }
+
+    // Recent history in RAM (on unless disabled)
+    historySettings = HistorySettings();
+    JsonObject history = doc["history"];
+    if (!history.isNull()) {
+        historySettings.enabled = history["enabled"] | true;
+        historySettings.minutes = history["minutes"] | 15UL;
+        historySettings.ramBytes = (history["ram_kb"] | 32UL) * 1024UL;
+    }
+    Serial.printf("[ConfigManager] Recent history: %s, %lu min, up to %lu KB RAM\n",
+                  historySettings.enabled ? "enabled" : "disabled", (unsigned long)historySettings.minutes,
+                  (unsigned long)(historySettings.ramBytes / 1024));
+
+    // Raw RTU traffic capture (optional)
+    captureSettings = CaptureSettings();
+    JsonObject capture = doc["capture"];
+    if (!capture.isNull()) {
+        captureSettings.enabled = capture["enabled"] | false;
+        captureSettings.file = capture["file"] | "/capture.rtucap";
+        captureSettings.bufferBytes = (capture["buffer_kb"] | 16UL) * 1024UL;
+        Serial.printf("[ConfigManager] RTU capture: %s, %s, %lu KB buffer\n",
+                      captureSettings.enabled ? "enabled" : "disabled", captureSettings.file.c_str(),
+                      (unsigned long)(captureSettings.bufferBytes / 1024));
+    }
 
-        Serial.printf("  - [%s] %s @ %d (%s), scaling: %s\n",
-                      r.key.c_str(), r.name.c_str(),
-                      r.register_address, r.type.c_str(),
-                      r.scaling.c_str());
+    // Register map discovery (optional)
+    discoverySettings = DiscoverySettings();
+    JsonObject discovery = doc["discovery"];
+    if (!discovery.isNull()) {
+        discoverySettings.enabled = discovery["enabled"] | false;
+        discoverySettings.first = discovery["first"] | 0;
+        discoverySettings.last = discovery["last"] | 0;
+        discoverySettings.rescan = discovery["rescan"] | false;
+        if (discoverySettings.last < discoverySettings.first) {
+            Serial.println("[ConfigManager][WARN] Discovery range is empty (last < first), discovery disabled.");
+            discoverySettings.enabled = false;
+        }
+        Serial.printf("[ConfigManager] Register discovery: %s (%u..%u)\n",
+                      discoverySettings.enabled ? "enabled" : "disabled", discoverySettings.first, discoverySettings.last);
+    }
+
+    // SD card retention (on unless disabled)
+    retentionSettings = RetentionSettings();
+    JsonObject retention = doc["retention"];
+    if (!retention.isNull()) {
+        retentionSettings.enabled = retention["enabled"] | true;
+        retentionSettings.highWatermark = retention["high_watermark"] | 90;
+        retentionSettings.lowWatermark = retention["low_watermark"] | 80;
+        retentionSettings.checkIntervalMs = (retention["check_interval_s"] | 300UL) * 1000UL;
+        if (retentionSettings.highWatermark > 99 || retentionSettings.lowWatermark >= retentionSettings.highWatermark) {
+            Serial.println("[ConfigManager][WARN] Retention watermarks invalid, using 90 % / 80 %.");
+            if (storage) storage->logError(ErrorCode::Config, "Invalid retention watermarks, defaults used.");
+            retentionSettings.highWatermark = 90;
+            retentionSettings.lowWatermark = 80;
+        }
+    }
+    Serial.printf("[ConfigManager] Retention: %s, delete from %u %% down to %u %% card usage\n",
+                  retentionSettings.enabled ? "enabled" : "disabled",
+                  retentionSettings.highWatermark, retentionSettings.lowWatermark);
+
+    // Compression of closed day files (optional)
+    compressionSettings = CompressionSettings();
+    JsonObject compression = doc["compression"];
+    if (!compression.isNull()) {
+        compressionSettings.enabled = compression["enabled"] | false;
+        compressionSettings.delayMs = (compression["delay_s"] | 600UL) * 1000UL;
+        Serial.printf("[ConfigManager] Day file compression: %s, %lu s after the day ends\n",
+                      compressionSettings.enabled ? "enabled" : "disabled",
+                      compressionSettings.delayMs / 1000);
     }
 
     // Logging configuration
+    JsonObject log = doc["logging"];
+    outputFolder = log["output_folder"] | "/";
+    filenameFormat = log["filename_format"] | "data_%Y%m%d.csv";
     if (storage) {
-        JsonObject log = doc["logging"];
-        String folder = log["output_folder"] | "/";
-        String format = log["filename_format"] | "data_%Y%m%d.csv";
+        const String& folder = outputFolder;
+        const String& format = filenameFormat;
         bool enabled = log["enabled"] | true;
         bool withHeader = log["include_header"] | true;
+        bool framed = log["framed"] | false;
+        bool sharded = log["shard_folders"] | true;
 
         Serial.println("[ConfigManager] Logging configuration:");
         Serial.printf("  - Folder: %s\n", folder.c_str());
         Serial.printf("  - Filename format: %s\n", format.c_str());
         Serial.printf("  - Enabled: %s\n", enabled ? "true" : "false");
         Serial.printf("  - Include header: %s\n", withHeader ? "true" : "false");
+        Serial.printf("  - Framed records: %s\n", framed ? "true" : "false");
+        Serial.printf("  - Monthly folders: %s\n", sharded ? "true" : "false");
+        storage->setSharding(sharded);
+
+        uint32_t indexInterval = log["index_interval_ms"] | TimeIndex::kDefaultIntervalMs;
+        Serial.printf("  - Time index interval: %lu ms\n", (unsigned long)indexInterval);
+        storage->setIndexInterval(indexInterval);
 
-        storage->configure(folder, format, enabled, withHeader);
+        storage->configure(folder, format, enabled, withHeader, framed);
+
+        unsigned long errorSummary = log["error_summary_interval_ms"] | 600000UL;
+        Serial.printf("  - Error summary interval: %lu ms\n", errorSummary);
+        storage->setErrorSummaryInterval(errorSummary);
+
+        // Sub-second sampling needs millisecond timestamps
+        bool timestampMillis = log["timestamp_millis"] | (pollingInterval < 1000);
+        Serial.printf("  - Millisecond timestamps: %s\n", timestampMillis ? "true" : "false");
+        storage->setTimestampMillis(timestampMillis);
     }
 
     Serial.println("[ConfigManager] Configuration loaded successfully.");
 }
 
 /// <summary>
-/// Returns the configured Modbus communication settings.
+/// Returns the list of Modbus register configurations loaded from JSON.
+/// </summary>
+const std::vector<RegisterConfig>& ConfigManager::getRegisters() const {
+    return registers;
+}
+
+/// <summary>
+/// Copies the compiled register table into the register list. Only key, unit,
+/// address, type and the generated scaling function are kept; names,
+/// descriptions and formula text are not needed at runtime.
 /// </summary>
-ModbusSettings ConfigManager::getModbusSettings() {
-    return modbusSettings;
+void ConfigManager::loadCompiled(bool registersOnly) {
+#ifdef HAS_COMPILED_CONFIG
+    if (!registersOnly) {
+        ModbusSettings& modbusSettings = buses[0].settings;
+        modbusSettings.slave_id = CompiledConfig::kSlaveId;
+        modbusSettings.baudrate = CompiledConfig::kBaudrate;
+        modbusSettings.parity = CompiledConfig::kParity;
+        modbusSettings.stop_bits = CompiledConfig::kStopBits;
+        modbusSettings.data_bits = CompiledConfig::kDataBits;
+        addressOffsetEnabled = CompiledConfig::kAddressOffset;
+        transformerVTR = CompiledConfig::kVTR;
+        transformerCTR = CompiledConfig::kCTR;
+        vtrRegister = CompiledConfig::kVTRRegister;
+        ctrRegister = CompiledConfig::kCTRRegister;
+        Serial.printf("[ConfigManager] Bus 0 and transformers from the compiled map: slave ID %d, %ld baud, VTR=%.2f, CTR=%.2f\n",
+                      modbusSettings.slave_id, modbusSettings.baudrate, transformerVTR, transformerCTR);
+    }
+
+    registers.clear();
+    registers.reserve(CompiledConfig::kRegisterCount);
+    for (const RegisterMap::Register& cr : CompiledConfig::kRegisters) {
+        RegisterConfig r;
+        r.key = cr.key;
+        r.unit = cr.unit;
+        r.register_address = cr.address;
+        r.dataType = cr.type;
+        r.length = RegisterMap::wordCount(cr.type);
+        r.scaleFn = cr.scale;
+        registers.push_back(r);
+    }
+    compiledMap = true;
+    Serial.printf("[ConfigManager] %u register(s) loaded from the compiled map.\n", (unsigned)registers.size());
+    if (buses.size() > 1) {
+        Serial.println("[ConfigManager][WARN] The compiled register map only covers bus 0, further buses poll nothing.");
+    }
+#else
+    (void)registersOnly;
+#endif
 }
 
 /// <summary>
-/// Returns the list of Modbus register configurations loaded from JSON.
+/// Stable-sorts the registers by bus, so every bus reads one contiguous range
+/// and keeps the configured order within it.
 /// </summary>
-std::vector<RegisterConfig> ConfigManager::getRegisters() {
-    return registers;
+void ConfigManager::assignBuses() {
+    std::stable_sort(registers.begin(), registers.end(),
+                     [](const RegisterConfig& a, const RegisterConfig& b) { return a.bus < b.bus; });
+    for (size_t b = 0; b < buses.size(); ++b) {
+        buses[b].firstRegister = 0;
+        buses[b].registerCount = 0;
+    }
+    for (size_t i = registers.size(); i-- > 0;) {
+        Bus& bus = buses[registers[i].bus];
+        bus.firstRegister = static_cast<uint16_t>(i);
+        ++bus.registerCount;
+    }
+}
+
+/// <summary>
+/// Uses the generated block tables with the compiled map (bus 0), otherwise
+/// plans block reads for each bus's JSON registers with the configured
+/// max_block_gap. Discovered ranges apply to bus 0, where discovery runs.
+/// </summary>
+void ConfigManager::buildReadPlan() {
+    for (size_t b = 0; b < buses.size(); ++b) {
+        Bus& bus = buses[b];
+#ifdef HAS_COMPILED_CONFIG
+        if (compiledMap && b == 0) {
+            bus.readPlan.blocks = CompiledConfig::kBlocks;
+            bus.readPlan.blockCount = CompiledConfig::kBlockCount;
+            bus.readPlan.slots = CompiledConfig::kSlots;
+            bus.readPlan.slotCount = CompiledConfig::kSlotCount;
+            Serial.printf("[ConfigManager] Read plan bus 0: %u register(s) in %u block read(s) (compiled, max gap %u).\n",
+                          (unsigned)bus.registerCount, (unsigned)bus.readPlan.blockCount,
+                          (unsigned)CompiledConfig::kMaxBlockGap);
+            checkSchedule(b, bus.settings.turnaround_us, false, true);
+            continue;
+        }
+#endif
+        std::vector<RegisterMap::Span> spans;
+        spans.reserve(bus.registerCount);
+        for (uint16_t i = 0; i < bus.registerCount; ++i) {
+            const RegisterConfig& r = registers[bus.firstRegister + i];
+            spans.push_back({r.register_address, r.length});
+        }
+        bool discovered = b == 0 && !validRanges.empty();
+        RegisterMap::plan(spans, maxBlockGap, bus.planBlocks, bus.planSlots, discovered ? &validRanges : nullptr);
+        bus.readPlan.blocks = bus.planBlocks.data();
+        bus.readPlan.blockCount = bus.planBlocks.size();
+        bus.readPlan.slots = bus.planSlots.data();
+        bus.readPlan.slotCount = bus.planSlots.size();
+        Serial.printf("[ConfigManager] Read plan bus %u: %u register(s) in %u block read(s) (max gap %u).\n",
+                      (unsigned)b, (unsigned)bus.registerCount, (unsigned)bus.readPlan.blockCount, (unsigned)maxBlockGap);
+        checkSchedule(b, bus.settings.turnaround_us, false, true);
+    }
+}
+
+/// <summary>
+/// Builds the channel list (registers, then derived channels) and compiles the
+/// derived expressions into one program. A channel that fails to compile is
+/// kept (logged as NAN) so the record layout does not depend on typos.
+/// </summary>
+void ConfigManager::buildChannels(JsonArray derived) {
+    channels = registers;
+
+    std::vector<std::string> inputKeys;
+    inputKeys.reserve(registers.size());
+    for (const auto& r : registers) inputKeys.push_back(r.key.c_str());
+
+    std::vector<DerivedProgram::Definition> definitions;
+    for (JsonObject def : derived) {
+        RegisterConfig c;
+        c.key = def["key"].as<String>();
+        c.name = def["name"].as<String>();
+        c.description = def["description"].as<String>();
+        c.register_address = 0;
+        c.type = "DERIVED";
+        c.unit = def["unit"].as<String>();
+        c.scaling = def["expression"].as<String>();
+        c.access = "R-only";
+        c.length = 0;
+        c.derived = true;
+        channels.push_back(c);
+        definitions.push_back({c.key.c_str(), c.scaling.c_str()});
+    }
+
+    size_t ok = derivedProgram.compile(inputKeys, definitions, DerivedProgram::kGapIntervals * pollingInterval);
+    for (size_t i = 0; i < definitions.size(); ++i) {
+        DerivedProgram::Status status = derivedProgram.status(i);
+        if (status == DerivedProgram::Status::Ok) continue;
+        Serial.printf("[ConfigManager][WARN] Derived channel '%s' = '%s': %s, values will be NAN.\n",
+                      definitions[i].key.c_str(), definitions[i].expression.c_str(),
+                      DerivedProgram::statusName(status));
+        if (storage) storage->logError(ErrorCode::Config, "Invalid derived channel: " + String(definitions[i].key.c_str()));
+    }
+    if (!definitions.empty()) {
+        Serial.printf("[ConfigManager] Derived channels: %u of %u compiled, %u instruction(s) per sample.\n",
+                      (unsigned)ok, (unsigned)definitions.size(), (unsigned)derivedProgram.ops().size());
+    }
+}
+
+/// <summary>
+/// Reads the alarm rules and compiles them into one flat table. A rule that
+/// fails to compile is reported and skipped; the others still run.
+/// </summary>
+void ConfigManager::buildAlarms(JsonObject alarms) {
+    alarmSettings = AlarmSettings();
+    std::vector<AlarmEngine::Definition> definitions;
+    if (!alarms.isNull()) {
+        alarmSettings.enabled = alarms["enabled"] | true;
+        alarmSettings.logFile = alarms["log_file"] | "/alarms.log";
+        alarmSettings.outputPin = alarms["output_pin"] | -1;
+        alarmSettings.outputActiveHigh = alarms["output_active_high"] | true;
+
+        for (JsonObject rule : alarms["rules"].as<JsonArray>()) {
+            AlarmEngine::Definition d;
+            d.name = String(rule["name"] | "").c_str();
+            d.key = String(rule["key"] | "").c_str();
+            d.above = rule["above"] | NAN;
+            d.below = rule["below"] | NAN;
+            d.rateAbove = rule["rate_above"] | NAN;
+            d.hysteresis = rule["hysteresis"] | 0.0f;
+            d.minDurationMs = rule["min_duration_ms"] | 0UL;
+            d.output = rule["output"] | false;
+            definitions.push_back(d);
+        }
+    }
+
+    std::vector<std::string> keys;
+    for (const auto& c : channels) keys.push_back(c.key.c_str());
+    size_t ok = alarmEngine.compile(keys, alarmSettings.enabled ? definitions : std::vector<AlarmEngine::Definition>());
+    if (!alarmSettings.enabled) return;
+
+    for (size_t i = 0; i < definitions.size(); ++i) {
+        AlarmEngine::Status status = alarmEngine.status(i);
+        if (status == AlarmEngine::Status::Ok) continue;
+        Serial.printf("[ConfigManager][WARN] Alarm rule '%s': %s, ignored.\n", alarmEngine.name(i).c_str(),
+                      AlarmEngine::statusName(status));
+        if (storage) storage->logError(ErrorCode::Config, "Invalid alarm rule: " + String(alarmEngine.name(i).c_str()));
+    }
+    Serial.printf("[ConfigManager] Alarms: %u of %u rule(s) compiled, events to %s, output pin %d\n",
+                  (unsigned)ok, (unsigned)definitions.size(), alarmSettings.logFile.c_str(), alarmSettings.outputPin);
+}
+
+/// <summary>
+/// Stores the discovered ranges of bus 0, reports its registers outside them and re-plans.
+/// </summary>
+void ConfigManager::setValidRanges(const std::vector<RegisterMap::Range>& ranges) {
+    validRanges = ranges;
+
+    for (uint16_t i = 0; i < buses[0].registerCount; ++i) {
+        const RegisterConfig& r = registers[buses[0].firstRegister + i];
+        uint32_t end = static_cast<uint32_t>(r.register_address) + r.length;
+        bool probed = r.register_address >= discoverySettings.first && end - 1 <= discoverySettings.last;
+        if (probed && !RegisterMap::isReadable(validRanges, r.register_address, end)) {
+            Serial.printf("[ConfigManager][WARN] Register '%s' @ %u is not readable on this device.\n",
+                          r.key.c_str(), r.register_address);
+            if (storage) storage->logError(ErrorCode::Config, "Configured register not readable on device: " + r.key);
+        }
+    }
+
+    if (!compiledMap) buildReadPlan();
+}
+
+/// <summary>
+/// Runs the timing model over the read plan. Above 80 % utilization there is
+/// little room left for slow answers and burst capture, so a warning is
+/// printed; above 100 % the schedule cannot be met and is rejected.
+/// </summary>
+BusTiming::Estimate ConfigManager::checkSchedule(size_t bus, uint32_t turnaroundUs, bool measured, bool adjustInterval) {
+    const ModbusSettings& modbusSettings = buses[bus].settings;
+    BusTiming::Line line = {static_cast<uint32_t>(modbusSettings.baudrate), modbusSettings.data_bits,
+                            modbusSettings.parity, modbusSettings.stop_bits};
+    BusTiming::Estimate e = BusTiming::estimate(line, buses[bus].readPlan, turnaroundUs, BusTiming::kResponseTimeoutUs,
+                                                pollingInterval);
+
+    Serial.printf("[ConfigManager] Bus %u schedule: %lu request(s), %lu byte(s) per cycle, %.1f ms per cycle "
+                  "(turnaround %.1f ms %s) = %.1f %% of %lu ms; worst case %.1f ms\n",
+                  (unsigned)bus, (unsigned long)e.transactions, (unsigned long)e.bytes, e.cycleUs / 1000.0f,
+                  turnaroundUs / 1000.0f, measured ? "measured" : "assumed", e.utilization * 100.0f,
+                  pollingInterval, e.worstCaseUs / 1000.0f);
+
+    if (e.utilization > 1.0f) {
+        Serial.printf("[ConfigManager][ERROR] Poll schedule of bus %u infeasible: %.1f ms of bus time per cycle exceeds the %lu ms interval.\n",
+                      (unsigned)bus, e.cycleUs / 1000.0f, pollingInterval);
+        if (storage) storage->logError(ErrorCode::Schedule, "Poll schedule exceeds the polling interval.");
+        if (adjustInterval) {
+            // Next multiple of 100 ms that leaves 20 % headroom
+            unsigned long needed = (static_cast<unsigned long>(e.cycleUs / 800.0f) / 100 + 1) * 100;
+            Serial.printf("[ConfigManager][WARN] Polling interval raised from %lu ms to %lu ms.\n", pollingInterval, needed);
+            pollingInterval = needed;
+            derivedProgram.setMaxGap(DerivedProgram::kGapIntervals * pollingInterval);
+        }
+    } else if (e.utilization > 0.8f) {
+        Serial.printf("[ConfigManager][WARN] Poll schedule uses %.1f %% of the bus, little headroom for slow answers.\n",
+                      e.utilization * 100.0f);
+    }
+    if (e.worstCaseUs > pollingInterval * 1000UL) {
+        Serial.printf("[ConfigManager][WARN] If the slave stops answering, a cycle takes up to %.1f s (timeouts).\n",
+                      e.worstCaseUs / 1000000.0f);
+    }
+    return e;
 }
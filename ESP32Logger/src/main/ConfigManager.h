@@ -4,20 +4,116 @@
 #include <ArduinoJson.h>
 #include <SD.h>
 #include "RegisterConfig.h"
+#include "RegisterMap.h"
+#include "BusTiming.h"
+#include "DerivedProgram.h"
+#include "AlarmEngine.h"
 #include "StorageManager.h"
 
-class StorageManager;
-
 /// <summary>
-/// Structure for holding Modbus RTU serial communication parameters.
+/// Structure for holding Modbus RTU serial communication parameters of one bus.
 /// These values are typically loaded from JSON configuration.
 /// </summary>
 struct ModbusSettings {
-    uint8_t slave_id;     ///< Modbus slave address
-    long baudrate;        ///< Baud rate (e.g., 9600, 19200)
-    char parity;          ///< Parity ('N' = None, 'E' = Even, 'O' = Odd)
-    uint8_t stop_bits;    ///< Stop bits (usually 1)
-    uint8_t data_bits;    ///< Data bits (usually 8)
+    uint8_t slave_id = 1;     ///< Modbus slave address
+    long baudrate = 9600;     ///< Baud rate (e.g., 9600, 19200)
+    char parity = 'N';        ///< Parity ('N' = None, 'E' = Even, 'O' = Odd)
+    uint8_t stop_bits = 1;    ///< Stop bits (usually 1)
+    uint8_t data_bits = 8;    ///< Data bits (usually 8)
+    uint32_t turnaround_us = 10000;  ///< Slave turnaround assumed until measured
+    uint8_t uart = 1;         ///< ESP32 UART (1 or 2, UART0 is the USB console; 0 = bus disabled)
+    int8_t rx_pin = 17;       ///< UART RX pin
+    int8_t tx_pin = 16;       ///< UART TX pin
+    int8_t de_re_pin = 4;     ///< RS485 direction pin (-1 = auto-direction transceiver)
+};
+
+/// <summary>
+/// Trigger rule evaluated on a burst register after every fast read.
+/// </summary>
+struct BurstTrigger {
+    enum class Kind : uint8_t { Above, Below, RateAbove };
+
+    String key;           ///< Register key the rule watches
+    Kind kind;            ///< Threshold direction or rate-of-change rule
+    float threshold;      ///< Limit in register units (per second for RateAbove)
+};
+
+/// <summary>
+/// Settings for triggered high-rate burst capture (see BurstCapture.h).
+/// </summary>
+struct BurstSettings {
+    bool enabled = false;                   ///< Burst capture on/off
+    std::vector<String> keys;               ///< Register keys polled at full bus speed
+    uint16_t preSamples = 200;              ///< Rows kept before the trigger
+    uint16_t postSamples = 200;             ///< Rows recorded after the trigger
+    unsigned long holdoffMs = 10000;        ///< Minimum pause between two events
+    String eventFolder = "/events/";        ///< Folder for event files
+    std::vector<BurstTrigger> triggers;     ///< Rules that start an event
+};
+
+/// <summary>
+/// Settings for the binary live stream on the USB serial port (see LiveStream.h).
+/// </summary>
+struct StreamSettings {
+    bool enabled = false;                   ///< Streaming on/off
+    unsigned long schemaIntervalMs = 10000; ///< How often the schema frame is repeated
+};
+
+/// <summary>
+/// Settings for SD card retention (see RetentionManager.h).
+/// </summary>
+struct RetentionSettings {
+    bool enabled = true;                    ///< Delete old files when the card fills up
+    uint8_t highWatermark = 90;             ///< Card usage (%) at which deletion starts
+    uint8_t lowWatermark = 80;              ///< Card usage (%) at which deletion stops
+    unsigned long checkIntervalMs = 300000; ///< How often the free space is measured
+};
+
+/// <summary>
+/// Settings for compressing closed day files (see LogCompressor.h).
+/// </summary>
+struct CompressionSettings {
+    bool enabled = false;                   ///< Replace closed day files by "<file>.lz"
+    unsigned long delayMs = 600000;         ///< Wait after the day rolled over, for late records
+};
+
+/// <summary>
+/// Settings of the alarm rules (see AlarmEngine.h); the rules themselves are
+/// compiled into getAlarms().
+/// </summary>
+struct AlarmSettings {
+    bool enabled = false;                   ///< Evaluate the rules
+    String logFile = "/alarms.log";         ///< Event log, one line per state change
+    int8_t outputPin = -1;                  ///< GPIO driven while an "output" rule is raised (-1 = none)
+    bool outputActiveHigh = true;           ///< Level of the pin while raised
+};
+
+/// <summary>
+/// Settings for the in-RAM recent history (see RecentHistory.h).
+/// </summary>
+struct HistorySettings {
+    bool enabled = true;                    ///< Keep recent samples in RAM
+    uint32_t minutes = 15;                  ///< Time span worth keeping
+    uint32_t ramBytes = 32 * 1024;          ///< RAM the history may use (caps the span)
+};
+
+/// <summary>
+/// Settings for recording the raw RTU traffic of the poll cycles (see RtuCapture.h).
+/// </summary>
+struct CaptureSettings {
+    bool enabled = false;                   ///< Record every request and response
+    String file = "/capture.rtucap";        ///< Capture file, appended to
+    uint32_t bufferBytes = 16 * 1024;       ///< RAM for records not written yet (per bus and for the cycles)
+};
+
+/// <summary>
+/// Settings for register map discovery (see RegisterDiscovery.h).
+/// </summary>
+struct DiscoverySettings {
+    bool enabled = false;                   ///< Discover (or load the cached map) at startup
+    uint16_t first = 0;                     ///< First address probed
+    uint16_t last = 0;                      ///< Last address probed (inclusive)
+    bool rescan = false;                    ///< Ignore the cached map and probe again
 };
 
 /// <summary>
@@ -27,6 +123,8 @@ struct ModbusSettings {
 /// </summary>
 class ConfigManager {
 public:
+    static constexpr size_t kMaxBuses = 2;  ///< RS485 buses (UART1 and UART2)
+
     /// <summary>
     /// Assigns a reference to the storage manager for logging errors.
     /// </summary>
@@ -55,6 +153,10 @@ public:
     /// <summary>
     /// Loads the configuration from "/config/config.json" on the SD card.
     /// Parses all required fields and stores them internally.
+    /// When the firmware was built with a compiled register map (CompiledConfig.h,
+    /// generated by rtulog-regmap) and the card's file is the one it was generated
+    /// from, or no file is present, the registers come from flash and the JSON
+    /// register list is skipped; a different file on the card overrides the map.
     /// </summary>
     void load();
 
@@ -65,14 +167,145 @@ public:
     unsigned long getPollingInterval() const;
 
     /// <summary>
-    /// Returns the current Modbus communication settings.
+    /// Returns how often (in milliseconds) staged samples are flushed to the SD card.
+    /// 0 means every acquisition cycle.
+    /// </summary>
+    unsigned long getFlushInterval() const { return flushInterval; }
+
+    /// <summary>
+    /// Returns the Modbus communication settings of a bus (0 = "communication").
+    /// </summary>
+    ModbusSettings getModbusSettings(size_t bus = 0) const { return buses[bus].settings; }
+
+    /// <summary>
+    /// Returns the number of RS485 buses (1 + entries of "buses").
+    /// </summary>
+    size_t getBusCount() const { return buses.size(); }
+
+    /// <summary>
+    /// Returns the index of the first register polled on a bus. Registers are
+    /// grouped by bus, so each bus owns one contiguous range of getRegisters().
+    /// </summary>
+    uint16_t getBusFirstRegister(size_t bus) const { return buses[bus].firstRegister; }
+
+    /// <summary>
+    /// Returns the number of registers polled on a bus.
+    /// </summary>
+    uint16_t getBusRegisterCount(size_t bus) const { return buses[bus].registerCount; }
+
+    /// <summary>
+    /// Returns the burst capture settings.
+    /// </summary>
+    const BurstSettings& getBurstSettings() const { return burstSettings; }
+
+    /// <summary>
+    /// Returns the live stream settings.
+    /// </summary>
+    const StreamSettings& getStreamSettings() const { return streamSettings; }
+
+    /// <summary>
+    /// Returns the recent history settings.
+    /// </summary>
+    const HistorySettings& getHistorySettings() const { return historySettings; }
+
+    /// <summary>
+    /// Returns the RTU traffic capture settings.
     /// </summary>
-    ModbusSettings getModbusSettings();
+    const CaptureSettings& getCaptureSettings() const { return captureSettings; }
+
+    /// <summary>
+    /// Returns the register map discovery settings.
+    /// </summary>
+    const DiscoverySettings& getDiscoverySettings() const { return discoverySettings; }
+
+    /// <summary>
+    /// Returns the SD card retention settings.
+    /// </summary>
+    const RetentionSettings& getRetentionSettings() const { return retentionSettings; }
+
+    /// <summary>
+    /// Returns the day file compression settings.
+    /// </summary>
+    const CompressionSettings& getCompressionSettings() const { return compressionSettings; }
+
+    /// <summary>
+    /// Returns the folder day files are written to (logging.output_folder).
+    /// </summary>
+    const String& getOutputFolder() const { return outputFolder; }
+
+    /// <summary>
+    /// Returns the day file name format (logging.filename_format).
+    /// </summary>
+    const String& getFilenameFormat() const { return filenameFormat; }
+
+    /// <summary>
+    /// Returns the device model name from the configuration ("device").
+    /// </summary>
+    const String& getDeviceName() const { return deviceName; }
+
+    /// <summary>
+    /// Applies the readable ranges found by discovery: warns about configured
+    /// registers the device does not serve and re-plans the block reads so
+    /// they may span short readable gaps (JSON registers only).
+    /// </summary>
+    void setValidRanges(const std::vector<RegisterMap::Range>& ranges);
+
+    /// <summary>
+    /// Evaluates the poll schedule of a bus (block reads of one cycle) with the
+    /// bus timing model and reports predicted utilization and worst-case cycle
+    /// time. Buses are polled concurrently, so each has the whole interval.
+    /// An infeasible schedule is logged as an error; with adjustInterval the
+    /// polling interval is then raised so cycles no longer overrun.
+    /// </summary>
+    /// <param name="bus">Bus index</param>
+    /// <param name="turnaroundUs">Slave turnaround to assume</param>
+    /// <param name="measured">True if turnaroundUs was measured on the bus</param>
+    /// <param name="adjustInterval">Raise the polling interval if infeasible</param>
+    /// <returns>The estimate</returns>
+    BusTiming::Estimate checkSchedule(size_t bus, uint32_t turnaroundUs, bool measured, bool adjustInterval);
+
+    /// <summary>
+    /// Returns the slave turnaround assumed on a bus until it is measured (turnaround_ms).
+    /// </summary>
+    uint32_t getAssumedTurnaroundUs(size_t bus = 0) const { return buses[bus].settings.turnaround_us; }
 
     /// <summary>
     /// Returns a list of all configured Modbus registers to read.
     /// </summary>
-    std::vector<RegisterConfig> getRegisters();
+    const std::vector<RegisterConfig>& getRegisters() const;
+
+    /// <summary>
+    /// Returns the logged channels: the registers followed by the derived
+    /// channels, in value order (see DerivedProgram.h).
+    /// </summary>
+    const std::vector<RegisterConfig>& getChannels() const { return channels; }
+
+    /// <summary>
+    /// Returns the compiled derived channel program; run() fills the derived
+    /// part of a value vector sized like getChannels().
+    /// </summary>
+    DerivedProgram& getDerivedProgram() { return derivedProgram; }
+
+    /// <summary>
+    /// Returns the compiled alarm rules; evaluate() takes a value vector sized like getChannels().
+    /// </summary>
+    AlarmEngine& getAlarms() { return alarmEngine; }
+
+    /// <summary>
+    /// Returns the alarm event log and output settings.
+    /// </summary>
+    const AlarmSettings& getAlarmSettings() const { return alarmSettings; }
+
+    /// <summary>
+    /// Returns the block read plan of a bus (slot indices are relative to
+    /// getBusFirstRegister()).
+    /// </summary>
+    const RegisterMap::ReadPlan& getReadPlan(size_t bus = 0) const { return buses[bus].readPlan; }
+
+    /// <summary>
+    /// Returns true if the registers come from the compiled register map.
+    /// </summary>
+    bool isCompiledMap() const { return compiledMap; }
 
     /// <summary>
     /// Returns true if debug mode is enabled in configuration.
@@ -85,16 +318,71 @@ public:
     bool isAddressOffsetEnabled() const { return addressOffsetEnabled; }
 
 private:
+    /// <summary>
+    /// Fills registers, Modbus and transformer settings from CompiledConfig.h.
+    /// </summary>
+    void loadCompiled(bool registersOnly);
+
+    /// <summary>
+    /// Groups the registers by bus and records each bus's register range.
+    /// </summary>
+    void assignBuses();
+
+    /// <summary>
+    /// Builds the block read plan of every bus.
+    /// </summary>
+    void buildReadPlan();
+
+    /// <summary>
+    /// Appends the derived channels to the registers and compiles their program.
+    /// </summary>
+    void buildChannels(JsonArray derived);
+
+    /// <summary>
+    /// Compiles the alarm rules against the channel list.
+    /// </summary>
+    void buildAlarms(JsonObject alarms);
+
     StorageManager* storage = nullptr;              ///< Reference to logger/storage handler
     unsigned long pollingInterval = 1000;           ///< Interval between Modbus reads
-    ModbusSettings modbusSettings;                  ///< Modbus serial configuration
+    unsigned long flushInterval = 0;                ///< Interval between SD flushes (0 = every cycle)
     std::vector<RegisterConfig> registers;          ///< Configured list of Modbus registers
+    std::vector<RegisterConfig> channels;           ///< Registers followed by the derived channels
+    DerivedProgram derivedProgram;                  ///< Compiled derived channel expressions
+    AlarmEngine alarmEngine;                        ///< Compiled alarm rules and their state
+    AlarmSettings alarmSettings;                    ///< Alarm event log and output settings
+    BurstSettings burstSettings;                    ///< Triggered burst capture settings
+    StreamSettings streamSettings;                  ///< Binary live stream settings
+    HistorySettings historySettings;                ///< In-RAM recent history settings
+    CaptureSettings captureSettings;                ///< RTU traffic capture settings
+    DiscoverySettings discoverySettings;            ///< Register map discovery settings
+    RetentionSettings retentionSettings;            ///< SD card retention settings
+    CompressionSettings compressionSettings;        ///< Day file compression settings
+    String outputFolder = "/";                      ///< Folder of the day files
+    String filenameFormat = "data_%Y%m%d.csv";      ///< strftime format of the day files
+    String deviceName;                              ///< Device model name
+    std::vector<RegisterMap::Range> validRanges;    ///< Readable ranges from discovery (empty = unknown)
     bool debugEnabled = false;                      ///< Enables verbose debugging if true
     float transformerVTR = 1.0f;                    ///< Voltage transformer ratio
     float transformerCTR = 1.0f;                    ///< Current transformer ratio
     uint16_t vtrRegister = 0;                       ///< Optional register to read VTR from device
     uint16_t ctrRegister = 0;                       ///< Optional register to read CTR from device
     bool addressOffsetEnabled = false;              ///< Enables 1-based addressing (Modbus)
+    uint16_t maxBlockGap = 0;                       ///< Unused words a block read may span
+    bool compiledMap = false;                       ///< Registers come from CompiledConfig.h
+
+    /// <summary>
+    /// One RS485 bus: its line, its register range and its read plan.
+    /// </summary>
+    struct Bus {
+        ModbusSettings settings;                    ///< Line and UART settings
+        uint16_t firstRegister = 0;                 ///< First register of the bus in registers
+        uint16_t registerCount = 0;                 ///< Registers polled on the bus
+        std::vector<RegisterMap::Block> planBlocks; ///< Runtime read plan (JSON registers)
+        std::vector<RegisterMap::Slot> planSlots;   ///< Slots of the runtime read plan
+        RegisterMap::ReadPlan readPlan;             ///< Active plan (flash tables or the vectors above)
+    };
+    std::vector<Bus> buses = std::vector<Bus>(1);   ///< Bus 0 = "communication", then "buses"
 };
 
 #endif // CONFIG_MANAGER_H
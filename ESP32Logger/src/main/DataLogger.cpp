@@ -1,46 +1,172 @@
 #include "DataLogger.h"
+#include "Trace.h"
 
 /// <summary>
 /// Constructs a new instance of DataLogger.
 /// </summary>
 /// <param name="rtc">Pointer to RTC manager for obtaining timestamps</param>
 /// <param name="storage">Pointer to StorageManager for writing JSON logs</param>
-/// <param name="modbus">Pointer to ModbusManager for register reads</param>
+/// <param name="buses">Pointer to the BusPoller for register reads</param>
 /// <param name="config">Pointer to ConfigManager to access register definitions</param>
-DataLogger::DataLogger(RtcManager* rtc, StorageManager* storage, ModbusManager* modbus, ConfigManager* config)
-    : rtc(rtc), storage(storage), modbus(modbus), config(config) {
+/// <param name="staging">Pointer to the staging ring holding unpersisted samples</param>
+/// <param name="stream">Pointer to the live stream</param>
+/// <param name="history">Pointer to the recent history</param>
+DataLogger::DataLogger(RtcManager* rtc, StorageManager* storage, BusPoller* buses, ConfigManager* config,
+                       StagingRing* staging, LiveStream* stream, RecentHistory* history)
+    : rtc(rtc), storage(storage), buses(buses), config(config), staging(staging), stream(stream),
+      history(history) {
     Serial.println("[DataLogger] Instance created.");
 }
 
 /// <summary>
 /// Performs a complete data logging cycle:
-/// - Retrieves current time
-/// - Reads all configured Modbus registers
-/// - Writes the values to SD card via StorageManager
+/// - Retrieves current time (epoch ms from the disciplined system clock)
+/// - Reads all configured Modbus registers and computes the derived channels
+/// - Checks the alarm rules and sets the alarm output
+/// - Stages the sample in reset-safe memory, keeps it in the recent history
+///   and publishes it on the live stream
+/// - Flushes staged samples when due (flush interval or ring 3/4 full)
 /// Logs an error if any step fails or if count mismatch occurs.
 /// </summary>
 void DataLogger::logAll() {
+    TRACE_SCOPE("logger.log", 0);
     Serial.println("[DataLogger] Logging cycle started...");
 
-    // Step 1: Get current timestamp
-    String timestamp = rtc->getFormattedTime();
-    Serial.printf("[DataLogger] Timestamp: %s\n", timestamp.c_str());
+    // Step 1: Get current timestamp (system clock, no I2C)
+    int64_t timestampMs = rtc->nowMs();
+    Serial.printf("[DataLogger] Timestamp: %lld ms\n", (long long)timestampMs);
 
-    // Step 2: Load register definitions from config
-    std::vector<RegisterConfig> registers = config->getRegisters();
-    Serial.printf("[DataLogger] Loaded %d register(s) for logging.\n", registers.size());
+    // Step 2: Load register and channel definitions from config
+    const std::vector<RegisterConfig>& registers = config->getRegisters();
+    const std::vector<RegisterConfig>& channels = config->getChannels();
+    Serial.printf("[DataLogger] Loaded %u register(s), %u channel(s) for logging.\n",
+                  (unsigned)registers.size(), (unsigned)channels.size());
 
-    // Step 3: Read values from Modbus
-    std::vector<float> values = modbus->readAll(registers);
-    Serial.printf("[DataLogger] Retrieved %d value(s) from Modbus.\n", values.size());
+    // Step 3: Read values from Modbus, every bus concurrently
+    std::vector<float> values(registers.size(), NAN);
+    uint32_t failed;
+    {
+        TRACE_SCOPE("logger.read", registers.size());
+        failed = buses->readAll(registers, values.data(), timestampMs);
+    }
+    Serial.printf("[DataLogger] Retrieved %u value(s) from Modbus, %lu failed request(s).\n",
+                  (unsigned)values.size(), (unsigned long)failed);
+
+    // Step 4: Compute the derived channels in one pass behind the register values
+    if (values.size() == registers.size() && channels.size() > registers.size()) {
+        values.resize(channels.size(), NAN);
+        config->getDerivedProgram().run(timestampMs, values.data());
+    }
+
+    // Step 5: Alarm rules, within the cycle; the event log is written in idle time
+    if (values.size() == channels.size()) {
+        AlarmEngine& alarms = config->getAlarms();
+        if (alarms.evaluate(timestampMs, values.data()) > 0) {
+            const AlarmSettings& settings = config->getAlarmSettings();
+            if (settings.outputPin >= 0) {
+                digitalWrite(settings.outputPin, alarms.outputActive() == settings.outputActiveHigh ? HIGH : LOW);
+            }
+        }
+    }
 
-    // Step 4: Validate and write results
-    if (!values.empty() && values.size() == registers.size()) {
-        Serial.println("[DataLogger] Writing values to storage...");
-        storage->writeJSON(timestamp, values, registers);
-        Serial.println("[DataLogger] Logging completed successfully.");
+    // Step 6: Validate and stage results
+    if (!values.empty() && values.size() == channels.size() && values.size() == staging->valueCount()) {
+        uint32_t seq = staging->push(timestampMs, values.data());
+        Serial.printf("[DataLogger] Sample #%u staged (%u pending).\n", seq, (unsigned)staging->pending());
+        if (history->valueCount() == values.size()) history->push(timestampMs, values.data());  // Never blocks readers
+        TRACE_SCOPE("stream.publish", seq);
+        stream->publish(timestampMs, values.data(), values.size());  // Never blocks, drops when the port is busy
     } else {
         Serial.println("[DataLogger][ERROR] Modbus read failed or mismatch in register/value count.");
-        storage->logError("Modbus read failed or register/value count mismatch.");
+        storage->logError(ErrorCode::ModbusRead, "Modbus read failed or register/value count mismatch.");
+    }
+
+    // Step 7: Flush when the interval elapsed or the ring is filling up
+    bool intervalDue = millis() - lastFlush >= config->getFlushInterval();
+    bool ringFilling = staging->pending() * 4 >= staging->capacity() * 3;
+    if (intervalDue || ringFilling) {
+        flushStaged();
+    }
+}
+
+/// <summary>
+/// Hands staged samples to the day file buffer of the StorageManager.
+/// </summary>
+class StagedWriter : public StagingRing::Sink {
+public:
+    StagedWriter(StorageManager* storage, const std::vector<RegisterConfig>& channels, size_t valueCount)
+        : storage(storage), channels(channels), valueCount(valueCount) {}
+
+    Result write(const StagingRing::Sample& sample) override {
+        switch (storage->writeJSON(sample.timestampMs, sample.values, valueCount, channels)) {
+            case StorageManager::WriteResult::Buffered: return Result::Buffered;
+            case StorageManager::WriteResult::Skipped:  return Result::Skipped;
+            default:                                    return Result::Failed;  // Also Disabled: stays staged
+        }
+    }
+
+    bool flush() override { return storage->flush(); }
+
+    uint32_t writeCount() const override { return storage->getLogWrites(); }
+
+private:
+    StorageManager* storage;
+    const std::vector<RegisterConfig>& channels;
+    size_t valueCount;
+};
+
+/// <summary>
+/// Writes all pending staged samples (and queued error lines) through the storage
+/// buffer. The persisted mark advances as far as samples reached the card, also
+/// when the batch fails part way (see StagingRing::drain()). Slots that fail
+/// their checksum (torn by a reset) and samples that can never be serialized
+/// are skipped. While logging is disabled nothing is written and the samples
+/// stay staged.
+/// </summary>
+/// <returns>True if all pending samples were persisted</returns>
+bool DataLogger::flushStaged() {
+    size_t pending = staging->pending();
+    TRACE_SCOPE("logger.flush", pending);
+    if (pending == 0) {
+        lastFlush = millis();
+        return storage->flush();  // Still push out queued error lines
+    }
+
+    if (!storage->isLoggingEnabled()) {
+        // Kept for when logging is enabled again; the ring overwrites the oldest once full
+        if (!disabledReported) {
+            Serial.println("[DataLogger][WARN] Logging disabled, samples stay staged.");
+            disabledReported = true;
+        }
+        return false;
+    }
+    disabledReported = false;
+
+    if (!storage->isCardPresent()) {
+        Serial.println("[DataLogger][ERROR] SD card not detected, keeping samples staged.");
+        storage->logError(ErrorCode::SdCard, "SD card not present.");
+        return false;
+    }
+
+    StagedWriter writer(storage, config->getChannels(), staging->valueCount());
+    StagingRing::DrainStats stats;
+    bool ok = staging->drain(writer, stats);
+    if (stats.corrupt > 0) {
+        Serial.printf("[DataLogger][WARN] %u staged slot(s) corrupt, skipped.\n", (unsigned)stats.corrupt);
+    }
+    if (stats.skipped > 0) {
+        Serial.printf("[DataLogger][WARN] %u staged sample(s) could not be serialized, skipped.\n", (unsigned)stats.skipped);
+    }
+    if (!ok) {
+        Serial.printf("[DataLogger][ERROR] Flush failed, %u sample(s) persisted, %u still staged.\n",
+                      (unsigned)stats.written, (unsigned)staging->pending());
+        return false;
+    }
+
+    lastFlush = millis();
+    Serial.printf("[DataLogger] Flushed %u staged sample(s) to storage.\n", (unsigned)stats.written);
+    if (staging->dropped() > 0) {
+        Serial.printf("[DataLogger][WARN] %u sample(s) were overwritten before they could be flushed.\n", staging->dropped());
     }
+    return true;
 }
@@ -3,15 +3,21 @@
 
 #include "RtcManager.h"
 #include "StorageManager.h"
-#include "ModbusManager.h"
+#include "BusPoller.h"
 #include "ConfigManager.h"
+#include "StagingRing.h"
+#include "LiveStream.h"
+#include "RecentHistory.h"
 
 /// <summary>
 /// Handles periodic logging of Modbus register values to persistent storage.
 /// This class coordinates:
-/// - Timestamping via RTC
-/// - Register reading via Modbus
-/// - Saving results to SD via StorageManager
+/// - Timestamping via the RTC-disciplined system clock
+/// - Register reading via Modbus, all buses at once
+/// - Alarm rules on every sample
+/// - Staging samples in reset-safe memory and keeping recent ones in RAM
+/// - Publishing samples on the live stream
+/// - Periodically flushing staged samples to SD via StorageManager
 /// </summary>
 class DataLogger {
 public:
@@ -26,25 +32,43 @@ public:
     /// </summary>
     /// <param name="rtc">Pointer to RTC manager (for current timestamp)</param>
     /// <param name="storage">Pointer to storage manager (for file output)</param>
-    /// <param name="modbus">Pointer to Modbus manager (for data reading)</param>
+    /// <param name="buses">Pointer to the bus poller (for data reading)</param>
     /// <param name="config">Pointer to configuration manager (for register definitions)</param>
-    DataLogger(RtcManager* rtc, StorageManager* storage, ModbusManager* modbus, ConfigManager* config);
+    /// <param name="staging">Pointer to the reset-safe staging ring</param>
+    /// <param name="stream">Pointer to the live stream (may be disabled)</param>
+    /// <param name="history">Pointer to the recent history (may be empty)</param>
+    DataLogger(RtcManager* rtc, StorageManager* storage, BusPoller* buses, ConfigManager* config,
+               StagingRing* staging, LiveStream* stream, RecentHistory* history);
 
     /// <summary>
     /// Executes a single logging operation.
     /// Steps:
-    /// 1. Gets current timestamp from RTC
-    /// 2. Reads all configured Modbus registers
-    /// 3. Saves the data to storage as JSON
+    /// 1. Gets current timestamp (epoch ms) from the system clock
+    /// 2. Reads all configured Modbus registers and computes the derived channels
+    /// 3. Checks the alarm rules and sets the alarm output
+    /// 4. Stages the sample, adds it to the recent history and publishes it on the live stream
+    /// 5. Flushes staged samples to storage when the flush interval has elapsed
     /// Logs errors in case of failure.
     /// </summary>
     void logAll();
 
+    /// <summary>
+    /// Writes every staged, not yet persisted sample to storage and
+    /// marks them persisted once the SD write succeeded.
+    /// </summary>
+    /// <returns>True if nothing is left pending</returns>
+    bool flushStaged();
+
 private:
     RtcManager* rtc;            ///< Reference to RTC manager (for timestamps)
     StorageManager* storage;   ///< Reference to storage backend (SD card writer)
-    ModbusManager* modbus;     ///< Reference to Modbus handler
+    BusPoller* buses;          ///< Reference to the Modbus buses
     ConfigManager* config;     ///< Reference to register configuration source
+    StagingRing* staging;      ///< Reset-safe buffer of unpersisted samples
+    LiveStream* stream;        ///< Binary sample stream on the USB serial port
+    RecentHistory* history;    ///< Last minutes of samples in RAM
+    unsigned long lastFlush = 0; ///< millis() of the last successful flush
+    bool disabledReported = false; ///< "Logging disabled" was printed since it was last enabled
 };
 
 #endif // DATA_LOGGER_H
@@ -0,0 +1,311 @@
+#include "DerivedProgram.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+using Kind = DerivedProgram::Op::Kind;
+
+static int precedence(Kind k) {
+    switch (k) {
+        case Kind::Add: case Kind::Sub: return 1;
+        case Kind::Mul: case Kind::Div: return 2;
+        case Kind::Neg: return 3;
+        default: return 0;
+    }
+}
+
+static bool isIdentifierChar(char c) {
+    return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+static bool isFunction(Kind k) {
+    return k == Kind::Sqrt || k == Kind::Abs || k == Kind::Integral || k == Kind::Rate;
+}
+
+/// <summary>
+/// Function name → instruction; false if name is not a function.
+/// </summary>
+static bool functionKind(const char* name, size_t len, Kind& kind) {
+    static const struct { const char* name; Kind kind; } functions[] = {
+        { "sqrt", Kind::Sqrt }, { "abs", Kind::Abs }, { "integral", Kind::Integral }, { "rate", Kind::Rate },
+    };
+    for (const auto& f : functions) {
+        if (strlen(f.name) == len && strncmp(name, f.name, len) == 0) {
+            kind = f.kind;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* DerivedProgram::statusName(Status status) {
+    switch (status) {
+        case Status::Ok:         return "ok";
+        case Status::Syntax:     return "syntax error";
+        case Status::UnknownKey: return "unknown key";
+        case Status::Duplicate:  return "duplicate key";
+        case Status::Cycle:      return "dependency cycle";
+        case Status::TooLarge:   return "program too large";
+    }
+    return "?";
+}
+
+/// <summary>
+/// Shunting-yard as in ScaleExpression, extended by key references and
+/// one-argument functions. A function waits on the operator stack below its
+/// opening parenthesis and is emitted when that parenthesis closes.
+/// </summary>
+DerivedProgram::Status DerivedProgram::parse(const char* text, const std::vector<const std::string*>& keys,
+                                             std::vector<Op>& out, uint16_t& stateCount) const {
+    out.clear();
+
+    // Operator stack; Kind::Const marks an open parenthesis
+    Kind pending[kMaxDepth * 2];
+    size_t pendingCount = 0;
+    const size_t pendingCapacity = sizeof(pending) / sizeof(pending[0]);
+    bool expectOperand = true;
+    const char* p = text;
+
+    while (*p) {
+        char c = *p;
+        if (isspace(static_cast<unsigned char>(c))) {
+            ++p;
+            continue;
+        }
+        if (expectOperand) {
+            if (isdigit(static_cast<unsigned char>(c)) || c == '.') {
+                char* end;
+                float v = strtof(p, &end);
+                if (end == p) return Status::Syntax;
+                out.push_back({Kind::Const, 0, v});
+                p = end;
+                expectOperand = false;
+            } else if (isalpha(static_cast<unsigned char>(c)) || c == '_') {
+                // Function call?
+                const char* name = p;
+                while (isIdentifierChar(*p)) ++p;
+                const char* after = p;
+                while (isspace(static_cast<unsigned char>(*after))) ++after;
+                Kind function;
+                if (*after == '(' && functionKind(name, p - name, function)) {
+                    if (pendingCount + 2 > pendingCapacity) return Status::Syntax;
+                    pending[pendingCount++] = function;
+                    pending[pendingCount++] = Kind::Const;
+                    p = after + 1;
+                    continue;
+                }
+
+                // Longest key that matches here as a whole word
+                size_t best = 0;
+                size_t bestIndex = 0;
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    size_t len = keys[i]->size();
+                    if (len > best && strncmp(name, keys[i]->c_str(), len) == 0 && !isIdentifierChar(name[len])) {
+                        best = len;
+                        bestIndex = i;
+                    }
+                }
+                if (best == 0) return Status::UnknownKey;
+                out.push_back({Kind::Load, static_cast<uint16_t>(bestIndex), 0.0f});
+                p = name + best;
+                expectOperand = false;
+            } else if (c == '(' || c == '-') {
+                if (pendingCount == pendingCapacity) return Status::Syntax;
+                pending[pendingCount++] = c == '(' ? Kind::Const : Kind::Neg;
+                ++p;
+            } else if (c == '+') {
+                ++p;
+            } else {
+                return Status::Syntax;
+            }
+            continue;
+        }
+
+        if (c == ')') {
+            while (pendingCount > 0 && pending[pendingCount - 1] != Kind::Const) {
+                out.push_back({pending[--pendingCount], 0, 0.0f});
+            }
+            if (pendingCount == 0) return Status::Syntax;
+            --pendingCount;
+            if (pendingCount > 0 && isFunction(pending[pendingCount - 1])) {
+                Kind function = pending[--pendingCount];
+                bool stateful = function == Kind::Integral || function == Kind::Rate;
+                out.push_back({function, stateful ? stateCount++ : static_cast<uint16_t>(0), 0.0f});
+            }
+            ++p;
+            continue;
+        }
+
+        Kind op;
+        switch (c) {
+            case '+': op = Kind::Add; break;
+            case '-': op = Kind::Sub; break;
+            case '*': op = Kind::Mul; break;
+            case '/': op = Kind::Div; break;
+            default: return Status::Syntax;
+        }
+        while (pendingCount > 0 && pending[pendingCount - 1] != Kind::Const &&
+               precedence(pending[pendingCount - 1]) >= precedence(op)) {
+            out.push_back({pending[--pendingCount], 0, 0.0f});
+        }
+        if (pendingCount == pendingCapacity) return Status::Syntax;
+        pending[pendingCount++] = op;
+        expectOperand = true;
+        ++p;
+    }
+
+    if (out.empty() || expectOperand) return Status::Syntax;
+    while (pendingCount > 0) {
+        if (pending[pendingCount - 1] == Kind::Const) return Status::Syntax;
+        out.push_back({pending[--pendingCount], 0, 0.0f});
+    }
+
+    size_t depth = 0;
+    for (const Op& op : out) {
+        if (op.kind == Kind::Const || op.kind == Kind::Load) {
+            if (++depth > kMaxDepth) return Status::Syntax;
+        } else if (op.kind == Kind::Add || op.kind == Kind::Sub || op.kind == Kind::Mul || op.kind == Kind::Div) {
+            --depth;
+        }
+    }
+    return Status::Ok;
+}
+
+/// <summary>
+/// Parses every channel, orders them so each channel runs after the derived
+/// channels it reads (Kahn's algorithm), and concatenates the programs with a
+/// Store after each. Failed channels store NAN and run first.
+/// </summary>
+size_t DerivedProgram::compile(const std::vector<std::string>& inputKeys, const std::vector<Definition>& definitions,
+                               uint32_t gapMs) {
+    const size_t inputs = inputKeys.size();
+    const size_t count = definitions.size();
+    maxGapMs = gapMs;
+    program.clear();
+    statuses.assign(count, Status::Ok);
+
+    std::vector<const std::string*> keys;
+    for (const auto& k : inputKeys) keys.push_back(&k);
+    for (size_t i = 0; i < count; ++i) {
+        for (const std::string* k : keys) {
+            if (*k == definitions[i].key) statuses[i] = Status::Duplicate;
+        }
+        keys.push_back(&definitions[i].key);
+    }
+
+    // Parse, collect dependencies between derived channels
+    std::vector<std::vector<Op>> bodies(count);
+    std::vector<std::vector<size_t>> dependents(count);
+    std::vector<size_t> unresolved(count, 0);
+    uint16_t stateCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (statuses[i] != Status::Ok) continue;
+        statuses[i] = parse(definitions[i].expression.c_str(), keys, bodies[i], stateCount);
+        if (statuses[i] != Status::Ok) continue;
+
+        std::vector<bool> seen(count, false);
+        for (const Op& op : bodies[i]) {
+            if (op.kind != Kind::Load || op.index < inputs) continue;
+            size_t d = op.index - inputs;
+            if (seen[d]) continue;
+            seen[d] = true;
+            dependents[d].push_back(i);
+            ++unresolved[i];
+        }
+    }
+
+    // Channels that failed are not waited for, their value is simply NAN
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < count; ++i) {
+        if (statuses[i] != Status::Ok) {
+            program.push_back({Kind::Const, 0, NAN});
+            program.push_back({Kind::Store, static_cast<uint16_t>(inputs + i), 0.0f});
+            for (size_t j : dependents[i]) --unresolved[j];
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (statuses[i] == Status::Ok && unresolved[i] == 0) ready.push_back(i);
+    }
+
+    std::vector<bool> emitted(count, false);
+    size_t budget = 0;
+    for (size_t r = 0; r < ready.size(); ++r) {
+        size_t i = ready[r];
+        emitted[i] = true;
+        if (budget + bodies[i].size() + 1 > kMaxOps) {
+            statuses[i] = Status::TooLarge;
+            program.push_back({Kind::Const, 0, NAN});
+        } else {
+            program.insert(program.end(), bodies[i].begin(), bodies[i].end());
+            budget += bodies[i].size() + 1;
+        }
+        program.push_back({Kind::Store, static_cast<uint16_t>(inputs + i), 0.0f});
+        for (size_t j : dependents[i]) {
+            if (--unresolved[j] == 0 && statuses[j] == Status::Ok) ready.push_back(j);
+        }
+    }
+
+    // Whatever never became ready waits on a cycle
+    size_t ok = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (statuses[i] == Status::Ok && !emitted[i]) {
+            statuses[i] = Status::Cycle;
+            program.push_back({Kind::Const, 0, NAN});
+            program.push_back({Kind::Store, static_cast<uint16_t>(inputs + i), 0.0f});
+        }
+        if (statuses[i] == Status::Ok) ++ok;
+    }
+
+    states.assign(stateCount, State());
+    return ok;
+}
+
+void DerivedProgram::reset() {
+    for (State& s : states) s = State();
+}
+
+/// <summary>
+/// Runs the program over one sample. integral() accumulates the trapezoid
+/// between the previous and the current valid value; rate() is the slope over
+/// the same interval. Intervals longer than maxGapMs (or going backwards) are
+/// skipped, NAN inputs leave the history untouched.
+/// </summary>
+void DerivedProgram::run(int64_t timestampMs, float* values) {
+    float stack[kMaxDepth];
+    size_t top = 0;
+
+    for (const Op& op : program) {
+        switch (op.kind) {
+            case Kind::Const: stack[top++] = op.value; break;
+            case Kind::Load: stack[top++] = values[op.index]; break;
+            case Kind::Store: values[op.index] = stack[--top]; break;
+            case Kind::Add: --top; stack[top - 1] += stack[top]; break;
+            case Kind::Sub: --top; stack[top - 1] -= stack[top]; break;
+            case Kind::Mul: --top; stack[top - 1] *= stack[top]; break;
+            case Kind::Div: --top; stack[top - 1] = stack[top] != 0.0f ? stack[top - 1] / stack[top] : NAN; break;
+            case Kind::Neg: stack[top - 1] = -stack[top - 1]; break;
+            case Kind::Sqrt: stack[top - 1] = sqrtf(stack[top - 1]); break;
+            case Kind::Abs: stack[top - 1] = fabsf(stack[top - 1]); break;
+            case Kind::Integral:
+            case Kind::Rate: {
+                State& s = states[op.index];
+                float x = stack[top - 1];
+                int64_t dt = timestampMs - s.lastMs;
+                bool span = !isnan(x) && !isnan(s.last) && dt > 0 && (maxGapMs == 0 || dt <= (int64_t)maxGapMs);
+                float result;
+                if (op.kind == Kind::Integral) {
+                    if (span) s.sum += (static_cast<double>(s.last) + x) * 0.5 * dt / 3600000.0;
+                    result = static_cast<float>(s.sum);
+                } else {
+                    result = span ? (x - s.last) * 1000.0f / dt : NAN;
+                }
+                if (!isnan(x)) {
+                    s.last = x;
+                    s.lastMs = timestampMs;
+                }
+                stack[top - 1] = result;
+                break;
+            }
+        }
+    }
+}
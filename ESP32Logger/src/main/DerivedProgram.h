@@ -0,0 +1,139 @@
+#ifndef DERIVED_PROGRAM_H
+#define DERIVED_PROGRAM_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Virtual channels computed from other channels of the same sample, e.g.
+/// "voltage_l1-n * current_l1" or "integral(active_power_total) / 1000".
+///
+/// All definitions are compiled at load into one postfix (RPN) program in
+/// dependency order. run() executes it once per sample over the value vector
+/// (physical registers first, derived channels after them), so a channel may
+/// use any register and any other derived channel. The program size and
+/// stack depth are limited, which bounds the per-sample cost.
+/// This header has no Arduino dependencies.
+///
+/// Supported: numbers, channel keys, + - * /, parentheses, unary minus and the
+/// functions sqrt(x), abs(x), integral(x) (trapezoidal time integral of x in
+/// x·hours, e.g. W → Wh, starting at 0 at load) and rate(x) (change of x per
+/// second). Keys containing '-' are matched as a whole ("voltage_l1-n"); write
+/// a minus between keys with spaces. Division by zero yields NAN.
+/// </summary>
+class DerivedProgram {
+public:
+    /// <summary>
+    /// One postfix instruction. index is the value index for Load/Store and
+    /// the state slot for Integral/Rate.
+    /// </summary>
+    struct Op {
+        enum class Kind : uint8_t { Const, Load, Store, Add, Sub, Mul, Div, Neg, Sqrt, Abs, Integral, Rate };
+        Kind kind;
+        uint16_t index;
+        float value;          ///< Constant for Kind::Const
+    };
+
+    /// <summary>
+    /// Compile result of one channel.
+    /// </summary>
+    enum class Status : uint8_t {
+        Ok,
+        Syntax,         ///< Malformed expression or nested too deeply
+        UnknownKey,     ///< References a key that is neither a register nor a derived channel
+        Duplicate,      ///< Key already used by a register or an earlier channel
+        Cycle,          ///< Part of, or depends on, a dependency cycle
+        TooLarge        ///< Program would exceed kMaxOps
+    };
+
+    /// <summary>
+    /// One derived channel.
+    /// </summary>
+    struct Definition {
+        std::string key;
+        std::string expression;
+    };
+
+    static constexpr size_t kMaxDepth = 16;     ///< Evaluation stack
+    static constexpr size_t kMaxOps = 256;      ///< Instructions per sample for all channels
+
+    /// <summary>
+    /// The logger compiles with maxGapMs of this many polling intervals:
+    /// integral() and rate() skip longer gaps.
+    /// </summary>
+    static constexpr uint32_t kGapIntervals = 3;
+
+    /// <summary>
+    /// Compiles the definitions. Channel i is stored at value index
+    /// inputKeys.size() + i. Channels that fail to compile evaluate to NAN.
+    /// </summary>
+    /// <param name="inputKeys">Keys of the physical registers, in value order</param>
+    /// <param name="definitions">Derived channels, in value order</param>
+    /// <param name="maxGapMs">Longer gaps between samples are not integrated (0 = no limit)</param>
+    /// <returns>Number of channels that compiled</returns>
+    size_t compile(const std::vector<std::string>& inputKeys, const std::vector<Definition>& definitions,
+                   uint32_t maxGapMs);
+
+    /// <summary>
+    /// Computes every derived channel of one sample in place.
+    /// </summary>
+    /// <param name="timestampMs">Sample time (for integral and rate)</param>
+    /// <param name="values">inputKeys.size() + channel count values; the physical part is read</param>
+    void run(int64_t timestampMs, float* values);
+
+    /// <summary>
+    /// Changes the gap limit (e.g. after the polling interval was raised).
+    /// </summary>
+    void setMaxGap(uint32_t gapMs) { maxGapMs = gapMs; }
+
+    /// <summary>
+    /// Clears integrals and rate history (e.g. after a time step).
+    /// </summary>
+    void reset();
+
+    /// <summary>
+    /// Compile status of channel i.
+    /// </summary>
+    Status status(size_t i) const { return i < statuses.size() ? statuses[i] : Status::Syntax; }
+
+    /// <summary>
+    /// Text for a status, for warnings.
+    /// </summary>
+    static const char* statusName(Status status);
+
+    /// <summary>
+    /// Number of derived channels.
+    /// </summary>
+    size_t channelCount() const { return statuses.size(); }
+
+    /// <summary>
+    /// The compiled program.
+    /// </summary>
+    const std::vector<Op>& ops() const { return program; }
+
+private:
+    /// <summary>
+    /// History of one integral() or rate() call site.
+    /// </summary>
+    struct State {
+        int64_t lastMs = 0;
+        float last = NAN;
+        double sum = 0.0;
+    };
+
+    /// <summary>
+    /// Compiles one expression to postfix with Load instructions for key references.
+    /// </summary>
+    Status parse(const char* text, const std::vector<const std::string*>& keys, std::vector<Op>& out,
+                 uint16_t& stateCount) const;
+
+    std::vector<Op> program;
+    std::vector<Status> statuses;
+    std::vector<State> states;
+    uint32_t maxGapMs = 0;
+};
+
+#endif // DERIVED_PROGRAM_H
@@ -0,0 +1,114 @@
+#include "ErrorLog.h"
+#include "LogFrame.h"
+#include <stdio.h>
+#include <string.h>
+
+/// <summary>
+/// Returns a short, stable identifier for an error code.
+/// </summary>
+const char* ErrorLog::codeToStr(ErrorCode code) {
+    switch (code) {
+        case ErrorCode::Config:     return "config";
+        case ErrorCode::ModbusRead: return "modbus_read";
+        case ErrorCode::SdCard:     return "sd_card";
+        case ErrorCode::FileOpen:   return "file_open";
+        case ErrorCode::FileWrite:  return "file_write";
+        case ErrorCode::Recovery:   return "recovery";
+        case ErrorCode::Staging:    return "staging";
+        case ErrorCode::Schedule:   return "schedule";
+        case ErrorCode::Retention:  return "retention";
+        case ErrorCode::Compression: return "compression";
+        default:                    return "generic";
+    }
+}
+
+/// <summary>
+/// Sets the destination for formatted error lines.
+/// </summary>
+void ErrorLog::setSink(LineSink s, void* context) {
+    sink = s;
+    sinkContext = context;
+}
+
+/// <summary>
+/// Finds a free entry, evicting the least recently seen one if the table is full.
+/// </summary>
+ErrorLog::Entry* ErrorLog::acquireEntry(uint32_t nowMs) {
+    Entry* victim = &entries[0];
+    for (size_t i = 0; i < kMaxEntries; ++i) {
+        if (!entries[i].used) return &entries[i];
+        if (entries[i].lastSeen - victim->lastSeen > 0x80000000u) victim = &entries[i];
+    }
+    if (victim->repeats > 0) emitSummary(*victim, nowMs);
+    return victim;
+}
+
+/// <summary>
+/// Counts an occurrence and emits it only if it starts a new window.
+/// </summary>
+bool ErrorLog::report(ErrorCode code, const char* message, uint32_t nowMs) {
+    total++;
+    uint32_t site = LogFrame::crc32(message, strlen(message));
+
+    for (size_t i = 0; i < kMaxEntries; ++i) {
+        Entry& e = entries[i];
+        if (e.used && e.code == code && e.site == site) {
+            e.repeats++;
+            e.lastSeen = nowMs;
+            return false;
+        }
+    }
+
+    Entry* e = acquireEntry(nowMs);
+    e->used = true;
+    e->code = code;
+    e->site = site;
+    e->windowStart = nowMs;
+    e->lastSeen = nowMs;
+    e->repeats = 0;
+    strncpy(e->message, message, kMessageSize - 1);
+    e->message[kMessageSize - 1] = '\0';
+
+    if (sink) {
+        char line[kMessageSize + 32];
+        snprintf(line, sizeof(line), "ERROR[%s] %s", codeToStr(code), message);
+        sink(sinkContext, line);
+    }
+    return true;
+}
+
+/// <summary>
+/// Writes "message xN in last M min" for the current window and starts a new one.
+/// </summary>
+void ErrorLog::emitSummary(Entry& e, uint32_t nowMs) {
+    if (sink) {
+        uint32_t elapsed = nowMs - e.windowStart;
+        char line[kMessageSize + 64];
+        if (elapsed >= 60000) {
+            snprintf(line, sizeof(line), "ERROR[%s] %s \xC3\x97%lu in last %lu min", codeToStr(e.code), e.message,
+                     (unsigned long)e.repeats, (unsigned long)(elapsed / 60000));
+        } else {
+            snprintf(line, sizeof(line), "ERROR[%s] %s \xC3\x97%lu in last %lu s", codeToStr(e.code), e.message,
+                     (unsigned long)e.repeats, (unsigned long)(elapsed / 1000));
+        }
+        sink(sinkContext, line);
+    }
+    e.repeats = 0;
+    e.windowStart = nowMs;
+}
+
+/// <summary>
+/// Summarizes elapsed windows and releases entries that stayed quiet.
+/// </summary>
+void ErrorLog::poll(uint32_t nowMs) {
+    for (size_t i = 0; i < kMaxEntries; ++i) {
+        Entry& e = entries[i];
+        if (!e.used || nowMs - e.windowStart < summaryInterval) continue;
+
+        if (e.repeats > 0) {
+            emitSummary(e, nowMs);
+        } else {
+            e.used = false;
+        }
+    }
+}
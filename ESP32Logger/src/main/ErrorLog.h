@@ -0,0 +1,99 @@
+#ifndef ERROR_LOG_H
+#define ERROR_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+/// Error categories used as part of the coalescing key.
+/// </summary>
+enum class ErrorCode : uint8_t {
+    Generic = 0,      ///< Uncategorized error
+    Config,           ///< Configuration could not be loaded or is invalid
+    ModbusRead,       ///< Modbus transaction failed
+    SdCard,           ///< SD card missing or not responding
+    FileOpen,         ///< Log file could not be opened
+    FileWrite,        ///< Short or failed write
+    Recovery,         ///< Torn-tail recovery or truncation
+    Staging,          ///< Staging ring lost or discarded samples
+    Schedule,         ///< Poll schedule does not fit the bus / cycle overran
+    Retention,        ///< Card full, old files deleted to free space
+    Compression       ///< Day file compression failed or was skipped
+};
+
+/// <summary>
+/// Rate-limited, coalescing error log.
+/// The first occurrence of an error (keyed by code and message) is emitted
+/// immediately. Repeats are only counted in RAM and summarized once per
+/// interval ("Modbus read failed x600 in last 10 min"). Entries that stay quiet
+/// for a whole interval are released, so a later recurrence is reported again.
+///
+/// The class has no Arduino dependencies; formatted lines are handed to a sink
+/// (StorageManager routes them through its buffered writer).
+/// </summary>
+class ErrorLog {
+public:
+    /// <summary>
+    /// Receives one formatted error line (without timestamp or newline).
+    /// </summary>
+    typedef void (*LineSink)(void* context, const char* line);
+
+    /// <summary>
+    /// Sets the destination for formatted lines.
+    /// </summary>
+    void setSink(LineSink sink, void* context);
+
+    /// <summary>
+    /// Sets the length of the coalescing window in milliseconds.
+    /// </summary>
+    void setSummaryInterval(uint32_t ms) { summaryInterval = ms; }
+
+    /// <summary>
+    /// Records one error occurrence.
+    /// </summary>
+    /// <param name="code">Error category</param>
+    /// <param name="message">Human-readable message</param>
+    /// <param name="nowMs">Current millis()</param>
+    /// <returns>True if the line was emitted now, false if it was coalesced</returns>
+    bool report(ErrorCode code, const char* message, uint32_t nowMs);
+
+    /// <summary>
+    /// Emits summaries for windows that have elapsed. Call once per cycle.
+    /// </summary>
+    void poll(uint32_t nowMs);
+
+    /// <summary>
+    /// Total number of reported errors since boot (including coalesced ones).
+    /// </summary>
+    uint32_t totalCount() const { return total; }
+
+    /// <summary>
+    /// Returns a short identifier for an error code (e.g. "modbus_read").
+    /// </summary>
+    static const char* codeToStr(ErrorCode code);
+
+private:
+    static const size_t kMaxEntries = 16;
+    static const size_t kMessageSize = 80;
+
+    struct Entry {
+        bool used;
+        ErrorCode code;
+        uint32_t site;              ///< CRC32 of the message text
+        uint32_t windowStart;       ///< millis() when the current window began
+        uint32_t lastSeen;          ///< millis() of the most recent occurrence
+        uint32_t repeats;           ///< Occurrences not yet written in this window
+        char message[kMessageSize];
+    };
+
+    void emitSummary(Entry& e, uint32_t nowMs);
+    Entry* acquireEntry(uint32_t nowMs);
+
+    Entry entries[kMaxEntries] = {};
+    LineSink sink = nullptr;
+    void* sinkContext = nullptr;
+    uint32_t summaryInterval = 600000;  ///< 10 minutes
+    uint32_t total = 0;
+};
+
+#endif // ERROR_LOG_H
@@ -0,0 +1,78 @@
+#include "LiveStream.h"
+
+/// <summary>
+/// Encodes the schema payload once; samples are encoded per publish().
+/// </summary>
+bool LiveStream::begin(const StreamSettings& settings, const std::vector<RegisterConfig>& registers,
+                       uint32_t schemaHash, Stream* serialPort) {
+    enabled = false;
+    port = serialPort;
+    if (!settings.enabled || !port) return false;
+
+    if (registers.empty() || registers.size() > StreamProtocol::kMaxValues) {
+        Serial.printf("[LiveStream][ERROR] %u register(s) do not fit into a sample frame, streaming disabled.\n",
+                      (unsigned)registers.size());
+        return false;
+    }
+
+    std::vector<const char*> keys;
+    std::vector<const char*> units;
+    for (const auto& r : registers) {
+        keys.push_back(r.key.c_str());
+        units.push_back(r.unit.c_str());
+    }
+    schemaPayload.resize(StreamProtocol::kMaxPayload);
+    size_t len = StreamProtocol::encodeSchema(schemaHash, keys.data(), units.data(),
+                                              static_cast<uint16_t>(registers.size()),
+                                              schemaPayload.data(), schemaPayload.size());
+    if (len == 0) {
+        Serial.println("[LiveStream][ERROR] Register keys and units do not fit into a schema frame, streaming disabled.");
+        return false;
+    }
+    schemaPayload.resize(len);
+
+    hash = schemaHash;
+    valueCount = static_cast<uint16_t>(registers.size());
+    schemaIntervalMs = settings.schemaIntervalMs;
+    schemaDue = true;
+    droppedCount = 0;
+    payload.resize(StreamProtocol::kMaxPayload);
+    frame.resize(StreamProtocol::kMaxPayload + StreamProtocol::kOverhead);
+    enabled = true;
+
+    Serial.printf("[LiveStream] Streaming %u value(s) per sample, schema every %lu ms.\n",
+                  (unsigned)valueCount, schemaIntervalMs);
+    return true;
+}
+
+/// <summary>
+/// Sends the schema when due, then the sample. If either does not fit into the
+/// TX buffer the sample is dropped; a pending schema is retried with the next sample.
+/// </summary>
+void LiveStream::publish(int64_t timestampMs, const float* values, size_t count) {
+    if (!enabled || count != valueCount) return;
+
+    if (millis() - lastSchema >= schemaIntervalMs) schemaDue = true;
+    if (schemaDue) {
+        if (!sendFrame(StreamProtocol::kTypeSchema, schemaPayload.data(), schemaPayload.size())) {
+            droppedCount++;
+            return;
+        }
+        schemaDue = false;
+        lastSchema = millis();
+    }
+
+    StreamProtocol::SampleHeader header = { hash, droppedCount, timestampMs, valueCount };
+    size_t len = StreamProtocol::encodeSample(header, values, payload.data(), payload.size());
+    if (!sendFrame(StreamProtocol::kTypeSample, payload.data(), len)) {
+        droppedCount++;
+    }
+}
+
+bool LiveStream::sendFrame(uint8_t type, const uint8_t* data, size_t length) {
+    size_t size = StreamProtocol::encodeFrame(type, seq, data, length, frame.data());
+    if (size == 0 || port->availableForWrite() < static_cast<int>(size)) return false;
+    port->write(frame.data(), size);
+    seq++;
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef LIVE_STREAM_H
+#define LIVE_STREAM_H
+
+#include <Arduino.h>
+#include <vector>
+#include "ConfigManager.h"
+#include "StreamProtocol.h"
+
+/// <summary>
+/// Streams every logged sample as a binary frame over the USB serial port
+/// (see StreamProtocol.h), so a host can watch live data without pulling the card.
+///
+/// Sending never blocks the acquisition path: a frame is only written if it fits
+/// into the free space of the serial TX buffer, otherwise the sample is dropped
+/// and counted (the count travels in the next sample frame that gets through).
+/// </summary>
+class LiveStream {
+public:
+    /// <summary>
+    /// Prepares the schema frame for the register list.
+    /// </summary>
+    /// <param name="settings">Stream settings from the configuration</param>
+    /// <param name="registers">Logged registers, in value order</param>
+    /// <param name="schemaHash">Hash of the register list (same as the staging ring uses)</param>
+    /// <param name="port">Serial port to write to</param>
+    /// <returns>True if streaming is enabled and ready</returns>
+    bool begin(const StreamSettings& settings, const std::vector<RegisterConfig>& registers, uint32_t schemaHash,
+               Stream* port);
+
+    /// <summary>
+    /// Returns true if streaming is active.
+    /// </summary>
+    bool isEnabled() const { return enabled; }
+
+    /// <summary>
+    /// Sends one sample (preceded by the schema frame when it is due). Never waits.
+    /// </summary>
+    void publish(int64_t timestampMs, const float* values, size_t count);
+
+    /// <summary>
+    /// Samples dropped because the port could not take them (since begin).
+    /// </summary>
+    uint32_t dropped() const { return droppedCount; }
+
+private:
+    /// <summary>
+    /// Frames a payload and writes it if the TX buffer has room for all of it.
+    /// </summary>
+    /// <returns>False if the frame was not sent</returns>
+    bool sendFrame(uint8_t type, const uint8_t* payload, size_t length);
+
+    Stream* port = nullptr;
+    bool enabled = false;
+    unsigned long schemaIntervalMs = 10000;   ///< Schema repeat interval
+    unsigned long lastSchema = 0;             ///< millis() of the last schema frame sent
+    bool schemaDue = true;                    ///< Schema must precede the next sample
+    uint32_t hash = 0;
+    uint16_t valueCount = 0;
+    uint32_t seq = 0;                         ///< Sequence number of the next frame
+    uint32_t droppedCount = 0;
+    std::vector<uint8_t> schemaPayload;       ///< Encoded once in begin()
+    std::vector<uint8_t> payload;             ///< Scratch for sample payloads
+    std::vector<uint8_t> frame;               ///< Scratch for the framed bytes
+};
+
+#endif // LIVE_STREAM_H
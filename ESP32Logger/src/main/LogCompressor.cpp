@@ -0,0 +1,327 @@
+#include "LogCompressor.h"
+#include <new>
+
+/// <summary>
+/// Raw size recorded in the trailer of a complete compressed file.
+/// </summary>
+/// <returns>False if the file is missing, truncated or not compressed</returns>
+static bool compressedSize(const String& path, uint64_t& rawSize) {
+    File file = SD.open(path, FILE_READ);
+    if (!file) return false;
+
+    uint8_t header[LzCodec::kHeaderSize];
+    uint8_t end[LzCodec::kBlockHeaderSize + LzCodec::kTrailerSize];
+    size_t size = file.size();
+    bool ok = size >= sizeof(header) + sizeof(end) && file.read(header, sizeof(header)) == sizeof(header) &&
+              LzCodec::checkHeader(header, sizeof(header)) && file.seek(size - sizeof(end)) &&
+              file.read(end, sizeof(end)) == sizeof(end);
+    file.close();
+
+    size_t rawLength, dataLength;
+    bool stored;
+    if (!ok || !LzCodec::decodeBlockHeader(end, rawLength, dataLength, stored) || rawLength != 0) return false;
+    uint32_t crc;
+    LzCodec::decodeTrailer(end + LzCodec::kBlockHeaderSize, crc, rawSize);
+    return true;
+}
+
+/// <summary>
+/// The encoder task is created once, pinned to core 0 at the loop's low
+/// priority. If it cannot be created, blocks are encoded in poll().
+/// </summary>
+void LogCompressor::begin(const CompressionSettings& compression, StorageManager* storageManager) {
+    while (busy.load(std::memory_order_acquire)) delay(1);  // A block is at most a few ms of work
+    release();
+    state = State::Idle;
+    pending.clear();
+
+    settings = compression;
+    storage = storageManager;
+    if (!settings.enabled || !storage) return;
+
+    if (!task && xTaskCreatePinnedToCore(workerMain, "lz", kTaskStackBytes, this, tskIDLE_PRIORITY + 1, &task, 0) != pdPASS) {
+        task = nullptr;
+        Serial.println("[LogCompressor][WARN] Cannot create the encoder task, compressing in the loop.");
+    }
+
+    // Catch up with a day that ended while the logger was off
+    lastFile = storage->getCurrentLogFile();
+    enqueue(storage->formatLogFilename((static_cast<int64_t>(time(nullptr)) - 86400) * 1000));
+
+    Serial.printf("[LogCompressor] Enabled: closed day files are compressed %lu s after the day ends.\n",
+                  settings.delayMs / 1000);
+}
+
+void LogCompressor::poll() {
+    if (!settings.enabled || !storage) return;
+
+    watchRollover();
+    switch (state) {
+        case State::Idle:
+            if (!pending.empty() && (long)(millis() - pending.front().dueMs) >= 0) {
+                String path = pending.front().path;
+                pending.erase(pending.begin());
+                start(path);
+            }
+            return;
+        case State::Compress:
+            compressStep();
+            return;
+        case State::Verify:
+            verifyStep();
+            return;
+    }
+}
+
+/// <summary>
+/// A late record for the previous day switches the current file back for a
+/// moment; today's file is never queued.
+/// </summary>
+void LogCompressor::watchRollover() {
+    const String& current = storage->getCurrentLogFile();
+    if (current == lastFile) return;
+
+    String previous = lastFile;
+    lastFile = current;
+    if (previous.length() == 0) return;
+    if (previous == storage->formatLogFilename(static_cast<int64_t>(time(nullptr)) * 1000)) return;
+    enqueue(previous);
+}
+
+void LogCompressor::enqueue(const String& path) {
+    unsigned long dueMs = millis() + settings.delayMs;
+    for (Pending& p : pending) {
+        if (p.path == path) {
+            p.dueMs = dueMs;
+            return;
+        }
+    }
+    if (pending.size() >= kMaxPending) pending.erase(pending.begin());  // Picked up again after a reboot
+    pending.push_back({ path, dueMs });
+}
+
+/// <summary>
+/// A file that is written to again (late records) is postponed. An original
+/// next to a ".lz" is only deleted when the ".lz" holds all of its bytes;
+/// otherwise records were appended after compression and both are kept.
+/// </summary>
+bool LogCompressor::start(const String& path) {
+    if (path == storage->getCurrentLogFile()) {
+        enqueue(path);
+        return false;
+    }
+
+    String lzPath = path + LzCodec::kExtension;
+    tempPath = lzPath + ".tmp";
+    if (SD.exists(tempPath)) SD.remove(tempPath);  // Interrupted run
+    if (!SD.exists(path)) return false;             // Compressed already, or no records that day
+
+    if (SD.exists(lzPath)) {
+        File original = SD.open(path, FILE_READ);
+        uint64_t originalSize = original ? original.size() : 0;
+        if (original) original.close();
+
+        uint64_t rawSize = 0;
+        if (compressedSize(lzPath, rawSize) && rawSize == originalSize) {
+            SD.remove(path);
+            Serial.printf("[LogCompressor] Removed %s, already compressed.\n", path.c_str());
+        } else {
+            Serial.printf("[LogCompressor][WARN] %s and %s differ, both kept.\n", path.c_str(), lzPath.c_str());
+            storage->logError(ErrorCode::Compression, "Day file changed after compression, both copies kept.");
+        }
+        return false;
+    }
+
+    encoder = new (std::nothrow) LzCodec::Encoder();
+    if (!encoder) {
+        Serial.println("[LogCompressor][WARN] Not enough memory for the encoder, retrying later.");
+        enqueue(path);
+        return false;
+    }
+    encoder->reset();
+    input.resize(LzCodec::kBlockSize);
+    encoded.resize(LzCodec::kMaxEncodedBlock);
+
+    source = SD.open(path, FILE_READ);
+    output = SD.open(tempPath, FILE_WRITE);
+    sourcePath = path;
+    state = State::Compress;
+    if (!source || !output) {
+        fail("Failed to open a day file for compression.");
+        return false;
+    }
+
+    uint8_t header[LzCodec::kHeaderSize];
+    LzCodec::encodeHeader(header);
+    if (output.write(header, sizeof(header)) != sizeof(header)) {
+        fail("Short write to a compressed day file.");
+        return false;
+    }
+    outputSize = sizeof(header);
+    crc = 0;
+    rawSize = 0;
+    encodedLength = 0;
+    Serial.printf("[LogCompressor] Compressing %s\n", path.c_str());
+    return true;
+}
+
+/// <summary>
+/// While the task encodes block n, the loop carries on; the next poll writes
+/// it and reads block n + 1.
+/// </summary>
+void LogCompressor::compressStep() {
+    if (busy.load(std::memory_order_acquire)) return;
+
+    if (encodedLength > 0) {
+        if (output.write(encoded.data(), encodedLength) != encodedLength) {
+            fail("Short write to a compressed day file.");
+            return;
+        }
+        outputSize += encodedLength;
+        encodedLength = 0;
+    }
+
+    size_t n = source.read(input.data(), LzCodec::kBlockSize);  // A read error ends early, replace() catches it
+    if (n > 0) {
+        crc = LogFrame::crc32(input.data(), n, crc);
+        rawSize += n;
+        inputLength = n;
+        encodeInput();
+        return;
+    }
+
+    uint8_t end[LzCodec::kBlockHeaderSize + LzCodec::kTrailerSize];
+    LzCodec::encodeEnd(crc, rawSize, end);
+    bool ok = output.write(end, sizeof(end)) == sizeof(end);
+    outputSize += sizeof(end);
+    source.close();
+    output.close();
+    delete encoder;
+    encoder = nullptr;
+    if (!ok) {
+        fail("Short write to a compressed day file.");
+        return;
+    }
+
+    // Read back what reached the card
+    sourceCrc = crc;
+    sourceSize = rawSize;
+    crc = 0;
+    rawSize = 0;
+    decoder = new (std::nothrow) LzCodec::Decoder();
+    output = SD.open(tempPath, FILE_READ);
+    uint8_t header[LzCodec::kHeaderSize];
+    if (!decoder || !output || output.read(header, sizeof(header)) != sizeof(header) ||
+        !LzCodec::checkHeader(header, sizeof(header))) {
+        fail("Failed to verify a compressed day file.");
+        return;
+    }
+    decoder->reset();
+    state = State::Verify;
+}
+
+void LogCompressor::verifyStep() {
+    uint8_t blockHeader[LzCodec::kBlockHeaderSize];
+    size_t rawLength, dataLength;
+    bool stored;
+    if (output.read(blockHeader, sizeof(blockHeader)) != sizeof(blockHeader) ||
+        !LzCodec::decodeBlockHeader(blockHeader, rawLength, dataLength, stored)) {
+        fail("Compressed day file failed verification.");
+        return;
+    }
+
+    if (rawLength == 0) {
+        uint8_t trailer[LzCodec::kTrailerSize];
+        uint32_t trailerCrc;
+        uint64_t trailerSize;
+        bool ok = output.read(trailer, sizeof(trailer)) == sizeof(trailer) && output.position() == output.size();
+        if (ok) LzCodec::decodeTrailer(trailer, trailerCrc, trailerSize);
+        if (!ok || crc != sourceCrc || rawSize != sourceSize || trailerCrc != sourceCrc || trailerSize != sourceSize) {
+            fail("Compressed day file failed verification.");
+            return;
+        }
+        replace();
+        return;
+    }
+
+    const uint8_t* raw;
+    if (output.read(encoded.data(), dataLength) != dataLength ||
+        !decoder->decodeBlock(encoded.data(), dataLength, rawLength, stored, &raw)) {
+        fail("Compressed day file failed verification.");
+        return;
+    }
+    crc = LogFrame::crc32(raw, rawLength, crc);
+    rawSize += rawLength;
+}
+
+/// <summary>
+/// The original is checked once more right before it goes: records appended
+/// during the job would otherwise be lost.
+/// </summary>
+void LogCompressor::replace() {
+    release();
+
+    File original = SD.open(sourcePath, FILE_READ);
+    uint64_t originalSize = original ? original.size() : 0;
+    if (original) original.close();
+    if (originalSize != sourceSize) {
+        fail("Day file grew while it was compressed, kept uncompressed.");
+        return;
+    }
+
+    String lzPath = sourcePath + LzCodec::kExtension;
+    if (!SD.rename(tempPath, lzPath)) {
+        fail("Failed to rename a compressed day file.");
+        return;
+    }
+    if (!SD.remove(sourcePath)) {
+        Serial.printf("[LogCompressor][WARN] Cannot delete %s, retried at the next start.\n", sourcePath.c_str());
+    }
+
+    state = State::Idle;
+    ++compressedFiles;
+    savedBytes += sourceSize > outputSize ? sourceSize - outputSize : 0;
+    Serial.printf("[LogCompressor] %s: %llu → %llu bytes (%.1f %%)\n", lzPath.c_str(),
+                  (unsigned long long)sourceSize, (unsigned long long)outputSize,
+                  sourceSize > 0 ? outputSize * 100.0 / sourceSize : 100.0);
+}
+
+void LogCompressor::fail(const char* message) {
+    release();
+    SD.remove(tempPath);
+    state = State::Idle;
+    Serial.printf("[LogCompressor][ERROR] %s: %s\n", sourcePath.c_str(), message);
+    storage->logError(ErrorCode::Compression, message);
+}
+
+void LogCompressor::release() {
+    if (source) source.close();
+    if (output) output.close();
+    delete encoder;
+    encoder = nullptr;
+    delete decoder;
+    decoder = nullptr;
+    input.clear();
+    input.shrink_to_fit();
+    encoded.clear();
+    encoded.shrink_to_fit();
+    encodedLength = 0;
+}
+
+void LogCompressor::encodeInput() {
+    if (!task) {
+        encodedLength = encoder->encodeBlock(input.data(), inputLength, encoded.data());
+        return;
+    }
+    busy.store(true, std::memory_order_release);
+    xTaskNotifyGive(task);
+}
+
+void LogCompressor::workerMain(void* arg) {
+    LogCompressor* self = static_cast<LogCompressor*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->encodedLength = self->encoder->encodeBlock(self->input.data(), self->inputLength, self->encoded.data());
+        self->busy.store(false, std::memory_order_release);
+    }
+}
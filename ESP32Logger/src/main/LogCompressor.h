@@ -0,0 +1,157 @@
+#ifndef LOG_COMPRESSOR_H
+#define LOG_COMPRESSOR_H
+
+#include <SD.h>
+#include <atomic>
+#include <vector>
+#include "ConfigManager.h"
+#include "StorageManager.h"
+#include "LzCodec.h"
+
+/// <summary>
+/// Replaces closed day files by "<day file>.lz" (see LzCodec.h) to stretch
+/// the SD card. A day file is queued when records move on to the next day's
+/// file (and yesterday's file at startup) and compressed once the configured
+/// delay has passed, so late records from the staging ring are in it.
+///
+/// The SD library is not thread-safe, so all card access stays on the loop
+/// task, one block read or write per poll() from the idle path. Only the
+/// CPU-heavy part, encoding a 4 KB block, is handed to a low-priority task on
+/// core 0 (the loop runs on core 1); poll() returns while it works.
+///
+/// A file is written as "<day file>.lz.tmp", decoded again and checked
+/// against the CRC32 and size of the original, then renamed; the original is
+/// deleted last. The ".idx" time index stays, its offsets refer to the
+/// decompressed data. After a power loss, a leftover ".tmp" is deleted, and an
+/// original next to a complete ".lz" of the same size is deleted.
+/// </summary>
+class LogCompressor {
+public:
+    /// <summary>
+    /// Applies the settings. Abandons a file in progress (it is queued again
+    /// at the next rollover) and queues yesterday's day file.
+    /// </summary>
+    /// <param name="settings">Compression settings</param>
+    /// <param name="storage">Storage manager (day file names, error log)</param>
+    void begin(const CompressionSettings& settings, StorageManager* storage);
+
+    /// <summary>
+    /// Performs one step: queue a closed day file, start a due one, or read,
+    /// write or verify one block. Call from the idle path.
+    /// </summary>
+    void poll();
+
+    /// <summary>
+    /// Returns true while a file is being compressed or verified.
+    /// </summary>
+    bool isBusy() const { return state != State::Idle; }
+
+    /// <summary>
+    /// Day files compressed since startup.
+    /// </summary>
+    uint32_t getCompressedFiles() const { return compressedFiles; }
+
+    /// <summary>
+    /// Bytes freed by compression since startup.
+    /// </summary>
+    uint64_t getSavedBytes() const { return savedBytes; }
+
+private:
+    enum class State : uint8_t {
+        Idle,           ///< Waiting for a due day file
+        Compress,       ///< Reading the day file, encoding, writing the ".tmp"
+        Verify          ///< Decoding the ".tmp" and checking it against the original
+    };
+
+    /// <summary>
+    /// Day file waiting for its delay.
+    /// </summary>
+    struct Pending {
+        String path;
+        unsigned long dueMs;        ///< millis() at which it may be compressed
+    };
+
+    static constexpr size_t kMaxPending = 4;
+    static constexpr uint32_t kTaskStackBytes = 4096;
+
+    /// <summary>
+    /// Queues the previous day file when records moved on to another day.
+    /// </summary>
+    void watchRollover();
+
+    /// <summary>
+    /// Adds a day file to the queue (or postpones it if already queued).
+    /// </summary>
+    void enqueue(const String& path);
+
+    /// <summary>
+    /// Cleans up after an interrupted run and opens the files of a job.
+    /// </summary>
+    /// <returns>True if the job started</returns>
+    bool start(const String& path);
+
+    /// <summary>
+    /// Writes the block the encoder finished and hands it the next one.
+    /// </summary>
+    void compressStep();
+
+    /// <summary>
+    /// Decodes one block of the ".tmp"; at the end block checks CRC and size.
+    /// </summary>
+    void verifyStep();
+
+    /// <summary>
+    /// Renames the verified ".tmp" and deletes the original.
+    /// </summary>
+    void replace();
+
+    /// <summary>
+    /// Abandons the job, deletes the ".tmp" and keeps the original.
+    /// </summary>
+    void fail(const char* message);
+
+    /// <summary>
+    /// Closes the files and releases the codec memory.
+    /// </summary>
+    void release();
+
+    /// <summary>
+    /// Encodes input into encoded, on the worker task or in the caller.
+    /// </summary>
+    void encodeInput();
+
+    /// <summary>
+    /// Worker task: waits for a notification, encodes one block.
+    /// </summary>
+    static void workerMain(void* arg);
+
+    CompressionSettings settings;
+    StorageManager* storage = nullptr;
+    std::vector<Pending> pending;           ///< Closed day files, oldest first
+    String lastFile;                        ///< Day file records went to at the previous poll
+
+    State state = State::Idle;
+    String sourcePath;                      ///< Day file being compressed
+    String tempPath;                        ///< "<day file>.lz.tmp"
+    File source;
+    File output;                            ///< ".tmp", written while compressing, read while verifying
+    LzCodec::Encoder* encoder = nullptr;    ///< Only while compressing (24 KB)
+    LzCodec::Decoder* decoder = nullptr;    ///< Only while verifying (8 KB)
+    std::vector<uint8_t> input;             ///< Raw block handed to the encoder
+    std::vector<uint8_t> encoded;           ///< Encoded block, or block data while verifying
+    size_t inputLength = 0;
+    size_t encodedLength = 0;               ///< Encoded bytes not written yet
+    uint32_t crc = 0;                       ///< CRC32 of the raw data read (or decoded)
+    uint64_t rawSize = 0;                   ///< Raw bytes read (or decoded)
+    uint32_t sourceCrc = 0;                 ///< CRC32 of the original, for the verification
+    uint64_t sourceSize = 0;                ///< Size of the original
+    uint64_t outputSize = 0;                ///< Bytes of the ".tmp"
+
+    TaskHandle_t task = nullptr;            ///< Encoder task (nullptr = encode in the caller)
+    std::atomic<bool> busy{false};          ///< The task owns encoder, input and encoded
+
+    uint32_t compressedFiles = 0;
+    uint64_t savedBytes = 0;
+};
+
+#endif // LOG_COMPRESSOR_H
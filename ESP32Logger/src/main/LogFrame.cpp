@@ -0,0 +1,169 @@
+#include "LogFrame.h"
+#include <string.h>
+
+namespace LogFrame {
+
+const uint8_t kSyncMarker[kSyncSize] = { 0xA5, 0x53, 0x59, 0x4E, 0x43, 0xFF, 0x00, 0x5A };
+
+// Nibble-wise CRC32 table (reflected polynomial 0xEDB88320), 64 bytes of flash
+static const uint32_t kCrcNibbleTable[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static uint16_t readU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t readU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+/// <summary>
+/// Computes CRC32 using a 16-entry nibble table (small flash footprint).
+/// </summary>
+uint32_t crc32(const void* data, size_t len, uint32_t crc) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ kCrcNibbleTable[crc & 0x0F];
+        crc = (crc >> 4) ^ kCrcNibbleTable[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+/// <summary>
+/// Writes magic bytes and payload length.
+/// </summary>
+void encodeHeader(uint16_t payloadLen, uint8_t out[kHeaderSize]) {
+    out[0] = kMagic0;
+    out[1] = kMagic1;
+    out[2] = static_cast<uint8_t>(payloadLen & 0xFF);
+    out[3] = static_cast<uint8_t>(payloadLen >> 8);
+}
+
+/// <summary>
+/// Writes CRC32 over the length field and the payload.
+/// </summary>
+void encodeTrailer(const uint8_t header[kHeaderSize], const void* payload, size_t payloadLen,
+                   uint8_t out[kTrailerSize]) {
+    uint32_t crc = crc32(header + 2, 2);
+    crc = crc32(payload, payloadLen, crc);
+    out[0] = static_cast<uint8_t>(crc);
+    out[1] = static_cast<uint8_t>(crc >> 8);
+    out[2] = static_cast<uint8_t>(crc >> 16);
+    out[3] = static_cast<uint8_t>(crc >> 24);
+}
+
+/// <summary>
+/// Returns true if a full sync marker starts at buf.
+/// </summary>
+bool isSyncAt(const uint8_t* buf, size_t avail) {
+    return avail >= kSyncSize && memcmp(buf, kSyncMarker, kSyncSize) == 0;
+}
+
+/// <summary>
+/// Validates magic, length bounds and CRC of the frame at buf.
+/// </summary>
+size_t frameSizeAt(const uint8_t* buf, size_t avail) {
+    if (avail < kOverhead || buf[0] != kMagic0 || buf[1] != kMagic1) return 0;
+
+    size_t payloadLen = readU16(buf + 2);
+    if (payloadLen == 0 || payloadLen > kMaxPayload) return 0;
+
+    size_t total = payloadLen + kOverhead;
+    if (avail < total) return 0;
+
+    uint32_t crc = crc32(buf + 2, 2);
+    crc = crc32(buf + kHeaderSize, payloadLen, crc);
+    return crc == readU32(buf + kHeaderSize + payloadLen) ? total : 0;
+}
+
+/// <summary>
+/// Skips sync markers and returns the next valid record.
+/// </summary>
+size_t next(const uint8_t* buf, size_t avail, const uint8_t** payload, size_t* payloadLen) {
+    size_t pos = 0;
+    while (isSyncAt(buf + pos, avail - pos)) pos += kSyncSize;
+
+    size_t n = frameSizeAt(buf + pos, avail - pos);
+    if (n == 0) return 0;
+
+    *payload = buf + pos + kHeaderSize;
+    *payloadLen = n - kOverhead;
+    return pos + n;
+}
+
+/// <summary>
+/// Walks frames forward from a candidate resume point.
+/// </summary>
+static RecoveryResult walkFrom(const uint8_t* window, size_t windowLen, uint64_t windowStart,
+                               size_t pos, uint64_t lastSync) {
+    RecoveryResult r = { false, 0, lastSync, 0, false };
+
+    while (pos < windowLen) {
+        if (isSyncAt(window + pos, windowLen - pos)) {
+            r.lastSync = windowStart + pos;
+            r.frames = 0;
+            pos += kSyncSize;
+            continue;
+        }
+        size_t n = frameSizeAt(window + pos, windowLen - pos);
+        if (n == 0) break;
+        pos += n;
+        r.frames++;
+    }
+
+    r.validEnd = windowStart + pos;
+    r.found = (r.frames > 0) || (pos == windowLen) || (r.lastSync != lastSync);
+    return r;
+}
+
+/// <summary>
+/// Scans sync marker candidates from the end of the window towards its start.
+/// If the window begins at file offset 0, the file start is the last candidate.
+/// </summary>
+RecoveryResult findValidEnd(const uint8_t* window, size_t windowLen, uint64_t windowStart) {
+    if (windowLen >= kSyncSize) {
+        for (size_t i = windowLen - kSyncSize + 1; i-- > 0;) {
+            if (window[i] != kMagic0 || !isSyncAt(window + i, windowLen - i)) continue;
+
+            RecoveryResult r = walkFrom(window, windowLen, windowStart, i + kSyncSize, windowStart + i);
+            if (r.found) return r;
+        }
+    }
+
+    if (windowStart == 0) {
+        RecoveryResult r = walkFrom(window, windowLen, 0, 0, 0);
+        r.found = true;  // File start is always a valid resume point
+        return r;
+    }
+
+    RecoveryResult none = { false, windowStart + windowLen, 0, 0, false };
+    return none;
+}
+
+/// <summary>
+/// Each retry reads its whole window again; widening is rare (torn tails
+/// longer than a sync interval) and a single contiguous buffer keeps
+/// findValidEnd() simple.
+/// </summary>
+RecoveryResult recoverTail(uint64_t fileSize, Reader& reader, std::vector<uint8_t>& window) {
+    for (size_t span = kRecoveryWindow; ; span *= 2) {
+        uint64_t windowStart = fileSize > span ? fileSize - span : 0;
+        window.resize(static_cast<size_t>(fileSize - windowStart));
+        if (!window.empty() && !reader.read(windowStart, window.data(), window.size())) {
+            RecoveryResult failed = { false, fileSize, 0, 0, true };
+            return failed;
+        }
+
+        RecoveryResult r = findValidEnd(window.data(), window.size(), windowStart);
+        if (r.found || windowStart == 0 || span >= kMaxRecoveryWindow) return r;
+    }
+}
+
+} // namespace LogFrame
@@ -0,0 +1,140 @@
+#ifndef LOG_FRAME_H
+#define LOG_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/// <summary>
+/// Length-prefixed, CRC32-protected record framing for log files.
+/// This header has no Arduino dependencies so host-side tools can read
+/// the same format the logger writes.
+///
+/// Frame layout (little endian):
+///   [0xA5 0x52] [uint16 payload length] [payload] [uint32 CRC32(length + payload)]
+///
+/// A fixed 8-byte sync marker is inserted whenever more than kSyncInterval bytes
+/// were written since the previous one. Recovery therefore only ever needs to look
+/// at the last kRecoveryWindow bytes of a file, regardless of its size.
+/// </summary>
+namespace LogFrame {
+
+constexpr uint8_t kMagic0 = 0xA5;                ///< First frame magic byte
+constexpr uint8_t kMagic1 = 0x52;                ///< Second frame magic byte ('R')
+constexpr size_t kHeaderSize = 4;                ///< Magic + length
+constexpr size_t kTrailerSize = 4;               ///< CRC32
+constexpr size_t kOverhead = kHeaderSize + kTrailerSize;
+constexpr size_t kMaxPayload = 4096;             ///< Largest accepted record payload
+constexpr size_t kSyncSize = 8;                  ///< Size of the sync marker
+constexpr size_t kSyncInterval = 4096;           ///< Max bytes between two sync markers
+
+/// <summary>
+/// Number of bytes read from the end of a file during recovery.
+/// Always contains the last intact sync marker, even if the newest one was torn.
+/// </summary>
+constexpr size_t kRecoveryWindow = 2 * (kSyncInterval + kSyncSize) + kMaxPayload + kOverhead;
+
+/// <summary>
+/// Largest window recoverTail() widens to when a long torn tail pushed the
+/// sync marker before the newest one out of kRecoveryWindow.
+/// </summary>
+constexpr size_t kMaxRecoveryWindow = 4 * kRecoveryWindow;
+
+/// <summary>
+/// Sync marker byte sequence. Starts with the frame magic byte but the second
+/// byte differs, so it can never be mistaken for a frame header.
+/// </summary>
+extern const uint8_t kSyncMarker[kSyncSize];
+
+/// <summary>
+/// Result of a backward recovery scan.
+/// </summary>
+struct RecoveryResult {
+    bool found;              ///< True if a valid resume point was located
+    uint64_t validEnd;       ///< File offset just past the last valid frame (or marker)
+    uint64_t lastSync;       ///< File offset of the last sync marker (0 = file start)
+    uint32_t frames;         ///< Number of intact frames seen after that sync marker
+    bool readFailed;         ///< recoverTail() only: the file could not be read
+};
+
+/// <summary>
+/// Random access to the file recoverTail() scans.
+/// </summary>
+class Reader {
+public:
+    virtual ~Reader() {}
+
+    /// <summary>
+    /// Reads exactly len bytes at a file offset.
+    /// </summary>
+    /// <returns>False if fewer bytes could be read</returns>
+    virtual bool read(uint64_t offset, uint8_t* out, size_t len) = 0;
+};
+
+/// <summary>
+/// Computes (or continues) a standard IEEE 802.3 CRC32.
+/// </summary>
+/// <param name="data">Input bytes</param>
+/// <param name="len">Number of bytes</param>
+/// <param name="crc">Previous CRC value when computing incrementally (0 to start)</param>
+/// <returns>Updated CRC32</returns>
+uint32_t crc32(const void* data, size_t len, uint32_t crc = 0);
+
+/// <summary>
+/// Writes the 4-byte frame header for a payload of the given length.
+/// </summary>
+void encodeHeader(uint16_t payloadLen, uint8_t out[kHeaderSize]);
+
+/// <summary>
+/// Writes the 4-byte frame trailer (CRC32 over length field and payload).
+/// </summary>
+void encodeTrailer(const uint8_t header[kHeaderSize], const void* payload, size_t payloadLen,
+                   uint8_t out[kTrailerSize]);
+
+/// <summary>
+/// Checks whether a complete sync marker starts at the given position.
+/// </summary>
+bool isSyncAt(const uint8_t* buf, size_t avail);
+
+/// <summary>
+/// Validates a frame starting at buf.
+/// </summary>
+/// <returns>Total frame size in bytes, or 0 if the frame is incomplete or corrupt</returns>
+size_t frameSizeAt(const uint8_t* buf, size_t avail);
+
+/// <summary>
+/// Extracts the next record from a framed byte stream, skipping sync markers.
+/// </summary>
+/// <param name="buf">Start of unread data</param>
+/// <param name="avail">Number of unread bytes</param>
+/// <param name="payload">Receives a pointer to the record payload</param>
+/// <param name="payloadLen">Receives the payload length</param>
+/// <returns>Bytes consumed (0 if no complete, valid record is available)</returns>
+size_t next(const uint8_t* buf, size_t avail, const uint8_t** payload, size_t* payloadLen);
+
+/// <summary>
+/// Locates the end of the last valid frame inside a tail window of a file.
+/// Tries sync markers from the newest backwards and walks frames forward from
+/// each candidate until it finds one that yields intact data.
+/// </summary>
+/// <param name="window">Bytes read from the end of the file</param>
+/// <param name="windowLen">Number of bytes in the window</param>
+/// <param name="windowStart">File offset of window[0]</param>
+RecoveryResult findValidEnd(const uint8_t* window, size_t windowLen, uint64_t windowStart);
+
+/// <summary>
+/// Locates the end of the last valid frame of a file: findValidEnd() on its
+/// last kRecoveryWindow bytes and, while nothing verifies there and the window
+/// does not reach the file start, again on a window twice as large, up to
+/// kMaxRecoveryWindow. A sync marker followed only by torn data verifies
+/// through an older marker, which a long torn tail can push out of the first
+/// window.
+/// </summary>
+/// <param name="fileSize">Size of the file</param>
+/// <param name="reader">Reads the file</param>
+/// <param name="window">Scratch buffer, holds the last window read on return</param>
+RecoveryResult recoverTail(uint64_t fileSize, Reader& reader, std::vector<uint8_t>& window);
+
+} // namespace LogFrame
+
+#endif // LOG_FRAME_H
@@ -0,0 +1,248 @@
+#include "LzCodec.h"
+#include "LogFrame.h"
+#include <string.h>
+
+namespace LzCodec {
+
+static const uint8_t kMagic[4] = { 'R', 'T', 'L', 'Z' };
+static const size_t kMinMatch = 3;
+static const size_t kMaxMatch = kMinMatch + 15 + 255;
+
+static void writeU16(uint16_t value, uint8_t* p) {
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void writeU32(uint32_t value, uint8_t* p) {
+    writeU16(static_cast<uint16_t>(value), p);
+    writeU16(static_cast<uint16_t>(value >> 16), p + 2);
+}
+
+static uint16_t readU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t readU32(const uint8_t* p) {
+    return readU16(p) | (static_cast<uint32_t>(readU16(p + 2)) << 16);
+}
+
+void encodeHeader(uint8_t out[kHeaderSize]) {
+    memcpy(out, kMagic, sizeof(kMagic));
+    out[4] = kVersion;
+    out[5] = static_cast<uint8_t>(kWindowBits);
+    out[6] = 0;
+    out[7] = 0;
+}
+
+bool checkHeader(const uint8_t* buf, size_t avail) {
+    return avail >= kHeaderSize && memcmp(buf, kMagic, sizeof(kMagic)) == 0 && buf[4] == kVersion &&
+           buf[5] == kWindowBits;
+}
+
+void encodeEnd(uint32_t crc, uint64_t rawSize, uint8_t out[kBlockHeaderSize + kTrailerSize]) {
+    memset(out, 0, kBlockHeaderSize);
+    writeU32(crc, out + kBlockHeaderSize);
+    writeU32(static_cast<uint32_t>(rawSize), out + kBlockHeaderSize + 4);
+    writeU32(static_cast<uint32_t>(rawSize >> 32), out + kBlockHeaderSize + 8);
+}
+
+bool decodeBlockHeader(const uint8_t buf[kBlockHeaderSize], size_t& rawLength, size_t& dataLength, bool& stored) {
+    uint16_t data = readU16(buf + 2);
+    rawLength = readU16(buf);
+    stored = (data & kStoredFlag) != 0;
+    dataLength = data & ~kStoredFlag;
+    if (rawLength == 0) return dataLength == 0 && !stored;
+    if (rawLength > kBlockSize) return false;
+    return stored ? dataLength == rawLength : dataLength > 0 && dataLength < rawLength;
+}
+
+void decodeTrailer(const uint8_t buf[kTrailerSize], uint32_t& crc, uint64_t& rawSize) {
+    crc = readU32(buf);
+    rawSize = readU32(buf + 4) | (static_cast<uint64_t>(readU32(buf + 8)) << 32);
+}
+
+// --- Encoder -----------------------------------------------------------------
+
+static inline size_t hash3(const uint8_t* p) {
+    uint32_t v = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+    return (v * 2654435761u) >> (32 - 12);
+}
+
+void Encoder::reset() {
+    fill = 0;
+    memset(head, 0xFF, sizeof(head));
+    memset(prev, 0xFF, sizeof(prev));
+}
+
+/// <summary>
+/// Positions are window offsets, so sliding by exactly kWindow keeps every
+/// prev[] slot (indexed by position mod kWindow) in place.
+/// </summary>
+void Encoder::slide() {
+    memmove(window, window + kWindow, fill - kWindow);
+    fill -= kWindow;
+    for (uint16_t& p : head) p = (p == kNil || p < kWindow) ? kNil : static_cast<uint16_t>(p - kWindow);
+    for (uint16_t& p : prev) p = (p == kNil || p < kWindow) ? kNil : static_cast<uint16_t>(p - kWindow);
+}
+
+void Encoder::insert(size_t pos) {
+    size_t h = hash3(window + pos);
+    prev[pos & (kWindow - 1)] = head[h];
+    head[h] = static_cast<uint16_t>(pos);
+}
+
+/// <summary>
+/// Greedy parse: at every position the longest match found within kMaxChain
+/// candidates is taken, otherwise a literal.
+/// </summary>
+size_t Encoder::encodeBlock(const uint8_t* in, size_t length, uint8_t* out) {
+    if (fill + length > 2 * kWindow) slide();
+    memcpy(window + fill, in, length);
+    size_t pos = fill;
+    size_t end = fill + length;
+    fill = end;
+
+    uint8_t* o = scratch;
+    uint8_t* flags = nullptr;
+    unsigned bit = 8;
+    while (pos < end) {
+        if (bit == 8) {
+            flags = o++;
+            *flags = 0;
+            bit = 0;
+        }
+
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+        if (end - pos >= kMinMatch) {
+            size_t maxLength = end - pos < kMaxMatch ? end - pos : kMaxMatch;
+            size_t candidate = head[hash3(window + pos)];
+            for (size_t chain = 0; candidate != kNil && candidate < pos && chain < kMaxChain; ++chain) {
+                size_t distance = pos - candidate;
+                if (distance >= kWindow) break;
+                if (window[candidate + bestLength] == window[pos + bestLength]) {
+                    size_t n = 0;
+                    while (n < maxLength && window[candidate + n] == window[pos + n]) ++n;
+                    if (n > bestLength) {
+                        bestLength = n;
+                        bestDistance = distance;
+                        if (n == maxLength) break;
+                    }
+                }
+                size_t older = prev[candidate & (kWindow - 1)];
+                if (older >= candidate) break;   // Slot reused by a newer position
+                candidate = older;
+            }
+            insert(pos);
+        }
+
+        if (bestLength >= kMinMatch) {
+            size_t code = bestLength - kMinMatch;
+            *flags |= static_cast<uint8_t>(1u << bit);
+            *o++ = static_cast<uint8_t>(bestDistance);
+            *o++ = static_cast<uint8_t>(((bestDistance >> 8) & 0x0F) | ((code < 15 ? code : 15) << 4));
+            if (code >= 15) *o++ = static_cast<uint8_t>(code - 15);
+            for (size_t p = pos + 1; p < pos + bestLength && end - p >= kMinMatch; ++p) insert(p);
+            pos += bestLength;
+        } else {
+            *o++ = window[pos++];
+        }
+        ++bit;
+    }
+
+    size_t dataLength = static_cast<size_t>(o - scratch);
+    bool stored = dataLength >= length;
+    if (stored) dataLength = length;
+    writeU16(static_cast<uint16_t>(length), out);
+    writeU16(static_cast<uint16_t>(dataLength | (stored ? kStoredFlag : 0)), out + 2);
+    memcpy(out + kBlockHeaderSize, stored ? in : scratch, dataLength);
+    return kBlockHeaderSize + dataLength;
+}
+
+// --- Decoder -----------------------------------------------------------------
+
+void Decoder::reset() {
+    fill = 0;
+}
+
+bool Decoder::decodeBlock(const uint8_t* data, size_t dataLength, size_t rawLength, bool stored, const uint8_t** out) {
+    if (rawLength == 0 || rawLength > kBlockSize) return false;
+    if (fill + rawLength > 2 * kWindow) {
+        memmove(window, window + kWindow, fill - kWindow);
+        fill -= kWindow;
+    }
+    size_t start = fill;
+    size_t end = fill + rawLength;
+
+    if (stored) {
+        if (dataLength != rawLength) return false;
+        memcpy(window + start, data, rawLength);
+    } else {
+        const uint8_t* in = data;
+        const uint8_t* inEnd = data + dataLength;
+        size_t pos = start;
+        uint8_t flags = 0;
+        unsigned bit = 8;
+        while (pos < end) {
+            if (bit == 8) {
+                if (in == inEnd) return false;
+                flags = *in++;
+                bit = 0;
+            }
+            if (flags & (1u << bit++)) {
+                if (inEnd - in < 2) return false;
+                size_t distance = in[0] | ((in[1] & 0x0F) << 8);
+                size_t length = (in[1] >> 4) + kMinMatch;
+                in += 2;
+                if (length == 15 + kMinMatch) {
+                    if (in == inEnd) return false;
+                    length += *in++;
+                }
+                if (distance == 0 || distance > pos || length > end - pos) return false;
+                for (size_t i = 0; i < length; ++i, ++pos) window[pos] = window[pos - distance];
+            } else {
+                if (in == inEnd) return false;
+                window[pos++] = *in++;
+            }
+        }
+        if (in != inEnd) return false;
+    }
+    fill = end;
+    *out = window + start;
+    return true;
+}
+
+bool decompress(const uint8_t* in, size_t length, std::vector<uint8_t>& out) {
+    out.clear();
+    if (!checkHeader(in, length)) return false;
+
+    Decoder decoder;
+    decoder.reset();
+    uint32_t crc = 0;
+    size_t pos = kHeaderSize;
+    for (;;) {
+        size_t rawLength, dataLength;
+        bool stored;
+        if (length - pos < kBlockHeaderSize || !decodeBlockHeader(in + pos, rawLength, dataLength, stored)) {
+            return false;
+        }
+        pos += kBlockHeaderSize;
+        if (rawLength == 0) break;
+
+        const uint8_t* raw;
+        if (length - pos < dataLength || !decoder.decodeBlock(in + pos, dataLength, rawLength, stored, &raw)) {
+            return false;
+        }
+        pos += dataLength;
+        crc = LogFrame::crc32(raw, rawLength, crc);
+        out.insert(out.end(), raw, raw + rawLength);
+    }
+
+    uint32_t expectedCrc;
+    uint64_t rawSize;
+    if (length - pos != kTrailerSize) return false;
+    decodeTrailer(in + pos, expectedCrc, rawSize);
+    return crc == expectedCrc && rawSize == out.size();
+}
+
+} // namespace LzCodec
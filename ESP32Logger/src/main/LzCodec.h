@@ -0,0 +1,146 @@
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/// <summary>
+/// Streaming LZSS codec for closed day files ("<day file>.lz"), small enough
+/// for the logger: the encoder needs 24 KB, the decoder 8 KB, and both work
+/// on blocks of up to 4 KB, so a file of any size is handled in bounded RAM.
+/// Matches reach back 4 KB across block boundaries, which suits NDJSON whose
+/// lines repeat the same keys and units. This header has no Arduino
+/// dependencies so host-side tools can read what the logger writes.
+///
+/// File layout (little endian):
+///   Header   "RTLZ" [uint8 version] [uint8 window bits] [uint16 0]
+///   Block    [uint16 raw length] [uint16 data length | kStoredFlag] [data]
+///   End      [uint16 0] [uint16 0] [uint32 CRC32 of the raw data] [uint64 raw size]
+///
+/// Block data is a sequence of groups: one flag byte, then 8 tokens (bit i set:
+/// token i is a match). A literal is one byte; a match is two bytes,
+/// distance (12 bits, 1..4095) and length - 3 (4 bits), with one more byte
+/// added to the length when those 4 bits are all set (lengths 3..273).
+/// A block that does not shrink is stored raw (kStoredFlag).
+/// </summary>
+namespace LzCodec {
+
+constexpr uint8_t kVersion = 1;
+constexpr size_t kWindowBits = 12;
+constexpr size_t kWindow = size_t(1) << kWindowBits;       ///< History a match can reach
+constexpr size_t kBlockSize = kWindow;                      ///< Largest raw block
+constexpr size_t kHeaderSize = 8;
+constexpr size_t kBlockHeaderSize = 4;
+constexpr size_t kTrailerSize = 12;                         ///< CRC32 and raw size after the end block header
+constexpr uint16_t kStoredFlag = 0x8000;
+constexpr size_t kMaxBlockData = kBlockSize + kBlockSize / 8 + 1;       ///< Worst case before falling back to stored
+constexpr size_t kMaxEncodedBlock = kBlockHeaderSize + kBlockSize;      ///< encodeBlock() output bound
+constexpr const char* kExtension = ".lz";
+
+/// <summary>
+/// Writes the file header.
+/// </summary>
+void encodeHeader(uint8_t out[kHeaderSize]);
+
+/// <summary>
+/// Checks a file header (magic, version, window size).
+/// </summary>
+bool checkHeader(const uint8_t* buf, size_t avail);
+
+/// <summary>
+/// Writes the end block: an empty block header followed by the trailer.
+/// </summary>
+void encodeEnd(uint32_t crc, uint64_t rawSize, uint8_t out[kBlockHeaderSize + kTrailerSize]);
+
+/// <summary>
+/// Reads a block header.
+/// </summary>
+/// <param name="rawLength">Receives the raw length (0 = end block)</param>
+/// <param name="dataLength">Receives the number of data bytes that follow</param>
+/// <param name="stored">Receives true if the data is the raw block</param>
+/// <returns>False if the header is invalid</returns>
+bool decodeBlockHeader(const uint8_t buf[kBlockHeaderSize], size_t& rawLength, size_t& dataLength, bool& stored);
+
+/// <summary>
+/// Reads the trailer after the end block header.
+/// </summary>
+void decodeTrailer(const uint8_t buf[kTrailerSize], uint32_t& crc, uint64_t& rawSize);
+
+/// <summary>
+/// Compresses a stream block by block. Hash chains are walked at most
+/// kMaxChain steps per position, which bounds the time per block.
+/// </summary>
+class Encoder {
+public:
+    static constexpr size_t kMaxChain = 32;
+
+    /// <summary>
+    /// Starts a new stream (forgets the history).
+    /// </summary>
+    void reset();
+
+    /// <summary>
+    /// Compresses the next block of the stream.
+    /// </summary>
+    /// <param name="in">Raw bytes</param>
+    /// <param name="length">1..kBlockSize</param>
+    /// <param name="out">Room for kMaxEncodedBlock bytes; receives header and data</param>
+    /// <returns>Bytes written</returns>
+    size_t encodeBlock(const uint8_t* in, size_t length, uint8_t* out);
+
+private:
+    static constexpr size_t kHashBits = 12;
+    static constexpr uint16_t kNil = 0xFFFF;
+
+    /// <summary>
+    /// Makes room for a block by dropping the oldest kWindow bytes.
+    /// </summary>
+    void slide();
+
+    void insert(size_t pos);
+
+    uint8_t window[2 * kWindow];        ///< History followed by the current block
+    uint16_t head[size_t(1) << kHashBits];  ///< Newest position per hash of 3 bytes
+    uint16_t prev[kWindow];             ///< Previous position with the same hash
+    size_t fill = 0;                    ///< Bytes in window
+    uint8_t scratch[kMaxBlockData];     ///< Token output before the stored / compressed decision
+};
+
+/// <summary>
+/// Decompresses a stream block by block.
+/// </summary>
+class Decoder {
+public:
+    void reset();
+
+    /// <summary>
+    /// Decodes the data of the next block.
+    /// </summary>
+    /// <param name="data">Block data (after the block header)</param>
+    /// <param name="dataLength">Bytes of data</param>
+    /// <param name="rawLength">Raw length from the block header</param>
+    /// <param name="stored">Stored flag from the block header</param>
+    /// <param name="out">Receives the decoded bytes (valid until the next call)</param>
+    /// <returns>False if the data is corrupt</returns>
+    bool decodeBlock(const uint8_t* data, size_t dataLength, size_t rawLength, bool stored, const uint8_t** out);
+
+private:
+    uint8_t window[2 * kWindow];
+    size_t fill = 0;
+};
+
+/// <summary>
+/// True if buf starts with a compressed file header.
+/// </summary>
+inline bool isCompressed(const uint8_t* buf, size_t avail) { return checkHeader(buf, avail); }
+
+/// <summary>
+/// Decompresses a whole file held in memory and checks size and CRC.
+/// </summary>
+/// <returns>False if the data is truncated or corrupt</returns>
+bool decompress(const uint8_t* in, size_t length, std::vector<uint8_t>& out);
+
+} // namespace LzCodec
+
+#endif // LZ_CODEC_H
@@ -1,15 +1,8 @@
 #include "ModbusManager.h"
-#include <ModbusMaster.h>
-#include <stack>
+#include "Trace.h"
+#include <algorithm>
 #include <vector>
 
-// Static RX/TX pin assignments for hardware serial (UART1)
-static const int MODBUS_RX_PIN = 17;
-static const int MODBUS_TX_PIN = 16;
-static int deRePin = 4;  // DE/RE pin for RS485 direction control
-static ConfigManager* config = nullptr;
-static ModbusMaster node; // Global ModbusMaster instance
-
 /// <summary>
 /// Converts a Modbus error code into a human-readable string.
 /// </summary>
@@ -42,42 +35,73 @@ void ModbusManager::setConfig(ConfigManager* cfg) {
 }
 
 /// <summary>
-/// RS485 pre-transmission callback: sets DE/RE pin HIGH to enable transmit.
-/// </summary>
-void preTransmission() {
-    if (deRePin >= 0)
-        digitalWrite(deRePin, HIGH);
-}
-
-/// <summary>
-/// RS485 post-transmission callback: sets DE/RE pin LOW to enable receive.
+/// Maps data bits, parity and stop bits to the UART frame format.
+/// Modbus uses 8 data bits (RTU) or 7 (ASCII); anything else falls back to 8N1.
 /// </summary>
-void postTransmission() {
-    if (deRePin >= 0)
-        digitalWrite(deRePin, LOW);
+static bool serialConfig(const ModbusSettings& settings, uint32_t& config) {
+    static const uint32_t formats[2][3][2] = {
+        // 7 data bits: N1, N2, E1, E2, O1, O2
+        {{SERIAL_7N1, SERIAL_7N2}, {SERIAL_7E1, SERIAL_7E2}, {SERIAL_7O1, SERIAL_7O2}},
+        // 8 data bits
+        {{SERIAL_8N1, SERIAL_8N2}, {SERIAL_8E1, SERIAL_8E2}, {SERIAL_8O1, SERIAL_8O2}},
+    };
+    int bits = settings.data_bits == 7 ? 0 : settings.data_bits == 8 ? 1 : -1;
+    int parity = settings.parity == 'N' ? 0 : settings.parity == 'E' ? 1 : settings.parity == 'O' ? 2 : -1;
+    int stop = settings.stop_bits == 1 ? 0 : settings.stop_bits == 2 ? 1 : -1;
+    if (bits < 0 || parity < 0 || stop < 0) {
+        config = SERIAL_8N1;
+        return false;
+    }
+    config = formats[bits][parity][stop];
+    return true;
 }
 
 /// <summary>
-/// Initializes UART1 and ModbusMaster for Modbus RTU communication over RS485.
+/// Initializes the bus's UART and the RTU master for Modbus RTU communication over RS485.
 /// </summary>
-void ModbusManager::begin(const ModbusSettings& settings) {
-    Serial.println("[ModbusManager] Initializing UART1 for RS485...");
-    Serial.printf("  - RX pin: %d, TX pin: %d, DE/RE pin: %d\n", MODBUS_RX_PIN, MODBUS_TX_PIN, deRePin);
+void ModbusManager::begin(const ModbusSettings& settings, size_t index) {
+    bus = index;
+    Serial.printf("[ModbusManager] Initializing UART%u for RS485 bus %u...\n", settings.uart, (unsigned)bus);
+    Serial.printf("  - RX pin: %d, TX pin: %d, DE/RE pin: %d\n", settings.rx_pin, settings.tx_pin, settings.de_re_pin);
     Serial.printf("  - Baudrate: %ld, Parity: %c, Stop Bits: %d, Data Bits: %d\n",
                   settings.baudrate, settings.parity, settings.stop_bits, settings.data_bits);
 
-    Serial1.begin(settings.baudrate, SERIAL_8N1, MODBUS_RX_PIN, MODBUS_TX_PIN);
-    pinMode(deRePin, OUTPUT);
-    digitalWrite(deRePin, LOW);
-
-    node.begin(settings.slave_id, Serial1);
-    node.preTransmission(preTransmission);
-    node.postTransmission(postTransmission);
+    uint32_t format;
+    line = {static_cast<uint32_t>(settings.baudrate), settings.data_bits, settings.parity, settings.stop_bits};
+    if (!serialConfig(settings, format)) {
+        Serial.println("[ModbusManager][WARN] Unsupported data bits / parity / stop bits, using 8N1.");
+        line = {static_cast<uint32_t>(settings.baudrate), 8, 'N', 1};
+    }
+    portENTER_CRITICAL(&statsLock);
+    busStats = BusStats();
+    portEXIT_CRITICAL(&statsLock);
+
+    end();
+    if (settings.uart == 1) {
+        port = &Serial1;
+    } else if (settings.uart == 2) {
+        port = &Serial2;
+    } else {
+        Serial.printf("[ModbusManager][ERROR] Bus %u has no UART, not opened.\n", (unsigned)bus);
+    }
+    if (port) port->begin(settings.baudrate, format, settings.rx_pin, settings.tx_pin);
+    transport.begin(port, settings.de_re_pin);
+    capture.begin(&transport, static_cast<uint8_t>(bus), 0);
+    master.begin(&capture, settings.slave_id, line);
 
     Serial.printf("[ModbusManager] Modbus slave ID set to %d\n", settings.slave_id);
     Serial.println("[ModbusManager] Modbus interface initialized successfully.");
 }
 
+/// <summary>
+/// Releases the UART; requests fail until begin() is called again.
+/// </summary>
+void ModbusManager::end() {
+    if (port) port->end();
+    port = nullptr;
+    transport.begin(nullptr, -1);
+}
+
 /// <summary>
 /// Sets voltage and current transformer ratios used in scaling expressions.
 /// </summary>
@@ -87,118 +111,128 @@ void ModbusManager::setTransformers(float vtr, float ctr) {
     Serial.printf("[ModbusManager] Set VTR = %.3f, CTR = %.3f\n", currentVTR, currentCTR);
 }
 
-// Operator precedence (for + - * /)
-int precedence(char op) {
-    if (op == '+' || op == '-') return 1;
-    if (op == '*' || op == '/') return 2;
-    return 0;
-}
+/// <summary>
+/// Reads one register (all of its words) and applies its compiled scaling.
+/// </summary>
+uint8_t ModbusManager::readScaled(const RegisterConfig& reg, float& decoded, float& value) {
+    uint16_t modbusAddress = reg.register_address;
+    if (config && config->isAddressOffsetEnabled()) {
+        modbusAddress -= 1;
+    }
 
-// Apply an operation between two float values
-float applyOp(float a, float b, char op) {
-    switch (op) {
-        case '+': return a + b;
-        case '-': return a - b;
-        case '*': return a * b;
-        case '/': return (b != 0.0f) ? a / b : NAN;
-        default: return NAN;
+    uint16_t count = RegisterMap::wordCount(reg.dataType);
+    if (reg.length > count) count = reg.length < RegisterMap::kMaxBlockWords ? reg.length : RegisterMap::kMaxBlockWords;
+    uint16_t raw[RegisterMap::kMaxBlockWords];
+    uint8_t result = transfer(modbusAddress, count, raw);
+    if (result == RtuMaster::kSuccess) {
+        decoded = RegisterMap::decode(reg.dataType, raw);
+        value = reg.applyScaling(decoded, currentVTR, currentCTR);
+    } else {
+        decoded = NAN;
+        value = NAN;
     }
+    return result;
 }
 
 /// <summary>
-/// Evaluates a simple math expression with variables: val, VTR, CTR.
-/// Example: "val * 0.1 * CTR / VTR"
+/// Reads one block of the read plan and scales every register in it.
+/// Blocks of the compiled map decode through their generated function.
 /// </summary>
-float evaluateExpression(String expr, float val, float VTR, float CTR) {
-    expr.replace("val", String(val, 6));
-    expr.replace("VTR", String(VTR, 6));
-    expr.replace("CTR", String(CTR, 6));
-    expr.replace(" ", "");
-
-    std::stack<float> values;
-    std::stack<char> ops;
-    int i = 0;
-
-    while (i < expr.length()) {
-        char c = expr[i];
-
-        if (isdigit(c) || c == '.') {
-            String numStr;
-            while (i < expr.length() && (isdigit(expr[i]) || expr[i] == '.')) {
-                numStr += expr[i++];
-            }
-            values.push(numStr.toFloat());
-            continue;
-        }
-
-        if (c == '(') {
-            ops.push(c);
-        } else if (c == ')') {
-            while (!ops.empty() && ops.top() != '(') {
-                if (values.size() < 2) return NAN;
-                float b = values.top(); values.pop();
-                float a = values.top(); values.pop();
-                char op = ops.top(); ops.pop();
-                values.push(applyOp(a, b, op));
-            }
-            if (!ops.empty()) ops.pop();
-        } else if (c == '+' || c == '-' || c == '*' || c == '/') {
-            while (!ops.empty() && precedence(ops.top()) >= precedence(c)) {
-                if (values.size() < 2) return NAN;
-                float b = values.top(); values.pop();
-                float a = values.top(); values.pop();
-                char op = ops.top(); ops.pop();
-                values.push(applyOp(a, b, op));
-            }
-            ops.push(c);
-        }
-        i++;
+uint8_t ModbusManager::readBlock(const RegisterMap::Block& block, const RegisterMap::Slot* slots,
+                                 const RegisterConfig* regs, float* out) {
+    uint16_t modbusAddress = block.address;
+    if (config && config->isAddressOffsetEnabled()) {
+        modbusAddress -= 1;
     }
 
-    while (!ops.empty()) {
-        if (values.size() < 2) return NAN;
-        float b = values.top(); values.pop();
-        float a = values.top(); values.pop();
-        char op = ops.top(); ops.pop();
-        values.push(applyOp(a, b, op));
+    uint16_t words[RegisterMap::kMaxBlockWords];
+    uint8_t result = transfer(modbusAddress, block.count, words);
+    if (result != RtuMaster::kSuccess) {
+        for (uint16_t i = 0; i < block.slotCount; ++i) out[slots[block.firstSlot + i].reg] = NAN;
+        return result;
     }
 
-    return values.empty() ? NAN : values.top();
+    if (block.decode) {
+        block.decode(words, currentVTR, currentCTR, out);
+        return result;
+    }
+    for (uint16_t i = 0; i < block.slotCount; ++i) {
+        const RegisterMap::Slot& slot = slots[block.firstSlot + i];
+        const RegisterConfig& reg = regs[slot.reg];
+        out[slot.reg] = reg.applyScaling(RegisterMap::decode(reg.dataType, words + slot.offset), currentVTR, currentCTR);
+    }
+    return result;
 }
 
 /// <summary>
-/// Reads and scales all configured registers.
-/// If a read fails, NAN is inserted in place of the value.
+/// Reads and scales the registers of this bus, one request per block of the
+/// bus's read plan (one request per register if no plan matches the range).
+/// If a read fails, NAN is inserted in place of the affected values.
 /// </summary>
-std::vector<float> ModbusManager::readAll(const std::vector<RegisterConfig>& regs) {
-    std::vector<float> results;
-    Serial.println("[ModbusManager] Starting Modbus read of all configured registers...");
-
-    for (const auto& reg : regs) {
-        uint16_t modbusAddress = reg.register_address;
-        if (config && config->isAddressOffsetEnabled()) {
-            modbusAddress -= 1;
+uint32_t ModbusManager::readAll(const std::vector<RegisterConfig>& regs, float* out, bool verbose) {
+    TRACE_SCOPE("modbus.bus", bus);
+    size_t first = config ? config->getBusFirstRegister(bus) : 0;
+    size_t count = config ? config->getBusRegisterCount(bus) : regs.size();
+    if (first > regs.size()) first = regs.size();
+    if (count > regs.size() - first) count = regs.size() - first;
+    const RegisterConfig* busRegs = regs.data() + first;
+    float* results = out + first;
+    std::fill(results, results + count, NAN);
+    uint32_t failed = 0;
+    if (verbose) Serial.printf("[ModbusManager] Starting Modbus read of %u register(s) on bus %u...\n", (unsigned)count, (unsigned)bus);
+
+    const RegisterMap::ReadPlan* plan = config ? &config->getReadPlan(bus) : nullptr;
+    if (plan && plan->slotCount == count && plan->blockCount > 0) {
+        for (size_t b = 0; b < plan->blockCount; ++b) {
+            const RegisterMap::Block& block = plan->blocks[b];
+            if (verbose) Serial.printf("  > Reading block @ %u, %u word(s), %u register(s)... ",
+                                       block.address, block.count, block.slotCount);
+            uint8_t result = readBlock(block, plan->slots, busRegs, results);
+            if (result != RtuMaster::kSuccess) {
+                ++failed;
+                if (verbose) Serial.printf("FAIL (code 0x%02X = %s)\n", result, modbusErrorToStr(result));
+                continue;
+            }
+            if (!verbose) continue;
+            Serial.println("OK");
+            for (uint16_t i = 0; i < block.slotCount; ++i) {
+                uint16_t r = plan->slots[block.firstSlot + i].reg;
+                Serial.printf("    ↪ [%s] = %.3f %s\n", busRegs[r].key.c_str(), results[r], busRegs[r].unit.c_str());
+            }
         }
-
-        Serial.printf("  > Reading [%s] @ %u (%s)... ", reg.key.c_str(), modbusAddress, reg.type.c_str());
-
-        uint8_t result = node.readHoldingRegisters(modbusAddress, reg.length);
-
-        if (result == node.ku8MBSuccess) {
-            uint16_t raw = node.getResponseBuffer(0);
-            Serial.printf("    ↪ Scaling expr: %s | val = %u | VTR = %.2f | CTR = %.2f\n",
-                reg.scaling.c_str(), raw, currentVTR, currentCTR);
-            float scaledValue = evaluateExpression(reg.scaling, raw, currentVTR, currentCTR);
-            results.push_back(scaledValue);
-            Serial.printf("OK (raw = %d → scaled = %.3f)\n", raw, scaledValue);
-        } else {
-            results.push_back(NAN);
-            Serial.printf("FAIL (code 0x%02X = %s)\n", result, modbusErrorToStr(result));
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            const RegisterConfig& reg = busRegs[i];
+            if (verbose) Serial.printf("  > Reading [%s] @ %u (%s)... ", reg.key.c_str(), reg.register_address,
+                                       RegisterMap::typeName(reg.dataType));
+
+            float decoded;
+            uint8_t result = readScaled(reg, decoded, results[i]);
+            if (result != RtuMaster::kSuccess) ++failed;
+            if (!verbose) continue;
+            if (result == RtuMaster::kSuccess) {
+                Serial.printf("OK (val = %.3f → scaled = %.3f)\n", decoded, results[i]);
+            } else {
+                Serial.printf("FAIL (code 0x%02X = %s)\n", result, modbusErrorToStr(result));
+            }
         }
     }
 
-    Serial.printf("[ModbusManager] Finished Modbus read. %d value(s) retrieved.\n", results.size());
-    return results;
+    if (verbose) Serial.printf("[ModbusManager] Finished Modbus read on bus %u, %lu failed request(s).\n",
+                               (unsigned)bus, (unsigned long)failed);
+    return failed;
+}
+
+/// <summary>
+/// Reads and scales registers into an array, silently.
+/// </summary>
+bool ModbusManager::readInto(const std::vector<RegisterConfig>& regs, float* out) {
+    bool allOk = true;
+    for (size_t i = 0; i < regs.size(); ++i) {
+        float decoded;
+        if (readScaled(regs[i], decoded, out[i]) != RtuMaster::kSuccess) allOk = false;
+    }
+    return allOk;
 }
 
 /// <summary>
@@ -211,9 +245,8 @@ bool ModbusManager::readRegister(uint16_t reg, uint16_t* outValue) {
         address -= 1;
     }
 
-    uint8_t result = node.readHoldingRegisters(address, 1);
-    if (result == node.ku8MBSuccess) {
-        *outValue = node.getResponseBuffer(0);
+    uint8_t result = transfer(address, 1, outValue);
+    if (result == RtuMaster::kSuccess) {
         return true;
     } else {
         Serial.printf("[ModbusManager][ERROR] ❌ Reading register %u failed: code 0x%02X (%s)\n",
@@ -222,8 +255,76 @@ bool ModbusManager::readRegister(uint16_t reg, uint16_t* outValue) {
     }
 }
 
+/// <summary>
+/// Reads a run of raw registers in one request, silently. Applies offset if enabled.
+/// </summary>
+uint8_t ModbusManager::readRaw(uint16_t address, uint16_t count, uint16_t* out) {
+    if (config && config->isAddressOffsetEnabled()) {
+        address -= 1;
+    }
+    return transfer(address, count, out);
+}
+
+/// <summary>
+/// Single read request on the bus address, copying the answer on success.
+/// Every transaction is timed: the bus time is accumulated and, for answered
+/// requests, the slave turnaround (time not explained by the wire model) is
+/// smoothed into the statistics.
+/// </summary>
+uint8_t ModbusManager::transfer(uint16_t wireAddress, uint16_t count, uint16_t* out) {
+    TRACE_SCOPE("modbus.request", wireAddress);
+    unsigned long startedUs = micros();
+    uint8_t result = master.readHoldingRegisters(wireAddress, count, out);
+    uint32_t elapsedUs = static_cast<uint32_t>(micros() - startedUs);
+
+    uint32_t turnaround = result == RtuMaster::kSuccess ? BusTiming::turnaroundFromMeasured(line, count, elapsedUs) : 0;
+    portENTER_CRITICAL(&statsLock);     // The console reads the statistics from another task
+    ++busStats.transactions;
+    busStats.busyUs += elapsedUs;
+    if (result == RtuMaster::kSuccess) {
+        busStats.turnaroundUs = busStats.turnaroundUs ? (busStats.turnaroundUs * 7 + turnaround) / 8 : turnaround;
+        if (turnaround > busStats.maxTurnaroundUs) busStats.maxTurnaroundUs = turnaround;
+    } else {
+        ++busStats.failures;
+    }
+    portEXIT_CRITICAL(&statsLock);
+    if (result != RtuMaster::kSuccess) TRACE_INSTANT("modbus.fail", result);
+    return result;
+}
+
+/// <summary>
+/// Runs RegisterMap::discover() on the bus. Illegal Data Address and Illegal
+/// Data Value (sent by some devices for reads crossing the end of a table)
+/// count as unreadable; any other error stops the discovery.
+/// </summary>
+bool ModbusManager::discover(uint16_t first, uint16_t last, std::vector<RegisterMap::Range>& valid,
+                             uint32_t& requests, bool applyOffset) {
+    bool useOffset = applyOffset && config && config->isAddressOffsetEnabled();
+    uint8_t lastError = RtuMaster::kSuccess;
+    uint16_t errorAddress = 0;
+
+    RegisterMap::ProbeFn probe = [&](uint16_t address, uint16_t count) {
+        uint8_t result = transfer(useOffset ? address - 1 : address, count, nullptr);
+        if (result == RtuMaster::kSuccess) return RegisterMap::ProbeResult::Valid;
+        if (result == RtuMaster::kIllegalDataAddress || result == RtuMaster::kIllegalDataValue) {
+            return RegisterMap::ProbeResult::Invalid;
+        }
+        lastError = result;
+        errorAddress = address;
+        return RegisterMap::ProbeResult::Failed;
+    };
+
+    bool ok = RegisterMap::discover(first, last, probe, valid, requests);
+    if (!ok) {
+        Serial.printf("[ModbusManager][ERROR] ❌ Discovery stopped at register %u: code 0x%02X (%s)\n",
+                      errorAddress, lastError, modbusErrorToStr(lastError));
+    }
+    return ok;
+}
+
 /// <summary>
 /// Scans a range of Modbus registers and prints values for debugging.
+/// The readable registers are found with discover(), then read in blocks.
 /// Optionally applies offset correction.
 /// </summary>
 void ModbusManager::scanRange(uint16_t start, uint16_t end, bool applyOffset) {
@@ -232,19 +333,32 @@ void ModbusManager::scanRange(uint16_t start, uint16_t end, bool applyOffset) {
     Serial.printf("\n🔍 [ModbusManager] Scanning Modbus registers from %u to %u (offset: %s)...\n",
                   start, end, useOffset ? "enabled" : "disabled");
 
-    for (uint16_t addr = start; addr <= end; ++addr) {
-        uint16_t realAddr = useOffset ? addr - 1 : addr;
-
-        uint8_t result = node.readHoldingRegisters(realAddr, 1);
-        if (result == node.ku8MBSuccess) {
-            uint16_t value = node.getResponseBuffer(0);
-            Serial.printf("  ✅ Reg %u [%u] → %u (0x%04X)\n", addr, realAddr, value, value);
-        } else {
-            Serial.printf("  ❌ Reg %u [%u] → Read failed (0x%02X = %s)\n",
-                          addr, realAddr, result, modbusErrorToStr(result));
+    unsigned long startedMs = millis();
+    std::vector<RegisterMap::Range> valid;
+    uint32_t requests = 0;
+    discover(start, end, valid, requests, applyOffset);
+
+    uint32_t readable = 0;
+    uint16_t words[RegisterMap::kMaxBlockWords];
+    for (const RegisterMap::Range& range : valid) {
+        for (uint32_t done = 0; done < range.count; done += RegisterMap::kMaxBlockWords) {
+            uint16_t addr = static_cast<uint16_t>(range.address + done);
+            uint16_t count = static_cast<uint16_t>(std::min<uint32_t>(RegisterMap::kMaxBlockWords, range.count - done));
+            uint16_t realAddr = useOffset ? addr - 1 : addr;
+            ++requests;
+            uint8_t result = transfer(realAddr, count, words);
+            if (result != RtuMaster::kSuccess) {
+                Serial.printf("  ❌ Reg %u..%u [%u] → Read failed (0x%02X = %s)\n",
+                              addr, addr + count - 1, realAddr, result, modbusErrorToStr(result));
+                continue;
+            }
+            for (uint16_t i = 0; i < count; ++i) {
+                Serial.printf("  ✅ Reg %u [%u] → %u (0x%04X)\n", addr + i, realAddr + i, words[i], words[i]);
+            }
+            readable += count;
         }
-        delay(10);
     }
 
-    Serial.println("🔍 [ModbusManager] Scan completed.\n");
+    Serial.printf("🔍 [ModbusManager] Scan completed: %lu readable register(s) in %u range(s), %lu request(s), %lu ms.\n\n",
+                  (unsigned long)readable, (unsigned)valid.size(), (unsigned long)requests, millis() - startedMs);
 }
@@ -2,12 +2,29 @@
 #define MODBUS_MANAGER_H
 
 #include "ConfigManager.h"
+#include "BusTiming.h"
+#include "CaptureTransport.h"
+#include "RtuMaster.h"
+#include "UartTransport.h"
 
 /// <summary>
-/// Handles Modbus RTU communication and scaling of raw register values.
+/// Measured bus activity, accumulated since begin().
+/// </summary>
+struct BusStats {
+    uint32_t transactions = 0;      ///< Read requests sent
+    uint32_t failures = 0;          ///< Requests without a valid answer
+    uint64_t busyUs = 0;            ///< Time spent inside requests
+    uint32_t turnaroundUs = 0;      ///< Smoothed slave turnaround (0 = not measured yet)
+    uint32_t maxTurnaroundUs = 0;   ///< Largest turnaround seen
+};
+
+/// <summary>
+/// Handles Modbus RTU communication and scaling of raw register values on one
+/// RS485 bus. One instance per bus (see BusPoller); instances share nothing,
+/// so different buses can be read from different tasks at the same time.
 /// Responsible for:
-/// - UART and ModbusMaster initialization
-/// - Reading and decoding registers
+/// - UART, DE/RE pin and RtuMaster initialization
+/// - Reading and decoding registers, grouped into block reads
 /// - Applying custom scaling formulas (e.g., "val * 0.1 * VTR")
 /// </summary>
 class ModbusManager {
@@ -15,6 +32,7 @@ public:
     /// <summary>
     /// Scans a range of Modbus registers and prints values via Serial for debugging.
     /// Useful for reverse-engineering unknown devices or diagnostics.
+    /// Readable registers are located with multi-register probes (see discover()).
     /// </summary>
     /// <param name="start">Start address</param>
     /// <param name="end">End address</param>
@@ -29,11 +47,17 @@ public:
     static const char* modbusErrorToStr(uint8_t code);
 
     /// <summary>
-    /// Initializes the Modbus communication interface.
-    /// Sets up UART and ModbusMaster with parameters from ModbusSettings.
+    /// Initializes the Modbus communication interface of a bus.
+    /// Sets up the UART, the DE/RE pin and the RTU master from ModbusSettings.
     /// </summary>
     /// <param name="settings">Modbus configuration parameters</param>
-    void begin(const ModbusSettings& settings);
+    /// <param name="bus">Bus index (selects the bus's registers and read plan)</param>
+    void begin(const ModbusSettings& settings, size_t bus = 0);
+
+    /// <summary>
+    /// Closes the UART (bus removed from the configuration).
+    /// </summary>
+    void end();
 
     /// <summary>
     /// Sets transformer scaling ratios.
@@ -44,12 +68,24 @@ public:
     void setTransformers(float vtr, float ctr);
 
     /// <summary>
-    /// Reads all Modbus registers defined in the given configuration list.
-    /// Returns scaled float values using expressions from RegisterConfig.
+    /// Reads the registers of this bus (its range of the configured list),
+    /// using the bus's block read plan when it covers the range.
+    /// Writes scaled float values using expressions from RegisterConfig.
     /// </summary>
-    /// <param name="regs">List of register configurations</param>
-    /// <returns>Vector of float results, NAN if failed</returns>
-    std::vector<float> readAll(const std::vector<RegisterConfig>& regs);
+    /// <param name="regs">Full list of register configurations</param>
+    /// <param name="out">Values indexed like regs; this bus's entries are written, NAN if failed</param>
+    /// <param name="verbose">Print every block and value</param>
+    /// <returns>Number of failed requests</returns>
+    uint32_t readAll(const std::vector<RegisterConfig>& regs, float* out, bool verbose);
+
+    /// <summary>
+    /// Reads and scales the given registers into a caller-provided array without
+    /// any Serial output, for high-rate polling. Failed reads yield NAN.
+    /// </summary>
+    /// <param name="regs">Registers to read</param>
+    /// <param name="out">Destination with room for regs.size() values</param>
+    /// <returns>True if every register was read successfully</returns>
+    bool readInto(const std::vector<RegisterConfig>& regs, float* out);
 
     /// <summary>
     /// Reads a single Modbus register and stores its raw 16-bit value.
@@ -59,11 +95,64 @@ public:
     /// <returns>True if successful, false if failed</returns>
     bool readRegister(uint16_t reg, uint16_t* outValue);
 
+    /// <summary>
+    /// Reads a run of raw registers in a single request without Serial output.
+    /// </summary>
+    /// <param name="address">First register address</param>
+    /// <param name="count">Number of registers (at most RegisterMap::kMaxBlockWords)</param>
+    /// <param name="out">Receives count raw values</param>
+    /// <returns>Modbus result code (RtuMaster::kSuccess on success)</returns>
+    uint8_t readRaw(uint16_t address, uint16_t count, uint16_t* out);
+
+    /// <summary>
+    /// Finds the readable registers of the device in [first, last] with
+    /// multi-register probes, bisecting rejected reads (see RegisterMap::discover()).
+    /// </summary>
+    /// <param name="first">First address to probe</param>
+    /// <param name="last">Last address to probe (inclusive)</param>
+    /// <param name="valid">Receives the readable ranges</param>
+    /// <param name="requests">Receives the number of requests sent</param>
+    /// <param name="applyOffset">Whether to apply address offset (0-based vs 1-based)</param>
+    /// <returns>False if the device stopped answering</returns>
+    bool discover(uint16_t first, uint16_t last, std::vector<RegisterMap::Range>& valid, uint32_t& requests,
+                  bool applyOffset = true);
+
     /// <summary>
     /// Enables or disables address offset correction (for 1-based or 0-based addressing).
     /// </summary>
     void setAddressOffset(bool enabled) { addressOffsetEnabled = enabled; }
 
+    /// <summary>
+    /// Returns the bus index given to begin().
+    /// </summary>
+    size_t getBusIndex() const { return bus; }
+
+    /// <summary>
+    /// Returns a consistent copy of the measured bus statistics (safe from any task).
+    /// </summary>
+    BusStats getBusStats() const {
+        portENTER_CRITICAL(&statsLock);
+        BusStats copy = busStats;
+        portEXIT_CRITICAL(&statsLock);
+        return copy;
+    }
+
+    /// <summary>
+    /// Returns the serial line parameters in effect (for the timing model).
+    /// </summary>
+    const BusTiming::Line& getLine() const { return line; }
+
+    /// <summary>
+    /// Reserves the capture buffer of the bus (0 = no capture). Recording is
+    /// switched on per poll cycle by BusPoller.
+    /// </summary>
+    void setCapture(size_t bufferBytes) { capture.begin(&transport, static_cast<uint8_t>(bus), bufferBytes); }
+
+    /// <summary>
+    /// Traffic recorder between the master and the UART.
+    /// </summary>
+    CaptureTransport& getCapture() { return capture; }
+
     /// <summary>
     /// Injects reference to the global configuration object.
     /// Used for evaluating scaling expressions that reference config values.
@@ -71,9 +160,44 @@ public:
     void setConfig(ConfigManager* cfg);
 
 private:
+    /// <summary>
+    /// Reads one register and applies its scaling expression.
+    /// </summary>
+    /// <param name="reg">Register definition</param>
+    /// <param name="decoded">Receives the decoded value before scaling</param>
+    /// <param name="value">Receives the scaled value, NAN on failure</param>
+    /// <returns>Modbus result code (RtuMaster::kSuccess on success)</returns>
+    uint8_t readScaled(const RegisterConfig& reg, float& decoded, float& value);
+
+    /// <summary>
+    /// Sends one read request for a bus address (no offset applied).
+    /// </summary>
+    /// <param name="out">Receives the registers on success (may be nullptr)</param>
+    uint8_t transfer(uint16_t wireAddress, uint16_t count, uint16_t* out);
+
+    /// <summary>
+    /// Reads one block of the read plan in a single request.
+    /// </summary>
+    /// <param name="block">Block to read</param>
+    /// <param name="slots">Slot table of the plan</param>
+    /// <param name="regs">Registers of the bus, which the slots refer to</param>
+    /// <param name="out">Values indexed like regs; the block's entries are written (NAN on failure)</param>
+    /// <returns>Modbus result code (RtuMaster::kSuccess on success)</returns>
+    uint8_t readBlock(const RegisterMap::Block& block, const RegisterMap::Slot* slots,
+                      const RegisterConfig* regs, float* out);
+
+    ConfigManager* config = nullptr;    ///< Configuration (offset, read plan)
+    size_t bus = 0;                     ///< Bus index
+    HardwareSerial* port = nullptr;     ///< UART of the bus (nullptr = closed)
+    UartTransport transport;            ///< UART with DE/RE control
+    CaptureTransport capture;           ///< Records the traffic of the UART when enabled
+    RtuMaster master;                   ///< Modbus RTU master on the capture transport
     float currentVTR = 1.0f;            ///< Voltage transformer ratio
     float currentCTR = 1.0f;            ///< Current transformer ratio
     bool addressOffsetEnabled = false; ///< Whether to apply address offset (+1)
+    BusTiming::Line line = {9600, 8, 'N', 1};  ///< Serial line parameters
+    BusStats busStats;                  ///< Measured bus activity (guarded by statsLock)
+    mutable portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;  ///< Guards busStats
 };
 
 #endif // MODBUS_MANAGER_H
@@ -0,0 +1,241 @@
+#include "RecentHistory.h"
+#include <math.h>
+#include <new>
+#include <string.h>
+
+/// <summary>
+/// Smaller / larger of two values, NAN only if both are NAN.
+/// </summary>
+static float lower(float a, float b) {
+    return (b < a || a != a) ? b : a;
+}
+
+static float higher(float a, float b) {
+    return (b > a || a != a) ? b : a;
+}
+
+size_t RecentHistory::begin(size_t budgetBytes, size_t wantedSamples, uint16_t valueCount) {
+    end();
+    if (valueCount == 0) return 0;
+
+    size_t perSample = bytesPerSample(valueCount);
+    size_t slots = 1;
+    while (slots * 2 * perSample <= budgetBytes && slots * 2 <= 0x40000000UL) slots *= 2;
+    while (wantedSamples > 0 && slots / 2 >= wantedSamples) slots /= 2;
+    if (slots < 2 || slots * perSample > budgetBytes) return 0;
+
+    size_t count = slots * (2 + 3 * static_cast<size_t>(valueCount));
+    Word* memory = new (std::nothrow) Word[count];
+    if (!memory) return 0;
+    words.reset(memory);
+    wordCount = count;
+    slotCount = slots;
+    channels = valueCount;
+    timestamps = memory;
+    leaves = timestamps + 2 * slots;
+    minNodes = leaves + valueCount * slots;
+    maxNodes = minNodes + valueCount * slots;
+
+    for (size_t i = 0; i < 2 * slots; ++i) timestamps[i].store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < 3 * valueCount * slots; ++i) storeFloat(leaves[i], NAN);
+    sequence.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    retryCount.store(0, std::memory_order_relaxed);
+    return slots;
+}
+
+void RecentHistory::end() {
+    words.reset();
+    wordCount = 0;
+    timestamps = leaves = minNodes = maxNodes = nullptr;
+    slotCount = 0;
+    channels = 0;
+}
+
+float RecentHistory::loadFloat(const Word& word) const {
+    uint32_t bits = word.load(std::memory_order_relaxed);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void RecentHistory::storeFloat(Word& word, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    word.store(bits, std::memory_order_relaxed);
+}
+
+int64_t RecentHistory::loadTimestamp(size_t slot) const {
+    uint64_t low = timestamps[2 * slot].load(std::memory_order_relaxed);
+    uint64_t high = timestamps[2 * slot + 1].load(std::memory_order_relaxed);
+    return static_cast<int64_t>((high << 32) | low);
+}
+
+float RecentHistory::minOf(uint16_t channel, size_t node) const {
+    size_t base = static_cast<size_t>(channel) * slotCount;
+    return loadFloat(node >= slotCount ? leaves[base + node - slotCount] : minNodes[base + node]);
+}
+
+float RecentHistory::maxOf(uint16_t channel, size_t node) const {
+    size_t base = static_cast<size_t>(channel) * slotCount;
+    return loadFloat(node >= slotCount ? leaves[base + node - slotCount] : maxNodes[base + node]);
+}
+
+/// <summary>
+/// Writes the sample into the next slot and updates the path from that leaf
+/// to the root of every channel's tree (log2(capacity) nodes per channel).
+/// </summary>
+void RecentHistory::push(int64_t timestampMs, const float* values) {
+    if (slotCount == 0) return;
+
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t n = total.load(std::memory_order_relaxed);
+    size_t slot = n & (slotCount - 1);
+    uint64_t bits = static_cast<uint64_t>(timestampMs);
+    timestamps[2 * slot].store(static_cast<uint32_t>(bits), std::memory_order_relaxed);
+    timestamps[2 * slot + 1].store(static_cast<uint32_t>(bits >> 32), std::memory_order_relaxed);
+
+    for (uint16_t c = 0; c < channels; ++c) {
+        size_t base = static_cast<size_t>(c) * slotCount;
+        storeFloat(leaves[base + slot], values[c]);
+        for (size_t node = (slotCount + slot) / 2; node >= 1; node /= 2) {
+            storeFloat(minNodes[base + node], lower(minOf(c, 2 * node), minOf(c, 2 * node + 1)));
+            storeFloat(maxNodes[base + node], higher(maxOf(c, 2 * node), maxOf(c, 2 * node + 1)));
+        }
+    }
+    total.store(n + 1, std::memory_order_relaxed);
+
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+template <typename Body>
+bool RecentHistory::readConsistent(Body body) const {
+    for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if ((before & 1) == 0) {
+            body();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) return true;
+        }
+        retryCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    return false;
+}
+
+size_t RecentHistory::size() const {
+    uint32_t n = total.load(std::memory_order_relaxed);
+    return n < slotCount ? n : slotCount;
+}
+
+bool RecentHistory::latest(uint16_t channel, Point& out) const {
+    if (channel >= channels) return false;
+    bool found = false;
+    bool consistent = readConsistent([&]() {
+        uint32_t n = total.load(std::memory_order_relaxed);
+        found = n > 0;
+        if (!found) return;
+        size_t slot = (n - 1) & (slotCount - 1);
+        out.timestampMs = loadTimestamp(slot);
+        out.value = loadFloat(leaves[static_cast<size_t>(channel) * slotCount + slot]);
+    });
+    return consistent && found;
+}
+
+bool RecentHistory::latestSample(int64_t& timestampMs, float* values) const {
+    if (slotCount == 0) return false;
+    bool found = false;
+    bool consistent = readConsistent([&]() {
+        uint32_t n = total.load(std::memory_order_relaxed);
+        found = n > 0;
+        if (!found) return;
+        size_t slot = (n - 1) & (slotCount - 1);
+        timestampMs = loadTimestamp(slot);
+        for (uint16_t c = 0; c < channels; ++c) values[c] = loadFloat(leaves[static_cast<size_t>(c) * slotCount + slot]);
+    });
+    return consistent && found;
+}
+
+size_t RecentHistory::lastN(uint16_t channel, size_t n, Point* out) const {
+    if (channel >= channels) return 0;
+    size_t written = 0;
+    bool consistent = readConsistent([&]() {
+        uint32_t pushed = total.load(std::memory_order_relaxed);
+        size_t held = pushed < slotCount ? pushed : slotCount;
+        size_t count = n < held ? n : held;
+        const Word* values = leaves + static_cast<size_t>(channel) * slotCount;
+        for (size_t i = 0; i < count; ++i) {
+            size_t slot = slotOf(pushed, held, held - count + i);
+            out[i].timestampMs = loadTimestamp(slot);
+            out[i].value = loadFloat(values[slot]);
+        }
+        written = count;
+    });
+    return consistent ? written : 0;
+}
+
+size_t RecentHistory::lowerBound(uint32_t pushed, size_t held, int64_t timeMs) const {
+    size_t lo = 0;
+    size_t hi = held;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (loadTimestamp(slotOf(pushed, held, mid)) < timeMs) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/// <summary>
+/// Bisects the held samples for the range, then walks the channel's tree
+/// bottom-up over the (at most two, if the range wraps) runs of ring slots.
+/// </summary>
+bool RecentHistory::extent(uint16_t channel, int64_t fromMs, int64_t toMs, Extent& out) const {
+    if (channel >= channels || fromMs > toMs) return false;
+    bool found = false;
+    bool consistent = readConsistent([&]() {
+        uint32_t pushed = total.load(std::memory_order_relaxed);
+        size_t held = pushed < slotCount ? pushed : slotCount;
+        size_t first = lowerBound(pushed, held, fromMs);
+        size_t end = toMs == INT64_MAX ? held : lowerBound(pushed, held, toMs + 1);
+        found = first < end;
+        if (!found) return;
+
+        out.min = NAN;
+        out.max = NAN;
+        out.samples = static_cast<uint32_t>(end - first);
+        out.firstMs = loadTimestamp(slotOf(pushed, held, first));
+        out.lastMs = loadTimestamp(slotOf(pushed, held, end - 1));
+
+        size_t from = slotOf(pushed, held, first);
+        size_t to = slotOf(pushed, held, end - 1);
+        size_t runs[2][2] = { { from, to }, { 0, 0 } };
+        size_t runCount = 1;
+        if (from > to) {
+            runs[0][1] = slotCount - 1;
+            runs[1][1] = to;
+            runCount = 2;
+        }
+        for (size_t r = 0; r < runCount; ++r) {
+            size_t l = runs[r][0] + slotCount;
+            size_t h = runs[r][1] + slotCount + 1;
+            for (; l < h; l /= 2, h /= 2) {
+                if (l & 1) {
+                    out.min = lower(out.min, minOf(channel, l));
+                    out.max = higher(out.max, maxOf(channel, l));
+                    ++l;
+                }
+                if (h & 1) {
+                    --h;
+                    out.min = lower(out.min, minOf(channel, h));
+                    out.max = higher(out.max, maxOf(channel, h));
+                }
+            }
+        }
+    });
+    return consistent && found;
+}
@@ -0,0 +1,171 @@
+#ifndef RECENT_HISTORY_H
+#define RECENT_HISTORY_H
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+/// The last minutes of samples in RAM, so the console, live outputs and alarms
+/// can look at recent values without reading the SD card back.
+///
+/// One writer (the acquisition path) pushes complete samples into a ring of
+/// power-of-two capacity. Readers never take a lock and never hold up the
+/// writer: every query runs against a sequence counter that is odd while a
+/// push is in progress, and is repeated if the counter moved meanwhile
+/// (seqlock). All shared words are relaxed atomics, so a reader racing a push
+/// sees old or new words, never a torn access, and the retry discards the mix.
+///
+/// Besides the raw values every channel keeps a min/max segment tree over the
+/// ring slots (the values are its leaves), so "latest" is O(1) and the
+/// minimum and maximum over any time range O(log n). NAN values (failed
+/// reads) are ignored by the extents.
+///
+/// begin() and end() must not run concurrently with readers. The class has no
+/// Arduino dependencies.
+/// </summary>
+class RecentHistory {
+public:
+    /// <summary>
+    /// Reader attempts before a query gives up (only while pushes keep
+    /// overlapping it, e.g. a reader of higher priority spinning on the writer's core).
+    /// </summary>
+    static constexpr int kMaxAttempts = 64;
+
+    /// <summary>
+    /// One value of one channel.
+    /// </summary>
+    struct Point {
+        int64_t timestampMs;
+        float value;
+    };
+
+    /// <summary>
+    /// Minimum and maximum of one channel over a time range.
+    /// </summary>
+    struct Extent {
+        float min;               ///< NAN if the range holds no valid value
+        float max;
+        uint32_t samples;        ///< Samples in the range (including NAN values)
+        int64_t firstMs;         ///< Timestamp of the first sample in the range
+        int64_t lastMs;          ///< Timestamp of the last sample in the range
+    };
+
+    /// <summary>
+    /// RAM one sample takes, with its share of the segment trees.
+    /// </summary>
+    static size_t bytesPerSample(uint16_t valueCount) { return 8 + 12 * static_cast<size_t>(valueCount); }
+
+    /// <summary>
+    /// Allocates the ring: the largest power of two of samples that fits the
+    /// budget, or the smallest one holding wantedSamples if that is less.
+    /// </summary>
+    /// <param name="budgetBytes">RAM the history may use</param>
+    /// <param name="wantedSamples">Samples worth keeping (0 = as many as fit)</param>
+    /// <param name="valueCount">Values per sample</param>
+    /// <returns>Capacity in samples, 0 if the budget holds less than two samples or allocation failed</returns>
+    size_t begin(size_t budgetBytes, size_t wantedSamples, uint16_t valueCount);
+
+    /// <summary>
+    /// Releases the ring.
+    /// </summary>
+    void end();
+
+    /// <summary>
+    /// Appends a sample (valueCount() values), overwriting the oldest one when full.
+    /// Single writer only.
+    /// </summary>
+    void push(int64_t timestampMs, const float* values);
+
+    /// <summary>
+    /// Newest value of a channel.
+    /// </summary>
+    /// <returns>False if there is none (or the query gave up, see kMaxAttempts)</returns>
+    bool latest(uint16_t channel, Point& out) const;
+
+    /// <summary>
+    /// Newest sample, every channel.
+    /// </summary>
+    /// <param name="values">valueCount() entries</param>
+    bool latestSample(int64_t& timestampMs, float* values) const;
+
+    /// <summary>
+    /// Last n values of a channel, oldest first.
+    /// </summary>
+    /// <returns>Number of points written (0 if none or the query gave up)</returns>
+    size_t lastN(uint16_t channel, size_t n, Point* out) const;
+
+    /// <summary>
+    /// Minimum and maximum of a channel over fromMs <= timestamp <= toMs.
+    /// Timestamps are searched by bisection, so a clock stepped backwards
+    /// only makes the range boundaries approximate until its samples age out.
+    /// </summary>
+    /// <returns>False if no sample falls into the range</returns>
+    bool extent(uint16_t channel, int64_t fromMs, int64_t toMs, Extent& out) const;
+
+    /// <summary>
+    /// Samples the ring holds when full.
+    /// </summary>
+    size_t capacity() const { return slotCount; }
+
+    /// <summary>
+    /// Samples currently held.
+    /// </summary>
+    size_t size() const;
+
+    uint16_t valueCount() const { return channels; }
+
+    /// <summary>
+    /// RAM allocated for the ring.
+    /// </summary>
+    size_t memoryBytes() const { return wordCount * sizeof(uint32_t); }
+
+    /// <summary>
+    /// Queries repeated because a push overlapped them (since begin).
+    /// </summary>
+    uint32_t retries() const { return retryCount.load(std::memory_order_relaxed); }
+
+private:
+    using Word = std::atomic<uint32_t>;
+
+    /// <summary>
+    /// Runs body inside a read section until it saw a consistent state.
+    /// </summary>
+    template <typename Body>
+    bool readConsistent(Body body) const;
+
+    // Relaxed word access
+    float loadFloat(const Word& word) const;
+    static void storeFloat(Word& word, float value);
+    int64_t loadTimestamp(size_t slot) const;
+
+    // Segment tree nodes: 1 .. slotCount-1 internal, slotCount .. 2*slotCount-1 the leaves
+    float minOf(uint16_t channel, size_t node) const;
+    float maxOf(uint16_t channel, size_t node) const;
+
+    /// <summary>
+    /// Ring slot of the i-th held sample (0 = oldest) for a given total and size.
+    /// </summary>
+    size_t slotOf(uint32_t total, size_t held, size_t i) const { return (total - held + i) & (slotCount - 1); }
+
+    /// <summary>
+    /// First held sample (0 = oldest) with timestamp >= timeMs, or held.
+    /// </summary>
+    size_t lowerBound(uint32_t total, size_t held, int64_t timeMs) const;
+
+    std::unique_ptr<Word[]> words;
+    size_t wordCount = 0;
+    Word* timestamps = nullptr;          ///< Two words per slot (low, high)
+    Word* leaves = nullptr;              ///< channels * slotCount values, channel-major
+    Word* minNodes = nullptr;            ///< channels * slotCount internal minima (node 0 unused)
+    Word* maxNodes = nullptr;            ///< channels * slotCount internal maxima (node 0 unused)
+    size_t slotCount = 0;
+    uint16_t channels = 0;
+
+    std::atomic<uint32_t> sequence{0};   ///< Odd while a push is in progress
+    std::atomic<uint32_t> total{0};      ///< Samples pushed since begin (wraps)
+    mutable std::atomic<uint32_t> retryCount{0};
+};
+
+#endif // RECENT_HISTORY_H
@@ -0,0 +1,83 @@
+#include "RecordWriter.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+RecordWriter::RecordWriter(char* buffer, size_t size, const char* timestamp) : buffer(buffer), size(size) {
+    put("{\"timestamp\":", 13);
+    putString(timestamp);
+    put(",\"values\":[", 11);
+}
+
+void RecordWriter::add(const char* key, float value, const char* unit) {
+    char number[kMaxValueLength];
+    size_t numberLength = formatValue(value, number);
+
+    put(firstValue ? "{\"key\":" : ",{\"key\":", firstValue ? 7 : 8);
+    putString(key);
+    put(",\"value\":", 9);
+    put(number, numberLength);
+    put(",\"unit\":", 8);
+    putString(unit);
+    put('}');
+    firstValue = false;
+}
+
+size_t RecordWriter::finish() {
+    put("]}", 2);
+    if (overflow || length >= size) return 0;
+    buffer[length] = '\0';
+    return length;
+}
+
+/// <summary>
+/// Tries 6 significant digits first (enough for most register values), then
+/// more until the text parses back to the same float; 9 always does.
+/// </summary>
+size_t RecordWriter::formatValue(float value, char* out) {
+    if (!isfinite(value)) {
+        memcpy(out, "null", 5);
+        return 4;
+    }
+    int n = 0;
+    for (int precision = 6; precision <= 9; ++precision) {
+        n = snprintf(out, kMaxValueLength, "%.*g", precision, static_cast<double>(value));
+        if (precision == 9 || strtof(out, nullptr) == value) break;
+    }
+    return static_cast<size_t>(n);
+}
+
+void RecordWriter::put(char c) {
+    if (length < size) {
+        buffer[length++] = c;
+    } else {
+        overflow = true;
+    }
+}
+
+void RecordWriter::put(const char* text, size_t count) {
+    if (count > size - length) {
+        overflow = true;
+        return;
+    }
+    memcpy(buffer + length, text, count);
+    length += count;
+}
+
+void RecordWriter::putString(const char* text) {
+    static const char kHex[] = "0123456789abcdef";
+    put('"');
+    for (const unsigned char* c = reinterpret_cast<const unsigned char*>(text); *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            put('\\');
+            put(static_cast<char>(*c));
+        } else if (*c < 0x20) {
+            char escaped[6] = { '\\', 'u', '0', '0', kHex[*c >> 4], kHex[*c & 15] };
+            put(escaped, sizeof(escaped));
+        } else {
+            put(static_cast<char>(*c));
+        }
+    }
+    put('"');
+}
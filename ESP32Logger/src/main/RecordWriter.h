@@ -0,0 +1,62 @@
+#ifndef RECORD_WRITER_H
+#define RECORD_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+/// Serializes one log record into a caller-provided buffer:
+///   {"timestamp":"...","values":[{"key":"...","value":1.5,"unit":"..."},...]}
+///
+/// Values are written with the fewest significant digits that read back as
+/// the same float (230.1, not 230.100006); NAN and infinities become null.
+/// Keys and units are escaped (quote, backslash, control characters).
+/// No allocation, no sprintf per character.
+///
+/// The class has no Arduino dependencies and is shared with host-side tools,
+/// so a record written by rtulog-poll is byte for byte the one the logger
+/// writes for the same sample.
+/// </summary>
+class RecordWriter {
+public:
+    static const size_t kMaxValueLength = 16;   ///< Longest formatted value including terminator
+
+    /// <summary>
+    /// Starts a record.
+    /// </summary>
+    /// <param name="buffer">Destination, terminated by finish()</param>
+    /// <param name="size">Buffer size in bytes</param>
+    /// <param name="timestamp">Formatted sample time (see TimestampFormatter)</param>
+    RecordWriter(char* buffer, size_t size, const char* timestamp);
+
+    /// <summary>
+    /// Appends one entry of the values array.
+    /// </summary>
+    void add(const char* key, float value, const char* unit);
+
+    /// <summary>
+    /// Closes the record and terminates it.
+    /// </summary>
+    /// <returns>Record length without terminator, 0 if it did not fit the buffer</returns>
+    size_t finish();
+
+    /// <summary>
+    /// Formats a value the way records contain it.
+    /// </summary>
+    /// <param name="out">At least kMaxValueLength bytes</param>
+    /// <returns>Length without terminator</returns>
+    static size_t formatValue(float value, char* out);
+
+private:
+    void put(char c);
+    void put(const char* text, size_t length);
+    void putString(const char* text);
+
+    char* buffer;
+    size_t size;
+    size_t length = 0;
+    bool overflow = false;
+    bool firstValue = true;
+};
+
+#endif // RECORD_WRITER_H
@@ -2,6 +2,8 @@
 #define REGISTER_CONFIG_H
 
 #include <Arduino.h>
+#include "RegisterMap.h"
+#include "ScaleExpression.h"
 
 /// <summary>
 /// Represents the configuration for a single Modbus register or measurement parameter.
@@ -59,6 +61,39 @@ struct RegisterConfig {
     /// For example: 1 for UINT16, 2 for FLOAT/UINT32.
     /// </summary>
     uint8_t length;
+
+    /// <summary>
+    /// RS485 bus the register is read on (0 = "communication", 1.. = "buses").
+    /// </summary>
+    uint8_t bus = 0;
+
+    /// <summary>
+    /// Parsed data type, decides how the register words are decoded.
+    /// </summary>
+    RegisterMap::Type dataType = RegisterMap::Type::Uint16;
+
+    /// <summary>
+    /// Scaling expression compiled at load time (JSON configuration).
+    /// </summary>
+    ScaleExpression scale;
+
+    /// <summary>
+    /// Generated scaling function (compiled register map); takes precedence over scale.
+    /// </summary>
+    RegisterMap::ScaleFn scaleFn = nullptr;
+
+    /// <summary>
+    /// True for a derived channel (see DerivedProgram.h): not read from the bus,
+    /// computed from other channels; scaling then holds its expression.
+    /// </summary>
+    bool derived = false;
+
+    /// <summary>
+    /// Scales one decoded value.
+    /// </summary>
+    float applyScaling(float val, float vtr, float ctr) const {
+        return scaleFn ? scaleFn(val, vtr, ctr) : scale.evaluate(val, vtr, ctr);
+    }
 };
 
 #endif // REGISTER_CONFIG_H
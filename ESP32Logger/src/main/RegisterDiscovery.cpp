@@ -0,0 +1,106 @@
+#include "RegisterDiscovery.h"
+#include <ArduinoJson.h>
+
+/// <summary>
+/// Uses the cache when it matches, otherwise probes the bus and stores the result.
+/// </summary>
+bool RegisterDiscovery::run(const DiscoverySettings& settings, uint8_t slaveId, const String& device,
+                            ModbusManager* modbus, StorageManager* storage, std::vector<RegisterMap::Range>& ranges) {
+    String path = cachePath(slaveId, device);
+
+    if (!settings.rescan && loadCache(path, settings, slaveId, device, ranges)) {
+        Serial.printf("[RegisterDiscovery] Loaded %u readable range(s) from %s.\n", (unsigned)ranges.size(), path.c_str());
+        return true;
+    }
+
+    Serial.printf("[RegisterDiscovery] Probing registers %u..%u on slave %u...\n", settings.first, settings.last, slaveId);
+    unsigned long startedMs = millis();
+    uint32_t requests = 0;
+    if (!modbus->discover(settings.first, settings.last, ranges, requests)) {
+        if (storage) storage->logError(ErrorCode::ModbusRead, "Register discovery failed: device stopped answering.");
+        ranges.clear();
+        return false;
+    }
+
+    uint32_t readable = 0;
+    for (const auto& r : ranges) {
+        readable += r.count;
+        Serial.printf("  - %u..%u (%u register(s))\n", r.address, r.address + r.count - 1, r.count);
+    }
+    Serial.printf("[RegisterDiscovery] %lu readable register(s) in %u range(s), %lu request(s), %lu ms.\n",
+                  (unsigned long)readable, (unsigned)ranges.size(), (unsigned long)requests, millis() - startedMs);
+
+    if (!saveCache(path, settings, slaveId, device, ranges)) {
+        Serial.printf("[RegisterDiscovery][WARN] Could not write %s, the next boot probes again.\n", path.c_str());
+        if (storage) storage->logError(ErrorCode::FileWrite, "Register discovery cache could not be written.");
+    }
+    return true;
+}
+
+String RegisterDiscovery::cachePath(uint8_t slaveId, const String& device) {
+    String path = "/config/regmap_";
+    path += String(slaveId);
+    path += "_";
+    for (size_t i = 0; i < device.length(); ++i) {
+        char c = device.charAt(i);
+        path += (isalnum(static_cast<unsigned char>(c)) || c == '-') ? c : '_';
+    }
+    path += ".json";
+    return path;
+}
+
+bool RegisterDiscovery::loadCache(const String& path, const DiscoverySettings& settings, uint8_t slaveId,
+                                  const String& device, std::vector<RegisterMap::Range>& ranges) {
+    File file = SD.open(path, FILE_READ);
+    if (!file) return false;
+
+    DynamicJsonDocument doc(4096);
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    if (error) {
+        Serial.printf("[RegisterDiscovery][WARN] %s is unreadable (%s), probing again.\n", path.c_str(), error.c_str());
+        return false;
+    }
+
+    String cachedDevice = doc["device"] | "";
+    if ((doc["slave"] | -1) != slaveId || cachedDevice != device ||
+        (doc["first"] | -1) != settings.first || (doc["last"] | -1) != settings.last) {
+        Serial.printf("[RegisterDiscovery] %s was made for another device or range, probing again.\n", path.c_str());
+        return false;
+    }
+
+    ranges.clear();
+    for (JsonArray r : doc["ranges"].as<JsonArray>()) {
+        uint16_t address = r[0] | 0;
+        uint16_t count = r[1] | 0;
+        if (count > 0) ranges.push_back({address, count});
+    }
+    return true;
+}
+
+bool RegisterDiscovery::saveCache(const String& path, const DiscoverySettings& settings, uint8_t slaveId,
+                                  const String& device, const std::vector<RegisterMap::Range>& ranges) {
+    DynamicJsonDocument doc(512 + ranges.size() * 32);
+    doc["slave"] = slaveId;
+    doc["device"] = device;
+    doc["first"] = settings.first;
+    doc["last"] = settings.last;
+    JsonArray list = doc.createNestedArray("ranges");
+    for (const auto& r : ranges) {
+        JsonArray entry = list.createNestedArray();
+        entry.add(r.address);
+        entry.add(r.count);
+    }
+
+    String tmp = path + ".tmp";
+    File file = SD.open(tmp, FILE_WRITE);
+    if (!file) return false;
+    bool ok = serializeJson(doc, file) > 0;
+    file.close();
+    if (!ok) {
+        SD.remove(tmp);
+        return false;
+    }
+    SD.remove(path);
+    return SD.rename(tmp, path);
+}
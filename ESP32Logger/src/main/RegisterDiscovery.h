@@ -0,0 +1,52 @@
+#ifndef REGISTER_DISCOVERY_H
+#define REGISTER_DISCOVERY_H
+
+#include <SD.h>
+#include <vector>
+#include "ConfigManager.h"
+#include "StorageManager.h"
+#include "ModbusManager.h"
+#include "RegisterMap.h"
+
+/// <summary>
+/// Finds which registers of the configured address span a device serves and
+/// caches the result on the SD card, one file per slave ID and device model:
+///   /config/regmap_<slave>_<device>.json
+///   {"slave":1,"device":"EM-07","first":4000,"last":4100,"ranges":[[4000,11],[4026,3]]}
+/// Later boots load the file instead of probing the bus again; the cache is
+/// only used if slave, device and span match the current configuration.
+/// </summary>
+class RegisterDiscovery {
+public:
+    /// <summary>
+    /// Loads the cached map or, if there is none (or rescan is set), probes the
+    /// device and writes the cache.
+    /// </summary>
+    /// <param name="settings">Discovery settings from the configuration</param>
+    /// <param name="slaveId">Modbus slave address</param>
+    /// <param name="device">Device model name</param>
+    /// <param name="ranges">Receives the readable ranges</param>
+    /// <returns>False if discovery failed and no map is available</returns>
+    bool run(const DiscoverySettings& settings, uint8_t slaveId, const String& device,
+             ModbusManager* modbus, StorageManager* storage, std::vector<RegisterMap::Range>& ranges);
+
+private:
+    /// <summary>
+    /// Cache file name; the device name is reduced to file-name-safe characters.
+    /// </summary>
+    static String cachePath(uint8_t slaveId, const String& device);
+
+    /// <summary>
+    /// Reads the cache if it was made for the same slave, device and span.
+    /// </summary>
+    bool loadCache(const String& path, const DiscoverySettings& settings, uint8_t slaveId, const String& device,
+                   std::vector<RegisterMap::Range>& ranges);
+
+    /// <summary>
+    /// Writes the cache via a temporary file, so a reset never leaves a partial map.
+    /// </summary>
+    bool saveCache(const String& path, const DiscoverySettings& settings, uint8_t slaveId, const String& device,
+                   const std::vector<RegisterMap::Range>& ranges);
+};
+
+#endif // REGISTER_DISCOVERY_H
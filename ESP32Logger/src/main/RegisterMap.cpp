@@ -0,0 +1,165 @@
+#include "RegisterMap.h"
+#include <algorithm>
+
+namespace RegisterMap {
+
+uint8_t wordCount(Type type) {
+    switch (type) {
+        case Type::Uint16: return Decoder<Type::Uint16>::kWords;
+        case Type::Int16: return Decoder<Type::Int16>::kWords;
+        case Type::Uint32: return Decoder<Type::Uint32>::kWords;
+        case Type::Int32: return Decoder<Type::Int32>::kWords;
+        case Type::Float32: return Decoder<Type::Float32>::kWords;
+    }
+    return 1;
+}
+
+float decode(Type type, const uint16_t* words) {
+    switch (type) {
+        case Type::Uint16: return Decoder<Type::Uint16>::decode(words);
+        case Type::Int16: return Decoder<Type::Int16>::decode(words);
+        case Type::Uint32: return Decoder<Type::Uint32>::decode(words);
+        case Type::Int32: return Decoder<Type::Int32>::decode(words);
+        case Type::Float32: return Decoder<Type::Float32>::decode(words);
+    }
+    return 0.0f;
+}
+
+bool parseType(const char* name, Type& type) {
+    if (strcmp(name, "UINT16") == 0) type = Type::Uint16;
+    else if (strcmp(name, "INT16") == 0) type = Type::Int16;
+    else if (strcmp(name, "UINT32") == 0) type = Type::Uint32;
+    else if (strcmp(name, "INT32") == 0) type = Type::Int32;
+    else if (strcmp(name, "FLOAT") == 0 || strcmp(name, "FLOAT32") == 0) type = Type::Float32;
+    else return false;
+    return true;
+}
+
+const char* typeName(Type type) {
+    switch (type) {
+        case Type::Uint16: return "Uint16";
+        case Type::Int16: return "Int16";
+        case Type::Uint32: return "Uint32";
+        case Type::Int32: return "Int32";
+        case Type::Float32: return "Float32";
+    }
+    return "Uint16";
+}
+
+/// <summary>
+/// Walks the registers in address order and starts a new block whenever the
+/// next register would leave a gap above maxGap or overflow kMaxBlockWords.
+/// Overlapping registers share the words they overlap.
+/// </summary>
+void plan(const std::vector<Span>& spans, uint16_t maxGap, std::vector<Block>& blocks, std::vector<Slot>& slots,
+          const std::vector<Range>* valid) {
+    blocks.clear();
+    slots.clear();
+
+    std::vector<uint16_t> order(spans.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<uint16_t>(i);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint16_t a, uint16_t b) { return spans[a].address < spans[b].address; });
+
+    uint32_t blockEnd = 0;
+    for (uint16_t reg : order) {
+        const Span& s = spans[reg];
+        uint32_t end = static_cast<uint32_t>(s.address) + s.words;
+        bool extend = false;
+        if (!blocks.empty() && std::max(end, blockEnd) - blocks.back().address <= kMaxBlockWords) {
+            extend = s.address <= blockEnd + maxGap ||
+                     (valid && s.address <= blockEnd + kValidGapWords && isReadable(*valid, blockEnd, s.address));
+        }
+        if (!extend) {
+            Block b = {s.address, 0, static_cast<uint16_t>(slots.size()), 0, nullptr};
+            blocks.push_back(b);
+            blockEnd = s.address;
+        }
+        Block& b = blocks.back();
+        blockEnd = std::max(blockEnd, end);
+        b.count = static_cast<uint16_t>(blockEnd - b.address);
+        slots.push_back({reg, static_cast<uint16_t>(s.address - b.address)});
+        ++b.slotCount;
+    }
+}
+
+bool isReadable(const std::vector<Range>& valid, uint32_t first, uint32_t end) {
+    for (const Range& r : valid) {
+        if (r.address <= first && end <= static_cast<uint32_t>(r.address) + r.count) return true;
+    }
+    return false;
+}
+
+/// <summary>
+/// Appends a readable run, joining it to the previous one if they touch.
+/// </summary>
+static void addRange(std::vector<Range>& valid, uint16_t address, uint16_t count) {
+    if (!valid.empty() && static_cast<uint32_t>(valid.back().address) + valid.back().count == address) {
+        valid.back().count += count;
+    } else {
+        valid.push_back({address, count});
+    }
+}
+
+/// <summary>
+/// Walks the span once. At each position the longest readable run is found
+/// with one kMaxBlockWords probe and, if that is rejected, a binary search for
+/// the run's end; the register after a run is then known to be unreadable.
+/// Inside unreadable stretches single registers are probed, since a rejected
+/// multi-register read does not tell which of its registers is missing.
+/// Cost: one request per 64 readable registers, about 8 per run boundary,
+/// one per unreadable register.
+/// </summary>
+bool discover(uint16_t first, uint16_t last, const ProbeFn& probe, std::vector<Range>& valid, uint32_t& requests) {
+    valid.clear();
+    requests = 0;
+    bool afterGap = false;
+    uint32_t pos = first;
+
+    while (pos <= last) {
+        uint16_t address = static_cast<uint16_t>(pos);
+        uint32_t limit = std::min<uint32_t>(kMaxBlockWords, static_cast<uint32_t>(last) - pos + 1);
+        uint32_t lo = 0;           // (address, lo) known readable
+        uint32_t hi = limit + 1;   // (address, hi) known unreadable (limit + 1 = not probed)
+
+        if (afterGap || limit == 1) {
+            ++requests;
+            ProbeResult r = probe(address, 1);
+            if (r == ProbeResult::Failed) return false;
+            if (r == ProbeResult::Invalid) {
+                afterGap = true;
+                ++pos;
+                continue;
+            }
+            lo = 1;
+        }
+        if (lo < limit) {
+            ++requests;
+            ProbeResult r = probe(address, static_cast<uint16_t>(limit));
+            if (r == ProbeResult::Failed) return false;
+            if (r == ProbeResult::Valid) lo = limit;
+            else hi = limit;
+        }
+        while (hi <= limit && hi - lo > 1) {
+            uint32_t mid = (lo + hi) / 2;
+            ++requests;
+            ProbeResult r = probe(address, static_cast<uint16_t>(mid));
+            if (r == ProbeResult::Failed) return false;
+            if (r == ProbeResult::Valid) lo = mid;
+            else hi = mid;
+        }
+
+        if (lo > 0) addRange(valid, address, static_cast<uint16_t>(lo));
+        if (hi <= limit) {
+            // (address, lo + 1) was rejected while (address, lo) was not
+            afterGap = true;
+            pos += lo + 1;
+        } else {
+            afterGap = false;
+            pos += lo;
+        }
+    }
+    return true;
+}
+
+} // namespace RegisterMap
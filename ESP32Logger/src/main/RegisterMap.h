@@ -0,0 +1,219 @@
+#ifndef REGISTER_MAP_H
+#define REGISTER_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <functional>
+#include <vector>
+
+/// <summary>
+/// Register data types, word decoding and the block read plan.
+/// This header has no Arduino dependencies; the logger uses it at runtime and
+/// the host generator (rtulog-regmap) uses the same planner to emit a
+/// flash-resident register map (CompiledConfig.h) for fixed deployments.
+///
+/// Multi-word values are big endian (high word first), as Modbus devices send them.
+/// </summary>
+namespace RegisterMap {
+
+/// <summary>
+/// Largest block read. The protocol allows 125 holding registers per request,
+/// but RtuMaster's response buffer holds 64 words.
+/// </summary>
+constexpr uint16_t kMaxBlockWords = 64;
+
+/// <summary>
+/// Gap up to which a block is extended over registers known to be readable
+/// (from discovery). A separate request costs about 20 character times of
+/// framing and silence plus the slave's turnaround, two words cost 4 bytes.
+/// </summary>
+constexpr uint16_t kValidGapWords = 16;
+
+/// <summary>
+/// Data type of a register value.
+/// </summary>
+enum class Type : uint8_t { Uint16, Int16, Uint32, Int32, Float32 };
+
+/// <summary>
+/// Decodes raw register words into a float. Specialized per type so the
+/// compiled map decodes without a runtime type switch.
+/// </summary>
+template <Type T> struct Decoder;
+
+template <> struct Decoder<Type::Uint16> {
+    static constexpr uint8_t kWords = 1;
+    static float decode(const uint16_t* w) { return static_cast<float>(w[0]); }
+};
+
+template <> struct Decoder<Type::Int16> {
+    static constexpr uint8_t kWords = 1;
+    static float decode(const uint16_t* w) { return static_cast<float>(static_cast<int16_t>(w[0])); }
+};
+
+template <> struct Decoder<Type::Uint32> {
+    static constexpr uint8_t kWords = 2;
+    static float decode(const uint16_t* w) {
+        return static_cast<float>((static_cast<uint32_t>(w[0]) << 16) | w[1]);
+    }
+};
+
+template <> struct Decoder<Type::Int32> {
+    static constexpr uint8_t kWords = 2;
+    static float decode(const uint16_t* w) {
+        return static_cast<float>(static_cast<int32_t>((static_cast<uint32_t>(w[0]) << 16) | w[1]));
+    }
+};
+
+template <> struct Decoder<Type::Float32> {
+    static constexpr uint8_t kWords = 2;
+    static float decode(const uint16_t* w) {
+        uint32_t bits = (static_cast<uint32_t>(w[0]) << 16) | w[1];
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+};
+
+/// <summary>
+/// Scaling function of a compiled register: scaled = f(val, VTR, CTR).
+/// </summary>
+using ScaleFn = float (*)(float val, float vtr, float ctr);
+
+/// <summary>
+/// Decodes every register of one block read and writes the scaled values to
+/// out[register index]. Generated per block in the compiled map.
+/// </summary>
+using BlockDecodeFn = void (*)(const uint16_t* words, float vtr, float ctr, float* out);
+
+/// <summary>
+/// One register of the compiled map.
+/// </summary>
+struct Register {
+    const char* key;
+    const char* unit;
+    uint16_t address;
+    Type type;
+    ScaleFn scale;
+};
+
+/// <summary>
+/// One register inside a block: its index in the register list and its word
+/// offset from the block start.
+/// </summary>
+struct Slot {
+    uint16_t reg;
+    uint16_t offset;
+};
+
+/// <summary>
+/// One multi-register read covering the slots [firstSlot, firstSlot + slotCount).
+/// decode is set in the compiled map and nullptr for plans built at runtime.
+/// </summary>
+struct Block {
+    uint16_t address;
+    uint16_t count;
+    uint16_t firstSlot;
+    uint16_t slotCount;
+    BlockDecodeFn decode;
+};
+
+/// <summary>
+/// Non-owning view of a block read plan, backed either by flash tables or by vectors.
+/// </summary>
+struct ReadPlan {
+    const Block* blocks = nullptr;
+    size_t blockCount = 0;
+    const Slot* slots = nullptr;
+    size_t slotCount = 0;
+};
+
+/// <summary>
+/// Address and width of one register, as input to the planner.
+/// </summary>
+struct Span {
+    uint16_t address;
+    uint8_t words;
+};
+
+/// <summary>
+/// Run of consecutive readable registers found by discovery.
+/// </summary>
+struct Range {
+    uint16_t address;
+    uint16_t count;
+};
+
+/// <summary>
+/// Outcome of one discovery probe.
+/// </summary>
+enum class ProbeResult : uint8_t {
+    Valid,      ///< Every register of the probe could be read
+    Invalid,    ///< Device rejected the address range (exception 0x02 / 0x03)
+    Failed      ///< No usable answer (timeout, CRC error); discovery stops
+};
+
+/// <summary>
+/// Reads count registers starting at address and classifies the answer.
+/// </summary>
+using ProbeFn = std::function<ProbeResult(uint16_t address, uint16_t count)>;
+
+/// <summary>
+/// Number of 16-bit words a type occupies.
+/// </summary>
+uint8_t wordCount(Type type);
+
+/// <summary>
+/// Decodes raw words with a runtime type switch.
+/// </summary>
+float decode(Type type, const uint16_t* words);
+
+/// <summary>
+/// Parses a configuration type name ("UINT16", "INT16", "UINT32", "INT32", "FLOAT"/"FLOAT32").
+/// </summary>
+/// <returns>False for unknown names</returns>
+bool parseType(const char* name, Type& type);
+
+/// <summary>
+/// Enumerator name of a type (e.g. "Uint32"), as used in generated code.
+/// </summary>
+const char* typeName(Type type);
+
+/// <summary>
+/// Groups registers into as few reads as possible. Registers are sorted by
+/// address and merged while the gap to the previous one is at most maxGap
+/// words and the block stays within kMaxBlockWords. Gap words are read and
+/// ignored, so maxGap above 0 is only safe on devices that answer reads of
+/// unmapped addresses. Gaps of up to kValidGapWords that lie inside a
+/// discovered readable range are bridged regardless of maxGap.
+/// </summary>
+/// <param name="spans">One entry per register, in register order</param>
+/// <param name="maxGap">Largest run of unused words a block may span</param>
+/// <param name="blocks">Receives the blocks, in address order (decode = nullptr)</param>
+/// <param name="slots">Receives the slots referenced by the blocks</param>
+/// <param name="valid">Readable ranges from discovery, sorted by address (optional)</param>
+void plan(const std::vector<Span>& spans, uint16_t maxGap, std::vector<Block>& blocks, std::vector<Slot>& slots,
+          const std::vector<Range>* valid = nullptr);
+
+/// <summary>
+/// Returns true if the words [first, end) lie inside one readable range.
+/// </summary>
+bool isReadable(const std::vector<Range>& valid, uint32_t first, uint32_t end);
+
+/// <summary>
+/// Finds the readable registers in [first, last] with few requests: readable
+/// stretches are confirmed kMaxBlockWords at a time and a rejected read is
+/// bisected to find where the readable run ends. Assumes the device rejects
+/// a read if any register in it is unmapped.
+/// </summary>
+/// <param name="first">First address to probe</param>
+/// <param name="last">Last address to probe (inclusive)</param>
+/// <param name="probe">Bus access</param>
+/// <param name="valid">Receives the readable ranges, sorted and coalesced</param>
+/// <param name="requests">Receives the number of probes sent</param>
+/// <returns>False if a probe failed; valid then holds the ranges found so far</returns>
+bool discover(uint16_t first, uint16_t last, const ProbeFn& probe, std::vector<Range>& valid, uint32_t& requests);
+
+} // namespace RegisterMap
+
+#endif // REGISTER_MAP_H
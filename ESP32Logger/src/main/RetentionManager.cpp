@@ -0,0 +1,238 @@
+#include "RetentionManager.h"
+
+/// <summary>
+/// Strips a folder path and a trailing '/' ("/logs/" → "/logs", "/" → "").
+/// </summary>
+static String trimFolder(const String& folder) {
+    if (folder.endsWith("/")) return folder.substring(0, folder.length() - 1);
+    return folder;
+}
+
+/// <summary>
+/// Last path component (File::name() is a full path on older ESP32 cores).
+/// </summary>
+static String baseName(const char* path) {
+    String name = path;
+    int slash = name.lastIndexOf('/');
+    return slash < 0 ? name : name.substring(slash + 1);
+}
+
+static bool allDigits(const String& text) {
+    for (size_t i = 0; i < text.length(); ++i) {
+        if (text[i] < '0' || text[i] > '9') return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// Stores the settings and normalizes the folders.
+/// </summary>
+void RetentionManager::begin(const RetentionSettings& retention, const String& logs, const String& filenameFormat,
+                             const String& events, StorageManager* storageManager) {
+    settings = retention;
+    logFolder = trimFolder(logs);
+    eventFolder = trimFolder(events);
+    storage = storageManager;
+
+    // Flat (unsharded) day files are recognized by the extension of the name format
+    int dot = filenameFormat.lastIndexOf('.');
+    logSuffix = dot < 0 ? String("") : filenameFormat.substring(dot);
+
+    state = State::Idle;
+    checked = false;
+
+    Serial.printf("[RetentionManager] %s: %s and %s, %u %% → %u %%, check every %lu s\n",
+                  settings.enabled ? "Enabled" : "Disabled", logs.c_str(), events.c_str(),
+                  settings.highWatermark, settings.lowWatermark, settings.checkIntervalMs / 1000);
+}
+
+/// <summary>
+/// Runs a due check while idle; while purging, performs one deletion step.
+/// The free space is only measured again once the freed bytes (estimated from
+/// the deleted file sizes) reach the low watermark.
+/// </summary>
+void RetentionManager::poll() {
+    if (!settings.enabled || !storage) return;
+
+    if (state == State::Idle) {
+        if (!checked || millis() - lastCheck >= settings.checkIntervalMs) {
+            lastCheck = millis();
+            checked = true;
+            check();
+        }
+        return;
+    }
+
+    if (usedBytes * 100 <= totalBytes * settings.lowWatermark) {
+        check();
+        if (state == State::Idle) return;
+    }
+
+    if (state == State::PurgeEvents) {
+        String name;
+        uint64_t size = 0;
+        if (eventFolder.length() > 0 && oldestEntry(eventFolder, false, 0, "evt_", nullptr, name, size)) {
+            removeFile(eventFolder + "/" + name, size, false);
+        } else {
+            state = State::PurgeLogs;
+            depth = 0;
+        }
+        return;
+    }
+
+    purgeLogStep();
+}
+
+/// <summary>
+/// Measures the card. SD.usedBytes() walks the FAT when the card has no valid
+/// free-cluster count, which is why it only runs at the check interval.
+/// </summary>
+void RetentionManager::check() {
+    totalBytes = SD.totalBytes();
+    if (totalBytes == 0) return;  // No card
+    usedBytes = SD.usedBytes();
+    usedPercent = usedBytes * 100.0f / totalBytes;
+
+    if (state == State::Idle) {
+        if (usedPercent < settings.highWatermark) return;
+
+        Serial.printf("[RetentionManager][WARN] Card %.1f %% full, deleting oldest files down to %u %%.\n",
+                      usedPercent, settings.lowWatermark);
+        storage->logError(ErrorCode::Retention, "Card above the high watermark, deleting oldest files.");
+        state = State::PurgeEvents;
+        depth = 0;
+        purgeDeleted = 0;
+    } else if (usedPercent <= settings.lowWatermark) {
+        finish(false);
+    }
+}
+
+/// <summary>
+/// Day files: flat files in the output folder predate sharding and go first,
+/// then the oldest year → month folder is emptied file by file.
+/// </summary>
+void RetentionManager::purgeLogStep() {
+    String name;
+    uint64_t size = 0;
+
+    switch (depth) {
+        case 0:
+            if (logSuffix.length() > 0 &&
+                oldestEntry(logFolder, false, 0, nullptr, logSuffix.c_str(), name, size)) {
+                if (!removeFile(logFolder + "/" + name, size, true)) finish(true);
+                return;
+            }
+            if (!oldestEntry(logFolder, true, 4, nullptr, nullptr, name, size)) {
+                finish(true);
+                return;
+            }
+            yearFolder = logFolder + "/" + name;
+            depth = 1;
+            return;
+
+        case 1:
+            if (!oldestEntry(yearFolder, true, 2, nullptr, nullptr, name, size)) {
+                if (!SD.rmdir(yearFolder)) {
+                    Serial.printf("[RetentionManager][WARN] Cannot remove %s (not empty).\n", yearFolder.c_str());
+                    finish(true);
+                    return;
+                }
+                depth = 0;
+                return;
+            }
+            monthFolder = yearFolder + "/" + name;
+            depth = 2;
+            return;
+
+        default:
+            if (!oldestEntry(monthFolder, false, 0, nullptr, nullptr, name, size)) {
+                if (!SD.rmdir(monthFolder)) {
+                    Serial.printf("[RetentionManager][WARN] Cannot remove %s (not empty).\n", monthFolder.c_str());
+                    finish(true);
+                    return;
+                }
+                depth = 1;
+                return;
+            }
+            if (!removeFile(monthFolder + "/" + name, size, true)) finish(true);
+            return;
+    }
+}
+
+/// <summary>
+/// Lists a folder once and keeps the matching entry with the smallest name.
+/// </summary>
+bool RetentionManager::oldestEntry(const String& folder, bool directories, size_t digits, const char* prefix,
+                                   const char* suffix, String& name, uint64_t& size) {
+    File dir = SD.open(folder.length() > 0 ? folder : String("/"));
+    if (!dir) return false;
+    if (!dir.isDirectory()) {
+        dir.close();
+        return false;
+    }
+
+    bool found = false;
+    for (File entry = dir.openNextFile(); entry; entry = dir.openNextFile()) {
+        bool isDirectory = entry.isDirectory();
+        String entryName = baseName(entry.name());
+        uint64_t entrySize = isDirectory ? 0 : entry.size();
+        entry.close();
+
+        if (isDirectory != directories) continue;
+        if (directories) {
+            if (digits > 0 && (entryName.length() != digits || !allDigits(entryName))) continue;
+        } else {
+            if (prefix && !entryName.startsWith(prefix)) continue;
+            if (suffix && !entryName.endsWith(suffix) &&
+                !entryName.endsWith(String(suffix) + LzCodec::kExtension)) continue;
+        }
+        if (!found || entryName < name) {
+            name = entryName;
+            size = entrySize;
+            found = true;
+        }
+    }
+    dir.close();
+    return found;
+}
+
+/// <summary>
+/// Deletes one file; the day file in use is kept.
+/// </summary>
+bool RetentionManager::removeFile(const String& path, uint64_t size, bool withIndex) {
+    if (path == storage->getCurrentLogFile()) return false;
+
+    if (!SD.remove(path)) {
+        Serial.printf("[RetentionManager][ERROR] Cannot delete %s\n", path.c_str());
+        storage->logError(ErrorCode::Retention, "Failed to delete an old file.");
+        finish(false);  // Retried at the next check
+        return true;
+    }
+    if (withIndex) {
+        // Time index sidecar, may not exist; a compressed day file keeps the original's
+        String dayFile = path.endsWith(LzCodec::kExtension)
+                             ? path.substring(0, path.length() - strlen(LzCodec::kExtension)) : path;
+        SD.remove(dayFile + ".idx");
+    }
+
+    usedBytes -= size < usedBytes ? size : usedBytes;
+    ++purgeDeleted;
+    ++deletedFiles;
+    Serial.printf("[RetentionManager] Deleted %s (%llu bytes)\n", path.c_str(), (unsigned long long)size);
+    return true;
+}
+
+/// <summary>
+/// Leaves the purge state; the next check runs after the regular interval.
+/// </summary>
+void RetentionManager::finish(bool exhausted) {
+    if (exhausted) {
+        Serial.printf("[RetentionManager][ERROR] Nothing left to delete, card still above %u %%.\n",
+                      settings.lowWatermark);
+        storage->logError(ErrorCode::Retention, "Card full: no old files left to delete.");
+    }
+    Serial.printf("[RetentionManager] Purge done: %lu file(s) deleted.\n", (unsigned long)purgeDeleted);
+
+    state = State::Idle;
+    lastCheck = millis();
+}
@@ -0,0 +1,117 @@
+#ifndef RETENTION_MANAGER_H
+#define RETENTION_MANAGER_H
+
+#include <SD.h>
+#include "ConfigManager.h"
+#include "StorageManager.h"
+#include "LzCodec.h"
+
+/// <summary>
+/// Keeps free space on the SD card with a high/low watermark policy.
+///
+/// Card usage is measured every checkIntervalMs. Once it reaches the high
+/// watermark, the oldest files are deleted until usage is back below the low
+/// watermark: burst event files first (raw high-rate data), then day files
+/// (plain or compressed, see LogCompressor.h) together with their ".idx" time
+/// index, oldest month folder first. Empty month and year folders are removed
+/// on the way. The day file currently written to is never deleted.
+///
+/// All work happens in poll() from the idle path, one directory listing or
+/// one deletion per call, so acquisition never waits on a purge.
+/// </summary>
+class RetentionManager {
+public:
+    /// <summary>
+    /// Applies the settings and the folders to manage. Resets any purge in progress.
+    /// </summary>
+    /// <param name="settings">Watermarks and check interval</param>
+    /// <param name="logFolder">Output folder of the day files (with trailing '/')</param>
+    /// <param name="filenameFormat">Day file name format, its extension identifies flat (unsharded) day files</param>
+    /// <param name="eventFolder">Burst event folder (with trailing '/')</param>
+    /// <param name="storage">Storage manager (current day file, error log)</param>
+    void begin(const RetentionSettings& settings, const String& logFolder, const String& filenameFormat,
+               const String& eventFolder, StorageManager* storage);
+
+    /// <summary>
+    /// Performs one step: a due free-space check, or one step of a purge.
+    /// Call from the idle path.
+    /// </summary>
+    void poll();
+
+    /// <summary>
+    /// Card usage in percent at the last check (negative before the first check).
+    /// </summary>
+    float getUsedPercent() const { return usedPercent; }
+
+    /// <summary>
+    /// Returns true while old files are being deleted.
+    /// </summary>
+    bool isPurging() const { return state != State::Idle; }
+
+    /// <summary>
+    /// Files deleted since startup.
+    /// </summary>
+    uint32_t getDeletedFiles() const { return deletedFiles; }
+
+private:
+    enum class State : uint8_t {
+        Idle,           ///< Waiting for the next check
+        PurgeEvents,    ///< Deleting the oldest burst event files
+        PurgeLogs       ///< Deleting the oldest day files
+    };
+
+    /// <summary>
+    /// Measures card usage and starts or ends a purge.
+    /// </summary>
+    void check();
+
+    /// <summary>
+    /// One step of the day file purge (descends output folder → year → month).
+    /// </summary>
+    void purgeLogStep();
+
+    /// <summary>
+    /// Finds the entry with the smallest name in a folder (names sort chronologically).
+    /// </summary>
+    /// <param name="folder">Folder without trailing '/'</param>
+    /// <param name="directories">Look for folders instead of files</param>
+    /// <param name="digits">For folders: required name length, all digits (0 = any)</param>
+    /// <param name="prefix">For files: required name prefix (nullptr = any)</param>
+    /// <param name="suffix">For files: required name suffix, also matched with ".lz" appended (nullptr = any)</param>
+    /// <param name="name">Receives the entry name</param>
+    /// <param name="size">Receives the file size</param>
+    /// <returns>False if the folder holds no matching entry</returns>
+    static bool oldestEntry(const String& folder, bool directories, size_t digits, const char* prefix,
+                            const char* suffix, String& name, uint64_t& size);
+
+    /// <summary>
+    /// Deletes a file (and its time index for day files) and books the freed space.
+    /// </summary>
+    /// <returns>False if the file is the current day file and was kept</returns>
+    bool removeFile(const String& path, uint64_t size, bool withIndex);
+
+    /// <summary>
+    /// Ends the purge; reports if it had to stop above the low watermark.
+    /// </summary>
+    void finish(bool exhausted);
+
+    RetentionSettings settings;
+    String logFolder;                   ///< Day file folder without trailing '/'
+    String logSuffix;                   ///< Extension of flat day files (e.g. ".csv")
+    String eventFolder;                 ///< Event folder without trailing '/'
+    StorageManager* storage = nullptr;
+
+    State state = State::Idle;
+    uint8_t depth = 0;                  ///< Day file purge: 0 = output folder, 1 = year, 2 = month
+    String yearFolder;                  ///< Year folder being purged
+    String monthFolder;                 ///< Month folder being purged
+    unsigned long lastCheck = 0;        ///< millis() of the last free-space check
+    bool checked = false;               ///< A check has run since begin()
+    uint64_t totalBytes = 0;            ///< Card capacity at the last check
+    uint64_t usedBytes = 0;             ///< Used bytes, measured or estimated during a purge
+    float usedPercent = -1.0f;          ///< usedBytes / totalBytes at the last check
+    uint32_t purgeDeleted = 0;          ///< Files deleted by the running purge
+    uint32_t deletedFiles = 0;          ///< Files deleted since startup
+};
+
+#endif // RETENTION_MANAGER_H
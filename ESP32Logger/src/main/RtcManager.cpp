@@ -1,4 +1,18 @@
 #include "RtcManager.h"
+#include <sys/time.h>
+
+// How often the system clock is re-synced to the RTC second edge
+static const uint32_t RTC_SYNC_INTERVAL_MS = 600000;
+// Minimum window over which drift is measured (an edge is stamped within ±RTC_EDGE_MAX_GAP_MS / 2)
+static const int64_t RTC_DRIFT_WINDOW_MS = 3600000;
+// An edge is only accepted if the polls before and after it were at most this far apart
+static const int64_t RTC_EDGE_MAX_GAP_MS = 20;
+// Give up waiting for a second edge after this long (RTC stopped?)
+static const uint32_t RTC_EDGE_TIMEOUT_MS = 1500;
+// Seconds tried before a sync is skipped because every edge fell into a wide gap
+static const uint8_t RTC_EDGE_ATTEMPTS = 5;
+// Backward corrections larger than this are applied immediately (e.g. manual time set)
+static const int64_t RTC_STEP_THRESHOLD_MS = 2000;
 
 /// <summary>
 /// Initializes the DS3231 RTC module.
@@ -28,6 +42,123 @@ void RtcManager::begin() {
     time_t timeNow = mktime(&t);
     struct timeval nowTime = { .tv_sec = timeNow, .tv_usec = 0 };
     settimeofday(&nowTime, nullptr);
+
+    // Coarse model until the first second-edge sync completes
+    baseRawMs = rawSystemMs();
+    baseOffsetMs = 0;
+    lastReturnedMs = 0;
+    synced = false;
+    syncState = SyncState::Idle;
+    lastSyncMillis = millis() - RTC_SYNC_INTERVAL_MS;  // Sync as soon as possible
+}
+
+/// <summary>
+/// Reads the uncorrected system clock.
+/// </summary>
+int64_t RtcManager::rawSystemMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return static_cast<int64_t>(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+}
+
+/// <summary>
+/// Returns drift-corrected, monotonic epoch milliseconds.
+/// </summary>
+int64_t RtcManager::nowMs() {
+    int64_t raw = rawSystemMs();
+    int64_t corrected = raw + baseOffsetMs + static_cast<int64_t>((raw - baseRawMs) * (driftPpm * 1e-6f));
+
+    if (corrected < lastReturnedMs && lastReturnedMs - corrected < RTC_STEP_THRESHOLD_MS) {
+        corrected = lastReturnedMs;  // Hold until the clock catches up
+    }
+    lastReturnedMs = corrected;
+    return corrected;
+}
+
+/// <summary>
+/// Incremental RTC discipline:
+/// Idle → (interval elapsed) read current RTC second → WaitEdge →
+/// (RTC second changed) resync at the observed edge → Idle.
+/// The edge lies between the last poll that saw the old second and the first
+/// one that sees the new second; it is stamped at their midpoint, and only if
+/// they were at most RTC_EDGE_MAX_GAP_MS apart. An edge that fell into a wider
+/// gap (a Modbus cycle ran between the polls) is dropped and the next second
+/// is waited for instead.
+/// </summary>
+void RtcManager::discipline() {
+    uint32_t ms = millis();
+
+    if (syncState == SyncState::Idle) {
+        if (ms - lastSyncMillis < RTC_SYNC_INTERVAL_MS) return;
+        edgeSecond = rtc.now().second();
+        edgePollRawMs = rawSystemMs();
+        edgeWaitStart = ms;
+        edgeAttempts = 0;
+        syncState = SyncState::WaitEdge;
+        return;
+    }
+
+    DateTime now = rtc.now();
+    int64_t raw = rawSystemMs();
+    int64_t gap = raw - edgePollRawMs;
+    int64_t before = edgePollRawMs;
+    edgePollRawMs = raw;
+
+    if (now.second() == edgeSecond) {
+        if (ms - edgeWaitStart > RTC_EDGE_TIMEOUT_MS) {
+            Serial.println("[RtcManager][WARN] No RTC second edge seen, skipping sync.");
+            syncState = SyncState::Idle;
+            lastSyncMillis = ms;
+        }
+        return;
+    }
+
+    if (gap > RTC_EDGE_MAX_GAP_MS) {
+        if (++edgeAttempts >= RTC_EDGE_ATTEMPTS) {
+            Serial.printf("[RtcManager][WARN] Polls around the RTC second edge too far apart (%ld ms), skipping sync.\n",
+                          (long)gap);
+            syncState = SyncState::Idle;
+            lastSyncMillis = ms;
+            return;
+        }
+        edgeSecond = now.second();  // Wait for the next edge
+        edgeWaitStart = ms;
+        return;
+    }
+
+    syncState = SyncState::Idle;
+    lastSyncMillis = ms;
+    resync(before + gap / 2, static_cast<int64_t>(now.unixtime()) * 1000);
+}
+
+/// <summary>
+/// Updates offset and drift estimate from one RTC edge observation.
+/// Drift is measured over windows of at least RTC_DRIFT_WINDOW_MS and smoothed.
+/// </summary>
+void RtcManager::resync(int64_t rawMs, int64_t rtcMs) {
+    int64_t offset = rtcMs - rawMs;
+    int64_t predicted = rawMs + baseOffsetMs + static_cast<int64_t>((rawMs - baseRawMs) * (driftPpm * 1e-6f));
+    lastResidualMs = static_cast<int32_t>(rtcMs - predicted);
+
+    if (!synced) {
+        anchorRawMs = rawMs;
+        anchorOffsetMs = offset;
+        synced = true;
+    } else if (rawMs - anchorRawMs >= RTC_DRIFT_WINDOW_MS) {
+        float measured = static_cast<float>(offset - anchorOffsetMs) * 1e6f / static_cast<float>(rawMs - anchorRawMs);
+        driftPpm = (driftPpm == 0.0f) ? measured : 0.7f * driftPpm + 0.3f * measured;
+        anchorRawMs = rawMs;
+        anchorOffsetMs = offset;
+    }
+
+    baseRawMs = rawMs;
+    baseOffsetMs = offset;
+
+    if (lastResidualMs < -RTC_STEP_THRESHOLD_MS) {
+        lastReturnedMs = 0;  // Large backward correction: allow the jump
+    }
+
+    Serial.printf("[RtcManager] Clock sync: residual %ld ms, drift %.2f ppm\n", (long)lastResidualMs, driftPpm);
 }
 
 /// <summary>
@@ -57,6 +188,13 @@ String RtcManager::getFormattedTime() {
 void RtcManager::setTime(uint16_t year, uint8_t month, uint8_t day,
                          uint8_t hour, uint8_t minute, uint8_t second) {
     rtc.adjust(DateTime(year, month, day, hour, minute, second));
+
+    // Re-sync the system clock model right away, drift history no longer applies
+    synced = false;
+    driftPpm = 0.0f;
+    syncState = SyncState::Idle;
+    lastSyncMillis = millis() - RTC_SYNC_INTERVAL_MS;
+
     Serial.printf("[RtcManager] RTC set to: %04d-%02d-%02d %02d:%02d:%02d\n",
                   year, month, day, hour, minute, second);
 }
@@ -99,28 +237,41 @@ parse_input:
         input.trim();
     }
 
-    // Manual time entry
-    if (input.length() >= 19) {
-        int y, M, d, h, m, s;
-        if (sscanf(input.c_str(), "%d-%d-%d %d:%d:%d", &y, &M, &d, &h, &m, &s) == 6) {
-            setTime(y, M, d, h, m, s);
-            Serial.printf("✅ [RtcManager] RTC manually set to %04d-%02d-%02d %02d:%02d:%02d\n", y, M, d, h, m, s);
-            return;
-        } else {
-            Serial.println("❌ [RtcManager] Invalid format. Expected: YYYY-MM-DD HH:MM:SS");
-        }
+    // Manual time entry, otherwise the current ESP system time
+    if (input.length() >= 19 && setTimeFromString(input.c_str())) return;
+    setTimeFromSystem();
+}
+
+/// <summary>
+/// Parses "YYYY-MM-DD HH:MM:SS" and sets the RTC.
+/// </summary>
+bool RtcManager::setTimeFromString(const char* text) {
+    int y, M, d, h, m, s;
+    if (sscanf(text, "%d-%d-%d %d:%d:%d", &y, &M, &d, &h, &m, &s) != 6 ||
+        y < 2000 || y > 2099 || M < 1 || M > 12 || d < 1 || d > 31 || h > 23 || m > 59 || s > 59 ||
+        h < 0 || m < 0 || s < 0) {
+        Serial.println("❌ [RtcManager] Invalid format. Expected: YYYY-MM-DD HH:MM:SS");
+        return false;
     }
+    setTime(y, M, d, h, m, s);
+    Serial.printf("✅ [RtcManager] RTC manually set to %04d-%02d-%02d %02d:%02d:%02d\n", y, M, d, h, m, s);
+    return true;
+}
 
-    // Fallback: use current ESP system time
+/// <summary>
+/// Sets the RTC from the current ESP system time.
+/// </summary>
+bool RtcManager::setTimeFromSystem() {
     time_t t = time(nullptr);
     struct tm* now = localtime(&t);
-    if (now) {
-        setTime(now->tm_year + 1900, now->tm_mon + 1, now->tm_mday,
-                now->tm_hour, now->tm_min, now->tm_sec);
-        Serial.printf("✅ [RtcManager] RTC set from system time: %04d-%02d-%02d %02d:%02d:%02d\n",
-                      now->tm_year + 1900, now->tm_mon + 1, now->tm_mday,
-                      now->tm_hour, now->tm_min, now->tm_sec);
-    } else {
+    if (!now) {
         Serial.println("❌ [RtcManager] Failed to get system time.");
+        return false;
     }
+    setTime(now->tm_year + 1900, now->tm_mon + 1, now->tm_mday,
+            now->tm_hour, now->tm_min, now->tm_sec);
+    Serial.printf("✅ [RtcManager] RTC set from system time: %04d-%02d-%02d %02d:%02d:%02d\n",
+                  now->tm_year + 1900, now->tm_mon + 1, now->tm_mday,
+                  now->tm_hour, now->tm_min, now->tm_sec);
+    return true;
 }
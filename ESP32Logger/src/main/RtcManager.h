@@ -7,6 +7,11 @@
 /// Manages access to the DS3231 Real-Time Clock (RTC).
 /// Provides basic initialization, time retrieval and formatting,
 /// as well as interactive manual time setting via Serial.
+///
+/// Sample timestamps come from the ESP32 system clock (nowMs()), which is
+/// disciplined against the RTC in the background: the RTC second edge is
+/// detected incrementally, the offset is re-synced, and the drift between
+/// the two clocks is estimated and extrapolated between syncs.
 /// </summary>
 class RtcManager {
 public:
@@ -23,6 +28,30 @@ public:
     /// <returns>Formatted date-time string from RTC</returns>
     String getFormattedTime();
 
+    /// <summary>
+    /// Returns the current time as epoch milliseconds from the system clock,
+    /// corrected for the estimated drift against the RTC. Never goes backwards
+    /// by less than a step threshold. No I2C access.
+    /// </summary>
+    int64_t nowMs();
+
+    /// <summary>
+    /// Advances the RTC discipline state machine. Cheap when nothing is due;
+    /// while waiting for the RTC second edge it performs one I2C read per call.
+    /// Call frequently from the main loop.
+    /// </summary>
+    void discipline();
+
+    /// <summary>
+    /// Returns the estimated drift of the system clock against the RTC in ppm.
+    /// </summary>
+    float getDriftPpm() const { return driftPpm; }
+
+    /// <summary>
+    /// Returns the RTC minus corrected system time measured at the last sync (ms).
+    /// </summary>
+    int32_t getLastOffsetMs() const { return lastResidualMs; }
+
     /// <summary>
     /// Sets the RTC time and date manually using individual components.
     /// </summary>
@@ -39,11 +68,53 @@ public:
     /// Prompts the user via Serial to manually enter the current time.
     /// If RTC time is invalid, allows entry in format: "YYYY-MM-DD HH:MM:SS".
     /// Automatically parses and applies the entered value.
+    /// Blocks for up to 10 s; only used at boot, before acquisition starts
+    /// (the serial console's setrtc command does not block).
     /// </summary>
     void serialSetupTime();
 
+    /// <summary>
+    /// Sets the RTC from text in the format "YYYY-MM-DD HH:MM:SS".
+    /// </summary>
+    /// <returns>False if the text could not be parsed</returns>
+    bool setTimeFromString(const char* text);
+
+    /// <summary>
+    /// Sets the RTC from the current ESP system time.
+    /// </summary>
+    /// <returns>False if the system time is not available</returns>
+    bool setTimeFromSystem();
+
 private:
+    /// <summary>
+    /// Re-syncs the clock model to an RTC second edge observed at rawMs.
+    /// </summary>
+    void resync(int64_t rawMs, int64_t rtcMs);
+
+    /// <summary>
+    /// Reads the uncorrected ESP32 system clock in milliseconds.
+    /// </summary>
+    static int64_t rawSystemMs();
+
+    enum class SyncState : uint8_t { Idle, WaitEdge };
+
     RTC_DS3231 rtc; ///< RTClib instance for DS3231 communication
+
+    SyncState syncState = SyncState::Idle;  ///< Discipline state machine
+    bool synced = false;                    ///< True after the first edge sync
+    uint32_t lastSyncMillis = 0;            ///< millis() of the last completed sync
+    uint32_t edgeWaitStart = 0;             ///< millis() when edge detection began
+    uint8_t edgeSecond = 0;                 ///< RTC second value before the edge
+    uint8_t edgeAttempts = 0;               ///< Edges dropped for a wide poll gap in this sync
+    int64_t edgePollRawMs = 0;              ///< Raw system time of the previous edge poll
+
+    int64_t baseRawMs = 0;                  ///< Raw system time at the last sync
+    int64_t baseOffsetMs = 0;               ///< RTC minus raw system time at the last sync
+    int64_t anchorRawMs = 0;                ///< Start of the drift measurement window
+    int64_t anchorOffsetMs = 0;             ///< Offset at the start of that window
+    float driftPpm = 0.0f;                  ///< Estimated system clock drift vs RTC
+    int32_t lastResidualMs = 0;             ///< Error of the model at the last sync
+    int64_t lastReturnedMs = 0;             ///< Monotonic guard for nowMs()
 };
 
 #endif // RTC_MANAGER_H
@@ -0,0 +1,86 @@
+#include "RtuCapture.h"
+#include <string.h>
+
+namespace RtuCapture {
+
+static const uint8_t kMagic[6] = { 'R', 'T', 'U', 'C', 'A', 'P' };
+
+static void writeU32(uint32_t value, uint8_t* p) {
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+    p[2] = static_cast<uint8_t>(value >> 16);
+    p[3] = static_cast<uint8_t>(value >> 24);
+}
+
+static uint32_t readU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void encodeHeader(uint8_t out[kHeaderSize]) {
+    memcpy(out, kMagic, sizeof(kMagic));
+    out[6] = kVersion;
+    out[7] = 0;
+}
+
+void encodeSample(int64_t timestampMs, uint8_t out[kSampleSize]) {
+    uint64_t value = static_cast<uint64_t>(timestampMs);
+    out[0] = kSampleTag;
+    writeU32(static_cast<uint32_t>(value), out + 1);
+    writeU32(static_cast<uint32_t>(value >> 32), out + 5);
+}
+
+size_t encodeTransaction(const Transaction& t, uint8_t* out) {
+    out[0] = kTransactionTag;
+    out[1] = t.bus;
+    writeU32(t.requestUs, out + 2);
+    writeU32(t.firstUs, out + 6);
+    writeU32(t.lastUs, out + 10);
+    out[14] = t.requestLength;
+    out[15] = t.responseLength;
+    memcpy(out + kTransactionHeaderSize, t.request, t.requestLength);
+    memcpy(out + kTransactionHeaderSize + t.requestLength, t.response, t.responseLength);
+    return transactionSize(t.requestLength, t.responseLength);
+}
+
+/// <summary>
+/// Headers of a newer version are rejected, so an old reader stops instead of
+/// misreading records it does not know.
+/// </summary>
+size_t decode(const uint8_t* buf, size_t avail, Record& out) {
+    if (avail == 0) return 0;
+
+    if (buf[0] == kMagic[0]) {
+        if (avail < kHeaderSize || memcmp(buf, kMagic, sizeof(kMagic)) != 0 || buf[6] != kVersion) return 0;
+        out.type = Record::Header;
+        return kHeaderSize;
+    }
+
+    if (buf[0] == kSampleTag) {
+        if (avail < kSampleSize) return 0;
+        uint64_t value = readU32(buf + 1) | (static_cast<uint64_t>(readU32(buf + 5)) << 32);
+        out.type = Record::Sample;
+        out.timestampMs = static_cast<int64_t>(value);
+        return kSampleSize;
+    }
+
+    if (buf[0] == kTransactionTag) {
+        if (avail < kTransactionHeaderSize) return 0;
+        size_t size = transactionSize(buf[14], buf[15]);
+        if (avail < size) return 0;
+        Transaction& t = out.transaction;
+        t.bus = buf[1];
+        t.requestUs = readU32(buf + 2);
+        t.firstUs = readU32(buf + 6);
+        t.lastUs = readU32(buf + 10);
+        t.requestLength = buf[14];
+        t.responseLength = buf[15];
+        t.request = buf + kTransactionHeaderSize;
+        t.response = t.request + t.requestLength;
+        out.type = Record::Transfer;
+        return size;
+    }
+    return 0;
+}
+
+} // namespace RtuCapture
@@ -0,0 +1,95 @@
+#ifndef RTU_CAPTURE_H
+#define RTU_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+/// Capture file of raw Modbus RTU traffic: every request the master sent and
+/// the bytes that came back, with the bus clock, grouped by sample cycle.
+/// The logger writes it (CaptureTransport), rtulog-poll --replay feeds it back
+/// through RtuMaster and the read plan, so slow meters and line faults can be
+/// reproduced on a PC. This header has no Arduino dependencies.
+///
+/// Records (little endian), appended in this order:
+///   Header       "RTUCAP" [uint8 version] [uint8 0]                  8 bytes
+///   Sample       'S' [int64 timestamp ms]                             9 bytes
+///   Transaction  'T' [uint8 bus] [uint32 request us] [uint32 first us]
+///                [uint32 last us] [uint8 request length] [uint8 response length]
+///                [request bytes] [response bytes]                    16 + lengths
+///
+/// A header starts every capture session (boot or configuration reload), so it
+/// may appear between any two records. The transactions after a sample record
+/// belong to that cycle, bus by bus. "request us" is the bus clock when the
+/// request had been sent; "first us" and "last us" are the arrival of the first
+/// and last response byte relative to it (0 without a response).
+/// </summary>
+namespace RtuCapture {
+
+constexpr uint8_t kVersion = 1;
+constexpr size_t kHeaderSize = 8;
+constexpr uint8_t kSampleTag = 'S';
+constexpr size_t kSampleSize = 9;
+constexpr uint8_t kTransactionTag = 'T';
+constexpr size_t kTransactionHeaderSize = 16;
+constexpr size_t kMaxFrame = 255;                ///< Longer frames are cut (RTU frames have at most 256 bytes)
+
+/// <summary>
+/// One request and its response. The byte pointers refer to the caller's buffer.
+/// </summary>
+struct Transaction {
+    uint8_t bus;
+    uint32_t requestUs;         ///< Bus clock after the request was sent
+    uint32_t firstUs;           ///< First response byte, relative to requestUs
+    uint32_t lastUs;            ///< Last response byte, relative to requestUs
+    uint8_t requestLength;
+    uint8_t responseLength;
+    const uint8_t* request;
+    const uint8_t* response;
+};
+
+/// <summary>
+/// Decoded record.
+/// </summary>
+struct Record {
+    enum Type : uint8_t { Header, Sample, Transfer } type;
+    int64_t timestampMs;        ///< Sample records
+    Transaction transaction;    ///< Transfer records
+};
+
+/// <summary>
+/// Size of an encoded transaction record.
+/// </summary>
+inline size_t transactionSize(size_t requestLength, size_t responseLength) {
+    return kTransactionHeaderSize + requestLength + responseLength;
+}
+
+/// <summary>
+/// Writes the session header.
+/// </summary>
+void encodeHeader(uint8_t out[kHeaderSize]);
+
+/// <summary>
+/// Writes a sample record.
+/// </summary>
+void encodeSample(int64_t timestampMs, uint8_t out[kSampleSize]);
+
+/// <summary>
+/// Writes a transaction record.
+/// </summary>
+/// <param name="out">Room for transactionSize(request, response) bytes</param>
+/// <returns>Bytes written</returns>
+size_t encodeTransaction(const Transaction& transaction, uint8_t* out);
+
+/// <summary>
+/// Decodes the record at buf.
+/// </summary>
+/// <param name="buf">Start of unread data</param>
+/// <param name="avail">Number of unread bytes</param>
+/// <param name="out">Receives the record; its pointers refer into buf</param>
+/// <returns>Bytes consumed, 0 if the record is incomplete or not a record</returns>
+size_t decode(const uint8_t* buf, size_t avail, Record& out);
+
+} // namespace RtuCapture
+
+#endif // RTU_CAPTURE_H
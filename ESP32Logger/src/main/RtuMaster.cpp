@@ -0,0 +1,111 @@
+#include "RtuMaster.h"
+
+static const uint8_t kReadHoldingRegisters = 0x03;
+static const uint8_t kExceptionFlag = 0x80;
+
+uint16_t RtuMaster::crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? static_cast<uint16_t>((crc >> 1) ^ 0xA001) : static_cast<uint16_t>(crc >> 1);
+        }
+    }
+    return crc;
+}
+
+void RtuMaster::begin(BusTransport* t, uint8_t id, const BusTiming::Line& line, uint32_t timeoutUs) {
+    transport = t;
+    slaveId = id;
+    gapUs = BusTiming::frameGapUs(line);
+    responseTimeoutUs = timeoutUs;
+    lastFrameUs = transport->nowUs() - gapUs;
+}
+
+void RtuMaster::waitSilence() {
+    uint32_t startUs = transport->nowUs();
+    for (;;) {
+        uint32_t quietUs = transport->nowUs() - lastFrameUs;
+        if (quietUs >= gapUs) return;
+        if (transport->nowUs() - startUs >= responseTimeoutUs) return;  // Babbling line, send anyway
+        if (transport->readByte(gapUs - quietUs) >= 0) {
+            lastFrameUs = transport->nowUs();  // Line not idle yet, start over
+        }
+    }
+}
+
+/// <summary>
+/// The whole answer has to arrive within the response timeout counted from
+/// the request, as with ModbusMaster; the expected length is known, so no
+/// inter-character timing is needed to find the end of the frame.
+/// </summary>
+bool RtuMaster::receive(uint8_t* buf, size_t len, uint32_t startUs) {
+    for (size_t i = 0; i < len; ++i) {
+        uint32_t elapsedUs = transport->nowUs() - startUs;
+        if (elapsedUs >= responseTimeoutUs) return false;
+        int c = transport->readByte(responseTimeoutUs - elapsedUs);
+        if (c < 0) return false;
+        buf[i] = static_cast<uint8_t>(c);
+    }
+    return true;
+}
+
+/// <summary>
+/// Sends one request and checks the answer: the first three bytes tell an
+/// exception (5 bytes) from a data frame (5 + 2·count bytes), then the CRC,
+/// slave address and function are verified in that order.
+/// </summary>
+uint8_t RtuMaster::readHoldingRegisters(uint16_t address, uint16_t count, uint16_t* out) {
+    if (!transport) return kResponseTimedOut;
+    if (count == 0 || count > RegisterMap::kMaxBlockWords) return kIllegalDataValue;
+
+    uint8_t request[8] = {
+        slaveId, kReadHoldingRegisters,
+        static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address),
+        static_cast<uint8_t>(count >> 8), static_cast<uint8_t>(count),
+    };
+    uint16_t crc = crc16(request, 6);
+    request[6] = static_cast<uint8_t>(crc);
+    request[7] = static_cast<uint8_t>(crc >> 8);
+
+    waitSilence();
+    transport->discardInput();
+    bool sent = transport->write(request, sizeof(request));
+    uint32_t sentUs = transport->nowUs();
+    lastFrameUs = sentUs;
+    if (!sent) return kResponseTimedOut;
+
+    uint8_t frame[5 + 2 * RegisterMap::kMaxBlockWords];
+    size_t length = 0;
+    uint8_t result = kSuccess;
+    if (!receive(frame, 3, sentUs)) {
+        result = kResponseTimedOut;
+    } else if (frame[1] == (kReadHoldingRegisters | kExceptionFlag)) {
+        length = 5;
+    } else if (frame[1] != kReadHoldingRegisters) {
+        result = kInvalidFunction;  // Unknown frame length, the silence wait drains the rest
+    } else if (frame[2] != 2 * count) {
+        result = kBadLength;
+    } else {
+        length = 5 + 2 * count;
+    }
+
+    if (result == kSuccess) {
+        if (!receive(frame + 3, length - 3, sentUs)) {
+            result = kResponseTimedOut;
+        } else if (crc16(frame, length - 2) != (frame[length - 2] | (frame[length - 1] << 8))) {
+            result = kInvalidCrc;
+        } else if (frame[0] != slaveId) {
+            result = kInvalidSlaveId;
+        } else if (length == 5) {
+            result = frame[2];  // Exception code
+        } else if (out) {
+            for (uint16_t i = 0; i < count; ++i) {
+                out[i] = static_cast<uint16_t>((frame[3 + 2 * i] << 8) | frame[4 + 2 * i]);
+            }
+        }
+    }
+
+    lastFrameUs = transport->nowUs();
+    return result;
+}
@@ -0,0 +1,77 @@
+#ifndef RTU_MASTER_H
+#define RTU_MASTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "BusTiming.h"
+#include "BusTransport.h"
+#include "RegisterMap.h"
+
+/// <summary>
+/// Modbus RTU master for function 0x03 (read holding registers) on a
+/// BusTransport. Replaces the ModbusMaster library, whose single global
+/// instance and context-free RS485 callbacks allowed only one bus; any
+/// number of RtuMasters can run side by side, one per bus and task.
+/// This header has no Arduino dependencies.
+///
+/// Result codes are those of ModbusMaster: 0x00 success, 0x01..0x0B the
+/// slave's exception code, 0xE0..0xE4 master errors.
+/// </summary>
+class RtuMaster {
+public:
+    static constexpr uint8_t kSuccess = 0x00;
+    static constexpr uint8_t kIllegalFunction = 0x01;
+    static constexpr uint8_t kIllegalDataAddress = 0x02;
+    static constexpr uint8_t kIllegalDataValue = 0x03;
+    static constexpr uint8_t kSlaveDeviceFailure = 0x04;
+    static constexpr uint8_t kInvalidSlaveId = 0xE0;
+    static constexpr uint8_t kInvalidFunction = 0xE1;
+    static constexpr uint8_t kResponseTimedOut = 0xE2;
+    static constexpr uint8_t kInvalidCrc = 0xE3;
+    static constexpr uint8_t kBadLength = 0xE4;
+
+    /// <summary>
+    /// Binds the master to a transport and a slave.
+    /// </summary>
+    /// <param name="transport">Bus transport (not owned)</param>
+    /// <param name="slaveId">Slave address</param>
+    /// <param name="line">Serial line parameters (for the frame silence)</param>
+    /// <param name="responseTimeoutUs">Time the slave has to answer completely</param>
+    void begin(BusTransport* transport, uint8_t slaveId, const BusTiming::Line& line,
+               uint32_t responseTimeoutUs = BusTiming::kResponseTimeoutUs);
+
+    /// <summary>
+    /// Reads count holding registers (at most RegisterMap::kMaxBlockWords).
+    /// </summary>
+    /// <param name="address">First register, as sent on the wire</param>
+    /// <param name="count">Number of registers</param>
+    /// <param name="out">Receives count values on success (may be nullptr)</param>
+    /// <returns>Result code (kSuccess on success)</returns>
+    uint8_t readHoldingRegisters(uint16_t address, uint16_t count, uint16_t* out);
+
+    /// <summary>
+    /// Modbus CRC16 (polynomial 0xA001, initial 0xFFFF), sent low byte first.
+    /// </summary>
+    static uint16_t crc16(const uint8_t* data, size_t len);
+
+private:
+    /// <summary>
+    /// Waits until the line has been silent for one frame gap since the last
+    /// frame; bytes arriving meanwhile are noise or a late answer and dropped.
+    /// Gives up after the response timeout if the line never goes quiet.
+    /// </summary>
+    void waitSilence();
+
+    /// <summary>
+    /// Reads len bytes before the deadline.
+    /// </summary>
+    bool receive(uint8_t* buf, size_t len, uint32_t startUs);
+
+    BusTransport* transport = nullptr;
+    uint8_t slaveId = 1;
+    uint32_t gapUs = 0;                 ///< 3.5 character silence
+    uint32_t responseTimeoutUs = BusTiming::kResponseTimeoutUs;
+    uint32_t lastFrameUs = 0;           ///< End of the last frame on the line
+};
+
+#endif // RTU_MASTER_H
@@ -0,0 +1,133 @@
+#include "ScaleExpression.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+using Kind = ScaleExpression::Op::Kind;
+
+static int precedence(Kind k) {
+    switch (k) {
+        case Kind::Add: case Kind::Sub: return 1;
+        case Kind::Mul: case Kind::Div: return 2;
+        case Kind::Neg: return 3;
+        default: return 0;
+    }
+}
+
+/// <summary>
+/// Shunting-yard: operands go straight to the program, operators wait on a
+/// stack until an operator of lower precedence (or a closing parenthesis)
+/// arrives. '-' where an operand is expected is unary minus. The stack depth
+/// of the result is checked so evaluate() can use a fixed array.
+/// </summary>
+bool ScaleExpression::compile(const char* text) {
+    program.clear();
+    valid = false;
+
+    // Operator stack; Kind::Const marks an open parenthesis
+    Kind pending[kMaxDepth * 2];
+    size_t pendingCount = 0;
+    bool expectOperand = true;
+    const char* p = text;
+
+    while (*p) {
+        char c = *p;
+        if (isspace(static_cast<unsigned char>(c))) {
+            ++p;
+            continue;
+        }
+        if (expectOperand) {
+            if (isdigit(static_cast<unsigned char>(c)) || c == '.') {
+                char* end;
+                float v = strtof(p, &end);
+                if (end == p) return false;
+                program.push_back({Kind::Const, v});
+                p = end;
+                expectOperand = false;
+            } else if (strncmp(p, "val", 3) == 0 || strncmp(p, "VTR", 3) == 0 || strncmp(p, "CTR", 3) == 0) {
+                if (isalnum(static_cast<unsigned char>(p[3])) || p[3] == '_') return false;
+                program.push_back({c == 'v' ? Kind::Val : c == 'V' ? Kind::Vtr : Kind::Ctr, 0.0f});
+                p += 3;
+                expectOperand = false;
+            } else if (c == '(' || c == '-') {
+                if (pendingCount == sizeof(pending) / sizeof(pending[0])) return false;
+                pending[pendingCount++] = c == '(' ? Kind::Const : Kind::Neg;
+                ++p;
+            } else if (c == '+') {
+                ++p;
+            } else {
+                return false;
+            }
+            continue;
+        }
+
+        if (c == ')') {
+            while (pendingCount > 0 && pending[pendingCount - 1] != Kind::Const) {
+                program.push_back({pending[--pendingCount], 0.0f});
+            }
+            if (pendingCount == 0) return false;
+            --pendingCount;
+            ++p;
+            continue;
+        }
+
+        Kind op;
+        switch (c) {
+            case '+': op = Kind::Add; break;
+            case '-': op = Kind::Sub; break;
+            case '*': op = Kind::Mul; break;
+            case '/': op = Kind::Div; break;
+            default: return false;
+        }
+        while (pendingCount > 0 && pending[pendingCount - 1] != Kind::Const &&
+               precedence(pending[pendingCount - 1]) >= precedence(op)) {
+            program.push_back({pending[--pendingCount], 0.0f});
+        }
+        if (pendingCount == sizeof(pending) / sizeof(pending[0])) return false;
+        pending[pendingCount++] = op;
+        expectOperand = true;
+        ++p;
+    }
+
+    if (program.empty() && pendingCount == 0) {
+        program.push_back({Kind::Val, 0.0f});
+        valid = true;
+        return true;
+    }
+    if (expectOperand) return false;
+    while (pendingCount > 0) {
+        if (pending[pendingCount - 1] == Kind::Const) return false;
+        program.push_back({pending[--pendingCount], 0.0f});
+    }
+
+    size_t depth = 0;
+    for (const Op& op : program) {
+        if (op.kind == Kind::Const || op.kind == Kind::Val || op.kind == Kind::Vtr || op.kind == Kind::Ctr) {
+            if (++depth > kMaxDepth) return false;
+        } else if (op.kind != Kind::Neg) {
+            --depth;
+        }
+    }
+    valid = true;
+    return true;
+}
+
+float ScaleExpression::evaluate(float val, float vtr, float ctr) const {
+    if (!valid) return NAN;
+    float stack[kMaxDepth];
+    size_t top = 0;
+    for (const Op& op : program) {
+        switch (op.kind) {
+            case Kind::Const: stack[top++] = op.value; break;
+            case Kind::Val: stack[top++] = val; break;
+            case Kind::Vtr: stack[top++] = vtr; break;
+            case Kind::Ctr: stack[top++] = ctr; break;
+            case Kind::Neg: stack[top - 1] = -stack[top - 1]; break;
+            case Kind::Add: --top; stack[top - 1] += stack[top]; break;
+            case Kind::Sub: --top; stack[top - 1] -= stack[top]; break;
+            case Kind::Mul: --top; stack[top - 1] *= stack[top]; break;
+            case Kind::Div: --top; stack[top - 1] = divide(stack[top - 1], stack[top]); break;
+        }
+    }
+    return stack[0];
+}
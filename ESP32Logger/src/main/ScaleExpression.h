@@ -0,0 +1,65 @@
+#ifndef SCALE_EXPRESSION_H
+#define SCALE_EXPRESSION_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/// <summary>
+/// Register scaling formula such as "val * 0.1 * VTR", compiled once into
+/// postfix (RPN) form so each read only runs a few float operations instead
+/// of re-parsing the text. This header has no Arduino dependencies; the host
+/// generator (rtulog-regmap) uses it to turn formulas into C++ functions.
+///
+/// Supported: numbers, the variables val, VTR and CTR, + - * /, parentheses
+/// and unary minus. Division by zero yields NAN. An empty formula means "val".
+/// </summary>
+class ScaleExpression {
+public:
+    /// <summary>
+    /// One postfix instruction.
+    /// </summary>
+    struct Op {
+        enum class Kind : uint8_t { Const, Val, Vtr, Ctr, Add, Sub, Mul, Div, Neg };
+        Kind kind;
+        float value;          ///< Constant for Kind::Const
+    };
+
+    /// <summary>
+    /// Largest evaluation stack a formula may need.
+    /// </summary>
+    static constexpr size_t kMaxDepth = 16;
+
+    /// <summary>
+    /// Compiles a formula. On failure the expression evaluates to NAN.
+    /// </summary>
+    /// <returns>False if the formula is malformed or too deeply nested</returns>
+    bool compile(const char* text);
+
+    /// <summary>
+    /// Evaluates the formula for one raw value.
+    /// </summary>
+    float evaluate(float val, float vtr, float ctr) const;
+
+    /// <summary>
+    /// Division as used by formulas: NAN instead of infinity for a zero divisor.
+    /// </summary>
+    static float divide(float a, float b) { return b != 0.0f ? a / b : NAN; }
+
+    /// <summary>
+    /// The compiled postfix program.
+    /// </summary>
+    const std::vector<Op>& ops() const { return program; }
+
+    /// <summary>
+    /// True if compile() succeeded.
+    /// </summary>
+    bool isValid() const { return valid; }
+
+private:
+    std::vector<Op> program;
+    bool valid = false;
+};
+
+#endif // SCALE_EXPRESSION_H
@@ -0,0 +1,661 @@
+#include "SerialConsole.h"
+#include "SystemManager.h"
+#include "TimestampFormatter.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+const SerialConsole::Command SerialConsole::kCommands[] = {
+    { "help",   "help",                 "List commands",                              &SerialConsole::startHelp,   &SerialConsole::stepHelp },
+    { "stats",  "stats",                "Uptime, bus, staging, clock, heap, history, SD card", &SerialConsole::startStats,  &SerialConsole::stepStats },
+    { "tail",   "tail [n]",             "Last n samples (default 10)",                &SerialConsole::startTail,   &SerialConsole::stepTail },
+    { "regs",   "regs",                 "Channels with their latest value",           &SerialConsole::startRegs,   &SerialConsole::stepRegs },
+    { "recent", "recent key [minutes]", "Latest, min and max of a channel from RAM",  &SerialConsole::startRecent, &SerialConsole::stepRecent },
+    { "alarms", "alarms",               "Alarm rules and their state",                &SerialConsole::startAlarms, &SerialConsole::stepAlarms },
+    { "read",   "read addr [count]",    "Read raw registers on bus 0 (up to 16)",     &SerialConsole::startRead,   &SerialConsole::stepRead },
+    { "setrtc", "setrtc [YYYY-MM-DD HH:MM:SS]", "Set the RTC (asks for the time if omitted)", &SerialConsole::startSetRtc, &SerialConsole::stepSetRtc },
+    { "reload", "reload",               "Flush staged samples and re-read config.json", &SerialConsole::startReload, &SerialConsole::stepReload },
+    { "trace",  "trace [save|clear]",   "Dump trace events (save: to /trace.txt)",    &SerialConsole::startTrace,  &SerialConsole::stepTrace },
+};
+
+const size_t SerialConsole::kCommandCount = sizeof(kCommands) / sizeof(kCommands[0]);
+
+/// <summary>
+/// Binds the console to its port and resets the line editor.
+/// </summary>
+void SerialConsole::begin(Stream* serialPort, SystemManager* systemManager) {
+    port = serialPort;
+    system = systemManager;
+    lineLength = 0;
+    lineOverflow = false;
+    outputLength = outputSent = 0;
+    active = nullptr;
+}
+
+/// <summary>
+/// One console step: pending output first, then input (at most one line),
+/// then the next step of the running command.
+/// </summary>
+void SerialConsole::poll() {
+    if (!port) return;
+    if (!flushOutput()) return;
+
+    readInput();
+    if (outputLength == 0 && active && !(this->*active->step)()) {
+        finish();
+    }
+    flushOutput();
+}
+
+/// <summary>
+/// Feeds received bytes through the line editor, up to the end of one line.
+/// </summary>
+void SerialConsole::readInput() {
+    for (size_t n = 0; n < kInputPerPoll && port->available() > 0; ++n) {
+        char c = static_cast<char>(port->read());
+
+        // Skip escape sequences (arrow keys etc.): ESC x, or ESC [ params final
+        if (escape == 1) {
+            escape = (c == '[') ? 2 : 0;
+            continue;
+        }
+        if (escape == 2) {
+            if (c >= 0x40 && c <= 0x7E) escape = 0;
+            continue;
+        }
+
+        bool wasCr = lastWasCr;
+        lastWasCr = (c == '\r');
+
+        switch (c) {
+            case '\n':
+                if (wasCr) break;  // Second half of CR LF
+                // fall through
+            case '\r':
+                echo("\r\n");
+                submitLine();
+                return;  // One line per poll, its reply needs the output buffer
+            case 0x08:  // Backspace
+            case 0x7F:  // Delete (sent by most terminals for backspace)
+                if (lineLength > 0) {
+                    --lineLength;
+                    echo("\b \b");
+                }
+                break;
+            case 0x15:  // Ctrl-U: clear line
+                while (lineLength > 0) {
+                    --lineLength;
+                    echo("\b \b");
+                }
+                lineOverflow = false;
+                break;
+            case 0x03:  // Ctrl-C: cancel command and line
+                lineLength = 0;
+                lineOverflow = false;
+                echo("^C\r\n");
+                if (active) {
+                    finish();
+                    outputLength = outputSent = 0;
+                }
+                break;
+            case 0x1B:
+                escape = 1;
+                break;
+            default:
+                if (c < 0x20 || c > 0x7E) break;  // Other control characters, non-ASCII
+                if (lineLength < kLineSize - 1) {
+                    line[lineLength++] = c;
+                    char text[2] = { c, '\0' };
+                    echo(text);
+                } else {
+                    lineOverflow = true;
+                }
+                break;
+        }
+    }
+}
+
+/// <summary>
+/// Dispatches a completed line: as input to a waiting setrtc, or as a new command.
+/// </summary>
+void SerialConsole::submitLine() {
+    line[lineLength] = '\0';
+    bool overflow = lineOverflow;
+    lineLength = 0;
+    lineOverflow = false;
+
+    if (overflow) {
+        emit("Line too long (max %u characters).\n", (unsigned)(kLineSize - 1));
+        return;
+    }
+
+    // Trim
+    char* text = line;
+    while (*text == ' ') ++text;
+    size_t len = strlen(text);
+    while (len > 0 && text[len - 1] == ' ') text[--len] = '\0';
+
+    if (active) {
+        if (active->step == &SerialConsole::stepSetRtc && phase == 1 && !argumentReady) {
+            strcpy(argument, text);
+            argumentReady = true;
+        } else if (len > 0) {
+            emit("Busy with '%s', Ctrl-C cancels.\n", active->name);
+        }
+        return;
+    }
+    if (len == 0) return;
+    if (system->isReloading()) {     // Channels and history do not match until the reload is done
+        emit("Configuration reload in progress, try again shortly.\n");
+        return;
+    }
+
+    // Split "name args"
+    char* args = text;
+    while (*args && *args != ' ') ++args;
+    if (*args) {
+        *args++ = '\0';
+        while (*args == ' ') ++args;
+    }
+
+    for (size_t i = 0; i < kCommandCount; ++i) {
+        if (strcasecmp(text, kCommands[i].name) != 0) continue;
+
+        phase = 0;
+        index = last = 0;
+        field = -1;
+        argumentReady = false;
+        startedMs = millis();
+        if ((this->*kCommands[i].start)(args)) {
+            active = &kCommands[i];
+        } else if (outputLength == 0) {
+            emit("Usage: %s\n", kCommands[i].usage);
+        }
+        return;
+    }
+    emit("Unknown command '%s', try 'help'.\n", text);
+}
+
+/// <summary>
+/// Ends the running command.
+/// </summary>
+void SerialConsole::finish() {
+    active = nullptr;
+    argumentReady = false;
+}
+
+/// <summary>
+/// Formats one fragment into the output buffer (truncated to kOutputSize).
+/// </summary>
+void SerialConsole::emit(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(output, sizeof(output), format, args);
+    va_end(args);
+    outputLength = len < 0 ? 0 : (static_cast<size_t>(len) < sizeof(output) ? len : sizeof(output) - 1);
+    outputSent = 0;
+}
+
+/// <summary>
+/// Writes the pending fragment without blocking.
+/// </summary>
+bool SerialConsole::flushOutput() {
+    if (outputSent >= outputLength) {
+        outputLength = outputSent = 0;
+        return true;
+    }
+    int room = port->availableForWrite();
+    if (room <= 0) return false;
+
+    size_t chunk = outputLength - outputSent;
+    if (chunk > static_cast<size_t>(room)) chunk = room;
+    outputSent += port->write(reinterpret_cast<const uint8_t*>(output) + outputSent, chunk);
+    if (outputSent < outputLength) return false;
+
+    outputLength = outputSent = 0;
+    return true;
+}
+
+/// <summary>
+/// Echoes typed characters; dropped rather than waiting for TX space.
+/// </summary>
+void SerialConsole::echo(const char* text) {
+    size_t len = strlen(text);
+    if (port->availableForWrite() >= static_cast<int>(len)) {
+        port->write(reinterpret_cast<const uint8_t*>(text), len);
+    }
+}
+
+/// <summary>
+/// help: lists the command table, one entry per step.
+/// </summary>
+bool SerialConsole::startHelp(const char*) {
+    return true;
+}
+
+bool SerialConsole::stepHelp() {
+    if (index >= kCommandCount) return false;
+    emit("  %-30s %s\n", kCommands[index].usage, kCommands[index].help);
+    ++index;
+    return true;
+}
+
+/// <summary>
+/// stats: one line per step; the bus lines take one step per bus (index).
+/// </summary>
+bool SerialConsole::startStats(const char*) {
+    return true;
+}
+
+bool SerialConsole::stepStats() {
+    switch (phase++) {
+        case 0:
+            emit("uptime %lu s, %lu cycle(s), interval %lu ms\n", millis() / 1000,
+                 (unsigned long)system->getCycleCount(), system->getPollingInterval());
+            return true;
+        case 1: {
+            BusPoller* buses = system->getBuses();
+            if (index >= buses->getBusCount()) return true;  // Next phase
+            BusStats bus = buses->getBus(index)->getBusStats();
+            emit("bus %u: %lu request(s), %lu failed, %.1f s busy, turnaround %.1f ms (max %.1f ms)\n",
+                 (unsigned)index, (unsigned long)bus.transactions, (unsigned long)bus.failures,
+                 bus.busyUs / 1000000.0, bus.turnaroundUs / 1000.0f, bus.maxTurnaroundUs / 1000.0f);
+            ++index;
+            --phase;  // Stay on the bus lines
+            return true;
+        }
+        case 2: {
+            const StagingRing* staging = system->getStaging();
+            emit("staging: %u of %u slot(s) pending, %lu dropped, newest #%lu\n", (unsigned)staging->pending(),
+                 (unsigned)staging->capacity(), (unsigned long)staging->dropped(),
+                 (unsigned long)staging->newestSeq());
+            return true;
+        }
+        case 3: {
+            RtcManager* rtc = system->getRtc();
+            TimestampFormatter formatter;
+            char now[TimestampFormatter::kMaxLength];
+            formatter.format(rtc->nowMs(), now, true);
+            emit("clock: %s, drift %.2f ppm, last offset %ld ms\n", now, rtc->getDriftPpm(),
+                 (long)rtc->getLastOffsetMs());
+            return true;
+        }
+        case 4:
+            emit("heap: %lu bytes free, %lu minimum\n", (unsigned long)ESP.getFreeHeap(),
+                 (unsigned long)ESP.getMinFreeHeap());
+            return true;
+        case 5: {
+            const RecentHistory* history = system->getHistory();
+            emit("history: %u of %u sample(s), %u bytes, %lu reader retries\n", (unsigned)history->size(),
+                 (unsigned)history->capacity(), (unsigned)history->memoryBytes(), (unsigned long)history->retries());
+            return true;
+        }
+        case 6: {
+            const RetentionManager* retention = system->getRetention();
+            emit("sd: %.1f %% used at last check, %lu file(s) deleted%s\n", retention->getUsedPercent(),
+                 (unsigned long)retention->getDeletedFiles(), retention->isPurging() ? ", purging" : "");
+            return true;
+        }
+        case 7: {
+            const LogCompressor* compressor = system->getCompressor();
+            emit("lz: %lu day file(s) compressed, %llu bytes saved%s\n", (unsigned long)compressor->getCompressedFiles(),
+                 (unsigned long long)compressor->getSavedBytes(), compressor->isBusy() ? ", compressing" : "");
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+/// <summary>
+/// tail [n]: samples from the staging ring, one value per step.
+/// </summary>
+bool SerialConsole::startTail(const char* args) {
+    unsigned long n = 10;
+    if (*args) {
+        char* end;
+        n = strtoul(args, &end, 10);
+        if (*end != '\0' || n == 0) return false;
+    }
+    const StagingRing* staging = system->getStaging();
+    last = staging->newestSeq();
+    if (last == 0) {
+        emit("No samples yet.\n");
+        return false;
+    }
+    if (n > staging->capacity()) n = staging->capacity();
+    index = last >= n ? last - static_cast<uint32_t>(n) + 1 : 1;
+    return true;
+}
+
+bool SerialConsole::stepTail() {
+    if (index > last) return false;
+
+    // Look the sample up again on every step, a new cycle may reuse its slot meanwhile
+    StagingRing::Sample sample;
+    if (!system->getStaging()->peekSeq(index, sample)) {
+        emit(field < 0 ? "#%lu no longer staged\n" : "\n#%lu no longer staged\n", (unsigned long)index);
+        ++index;
+        field = -1;
+        return true;
+    }
+
+    const std::vector<RegisterConfig>& regs = system->getConfig()->getChannels();
+    size_t count = system->getStaging()->valueCount();
+    if (count > regs.size()) count = regs.size();
+
+    if (field < 0) {
+        TimestampFormatter formatter;
+        char time[TimestampFormatter::kMaxLength];
+        formatter.format(sample.timestampMs, time, true);
+        emit("#%lu %s", (unsigned long)sample.seq, time);
+    } else if (static_cast<size_t>(field) < count) {
+        emit(" %s=%g", regs[field].key.c_str(), sample.values[field]);
+    } else {
+        emit("\n");
+        ++index;
+        field = -1;
+        return true;
+    }
+    ++field;
+    return true;
+}
+
+/// <summary>
+/// regs: one channel (register or derived) per step, with the value of the newest sample.
+/// </summary>
+bool SerialConsole::startRegs(const char*) {
+    return true;
+}
+
+bool SerialConsole::stepRegs() {
+    const std::vector<RegisterConfig>& regs = system->getConfig()->getChannels();
+    if (index >= regs.size()) return false;
+
+    const RegisterConfig& r = regs[index];
+    char where[24];
+    if (r.derived) {
+        snprintf(where, sizeof(where), "%-14s", "derived");
+    } else {
+        snprintf(where, sizeof(where), "@%-5u %-7s", r.register_address, RegisterMap::typeName(r.dataType));
+    }
+    StagingRing::Sample sample;
+    const StagingRing* staging = system->getStaging();
+    if (index < staging->valueCount() && staging->peekSeq(staging->newestSeq(), sample)) {
+        emit("  %-24s %s %g %s\n", r.key.c_str(), where, sample.values[index], r.unit.c_str());
+    } else {
+        emit("  %-24s %s - %s\n", r.key.c_str(), where, r.unit.c_str());
+    }
+    ++index;
+    return true;
+}
+
+/// <summary>
+/// recent key [minutes]: latest value, then min/max over the window (default:
+/// all the history holds), then the last few values, one line per step.
+/// </summary>
+bool SerialConsole::startRecent(const char* args) {
+    const RecentHistory* history = system->getHistory();
+    if (history->capacity() == 0) {
+        emit("Recent history is disabled.\n");
+        return false;
+    }
+
+    char key[kLineSize];
+    unsigned long minutes = 0;
+    int fields = sscanf(args, "%s %lu", key, &minutes);
+    if (fields < 1) return false;
+
+    const std::vector<RegisterConfig>& channels = system->getConfig()->getChannels();
+    for (index = 0; index < channels.size() && channels[index].key != key; ++index) {
+    }
+    if (index >= channels.size() || index >= history->valueCount()) {
+        emit("Unknown channel '%s'.\n", key);
+        return false;
+    }
+    last = fields == 2 ? static_cast<uint32_t>(minutes) : 0;
+    return true;
+}
+
+bool SerialConsole::stepRecent() {
+    const RecentHistory* history = system->getHistory();
+    const RegisterConfig& channel = system->getConfig()->getChannels()[index];
+    uint16_t c = static_cast<uint16_t>(index);
+    TimestampFormatter formatter;
+    char time[TimestampFormatter::kMaxLength];
+
+    switch (phase++) {
+        case 0: {
+            RecentHistory::Point point;
+            if (!history->latest(c, point)) {
+                emit("No samples yet.\n");
+                return false;
+            }
+            formatter.format(point.timestampMs, time, true);
+            emit("%s: %g %s at %s (%u sample(s) in RAM)\n", channel.key.c_str(), point.value, channel.unit.c_str(), time,
+                 (unsigned)history->size());
+            return true;
+        }
+        case 1: {
+            RecentHistory::Extent extent;
+            RecentHistory::Point newest;
+            int64_t fromMs = INT64_MIN;
+            if (last > 0 && history->latest(c, newest)) fromMs = newest.timestampMs - static_cast<int64_t>(last) * 60000;
+            if (history->extent(c, fromMs, INT64_MAX, extent)) {
+                formatter.format(extent.firstMs, time, true);
+                emit("  min %g, max %g over %lu sample(s) since %s\n", extent.min, extent.max,
+                     (unsigned long)extent.samples, time);
+            }
+            return true;
+        }
+        case 2: {
+            RecentHistory::Point points[kRecentPoints];
+            size_t n = history->lastN(c, kRecentPoints, points);
+            char text[kRecentPoints * 16] = "";
+            size_t used = 0;
+            for (size_t i = 0; i < n; ++i) {
+                used += snprintf(text + used, sizeof(text) - used, " %g", points[i].value);
+            }
+            emit("  last:%s\n", text);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+/// <summary>
+/// alarms: one rule per step with its state.
+/// </summary>
+bool SerialConsole::startAlarms(const char*) {
+    if (system->getConfig()->getAlarms().ruleCount() == 0) {
+        emit("No alarm rules configured.\n");
+        return false;
+    }
+    return true;
+}
+
+bool SerialConsole::stepAlarms() {
+    const AlarmEngine& alarms = system->getConfig()->getAlarms();
+    if (index >= alarms.ruleCount()) return false;
+
+    AlarmEngine::Status status = alarms.status(index);
+    const char* state = status != AlarmEngine::Status::Ok ? AlarmEngine::statusName(status)
+                        : alarms.isActive(index) ? "RAISED" : "ok";
+    emit("  %-40s %s\n", alarms.name(index).c_str(), state);
+    ++index;
+    return true;
+}
+
+/// <summary>
+/// read addr [count]: one bus request, then one word per step.
+/// </summary>
+bool SerialConsole::startRead(const char* args) {
+    char* end;
+    unsigned long address = strtoul(args, &end, 0);
+    if (end == args || address > 0xFFFF) return false;
+
+    unsigned long count = 1;
+    while (*end == ' ') ++end;
+    if (*end) {
+        const char* countText = end;
+        count = strtoul(countText, &end, 0);
+        if (end == countText || *end != '\0') return false;
+    }
+    if (count == 0 || count > kMaxReadWords || address + count > 0x10000) return false;
+
+    readAddress = static_cast<uint16_t>(address);
+    readCount = static_cast<uint16_t>(count);
+    return true;
+}
+
+bool SerialConsole::stepRead() {
+    if (phase == 0) {
+        // A single transaction, as long as one register read of a poll cycle
+        uint8_t result = system->getModbus()->readRaw(readAddress, readCount, readWords);
+        if (result != RtuMaster::kSuccess) {
+            emit("Read of %u register(s) @%u failed: code 0x%02X\n", readCount, readAddress, result);
+            return false;
+        }
+        phase = 1;
+        index = 0;
+        return true;
+    }
+    if (index >= readCount) return false;
+
+    uint16_t w = readWords[index];
+    emit("  %u = %u (0x%04X, %d)\n", (unsigned)(readAddress + index), w, w, (int)static_cast<int16_t>(w));
+    ++index;
+    return true;
+}
+
+/// <summary>
+/// setrtc [time]: applies the argument, or waits for the next line without blocking.
+/// </summary>
+bool SerialConsole::startSetRtc(const char* args) {
+    if (*args) {
+        strcpy(argument, args);
+        argumentReady = true;
+        phase = 1;
+    }
+    return true;
+}
+
+bool SerialConsole::stepSetRtc() {
+    if (phase == 0) {
+        emit("Enter time as YYYY-MM-DD HH:MM:SS (empty line = ESP system time, %lu s timeout):\n",
+             kPromptTimeoutMs / 1000);
+        phase = 1;
+        return true;
+    }
+    if (!argumentReady) {
+        if (millis() - startedMs < kPromptTimeoutMs) return true;
+        emit("setrtc timed out, RTC unchanged.\n");
+        return false;
+    }
+
+    RtcManager* rtc = system->getRtc();
+    if (argument[0] == '\0') {
+        rtc->setTimeFromSystem();
+    } else {
+        rtc->setTimeFromString(argument);
+    }
+    return false;
+}
+
+/// <summary>
+/// reload: waits for a burst event to finish, flushes, then starts the reload
+/// and waits while serviceIdle() runs its phases (parse, each bus, discovery,
+/// capture). Ctrl-C only stops the waiting; the reload itself always completes.
+/// </summary>
+bool SerialConsole::startReload(const char*) {
+    return true;
+}
+
+bool SerialConsole::stepReload() {
+    switch (phase) {
+        case 0:
+            if (system->isCapturingBurst()) {
+                if (index++ == 0) emit("Waiting for the burst event to be written...\n");
+                return true;
+            }
+            phase = 1;
+            return true;
+        case 1:
+            if (!system->flushStaged()) {
+                if (system->getStorage()->isLoggingEnabled()) {
+                    emit("Reload aborted: staged samples could not be written to the SD card.\n");
+                    return false;
+                }
+                // Nothing can be written; the samples survive the reload if the channels stay the same
+                emit("Logging is disabled, %u staged sample(s) kept if the channels do not change.\n",
+                     (unsigned)system->getStaging()->pending());
+            }
+            system->beginReload();
+            phase = 2;
+            return true;
+        default:
+            if (system->isReloading()) return true;
+            emit("Configuration reloaded: %u register(s), %u derived channel(s), interval %lu ms.\n",
+                 (unsigned)system->getConfig()->getRegisters().size(),
+                 (unsigned)system->getConfig()->getDerivedProgram().channelCount(), system->getPollingInterval());
+            return false;
+    }
+}
+
+/// <summary>
+/// trace [save|clear]: one dump line per step, to the port or collected into
+/// chunks for the SD card. Events keep being recorded meanwhile.
+/// </summary>
+bool SerialConsole::startTrace(const char* args) {
+#if !TRACE_EVENTS
+    emit("Tracing is not compiled in, build with -DTRACE_EVENTS=1.\n");
+    return false;
+#endif
+    if (strcasecmp(args, "clear") == 0) {
+        Trace::clear();
+        emit("Trace cleared.\n");
+        return false;
+    }
+    bool save = strcasecmp(args, "save") == 0;
+    if (*args && !save) return false;
+
+    traceDump.begin();
+    traceLength = 0;
+    phase = save ? 1 : 0;
+    if (save) SD.remove(kTracePath);
+    return true;
+}
+
+bool SerialConsole::stepTrace() {
+    char text[TraceFormat::kMaxLine];
+    size_t length = traceDump.next(text, sizeof(text));
+
+    if (phase == 0 && length > 0) {
+        emit("%s", text);
+        return true;
+    }
+    if (phase == 1) {
+        if (length > 0 && traceLength + length <= sizeof(traceChunk)) {
+            memcpy(traceChunk + traceLength, text, length);
+            traceLength += length;
+            return true;
+        }
+        if (traceLength > 0 && !system->getStorage()->appendBytes(kTracePath, traceChunk, traceLength)) {
+            emit("Writing %s failed.\n", kTracePath);
+            return false;
+        }
+        memcpy(traceChunk, text, length);
+        traceLength = length;
+        if (length > 0) return true;
+        phase = 2;
+        emit("Trace saved to %s.\n", kTracePath);
+        return true;
+    }
+
+    if (traceDump.getLost() > 0) {
+        emit("%lu event(s) were overwritten before the dump reached them.\n", (unsigned long)traceDump.getLost());
+    }
+    return false;
+}
@@ -0,0 +1,131 @@
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+#include <Arduino.h>
+#include "Trace.h"
+
+class SystemManager;
+
+/// <summary>
+/// Non-blocking command console on the USB serial port.
+///
+/// Input is collected into a fixed line buffer with basic line editing
+/// (backspace, Ctrl-U clears the line, Ctrl-C cancels the running command,
+/// ANSI escape sequences such as arrow keys are ignored). A complete line is
+/// looked up in the command table; the command then runs as a small state
+/// machine that produces at most one output fragment per poll(), and output
+/// is only written as far as the serial TX buffer has room, so acquisition
+/// never waits on the console.
+///
+/// Commands: help, stats, tail [n], regs, recent key [minutes], alarms, read addr [count], setrtc [time], reload,
+/// trace [save|clear].
+/// </summary>
+class SerialConsole {
+public:
+    static const size_t kLineSize = 96;                  ///< Longest command line including terminator
+    static const size_t kOutputSize = 160;               ///< Longest output fragment
+    static const size_t kInputPerPoll = 64;              ///< Input bytes processed per poll()
+    static const unsigned long kPromptTimeoutMs = 30000; ///< setrtc waits this long for the time
+    static const uint16_t kMaxReadWords = 16;            ///< Largest read command
+    static const size_t kRecentPoints = 8;               ///< Values listed by recent
+    static const size_t kTraceChunk = 512;               ///< trace save writes this much per SD append
+    static constexpr const char* kTracePath = "/trace.txt";
+
+    /// <summary>
+    /// Binds the console to a serial port and the system it controls.
+    /// </summary>
+    void begin(Stream* port, SystemManager* system);
+
+    /// <summary>
+    /// Processes pending input and advances the running command by one step.
+    /// Call on every loop() iteration.
+    /// </summary>
+    void poll();
+
+private:
+    /// <summary>
+    /// Entry of the command table.
+    /// </summary>
+    struct Command {
+        const char* name;
+        const char* usage;
+        const char* help;
+        bool (SerialConsole::*start)(const char* args);   ///< Parses arguments, false on a usage error
+        bool (SerialConsole::*step)();                    ///< Advances the command, false once it is done
+    };
+
+    static const Command kCommands[];
+    static const size_t kCommandCount;
+
+    void readInput();
+    void submitLine();
+    void finish();
+
+    /// <summary>
+    /// Formats an output fragment. Only valid while the output buffer is empty,
+    /// i.e. once per step.
+    /// </summary>
+    void emit(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    /// <summary>
+    /// Writes as much of the pending fragment as the TX buffer accepts.
+    /// </summary>
+    /// <returns>True if nothing is left pending</returns>
+    bool flushOutput();
+
+    /// <summary>
+    /// Echoes input back if the TX buffer has room (echo is dropped otherwise).
+    /// </summary>
+    void echo(const char* text);
+
+    bool startHelp(const char* args);
+    bool stepHelp();
+    bool startStats(const char* args);
+    bool stepStats();
+    bool startTail(const char* args);
+    bool stepTail();
+    bool startRegs(const char* args);
+    bool stepRegs();
+    bool startRecent(const char* args);
+    bool stepRecent();
+    bool startAlarms(const char* args);
+    bool stepAlarms();
+    bool startRead(const char* args);
+    bool stepRead();
+    bool startSetRtc(const char* args);
+    bool stepSetRtc();
+    bool startReload(const char* args);
+    bool stepReload();
+    bool startTrace(const char* args);
+    bool stepTrace();
+
+    Stream* port = nullptr;
+    SystemManager* system = nullptr;
+
+    char line[kLineSize];                ///< Line being edited
+    size_t lineLength = 0;
+    bool lineOverflow = false;           ///< Input exceeded the buffer, line is rejected
+    bool lastWasCr = false;              ///< Swallow the LF of a CR LF pair
+    uint8_t escape = 0;                  ///< 1 = after ESC, 2 = inside a CSI sequence
+
+    char output[kOutputSize];            ///< Pending output fragment
+    size_t outputLength = 0;
+    size_t outputSent = 0;
+
+    const Command* active = nullptr;     ///< Running command
+    uint8_t phase = 0;                   ///< Command-specific state
+    uint32_t index = 0;                  ///< Command-specific position
+    uint32_t last = 0;                   ///< Command-specific end position
+    int32_t field = -1;                  ///< Register within the current tail sample (-1 = timestamp)
+    unsigned long startedMs = 0;         ///< Start of the command (setrtc timeout)
+    char argument[kLineSize];            ///< Argument line kept for the command
+    bool argumentReady = false;          ///< setrtc received its time line
+    uint16_t readAddress = 0;
+    uint16_t readCount = 0;
+    uint16_t readWords[kMaxReadWords];
+    Trace::Dump traceDump;
+    uint8_t traceChunk[kTraceChunk];     ///< Dump lines not yet written by trace save
+    size_t traceLength = 0;
+};
+
+#endif // SERIAL_CONSOLE_H
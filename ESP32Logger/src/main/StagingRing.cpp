@@ -0,0 +1,229 @@
+#include "StagingRing.h"
+#include "LogFrame.h"
+#include <string.h>
+
+static const uint32_t STAGING_MAGIC = 0x52545352;   // "RSTR"
+static const uint16_t STAGING_VERSION = 2;   // v2: epoch-ms timestamps
+
+/// <summary>
+/// Persistent header at the start of the region.
+/// Only persistedSeq changes after initialization; it is a single aligned
+/// 32-bit store, so a reset can never leave it half written.
+/// </summary>
+struct StagingRing::Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t valueCount;
+    uint32_t schemaHash;
+    uint32_t slotCount;
+    uint32_t layoutCrc;               ///< CRC over the fields above
+    volatile uint32_t persistedSeq;   ///< Highest sequence number written to storage
+};
+
+/// <summary>
+/// Fixed part of a slot, followed by valueCount floats.
+/// </summary>
+struct StagingRing::Slot {
+    uint32_t seq;               ///< 0 = never written
+    uint32_t crc;               ///< CRC over seq, timestamp and values
+    int64_t timestampMs;        ///< Epoch milliseconds
+};
+
+// Slots start and repeat on 8-byte boundaries (int64 timestamp)
+static size_t align8(size_t n) {
+    return (n + 7) & ~static_cast<size_t>(7);
+}
+
+static uint32_t layoutCrcOf(uint32_t magic, uint16_t version, uint16_t valueCount,
+                            uint32_t schemaHash, uint32_t slotCount) {
+    uint32_t crc = LogFrame::crc32(&magic, sizeof(magic));
+    crc = LogFrame::crc32(&version, sizeof(version), crc);
+    crc = LogFrame::crc32(&valueCount, sizeof(valueCount), crc);
+    crc = LogFrame::crc32(&schemaHash, sizeof(schemaHash), crc);
+    return LogFrame::crc32(&slotCount, sizeof(slotCount), crc);
+}
+
+/// <summary>
+/// Returns the value array that follows the fixed part of a slot.
+/// </summary>
+float* StagingRing::slotValues(const Slot* slot) {
+    return reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(const_cast<Slot*>(slot)) + sizeof(Slot));
+}
+
+/// <summary>
+/// Validates an existing ring or initializes a new one in the given region.
+/// </summary>
+StagingRing::AttachResult StagingRing::attach(void* region, size_t bytes, uint16_t count, uint32_t schemaHash) {
+    header = static_cast<Header*>(region);
+    slots = static_cast<uint8_t*>(region) + align8(sizeof(Header));
+    slotStride = align8(sizeof(Slot) + count * sizeof(float));
+    slotCount = bytes > align8(sizeof(Header)) ? (bytes - align8(sizeof(Header))) / slotStride : 0;
+    nextSeq = 1;
+    droppedCount = 0;
+
+    uint32_t expectedLayout = layoutCrcOf(STAGING_MAGIC, STAGING_VERSION, count, schemaHash, slotCount);
+    bool headerValid = header->magic == STAGING_MAGIC && header->version == STAGING_VERSION &&
+                       header->layoutCrc == layoutCrcOf(header->magic, header->version, header->valueCount,
+                                                        header->schemaHash, header->slotCount);
+
+    if (headerValid && header->layoutCrc == expectedLayout) {
+        // Resume after the newest intact slot (or after the persisted mark)
+        uint32_t maxSeq = header->persistedSeq;
+        for (size_t i = 0; i < slotCount; ++i) {
+            const Slot* s = reinterpret_cast<const Slot*>(slots + i * slotStride);
+            if (s->seq > maxSeq && s->crc == slotCrc(s, count)) maxSeq = s->seq;
+        }
+        nextSeq = maxSeq + 1;
+        return AttachResult::Restored;
+    }
+
+    header->magic = STAGING_MAGIC;
+    header->version = STAGING_VERSION;
+    header->valueCount = count;
+    header->schemaHash = schemaHash;
+    header->slotCount = static_cast<uint32_t>(slotCount);
+    header->layoutCrc = expectedLayout;
+    header->persistedSeq = 0;
+    memset(slots, 0, slotCount * slotStride);
+
+    return headerValid ? AttachResult::LayoutChanged : AttachResult::Fresh;
+}
+
+/// <summary>
+/// Returns the number of values per sample.
+/// </summary>
+uint16_t StagingRing::valueCount() const {
+    return header ? header->valueCount : 0;
+}
+
+/// <summary>
+/// Maps a sequence number onto its slot.
+/// </summary>
+StagingRing::Slot* StagingRing::slotAt(uint32_t seq) const {
+    return reinterpret_cast<Slot*>(slots + (seq % slotCount) * slotStride);
+}
+
+/// <summary>
+/// Computes the checksum of a slot (everything except the crc field itself).
+/// </summary>
+uint32_t StagingRing::slotCrc(const Slot* slot, uint16_t count) {
+    uint32_t crc = LogFrame::crc32(&slot->seq, sizeof(slot->seq));
+    crc = LogFrame::crc32(&slot->timestampMs, sizeof(slot->timestampMs), crc);
+    return LogFrame::crc32(slotValues(slot), count * sizeof(float), crc);
+}
+
+/// <summary>
+/// Oldest sequence number that is both unpersisted and still held in the ring.
+/// </summary>
+uint32_t StagingRing::oldestPendingSeq() const {
+    uint32_t oldest = header->persistedSeq + 1;
+    if (nextSeq - oldest > slotCount) oldest = nextSeq - static_cast<uint32_t>(slotCount);
+    return oldest;
+}
+
+/// <summary>
+/// Writes a sample into the next slot.
+/// </summary>
+uint32_t StagingRing::push(int64_t timestampMs, const float* values) {
+    if (!header || slotCount == 0) return 0;
+
+    uint32_t seq = nextSeq++;
+    if (seq - header->persistedSeq > slotCount) droppedCount++;
+
+    Slot* s = slotAt(seq);
+    s->seq = seq;
+    s->timestampMs = timestampMs;
+    memcpy(slotValues(s), values, header->valueCount * sizeof(float));
+    s->crc = slotCrc(s, header->valueCount);
+    return seq;
+}
+
+/// <summary>
+/// Returns the number of unpersisted samples still available.
+/// </summary>
+size_t StagingRing::pending() const {
+    if (!header || slotCount == 0) return 0;
+    return nextSeq - oldestPendingSeq();
+}
+
+/// <summary>
+/// Returns a view of the i-th pending sample after verifying its checksum.
+/// </summary>
+bool StagingRing::peek(size_t i, Sample& out) const {
+    if (i >= pending()) return false;
+
+    uint32_t seq = oldestPendingSeq() + static_cast<uint32_t>(i);
+    const Slot* s = slotAt(seq);
+    if (s->seq != seq || s->crc != slotCrc(s, header->valueCount)) return false;
+
+    out.seq = seq;
+    out.timestampMs = s->timestampMs;
+    out.values = slotValues(s);
+    return true;
+}
+
+/// <summary>
+/// Looks up a sample by sequence number; the slot must still hold it.
+/// </summary>
+bool StagingRing::peekSeq(uint32_t seq, Sample& out) const {
+    if (!header || slotCount == 0 || seq == 0 || seq >= nextSeq || nextSeq - seq > slotCount) return false;
+
+    const Slot* s = slotAt(seq);
+    if (s->seq != seq || s->crc != slotCrc(s, header->valueCount)) return false;
+
+    out.seq = seq;
+    out.timestampMs = s->timestampMs;
+    out.values = slotValues(s);
+    return true;
+}
+
+/// <summary>
+/// Walks by sequence number, not by pending index: marking samples persisted
+/// in the middle of the batch moves the oldest pending sample.
+/// </summary>
+bool StagingRing::drain(Sink& sink, DrainStats& stats) {
+    stats = DrainStats();
+    size_t count = pending();
+    uint32_t firstSeq = nextSeq - static_cast<uint32_t>(count);
+    uint32_t handedSeq = 0;     // Newest sample buffered, skipped or found corrupt
+    size_t buffered = 0;        // Buffered samples not yet known to be on the card
+    uint32_t writes = sink.writeCount();
+
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t seq = firstSeq + static_cast<uint32_t>(i);
+        Sample sample;
+        if (!peekSeq(seq, sample)) {
+            ++stats.corrupt;
+            handedSeq = seq;
+            continue;
+        }
+
+        Sink::Result result = sink.write(sample);
+        if (sink.writeCount() != writes) {
+            writes = sink.writeCount();
+            stats.written += buffered;
+            buffered = 0;
+            if (handedSeq != 0) markPersisted(handedSeq);
+        }
+        if (result == Sink::Result::Failed) return false;
+        if (result == Sink::Result::Skipped) {
+            ++stats.skipped;
+        } else {
+            ++buffered;
+        }
+        handedSeq = seq;
+    }
+
+    if (!sink.flush()) return false;
+    stats.written += buffered;
+    if (handedSeq != 0) markPersisted(handedSeq);
+    return true;
+}
+
+/// <summary>
+/// Advances the persisted mark; samples up to seq may now be overwritten.
+/// </summary>
+void StagingRing::markPersisted(uint32_t seq) {
+    if (!header || seq <= header->persistedSeq || seq >= nextSeq) return;
+    header->persistedSeq = seq;
+}
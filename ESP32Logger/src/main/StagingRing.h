@@ -0,0 +1,167 @@
+#ifndef STAGING_RING_H
+#define STAGING_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+/// Write-back staging ring for samples that are not yet persisted to the SD card.
+/// Operates on a caller-provided memory region (RTC slow memory or no-init PSRAM on
+/// the ESP32) that survives watchdog and brownout resets. Every slot carries its
+/// sequence number and a CRC32, so a slot torn by a reset is simply ignored.
+///
+/// The class has no Arduino dependencies. A reset can be simulated on the host by
+/// attaching a fresh instance to the same memory region.
+/// </summary>
+class StagingRing {
+public:
+    /// <summary>
+    /// Outcome of attaching to a memory region.
+    /// </summary>
+    enum class AttachResult {
+        Restored,       ///< Region held a ring with the same layout, pending samples kept
+        Fresh,          ///< Region was empty or corrupt and has been initialized
+        LayoutChanged   ///< Region held a ring for a different register set, samples discarded
+    };
+
+    /// <summary>
+    /// Read-only view of one staged sample.
+    /// </summary>
+    struct Sample {
+        uint32_t seq;               ///< Sequence number (strictly increasing, never 0)
+        int64_t timestampMs;        ///< Epoch milliseconds
+        const float* values;        ///< valueCount() values in register order
+    };
+
+    /// <summary>
+    /// Storage the pending samples are drained into (see drain()).
+    /// </summary>
+    class Sink {
+    public:
+        /// <summary>
+        /// Outcome of handing over one sample.
+        /// </summary>
+        enum class Result {
+            Buffered,   ///< Accepted; on the card after the next successful write
+            Skipped,    ///< Can never be written (e.g. does not serialize), dropped
+            Failed      ///< Storage error, the sample is kept for the next attempt
+        };
+
+        virtual ~Sink() = default;
+
+        /// <summary>
+        /// Buffers one sample. May first write out what is buffered (new day
+        /// file, full buffer), which writeCount() then reflects.
+        /// </summary>
+        virtual Result write(const Sample& sample) = 0;
+
+        /// <summary>
+        /// Writes everything buffered to the card.
+        /// </summary>
+        /// <returns>True if it reached the card completely</returns>
+        virtual bool flush() = 0;
+
+        /// <summary>
+        /// Number of successful writes of buffered samples so far; a change
+        /// means every sample buffered before is on the card.
+        /// </summary>
+        virtual uint32_t writeCount() const = 0;
+    };
+
+    /// <summary>
+    /// Counters of one drain().
+    /// </summary>
+    struct DrainStats {
+        size_t written = 0;         ///< Samples persisted
+        size_t skipped = 0;         ///< Samples the sink could never write
+        size_t corrupt = 0;         ///< Slots that failed their checksum
+    };
+
+    /// <summary>
+    /// Binds the ring to a memory region and validates its contents.
+    /// </summary>
+    /// <param name="region">8-byte aligned, persistent memory</param>
+    /// <param name="bytes">Size of the region in bytes</param>
+    /// <param name="valueCount">Number of float values per sample</param>
+    /// <param name="schemaHash">Hash of the register list the values belong to</param>
+    AttachResult attach(void* region, size_t bytes, uint16_t valueCount, uint32_t schemaHash);
+
+    /// <summary>
+    /// Stores one sample. If the ring is full, the oldest unpersisted sample is
+    /// overwritten and counted in dropped().
+    /// </summary>
+    /// <returns>Sequence number assigned to the sample (0 if not attached)</returns>
+    uint32_t push(int64_t timestampMs, const float* values);
+
+    /// <summary>
+    /// Number of samples waiting to be persisted.
+    /// </summary>
+    size_t pending() const;
+
+    /// <summary>
+    /// Returns the i-th pending sample (0 = oldest).
+    /// </summary>
+    /// <returns>False if the slot is missing or fails its checksum</returns>
+    bool peek(size_t i, Sample& out) const;
+
+    /// <summary>
+    /// Returns the sample with the given sequence number, persisted or not,
+    /// as long as its slot has not been reused.
+    /// </summary>
+    /// <returns>False if the sample was overwritten or fails its checksum</returns>
+    bool peekSeq(uint32_t seq, Sample& out) const;
+
+    /// <summary>
+    /// Sequence number of the most recently pushed sample (0 if none).
+    /// </summary>
+    uint32_t newestSeq() const { return nextSeq - 1; }
+
+    /// <summary>
+    /// Marks every sample up to and including seq as safely written to storage.
+    /// </summary>
+    void markPersisted(uint32_t seq);
+
+    /// <summary>
+    /// Hands every pending sample, oldest first, to the sink and flushes it.
+    /// The persisted mark follows what actually reached the card: when the
+    /// sink writes its buffer out in the middle of the batch, the samples
+    /// buffered so far are marked at once, so a later failure does not make
+    /// the next attempt write them twice. Corrupt slots and samples the sink
+    /// skips are passed over and marked with their neighbours.
+    /// </summary>
+    /// <returns>True if nothing is left pending</returns>
+    bool drain(Sink& sink, DrainStats& stats);
+
+    /// <summary>
+    /// Number of samples the region can hold with the current layout.
+    /// </summary>
+    size_t capacity() const { return slotCount; }
+
+    /// <summary>
+    /// Number of values stored per sample.
+    /// </summary>
+    uint16_t valueCount() const;
+
+    /// <summary>
+    /// Samples overwritten before they could be persisted (since attach).
+    /// </summary>
+    uint32_t dropped() const { return droppedCount; }
+
+private:
+    struct Header;
+    struct Slot;
+
+    Slot* slotAt(uint32_t seq) const;
+    static float* slotValues(const Slot* slot);
+    static uint32_t slotCrc(const Slot* slot, uint16_t valueCount);
+    uint32_t oldestPendingSeq() const;
+
+    Header* header = nullptr;     ///< Start of the persistent region
+    uint8_t* slots = nullptr;     ///< First slot
+    size_t slotStride = 0;        ///< Bytes per slot
+    size_t slotCount = 0;         ///< Slots in the region
+    uint32_t nextSeq = 1;         ///< Sequence number for the next push
+    uint32_t droppedCount = 0;    ///< Overwritten, never persisted samples
+};
+
+#endif // STAGING_RING_H
@@ -1,11 +1,34 @@
 #include "StorageManager.h"
-#include <ArduinoJson.h>
+#include "RecordWriter.h"
+#include "Trace.h"
+#include <unistd.h>
+
+// VFS mount point used by the ESP32 SD library (needed for POSIX calls such as truncate)
+static const char* SD_MOUNT_POINT = "/sd";
+
+/// <summary>
+/// Lets LogFrame::recoverTail() read an open log file.
+/// </summary>
+class FileReader : public LogFrame::Reader {
+public:
+    explicit FileReader(File& file) : file(file) {}
+
+    bool read(uint64_t offset, uint8_t* out, size_t len) override {
+        return file.seek(offset) && file.read(out, len) == len;
+    }
+
+private:
+    File& file;
+};
 
 /// <summary>
 /// Initializes the SD card interface.
 /// Must be called once during system startup before using SD operations.
 /// </summary>
 void StorageManager::begin() {
+    errors.setSink(&StorageManager::errorLineSink, this);
+    errorBuffer.path = errorLogFile;
+
     Serial.println("[StorageManager] Initializing SD card...");
     if (SD.begin()) {
         Serial.println("[StorageManager] SD card initialized successfully.");
@@ -20,6 +43,7 @@ void StorageManager::begin() {
 /// </summary>
 /// <returns>True if SD card is available, false otherwise</returns>
 bool StorageManager::isCardPresent() {
+    TRACE_SCOPE("sd.check", 0);
     bool available = SD.begin();  // Triggers a re-check
     Serial.printf("[StorageManager] SD card presence: %s\n", available ? "yes" : "no");
     return available;
@@ -31,65 +55,256 @@ bool StorageManager::isCardPresent() {
 /// </summary>
 /// <returns>Full path to the generated log file</returns>
 String StorageManager::getTodayLogFilename() {
-    time_t t = time(nullptr);
-    struct tm* tm_info = localtime(&t);
+    return getLogFilename(static_cast<int64_t>(time(nullptr)) * 1000);
+}
+
+/// <summary>
+/// Generates the day file path for a sample time, "folder/YYYY/MM/name" when
+/// sharding is enabled.
+/// </summary>
+/// <param name="timestampMs">Time in epoch milliseconds</param>
+/// <returns>Full path to the log file for that day</returns>
+String StorageManager::formatLogFilename(int64_t timestampMs) const {
+    time_t t = static_cast<time_t>(timestampMs / 1000);
+    struct tm tm_info;
+    localtime_r(&t, &tm_info);
 
     char buffer[64];
-    strftime(buffer, sizeof(buffer), filenameFormat.c_str(), tm_info);
+    strftime(buffer, sizeof(buffer), filenameFormat.c_str(), &tm_info);
+
+    String folder = outputFolder;
+    if (shardFolders) {
+        char shard[16];
+        strftime(shard, sizeof(shard), "%Y/%m/", &tm_info);
+        folder += shard;
+    }
+    return folder + String(buffer);
+}
+
+/// <summary>
+/// Day file path of a sample; strftime and the folder check only run when the day changes.
+/// </summary>
+/// <param name="timestampMs">Sample time in epoch milliseconds</param>
+/// <returns>Full path to the log file for that day</returns>
+String StorageManager::getLogFilename(int64_t timestampMs) {
+    int64_t day = timestampMs / 86400000LL;
+    if (day == filenameDay) return cachedFilename;
 
-    String fullPath = outputFolder + String(buffer);
-    Serial.printf("[StorageManager] Log filename generated: %s\n", fullPath.c_str());
-    return fullPath;
+    cachedFilename = formatLogFilename(timestampMs);
+    ensureFolder(cachedFilename.substring(0, cachedFilename.lastIndexOf('/') + 1));  // Once per day
+    filenameDay = day;
+    Serial.printf("[StorageManager] Log filename generated: %s\n", cachedFilename.c_str());
+    return cachedFilename;
 }
 
 /// <summary>
-/// Writes a single log entry to the SD card in JSON format.
+/// Creates every missing level of a folder path ("/logs/2025/07/").
+/// </summary>
+void StorageManager::ensureFolder(const String& path) {
+    int from = 1;
+    while (from < (int)path.length()) {
+        int slash = path.indexOf('/', from);
+        String level = path.substring(0, slash < 0 ? path.length() : slash);
+        if (level.length() > 0 && !SD.exists(level)) {
+            SD.mkdir(level);
+        }
+        if (slash < 0) break;
+        from = slash + 1;
+    }
+}
+
+/// <summary>
+/// Serializes a single log entry in JSON format and appends it to the write buffer.
 /// Each entry contains a timestamp and an array of key/value/unit objects.
-/// Skips logging if SD is unavailable or configuration mismatch occurs.
+/// Flushes first if the buffer belongs to another file or would overflow.
 /// </summary>
-/// <param name="timestamp">Formatted timestamp string</param>
-/// <param name="values">Vector of float values from Modbus</param>
+/// <param name="timestampMs">Sample time in epoch milliseconds</param>
+/// <param name="values">Float values from Modbus</param>
+/// <param name="count">Number of values</param>
 /// <param name="registers">Vector of RegisterConfig defining keys and units</param>
-void StorageManager::writeJSON(const String& timestamp, const std::vector<float>& values, const std::vector<RegisterConfig>& registers) {
-    if (!loggingEnabled) {
-        Serial.println("[StorageManager][WARN] Logging disabled.");
-        return;
+/// <returns>Buffered, Skipped for records that can never be written, Failed on an SD error,
+/// Disabled while logging is off (not reported here, once per sample would flood the port)</returns>
+StorageManager::WriteResult StorageManager::writeJSON(int64_t timestampMs, const float* values, size_t count,
+                                                      const std::vector<RegisterConfig>& registers) {
+    if (!loggingEnabled) return WriteResult::Disabled;
+
+    if (count != registers.size()) {
+        Serial.printf("[StorageManager][ERROR] Register/value count mismatch: %u vs %u\n",
+                      (unsigned)registers.size(), (unsigned)count);
+        logError(ErrorCode::Generic, "Logging skipped due to register/value size mismatch.");
+        return WriteResult::Skipped;
     }
 
-    if (values.size() != registers.size()) {
-        Serial.printf("[StorageManager][ERROR] Register/value count mismatch: %d vs %d\n", registers.size(), values.size());
-        logError("Logging skipped due to register/value size mismatch.");
-        return;
+    size_t len = serializeRecord(timestampMs, values, count, registers);
+    if (len == 0) return WriteResult::Skipped;
+
+    String filename = getLogFilename(timestampMs);
+    if (filename != dataBuffer.path || dataBuffer.data.size() + len + LogFrame::kOverhead + LogFrame::kSyncSize > dataBuffer.limit) {
+        if (!dataBuffer.data.empty() && !flushLog()) return WriteResult::Failed;
+        dataBuffer.path = filename;
     }
+    if (filename != activeLogFile) {
+        prepareLogFile(filename);
+    }
+
+    appendRecord(reinterpret_cast<const uint8_t*>(recordBuffer), len, timestampMs);
+    return WriteResult::Buffered;
+}
 
-    String filename = getTodayLogFilename();
-    File file = SD.open(filename, FILE_APPEND);
+/// <summary>
+/// Serializes one record into recordBuffer.
+/// The timestamp is formatted only here, at serialization time.
+/// </summary>
+/// <returns>Length of the serialized record, 0 on failure</returns>
+size_t StorageManager::serializeRecord(int64_t timestampMs, const float* values, size_t count,
+                                       const std::vector<RegisterConfig>& registers) {
+    char timestamp[TimestampFormatter::kMaxLength];
+    timestampFormatter.format(timestampMs, timestamp, timestampMillis);
+
+    RecordWriter record(recordBuffer, sizeof(recordBuffer), timestamp);
+    for (size_t i = 0; i < count; ++i) {
+        record.add(registers[i].key.c_str(), values[i], registers[i].unit.c_str());
+    }
+
+    size_t len = record.finish();
+    if (len == 0) {
+        Serial.printf("[StorageManager][ERROR] Record too large (over %u bytes).\n", (unsigned)sizeof(recordBuffer));
+        logError(ErrorCode::Generic, "Logging skipped: serialized record exceeds buffer.");
+        return 0;
+    }
+    return len;
+}
+
+/// <summary>
+/// Writes one record as a plain NDJSON line straight to an open file.
+/// Used for event files that are written once, outside the day-file buffer.
+/// </summary>
+/// <returns>True if the line was written completely</returns>
+bool StorageManager::writeJSONLine(File& file, int64_t timestampMs, const float* values, size_t count,
+                                   const std::vector<RegisterConfig>& registers) {
+    size_t len = serializeRecord(timestampMs, values, count, registers);
+    if (len == 0) return false;
+
+    recordBuffer[len] = '\n';
+    return file.write(reinterpret_cast<const uint8_t*>(recordBuffer), len + 1) == len + 1;
+}
+
+/// <summary>
+/// Writes buffered log records and queued error lines to the card.
+/// </summary>
+/// <returns>True if the log records were written completely</returns>
+bool StorageManager::flush() {
+    bool ok = flushLog();
+    flushBuffer(errorBuffer);  // Best effort, errors stay coalesced in RAM anyway
+    return ok;
+}
+
+/// <summary>
+/// Writes one event line with its own open/write/close, so it is on the card
+/// when this returns, independent of the flush interval.
+/// </summary>
+bool StorageManager::appendLine(const String& path, const char* line) {
+    TRACE_SCOPE("sd.append", strlen(line));
+    File file = SD.open(path, FILE_APPEND);
     if (!file) {
-        Serial.printf("[StorageManager][ERROR] Failed to open log file: %s\n", filename.c_str());
-        logError("Failed to open log file: " + filename);
-        return;
+        Serial.printf("[StorageManager][ERROR] Failed to open %s\n", path.c_str());
+        logError(ErrorCode::FileOpen, "Failed to open event file: " + path);
+        return false;
     }
+    size_t length = strlen(line);
+    bool ok = file.write(reinterpret_cast<const uint8_t*>(line), length) == length && file.write('\n') == 1;
+    file.close();
+    if (!ok) {
+        Serial.printf("[StorageManager][ERROR] Short write to %s\n", path.c_str());
+        logError(ErrorCode::FileWrite, "Short write to event file: " + path);
+    }
+    return ok;
+}
 
-    Serial.printf("[StorageManager] Writing log entry to %s\n", filename.c_str());
+/// <summary>
+/// Writes one block with its own open/write/close. A short write is cut back
+/// to the size the file had before, so the caller can retry the whole block
+/// without leaving a partial copy in front of it.
+/// </summary>
+bool StorageManager::appendBytes(const String& path, const uint8_t* data, size_t length) {
+    TRACE_SCOPE("sd.append", length);
+    File file = SD.open(path, FILE_APPEND);
+    if (!file) {
+        Serial.printf("[StorageManager][ERROR] Failed to open %s\n", path.c_str());
+        logError(ErrorCode::FileOpen, "Failed to open output file: " + path);
+        return false;
+    }
+    uint64_t sizeBefore = file.size();
+    bool ok = file.write(data, length) == length;
+    file.close();
+    if (!ok) {
+        Serial.printf("[StorageManager][ERROR] Short write to %s\n", path.c_str());
+        logError(ErrorCode::FileWrite, "Short write to output file: " + path);
+        if (!truncateFile(path, sizeBefore)) {
+            logError(ErrorCode::Recovery, "Failed to cut back short write: " + path);
+        }
+    }
+    return ok;
+}
 
-    // Create JSON structure
-    DynamicJsonDocument doc(2048);
-    doc["timestamp"] = timestamp;
+/// <summary>
+/// Writes buffered records, then the index entries that point into them.
+/// The index is never written ahead of its data; entries for records that
+/// failed to reach the card are discarded with them.
+/// </summary>
+/// <returns>True if the log records were written completely</returns>
+bool StorageManager::flushLog() {
+    size_t pending = dataBuffer.data.size();
+    bool sameFile = (dataBuffer.path == activeLogFile);
+    if (!flushBuffer(dataBuffer)) {
+        indexBuffer.data.clear();
+        return false;
+    }
+    if (sameFile) activeFileSize += pending;
+    if (pending > 0) ++logWrites;
 
-    JsonArray valArray = doc.createNestedArray("values");
-    for (size_t i = 0; i < values.size(); ++i) {
-        JsonObject entry = valArray.createNestedObject();
-        entry["key"] = registers[i].key;
-        entry["value"] = values[i];
-        entry["unit"] = registers[i].unit;
+    flushBuffer(indexBuffer);  // On failure the index is re-validated before the next append
+    return true;
+}
+
+/// <summary>
+/// Writes one buffer to its file with a single open/write/close.
+/// On failure the buffer is dropped (the caller still holds the samples)
+/// and the log file tail is re-inspected before the next append.
+/// </summary>
+/// <returns>True if the buffer was written completely</returns>
+bool StorageManager::flushBuffer(WriteBuffer& buffer) {
+    if (buffer.data.empty()) return true;
+    TRACE_SCOPE("sd.flush", buffer.data.size());
+
+    bool isErrorLog = (&buffer == &errorBuffer);
+    File file = SD.open(buffer.path, FILE_APPEND);
+    if (!file) {
+        Serial.printf("[StorageManager][ERROR] Failed to open %s\n", buffer.path.c_str());
+        buffer.data.clear();
+        if (!isErrorLog) {
+            activeLogFile = "";
+            logError(ErrorCode::FileOpen, "Failed to open log file: " + buffer.path);
+        }
+        return false;
     }
 
-    // Write to file
-    serializeJson(doc, file);
-    file.println();  // Ensure newline for NDJSON
+    Serial.printf("[StorageManager] Flushing %u byte(s) to %s\n", (unsigned)buffer.data.size(), buffer.path.c_str());
+
+    size_t written = file.write(buffer.data.data(), buffer.data.size());
     file.close();
 
-    Serial.println("[StorageManager] Log entry saved.");
+    bool ok = (written == buffer.data.size());
+    buffer.data.clear();
+
+    if (!ok) {
+        Serial.printf("[StorageManager][ERROR] Short write to %s\n", buffer.path.c_str());
+        if (!isErrorLog) {
+            activeLogFile = "";
+            logError(ErrorCode::FileWrite, "Short write to log file: " + buffer.path);
+        }
+    }
+    return ok;
 }
 
 /// <summary>
@@ -100,33 +315,264 @@ void StorageManager::writeJSON(const String& timestamp, const std::vector<float>
 /// <param name="format">Filename format (strftime-style)</param>
 /// <param name="enable">Enable or disable logging</param>
 /// <param name="withHeader">Whether to include CSV headers (reserved)</param>
-void StorageManager::configure(const String& folder, const String& format, bool enable, bool withHeader) {
+/// <param name="framed">Whether records are wrapped in CRC32 frames</param>
+void StorageManager::configure(const String& folder, const String& format, bool enable, bool withHeader, bool framed) {
+    flush();  // Buffered records belong to the previous configuration
+
     outputFolder = folder;
     filenameFormat = format;
     loggingEnabled = enable;
     includeHeader = withHeader;
+    framedRecords = framed;
+    activeLogFile = "";  // Force tail recovery before the next append
+    filenameDay = INT64_MIN;
 
     Serial.println("[StorageManager] Logging configuration updated:");
     Serial.printf("  - Output folder: %s\n", outputFolder.c_str());
     Serial.printf("  - Filename format: %s\n", filenameFormat.c_str());
     Serial.printf("  - Logging enabled: %s\n", loggingEnabled ? "true" : "false");
     Serial.printf("  - Include header: %s\n", includeHeader ? "true" : "false");
+    Serial.printf("  - Framed records: %s\n", framedRecords ? "true" : "false");
+
+    // Recover today's file right away so a torn tail never survives a reboot
+    if (loggingEnabled) {
+        prepareLogFile(getTodayLogFilename());
+    }
+}
+
+/// <summary>
+/// Recovers the tail of a log file in constant time.
+/// Framed files are cut back to the end of the last frame with a valid CRC,
+/// NDJSON files are cut back to the last complete line.
+/// </summary>
+/// <param name="path">Log file about to be appended to</param>
+void StorageManager::prepareLogFile(const String& path) {
+    TRACE_SCOPE("sd.prepare", 0);
+    activeLogFile = path;
+    activeFileSize = 0;
+    bytesSinceSync = 0;
+
+    recoverTail(path);
+    prepareIndex(path);
+}
+
+/// <summary>
+/// Cuts a torn record off the end of a log file and sets activeFileSize.
+/// </summary>
+void StorageManager::recoverTail(const String& path) {
+    File file = SD.open(path, FILE_READ);
+    if (!file) return;  // New file, nothing to recover
+
+    uint64_t size = file.size();
+    activeFileSize = size;
+    uint64_t validEnd = size;
+    std::vector<uint8_t> window;
+
+    if (framedRecords) {
+        FileReader reader(file);
+        LogFrame::RecoveryResult r = LogFrame::recoverTail(size, reader, window);
+        file.close();
+        if (r.readFailed) {
+            Serial.printf("[StorageManager][ERROR] Recovery read failed for %s\n", path.c_str());
+            logError(ErrorCode::Recovery, "Recovery read failed: " + path);
+            return;
+        }
+        if (!r.found) {
+            // Unknown or legacy content: leave it alone, next write starts with a sync marker
+            Serial.printf("[StorageManager][WARN] No frame found in tail of %s, appending new sync point.\n", path.c_str());
+            bytesSinceSync = LogFrame::kSyncInterval;
+            return;
+        }
+        validEnd = r.validEnd;
+        bytesSinceSync = static_cast<uint32_t>(validEnd - r.lastSync);
+    } else {
+        uint64_t windowStart = size > LogFrame::kRecoveryWindow ? size - LogFrame::kRecoveryWindow : 0;
+        size_t windowLen = static_cast<size_t>(size - windowStart);
+        window.resize(windowLen);
+        file.seek(windowStart);
+        size_t got = windowLen ? file.read(window.data(), windowLen) : 0;
+        file.close();
+
+        if (got != windowLen) {
+            Serial.printf("[StorageManager][ERROR] Recovery read failed for %s\n", path.c_str());
+            logError(ErrorCode::Recovery, "Recovery read failed: " + path);
+            return;
+        }
+        if (windowLen > 0 && window[windowLen - 1] != '\n') {
+            size_t i = windowLen;
+            while (i > 0 && window[i - 1] != '\n') --i;
+            if (i == 0 && windowStart > 0) return;  // No line break in window, do not guess
+            validEnd = windowStart + i;
+        }
+    }
+
+    if (validEnd < size) {
+        Serial.printf("[StorageManager][WARN] Torn tail in %s: truncating %llu -> %llu bytes.\n",
+                      path.c_str(), (unsigned long long)size, (unsigned long long)validEnd);
+        if (!truncateFile(path, validEnd)) {
+            logError(ErrorCode::Recovery, "Failed to truncate torn tail: " + path);
+            return;
+        }
+        activeFileSize = validEnd;
+        logError(ErrorCode::Recovery, "Recovered torn log tail: " + path);
+    }
+}
+
+/// <summary>
+/// Opens the time index of a log file for appending.
+/// Entries pointing past the (possibly truncated) data are dropped, an index
+/// written with a different layout is discarded and started over.
+/// </summary>
+void StorageManager::prepareIndex(const String& path) {
+    indexBuffer.path = path + ".idx";
+    indexBuffer.data.clear();
+    indexNeedsHeader = true;
+    indexBuilder.reset(indexIntervalMs);
+    if (indexIntervalMs == 0) return;
+
+    File file = SD.open(indexBuffer.path, FILE_READ);
+    if (!file) return;  // No index yet, created with the first entry
+
+    uint64_t size = file.size();
+    uint8_t head[TimeIndex::kHeaderSize];
+    TimeIndex::Header header;
+    bool valid = size >= sizeof(head) && file.read(head, sizeof(head)) == sizeof(head) &&
+                 TimeIndex::decodeHeader(head, sizeof(head), header) &&
+                 header.intervalMs == indexIntervalMs &&
+                 ((header.flags & TimeIndex::kFlagFramed) != 0) == framedRecords;
+
+    if (!valid) {
+        file.close();
+        Serial.printf("[StorageManager][WARN] Index %s does not match, starting a new one.\n", indexBuffer.path.c_str());
+        truncateFile(indexBuffer.path, 0);
+        return;
+    }
+
+    // Walk back over entries the data file no longer covers (torn tail, failed flush)
+    uint64_t count = (size - TimeIndex::kHeaderSize) / TimeIndex::kEntrySize;
+    uint64_t keep = count;
+    TimeIndex::Entry last = { 0, 0 };
+    while (keep > 0) {
+        uint8_t raw[TimeIndex::kEntrySize];
+        file.seek(TimeIndex::kHeaderSize + (keep - 1) * TimeIndex::kEntrySize);
+        if (file.read(raw, sizeof(raw)) != sizeof(raw)) break;
+        last = TimeIndex::decodeEntry(raw);
+        if (last.offset < activeFileSize) break;
+        keep--;
+    }
+    file.close();
+
+    uint64_t validSize = TimeIndex::kHeaderSize + keep * TimeIndex::kEntrySize;
+    if (validSize < size && !truncateFile(indexBuffer.path, validSize)) {
+        logError(ErrorCode::Recovery, "Failed to trim time index: " + indexBuffer.path);
+    }
+
+    indexNeedsHeader = false;
+    if (keep > 0) indexBuilder.resume(indexIntervalMs, last.timeMs);
 }
 
 /// <summary>
-/// Logs an error message to a persistent error log file on the SD card,
-/// prefixed with a timestamp for later diagnostics.
+/// Appends a record to the write buffer either as a CRC32 frame or as a plain NDJSON line.
+/// In framed mode a sync marker is emitted first whenever the sync interval has elapsed.
 /// </summary>
+void StorageManager::appendRecord(const uint8_t* data, size_t len, int64_t timestampMs) {
+    std::vector<uint8_t>& writeBuffer = dataBuffer.data;
+    if (writeBuffer.capacity() < dataBuffer.limit) writeBuffer.reserve(dataBuffer.limit);
+
+    if (!framedRecords) {
+        indexRecord(timestampMs, activeFileSize + writeBuffer.size());
+        writeBuffer.insert(writeBuffer.end(), data, data + len);
+        writeBuffer.push_back('\n');  // Newline terminates the NDJSON record
+        return;
+    }
+
+    if (bytesSinceSync >= LogFrame::kSyncInterval) {
+        writeBuffer.insert(writeBuffer.end(), LogFrame::kSyncMarker, LogFrame::kSyncMarker + LogFrame::kSyncSize);
+        bytesSinceSync = 0;
+    }
+    indexRecord(timestampMs, activeFileSize + writeBuffer.size());
+
+    uint8_t header[LogFrame::kHeaderSize];
+    uint8_t trailer[LogFrame::kTrailerSize];
+    LogFrame::encodeHeader(static_cast<uint16_t>(len), header);
+    LogFrame::encodeTrailer(header, data, len, trailer);
+
+    writeBuffer.insert(writeBuffer.end(), header, header + sizeof(header));
+    writeBuffer.insert(writeBuffer.end(), data, data + len);
+    writeBuffer.insert(writeBuffer.end(), trailer, trailer + sizeof(trailer));
+    bytesSinceSync += len + LogFrame::kOverhead;
+}
+
+/// <summary>
+/// Queues an index entry if the record starts a new time bucket.
+/// </summary>
+void StorageManager::indexRecord(int64_t timestampMs, uint64_t offset) {
+    TimeIndex::Entry entry;
+    if (indexIntervalMs == 0 || !indexBuilder.offer(timestampMs, offset, entry)) return;
+
+    std::vector<uint8_t>& buf = indexBuffer.data;
+    if (indexNeedsHeader) {
+        uint8_t head[TimeIndex::kHeaderSize];
+        TimeIndex::encodeHeader(indexIntervalMs, framedRecords ? TimeIndex::kFlagFramed : 0, head);
+        buf.insert(buf.end(), head, head + sizeof(head));
+        indexNeedsHeader = false;
+    }
+
+    uint8_t raw[TimeIndex::kEntrySize];
+    TimeIndex::encodeEntry(entry, raw);
+    buf.insert(buf.end(), raw, raw + sizeof(raw));
+}
+
+/// <summary>
+/// Truncates a file through the VFS layer (the Arduino File API has no truncate).
+/// </summary>
+bool StorageManager::truncateFile(const String& path, uint64_t size) {
+    String vfsPath = String(SD_MOUNT_POINT) + path;
+    if (truncate(vfsPath.c_str(), static_cast<off_t>(size)) != 0) {
+        Serial.printf("[StorageManager][ERROR] truncate(%s) failed.\n", vfsPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// Reports an error through the coalescing error log.
+/// Only first occurrences and periodic summaries reach the card or Serial.
+/// </summary>
+/// <param name="code">Error category</param>
 /// <param name="message">Error message to log</param>
-void StorageManager::logError(const String& message) {
-    File errorFile = SD.open(errorLogFile, FILE_APPEND);
-    if (errorFile) {
-        time_t now = time(nullptr);
-        errorFile.print("[");
-        errorFile.print(ctime(&now));  // Includes newline
-        errorFile.print("] ERROR: ");
-        errorFile.println(message);
-        errorFile.close();
-    }
-    Serial.printf("[StorageManager][LOG_ERROR] %s\n", message.c_str());
+void StorageManager::logError(ErrorCode code, const String& message) {
+    errors.report(code, message.c_str(), millis());
+}
+
+/// <summary>
+/// Emits coalesced error summaries whose interval has elapsed.
+/// </summary>
+void StorageManager::pollErrors() {
+    errors.poll(millis());
+}
+
+/// <summary>
+/// Prefixes an error line with the current time and queues it in the error buffer.
+/// The buffer is only written out on flush() or when it fills up.
+/// </summary>
+void StorageManager::errorLineSink(void* context, const char* line) {
+    StorageManager* self = static_cast<StorageManager*>(context);
+
+    time_t now = time(nullptr);
+    char stamp[24];
+    strftime(stamp, sizeof(stamp), "[%Y-%m-%d %H:%M:%S] ", localtime(&now));
+
+    size_t stampLen = strlen(stamp);
+    size_t lineLen = strlen(line);
+    WriteBuffer& buffer = self->errorBuffer;
+    if (buffer.data.size() + stampLen + lineLen + 1 > buffer.limit) {
+        self->flushBuffer(buffer);
+    }
+
+    buffer.data.insert(buffer.data.end(), stamp, stamp + stampLen);
+    buffer.data.insert(buffer.data.end(), line, line + lineLen);
+    buffer.data.push_back('\n');
+
+    Serial.printf("[StorageManager][LOG_ERROR] %s\n", line);
 }
@@ -4,12 +4,18 @@
 #include <SD.h>
 #include <vector>
 #include "RegisterConfig.h"
+#include "LogFrame.h"
+#include "ErrorLog.h"
+#include "TimestampFormatter.h"
+#include "TimeIndex.h"
 
 /// <summary>
 /// Manages SD card logging operations, including:
-/// - Writing log entries in JSON format
-/// - Error logging to persistent file
-/// - File and folder naming based on date
+/// - Writing log entries in JSON format (optionally CRC-framed)
+/// - Recovering torn records after power loss
+/// - Maintaining a sparse time index ("<log file>.idx") next to every log file
+/// - Error logging to persistent file, unbuffered event lines
+/// - File and folder naming based on date (day files sharded into YYYY/MM/ folders)
 /// </summary>
 class StorageManager {
 public:
@@ -27,19 +33,120 @@ public:
     bool isCardPresent();
 
     /// <summary>
-    /// Writes a single log entry in JSON format to the SD card.
+    /// Outcome of writeJSON().
+    /// </summary>
+    enum class WriteResult {
+        Buffered,   ///< In the write buffer
+        Skipped,    ///< Can never be written (count mismatch, record too large), dropped
+        Failed,     ///< Writing out the buffer ahead of the record failed
+        Disabled    ///< Logging is disabled, nothing written; the caller keeps the record
+    };
+
+    /// <summary>
+    /// Serializes a single log entry in JSON format into the write buffer.
     /// Each entry includes a timestamp and an array of measurement objects (key/value/unit).
+    /// The timestamp is formatted only here, and the record goes to the day file
+    /// of the sample time. Data reaches the SD card on the next flush() (or when the buffer fills up).
     /// </summary>
-    /// <param name="timestamp">Timestamp string (e.g., "2025-07-03 12:00:00")</param>
+    /// <param name="timestampMs">Sample time in epoch milliseconds</param>
     /// <param name="values">Float values corresponding to registers</param>
+    /// <param name="count">Number of values</param>
     /// <param name="registers">Register definitions with key and unit</param>
-    void writeJSON(const String& timestamp, const std::vector<float>& values, const std::vector<RegisterConfig>& registers);
+    /// <returns>Whether the record was buffered, skipped for good, or kept out by a write error or disabled logging</returns>
+    WriteResult writeJSON(int64_t timestampMs, const float* values, size_t count, const std::vector<RegisterConfig>& registers);
+
+    /// <summary>
+    /// Writes one record as a plain NDJSON line directly to an open file
+    /// (used for event files, bypasses the day-file buffer).
+    /// </summary>
+    /// <returns>True if the line was written completely</returns>
+    bool writeJSONLine(File& file, int64_t timestampMs, const float* values, size_t count,
+                       const std::vector<RegisterConfig>& registers);
 
     /// <summary>
-    /// Appends an error message with timestamp to a persistent error log file on the SD card.
+    /// Writes all buffered records and error lines to the SD card,
+    /// with a single open/write/close per file.
     /// </summary>
+    /// <returns>True if all buffered log records are now on the card</returns>
+    bool flush();
+
+    /// <summary>
+    /// Reports an error. The first occurrence is written to the error log,
+    /// repeats with the same code and message are counted and summarized
+    /// once per summary interval. Lines go through the buffered writer.
+    /// </summary>
+    /// <param name="code">Error category</param>
     /// <param name="message">Error message to be logged</param>
-    void logError(const String& message);
+    void logError(ErrorCode code, const String& message);
+
+    /// <summary>
+    /// Appends one line to a small event file right away (open, write, close),
+    /// bypassing the record buffers, e.g. for alarm state changes.
+    /// </summary>
+    /// <param name="path">File to append to</param>
+    /// <param name="line">Line without newline</param>
+    /// <returns>True if the line was written</returns>
+    bool appendLine(const String& path, const char* line);
+
+    /// <summary>
+    /// Appends a block of binary data to a file right away (open, write,
+    /// close), bypassing the record buffers, e.g. for the RTU capture.
+    /// After a short write the file is truncated back to its previous size,
+    /// so a failed block can be appended again as a whole.
+    /// </summary>
+    /// <param name="path">File to append to</param>
+    /// <param name="data">Bytes to write</param>
+    /// <param name="length">Number of bytes</param>
+    /// <returns>True if every byte was written</returns>
+    bool appendBytes(const String& path, const uint8_t* data, size_t length);
+
+    /// <summary>
+    /// Emits coalesced error summaries whose interval has elapsed.
+    /// Should be called once per cycle.
+    /// </summary>
+    void pollErrors();
+
+    /// <summary>
+    /// Sets the window (in milliseconds) over which repeated errors are coalesced.
+    /// </summary>
+    void setErrorSummaryInterval(unsigned long ms) { errors.setSummaryInterval(ms); }
+
+    /// <summary>
+    /// Enables millisecond resolution ("HH:MM:SS.mmm") in serialized timestamps.
+    /// </summary>
+    void setTimestampMillis(bool enabled) { timestampMillis = enabled; }
+
+    /// <summary>
+    /// Sets the time index bucket width in milliseconds (0 disables the index).
+    /// Must be called before configure().
+    /// </summary>
+    void setIndexInterval(uint32_t ms) { indexIntervalMs = ms; }
+
+    /// <summary>
+    /// Places day files in "YYYY/MM/" subfolders of the output folder, so no
+    /// directory grows beyond a month of files. Must be called before configure().
+    /// </summary>
+    void setSharding(bool enabled) { shardFolders = enabled; }
+
+    /// <summary>
+    /// Path of the day file records currently go to (empty before the first one).
+    /// Retention never deletes it.
+    /// </summary>
+    const String& getCurrentLogFile() const { return cachedFilename; }
+
+    /// <summary>
+    /// Number of times buffered log records were written to the card completely,
+    /// by flush() or by writeJSON() making room. A change means every record
+    /// buffered before is on the card.
+    /// </summary>
+    uint32_t getLogWrites() const { return logWrites; }
+
+    /// <summary>
+    /// Path of the day file for a time under the current configuration,
+    /// without caching it or creating its folder.
+    /// </summary>
+    /// <param name="timestampMs">Time in epoch milliseconds</param>
+    String formatLogFilename(int64_t timestampMs) const;
 
     /// <summary>
     /// Configures logging behavior, including output folder and filename format.
@@ -48,20 +155,127 @@ public:
     /// <param name="format">Filename format (e.g., "log_%Y%m%d.json") using strftime syntax</param>
     /// <param name="enable">True to enable logging, false to disable</param>
     /// <param name="withHeader">Whether to include CSV headers (not used in JSON)</param>
-    void configure(const String& folder, const String& format, bool enable, bool withHeader);
+    /// <param name="framed">True to wrap each record in a CRC32 frame (see LogFrame.h)</param>
+    void configure(const String& folder, const String& format, bool enable, bool withHeader, bool framed = false);
+
+    /// <summary>
+    /// Returns false if configure() disabled logging (records are not written).
+    /// </summary>
+    bool isLoggingEnabled() const { return loggingEnabled; }
 
 private:
+    /// <summary>
+    /// RAM buffer for one target file, written out in a single SD access.
+    /// </summary>
+    struct WriteBuffer {
+        String path;                    // File the buffered bytes belong to
+        std::vector<uint8_t> data;      // Bytes not yet written to SD
+        size_t limit;                   // Flush threshold in bytes
+    };
+
+    /// <summary>
+    /// Serializes one record (timestamp + key/value/unit array) into recordBuffer.
+    /// </summary>
+    /// <returns>Length in bytes, 0 if the record does not fit</returns>
+    size_t serializeRecord(int64_t timestampMs, const float* values, size_t count,
+                           const std::vector<RegisterConfig>& registers);
+
+    /// <summary>
+    /// Writes the data buffer and then the index entries referring to it.
+    /// </summary>
+    /// <returns>True if the data buffer was written completely</returns>
+    bool flushLog();
+
+    /// <summary>
+    /// Appends a buffer's content to its file and clears it.
+    /// </summary>
+    /// <returns>True if all bytes were written</returns>
+    bool flushBuffer(WriteBuffer& buffer);
+
+    /// <summary>
+    /// ErrorLog sink: timestamps a line and queues it in the error buffer.
+    /// </summary>
+    static void errorLineSink(void* context, const char* line);
+
+    /// <summary>
+    /// Inspects the tail of a log file before the first append to it in this session.
+    /// Truncates a torn last record left behind by a power loss and restores
+    /// the sync marker bookkeeping. Reads at most LogFrame::kRecoveryWindow bytes.
+    /// </summary>
+    /// <param name="path">Log file about to be appended to</param>
+    void prepareLogFile(const String& path);
+
+    /// <summary>
+    /// Truncates a torn last record and determines the valid file size.
+    /// </summary>
+    void recoverTail(const String& path);
+
+    /// <summary>
+    /// Validates the tail of the log file's time index and resumes it.
+    /// </summary>
+    void prepareIndex(const String& path);
+
+    /// <summary>
+    /// Adds an index entry for a record if it opens a new time bucket.
+    /// </summary>
+    /// <param name="timestampMs">Record time</param>
+    /// <param name="offset">Byte offset of the record in the log file</param>
+    void indexRecord(int64_t timestampMs, uint64_t offset);
+
+    /// <summary>
+    /// Appends one serialized record to the write buffer,
+    /// either framed (with periodic sync markers) or as a plain NDJSON line.
+    /// </summary>
+    void appendRecord(const uint8_t* data, size_t len, int64_t timestampMs);
+
+    /// <summary>
+    /// Shrinks a file on the SD card to the given size.
+    /// </summary>
+    bool truncateFile(const String& path, uint64_t size);
+
     /// <summary>
     /// Generates the full path for today's log file using the current date and configured format.
     /// </summary>
     /// <returns>Full SD card file path for today's log</returns>
     String getTodayLogFilename();
 
-    String errorLogFile = "error.log";                 // Error log filename
+    /// <summary>
+    /// Generates the full path of the day file a sample belongs to.
+    /// The result is cached per day, strftime only runs when the day changes.
+    /// </summary>
+    /// <param name="timestampMs">Sample time in epoch milliseconds</param>
+    String getLogFilename(int64_t timestampMs);
+
+    /// <summary>
+    /// Creates a folder and its missing parents (SD.mkdir creates one level).
+    /// </summary>
+    void ensureFolder(const String& path);
+
+    String errorLogFile = "/error.log";                // Error log filename
     String outputFolder = "/";                         // Output directory
     String filenameFormat = "data_%Y%m%d.json";        // Filename format (strftime-compatible)
     bool loggingEnabled = true;                        // Enable/disable logging
     bool includeHeader = true;                         // Reserved for future CSV support
+    bool shardFolders = true;                          // Day files in YYYY/MM/ subfolders
+    bool framedRecords = false;                        // Wrap records in CRC32 frames
+    bool timestampMillis = false;                      // Serialize timestamps with milliseconds
+    uint32_t logWrites = 0;                            // Complete writes of the data buffer
+
+    TimestampFormatter timestampFormatter;             // Incremental epoch-ms → text formatter
+    int64_t filenameDay = INT64_MIN;                   // Day number cachedFilename belongs to
+    String cachedFilename;                             // Day file path for filenameDay
+
+    WriteBuffer dataBuffer = { "", {}, 8192 };         // Encoded records not yet written to SD
+    WriteBuffer errorBuffer = { "", {}, 2048 };        // Error lines not yet written to SD
+    WriteBuffer indexBuffer = { "", {}, 512 };         // Index entries for records in dataBuffer
+    TimeIndex::Builder indexBuilder;                   // Decides which records get an index entry
+    uint32_t indexIntervalMs = TimeIndex::kDefaultIntervalMs;  // Index bucket width (0 = no index)
+    bool indexNeedsHeader = true;                      // Index file is empty or missing
+    ErrorLog errors;                                   // Coalesces repeated errors
+    String activeLogFile;                              // File the recovery state below belongs to
+    uint64_t activeFileSize = 0;                       // Bytes of activeLogFile already on the card
+    uint32_t bytesSinceSync = 0;                       // Framed bytes written since the last sync marker
+    char recordBuffer[LogFrame::kMaxPayload];          // Serialization buffer for a single record
 };
 
 #endif // STORAGE_MANAGER_H
@@ -0,0 +1,143 @@
+#include "StreamProtocol.h"
+#include "LogFrame.h"
+#include <string.h>
+
+namespace StreamProtocol {
+
+static void writeLE(uint8_t* p, uint64_t v, size_t n) {
+    for (size_t i = 0; i < n; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+static uint64_t readLE(const uint8_t* p, size_t n) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+/// <summary>
+/// Header, payload, then CRC32 over everything after the magic byte.
+/// </summary>
+size_t encodeFrame(uint8_t type, uint32_t seq, const uint8_t* payload, size_t length, uint8_t* out) {
+    if (length > kMaxPayload) return 0;
+    out[0] = kMagic;
+    out[1] = type;
+    writeLE(out + 2, length, 2);
+    writeLE(out + 4, seq, 4);
+    memcpy(out + kHeaderSize, payload, length);
+    uint32_t crc = LogFrame::crc32(out + 1, kHeaderSize - 1 + length);
+    writeLE(out + kHeaderSize + length, crc, 4);
+    return length + kOverhead;
+}
+
+size_t encodeSchema(uint32_t schemaHash, const char* const* keys, const char* const* units, uint16_t count,
+                    uint8_t* out, size_t capacity) {
+    if (capacity < 6) return 0;
+    writeLE(out, schemaHash, 4);
+    writeLE(out + 4, count, 2);
+    size_t pos = 6;
+    for (uint16_t i = 0; i < count; ++i) {
+        size_t keyLen = strlen(keys[i]);
+        size_t unitLen = units[i] ? strlen(units[i]) : 0;
+        if (keyLen > 255 || unitLen > 255 || pos + 2 + keyLen + unitLen > capacity) return 0;
+        out[pos++] = static_cast<uint8_t>(keyLen);
+        memcpy(out + pos, keys[i], keyLen);
+        pos += keyLen;
+        out[pos++] = static_cast<uint8_t>(unitLen);
+        if (unitLen) memcpy(out + pos, units[i], unitLen);
+        pos += unitLen;
+    }
+    return pos;
+}
+
+size_t encodeSample(const SampleHeader& header, const float* values, uint8_t* out, size_t capacity) {
+    size_t size = kSampleFixedSize + static_cast<size_t>(header.count) * sizeof(float);
+    if (size > capacity) return 0;
+    writeLE(out, header.schemaHash, 4);
+    writeLE(out + 4, header.dropped, 4);
+    writeLE(out + 8, static_cast<uint64_t>(header.timestampMs), 8);
+    writeLE(out + 16, header.count, 2);
+    for (uint16_t i = 0; i < header.count; ++i) {
+        uint32_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        writeLE(out + kSampleFixedSize + 4 * i, bits, 4);
+    }
+    return size;
+}
+
+/// <summary>
+/// Skips to the next magic byte, waits for the full frame, then checks the CRC.
+/// A bad CRC only skips the magic byte, so a real frame starting inside the
+/// rejected bytes is still found.
+/// </summary>
+DecodeStatus decode(const uint8_t* buf, size_t avail, size_t& consumed, Frame& frame) {
+    consumed = 0;
+    if (avail == 0) return DecodeStatus::NeedMore;
+    if (buf[0] != kMagic) {
+        const void* next = memchr(buf, kMagic, avail);
+        consumed = next ? static_cast<size_t>(static_cast<const uint8_t*>(next) - buf) : avail;
+        return DecodeStatus::Skipped;
+    }
+    if (avail < kHeaderSize) return DecodeStatus::NeedMore;
+
+    uint8_t type = buf[1];
+    size_t length = static_cast<size_t>(readLE(buf + 2, 2));
+    if ((type != kTypeSchema && type != kTypeSample) || length > kMaxPayload) {
+        consumed = 1;
+        return DecodeStatus::Skipped;
+    }
+    if (avail < length + kOverhead) return DecodeStatus::NeedMore;
+
+    uint32_t crc = static_cast<uint32_t>(readLE(buf + kHeaderSize + length, 4));
+    if (LogFrame::crc32(buf + 1, kHeaderSize - 1 + length) != crc) {
+        consumed = 1;
+        return DecodeStatus::Skipped;
+    }
+
+    frame.type = type;
+    frame.seq = static_cast<uint32_t>(readLE(buf + 4, 4));
+    frame.payload = buf + kHeaderSize;
+    frame.length = length;
+    consumed = length + kOverhead;
+    return DecodeStatus::Ok;
+}
+
+bool decodeSample(const uint8_t* payload, size_t length, SampleHeader& header, const uint8_t*& values) {
+    if (length < kSampleFixedSize) return false;
+    header.schemaHash = static_cast<uint32_t>(readLE(payload, 4));
+    header.dropped = static_cast<uint32_t>(readLE(payload + 4, 4));
+    header.timestampMs = static_cast<int64_t>(readLE(payload + 8, 8));
+    header.count = static_cast<uint16_t>(readLE(payload + 16, 2));
+    values = payload + kSampleFixedSize;
+    return length >= kSampleFixedSize + static_cast<size_t>(header.count) * sizeof(float);
+}
+
+float sampleValue(const uint8_t* values, size_t i) {
+    uint32_t bits = static_cast<uint32_t>(readLE(values + 4 * i, 4));
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+bool decodeSchemaHeader(const uint8_t* payload, size_t length, uint32_t& schemaHash, uint16_t& count, size_t& pos) {
+    if (length < 6) return false;
+    schemaHash = static_cast<uint32_t>(readLE(payload, 4));
+    count = static_cast<uint16_t>(readLE(payload + 4, 2));
+    pos = 6;
+    return true;
+}
+
+bool decodeSchemaEntry(const uint8_t* payload, size_t length, size_t& pos, const char*& key, size_t& keyLength,
+                       const char*& unit, size_t& unitLength) {
+    if (pos >= length) return false;
+    keyLength = payload[pos++];
+    if (pos + keyLength >= length) return false;
+    key = reinterpret_cast<const char*>(payload + pos);
+    pos += keyLength;
+    unitLength = payload[pos++];
+    if (pos + unitLength > length) return false;
+    unit = reinterpret_cast<const char*>(payload + pos);
+    pos += unitLength;
+    return true;
+}
+
+} // namespace StreamProtocol
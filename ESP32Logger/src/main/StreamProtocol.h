@@ -0,0 +1,119 @@
+#ifndef STREAM_PROTOCOL_H
+#define STREAM_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+/// Binary live-sample protocol on the USB serial port.
+/// This header has no Arduino dependencies; the logger encodes frames with it
+/// and host-side tools decode them (rtulog-stream).
+///
+/// Frame layout (little endian):
+///   [0xA5] [type] [uint16 payload length] [uint32 sequence] [payload] [uint32 CRC32(type .. payload)]
+///
+/// Types:
+///   'H' schema  [uint32 schema hash] [uint16 count] then per register
+///               [uint8 key length] [key] [uint8 unit length] [unit]
+///   'D' sample  [uint32 schema hash] [uint32 dropped] [int64 time ms] [uint16 count] [float values...]
+///
+/// The sequence number counts frames actually sent, so a gap on the receiver means
+/// bytes lost in transit; samples the logger could not send (port busy) are counted
+/// in the sample frame's "dropped" field instead. The schema frame is repeated
+/// periodically so a receiver can attach at any time. Text printed on the same port
+/// between frames is skipped by the decoder (a frame only counts if its CRC matches).
+/// </summary>
+namespace StreamProtocol {
+
+constexpr uint8_t kMagic = 0xA5;
+constexpr uint8_t kTypeSchema = 'H';
+constexpr uint8_t kTypeSample = 'D';
+constexpr size_t kHeaderSize = 8;                ///< Magic, type, length, sequence
+constexpr size_t kTrailerSize = 4;               ///< CRC32
+constexpr size_t kOverhead = kHeaderSize + kTrailerSize;
+constexpr size_t kMaxPayload = 1024;             ///< Largest accepted payload
+constexpr size_t kSampleFixedSize = 18;          ///< Sample payload without values
+constexpr size_t kMaxValues = (kMaxPayload - kSampleFixedSize) / sizeof(float);
+
+/// <summary>
+/// A decoded frame. The payload points into the caller's buffer.
+/// </summary>
+struct Frame {
+    uint8_t type;
+    uint32_t seq;
+    const uint8_t* payload;
+    size_t length;
+};
+
+/// <summary>
+/// Fixed part of a sample payload.
+/// </summary>
+struct SampleHeader {
+    uint32_t schemaHash;
+    uint32_t dropped;            ///< Samples the sender had to drop so far
+    int64_t timestampMs;
+    uint16_t count;
+};
+
+/// <summary>
+/// Outcome of one decode step.
+/// </summary>
+enum class DecodeStatus {
+    NeedMore,        ///< Not enough bytes for a complete frame yet
+    Skipped,         ///< Byte(s) at the start are not a valid frame (noise, text, corruption)
+    Ok               ///< A frame with a matching CRC was decoded
+};
+
+/// <summary>
+/// Wraps a payload into a frame.
+/// </summary>
+/// <param name="out">Destination of at least length + kOverhead bytes</param>
+/// <returns>Frame size in bytes, 0 if the payload is too large</returns>
+size_t encodeFrame(uint8_t type, uint32_t seq, const uint8_t* payload, size_t length, uint8_t* out);
+
+/// <summary>
+/// Builds a schema payload from parallel key and unit lists.
+/// </summary>
+/// <returns>Payload size, 0 if it does not fit into capacity</returns>
+size_t encodeSchema(uint32_t schemaHash, const char* const* keys, const char* const* units, uint16_t count,
+                    uint8_t* out, size_t capacity);
+
+/// <summary>
+/// Builds a sample payload.
+/// </summary>
+/// <returns>Payload size, 0 if it does not fit into capacity</returns>
+size_t encodeSample(const SampleHeader& header, const float* values, uint8_t* out, size_t capacity);
+
+/// <summary>
+/// Looks for a frame at the start of buf.
+/// </summary>
+/// <param name="consumed">Bytes to drop from the buffer (frame size, or garbage to skip)</param>
+DecodeStatus decode(const uint8_t* buf, size_t avail, size_t& consumed, Frame& frame);
+
+/// <summary>
+/// Reads the fixed part of a sample payload; value i is at values + 4 * i (use sampleValue).
+/// </summary>
+/// <returns>False if the payload is too short for its value count</returns>
+bool decodeSample(const uint8_t* payload, size_t length, SampleHeader& header, const uint8_t*& values);
+
+/// <summary>
+/// Reads one (possibly unaligned) little endian float.
+/// </summary>
+float sampleValue(const uint8_t* values, size_t i);
+
+/// <summary>
+/// Reads the schema hash and register count of a schema payload.
+/// </summary>
+/// <param name="pos">Receives the offset of the first register entry</param>
+bool decodeSchemaHeader(const uint8_t* payload, size_t length, uint32_t& schemaHash, uint16_t& count, size_t& pos);
+
+/// <summary>
+/// Reads the next register entry of a schema payload and advances pos.
+/// Key and unit point into the payload and are not terminated.
+/// </summary>
+bool decodeSchemaEntry(const uint8_t* payload, size_t length, size_t& pos, const char*& key, size_t& keyLength,
+                       const char*& unit, size_t& unitLength);
+
+} // namespace StreamProtocol
+
+#endif // STREAM_PROTOCOL_H
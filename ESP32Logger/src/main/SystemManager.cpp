@@ -4,20 +4,65 @@
 #include "StorageManager.h"
 #include "ModbusManager.h"
 #include "DataLogger.h"
+#include "LogFrame.h"
+#include "RegisterDiscovery.h"
+#include "SerialConsole.h"
+#include "TimestampFormatter.h"
+#include "Trace.h"
+
+// Size of the reset-safe staging region. RTC slow memory holds 8 KB in total,
+// no-init PSRAM (when enabled in the build) allows much longer flush intervals.
+#ifndef STAGING_RTC_BYTES
+#define STAGING_RTC_BYTES 6144
+#endif
+#ifndef STAGING_PSRAM_BYTES
+#define STAGING_PSRAM_BYTES (256 * 1024)
+#endif
+
+#if defined(CONFIG_SPIRAM_ALLOW_NOINIT_SEG_EXTERNAL_MEMORY) && defined(EXT_RAM_NOINIT_ATTR)
+static EXT_RAM_NOINIT_ATTR uint64_t stagingRegion[STAGING_PSRAM_BYTES / sizeof(uint64_t)];
+#else
+static RTC_NOINIT_ATTR uint64_t stagingRegion[STAGING_RTC_BYTES / sizeof(uint64_t)];
+#endif
 
 /// <summary>
-/// Returns the configured polling interval from the loaded configuration.
+/// Appends text as a JSON string: quotes and backslashes escaped, control
+/// characters as \u00XX (alarm names come straight from the config).
 /// </summary>
-unsigned long SystemManager::getPollingInterval() const {
-    return config.getPollingInterval();
+static void appendJsonString(String& out, const char* text) {
+    out += '"';
+    for (const unsigned char* c = reinterpret_cast<const unsigned char*>(text); *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+            out += static_cast<char>(*c);
+        } else if (*c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+            out += escaped;
+        } else {
+            out += static_cast<char>(*c);
+        }
+    }
+    out += '"';
 }
 
 /// <summary>
-/// Triggers RTC time setup via serial input.
-/// Useful when RTC has invalid or unset time.
+/// Hashes the ordered list of register keys, so staged samples are only
+/// replayed against the register set they were recorded with.
 /// </summary>
-void SystemManager::setupRTCFromSerial() {
-    rtc.serialSetupTime();
+static uint32_t registerSchemaHash(const std::vector<RegisterConfig>& regs) {
+    uint32_t crc = 0;
+    for (const auto& r : regs) {
+        crc = LogFrame::crc32(r.key.c_str(), r.key.length() + 1, crc);
+    }
+    return crc;
+}
+
+/// <summary>
+/// Returns the configured polling interval from the loaded configuration.
+/// </summary>
+unsigned long SystemManager::getPollingInterval() const {
+    return config.getPollingInterval();
 }
 
 /// <summary>
@@ -26,9 +71,15 @@ void SystemManager::setupRTCFromSerial() {
 /// - RTC (including manual time entry if invalid)
 /// - SD card for storage
 /// - Configuration loading
+/// - Replay of samples staged before a reset
 /// - Modbus communication
+/// - Register map discovery (cached on the SD card)
 /// - Transformer register readout (VTR/CTR)
-/// - DataLogger instance
+/// - Burst capture
+/// - Live stream
+/// - Recent history
+/// - SD card retention and day file compression
+/// - Serial command console
 /// </summary>
 void SystemManager::setupAll() {
     Serial.println("🔧 [SystemManager] Starting system setup...");
@@ -52,21 +103,82 @@ void SystemManager::setupAll() {
     config.setStorage(&storage);
     config.load();
 
-    // 4. Modbus setup
-    ModbusSettings mb = config.getModbusSettings();
-    modbus.begin(mb);
-    modbus.setConfig(&config);
-    modbus.setAddressOffset(config.isAddressOffsetEnabled());
+    // 4. Staging ring: replay samples that did not reach the SD card before a reset
+    setupStaging(false);
+
+    // 5.-6. Modbus, register map discovery, transformer ratios
+    setupBus();
+
+    // 7.-8. Burst capture, live stream, recent history, SD card retention and compression
+    setupCapture();
+
+    // 9. Serial command console
+    console.begin(&Serial, this);
+
+    Serial.println("✅ [SystemManager] System setup complete.");
+}
+
+/// <summary>
+/// Attaches the staging ring for the current register set and replays
+/// samples staged before a reset. On a reload nothing is pending (flushed
+/// beforehand) unless logging is disabled, so a changed register set is only
+/// an error if it discards samples kept for that reason.
+/// </summary>
+void SystemManager::setupStaging(bool reload) {
+    const std::vector<RegisterConfig>& regs = config.getChannels();
+    logger = DataLogger(&rtc, &storage, &buses, &config, &staging, &stream, &history);
+    size_t kept = staging.pending();    // Not attached yet at startup (0)
+
+    StagingRing::AttachResult attach = staging.attach(stagingRegion, sizeof(stagingRegion),
+                                                      static_cast<uint16_t>(regs.size()), registerSchemaHash(regs));
+    Serial.printf("💽 [SystemManager] Staging ring: %u slot(s), %s.\n", (unsigned)staging.capacity(),
+                  attach == StagingRing::AttachResult::Restored ? "restored" :
+                  attach == StagingRing::AttachResult::Fresh ? "initialized" : "register set changed, reset");
+    if (attach == StagingRing::AttachResult::LayoutChanged && (!reload || kept > 0)) {
+        storage.logError(ErrorCode::Staging, "Staged samples discarded: register configuration changed.");
+    }
+    if (staging.pending() > 0) {
+        Serial.printf("💽 [SystemManager] Replaying %u staged sample(s)...\n", (unsigned)staging.pending());
+        logger.flushStaged();
+    }
+}
 
-    // 5. Read VTR and CTR registers
+/// <summary>
+/// Opens the Modbus lines, runs register map discovery and reads the
+/// transformer ratios (both on bus 0).
+/// </summary>
+void SystemManager::setupBus() {
+    // Modbus setup, one manager (and poll task) per bus
+    buses.begin(&config);
+    captureDropped = 0;
+    setupDiscovery();
+}
+
+/// <summary>
+/// Runs register map discovery (or the debug scan) and reads the transformer
+/// ratios on bus 0, then re-checks the poll schedule with the turnaround
+/// measured meanwhile.
+/// </summary>
+void SystemManager::setupDiscovery() {
+    ModbusSettings mb = config.getModbusSettings(0);
+    ModbusManager& modbus = *buses.getBus(0);
+
+    // Read VTR and CTR registers
     uint16_t vtrAddr = config.getVTRRegister();
     uint16_t ctrAddr = config.getCTRRegister();
     uint16_t vtrRaw = 0, ctrRaw = 0;
     float vtr = config.getVTR();  // fallback from config
     float ctr = config.getCTR();
 
-    // Optional debug scan of registers
-    if (config.isDebugEnabled()) {
+    // Register map discovery (cached per slave and device model), otherwise the optional debug scan
+    const DiscoverySettings& discovery = config.getDiscoverySettings();
+    if (discovery.enabled) {
+        RegisterDiscovery discoverer;
+        std::vector<RegisterMap::Range> ranges;
+        if (discoverer.run(discovery, mb.slave_id, config.getDeviceName(), &modbus, &storage, ranges)) {
+            config.setValidRanges(ranges);
+        }
+    } else if (config.isDebugEnabled()) {
         bool offset = config.isAddressOffsetEnabled();
         modbus.scanRange(4000, 4100, offset);
     }
@@ -99,29 +211,258 @@ void SystemManager::setupAll() {
 
     // Apply transformer ratios to Modbus manager
     Serial.printf("[DEBUG] Final transformer ratios → VTR = %.2f, CTR = %.2f\n", vtr, ctr);
-    modbus.setTransformers(vtr, ctr);
+    buses.setTransformers(vtr, ctr);
 
-    // 6. Create data logger
-    Serial.println("📝 [SystemManager] Creating DataLogger instance...");
-    logger = DataLogger(&rtc, &storage, &modbus, &config);
+    // Re-check the poll schedule of bus 0 with the turnaround measured during the reads above
+    for (size_t b = 0; b < buses.getBusCount(); ++b) {
+        modelTurnaroundUs[b] = config.getAssumedTurnaroundUs(b);
+        lastBusyUs[b] = 0;
+    }
+    if (modbus.getBusStats().turnaroundUs > 0) {
+        modelTurnaroundUs[0] = modbus.getBusStats().turnaroundUs;
+        config.checkSchedule(0, modelTurnaroundUs[0], true, true);
+    }
+    lastCycleMs = 0;
+}
 
-    Serial.println("✅ [SystemManager] System setup complete.");
+/// <summary>
+/// Releases the alarm output, starts burst capture, the live stream and the
+/// recent history for the current register set, points retention at the
+/// configured folders and starts the day file compressor.
+/// </summary>
+void SystemManager::setupCapture() {
+    const std::vector<RegisterConfig>& channels = config.getChannels();
+
+    // Alarm output starts released (rule state is reset by every load)
+    const AlarmSettings& alarms = config.getAlarmSettings();
+    alarmEventsDropped = 0;
+    if (alarms.enabled && alarms.outputPin >= 0) {
+        pinMode(alarms.outputPin, OUTPUT);
+        digitalWrite(alarms.outputPin, alarms.outputActiveHigh ? LOW : HIGH);
+    }
+
+    // Burst capture (optional), polls physical registers of bus 0 only
+    const std::vector<RegisterConfig>& regs = config.getRegisters();
+    std::vector<RegisterConfig> busZero(regs.begin() + config.getBusFirstRegister(0),
+                                        regs.begin() + config.getBusFirstRegister(0) + config.getBusRegisterCount(0));
+    burst.begin(config.getBurstSettings(), busZero, &rtc, &storage, buses.getBus(0));
+
+    // Live stream on the USB serial port (optional)
+    stream.begin(config.getStreamSettings(), channels, registerSchemaHash(channels), &Serial);
+
+    // Recent history in RAM, as many samples as the span needs and the budget allows.
+    // Its readers (console, alarms) run in this task, so re-allocating is safe here.
+    const HistorySettings& hist = config.getHistorySettings();
+    history.end();
+    if (hist.enabled) {
+        size_t wanted = hist.minutes * 60000UL / config.getPollingInterval() + 1;
+        size_t slots = history.begin(hist.ramBytes, wanted, static_cast<uint16_t>(channels.size()));
+        if (slots > 0) {
+            Serial.printf("🕒 [SystemManager] Recent history: %u sample(s) (%lu s), %u bytes.\n", (unsigned)slots,
+                          (unsigned long)(slots * config.getPollingInterval() / 1000), (unsigned)history.memoryBytes());
+        } else {
+            Serial.println("[SystemManager][WARN] Recent history does not fit its RAM budget, disabled.");
+        }
+    }
+
+    // Free-space control of the SD card, runs in idle time
+    retention.begin(config.getRetentionSettings(), config.getOutputFolder(), config.getFilenameFormat(),
+                    config.getBurstSettings().eventFolder, &storage);
+
+    // Compression of closed day files, SD access in idle time, encoding on core 0
+    compressor.begin(config.getCompressionSettings(), &storage);
+}
+
+/// <summary>
+/// The caller flushes staged samples first (see SerialConsole's reload).
+/// </summary>
+void SystemManager::beginReload() {
+    if (reloadPhase != ReloadPhase::Idle) return;
+    Serial.println("🗂️  [SystemManager] Reloading configuration...");
+    reloadPhase = ReloadPhase::Parse;
+    reloadBus = 0;
+}
+
+/// <summary>
+/// One phase per call, in the order of setupAll(). The first phase replaces
+/// the configuration, so from there on until the last one the cycle and the
+/// idle tasks that use it wait (see runCycle() and serviceIdle()).
+/// </summary>
+void SystemManager::reloadStep() {
+    TRACE_SCOPE("system.reload", static_cast<uint32_t>(reloadPhase));
+    switch (reloadPhase) {
+        case ReloadPhase::Idle:
+            return;
+        case ReloadPhase::Parse:
+            writeCapture(true);
+            config.load();
+            setupStaging(true);
+            reloadPhase = ReloadPhase::Buses;
+            return;
+        case ReloadPhase::Buses:
+            if (reloadBus == 0) {
+                buses.prepare(&config);
+                captureDropped = 0;
+            }
+            buses.openBus(reloadBus++);
+            if (reloadBus >= buses.getBusCount()) reloadPhase = ReloadPhase::Discovery;
+            return;
+        case ReloadPhase::Discovery:
+            setupDiscovery();
+            reloadPhase = ReloadPhase::Capture;
+            return;
+        case ReloadPhase::Capture:
+            setupCapture();
+            reloadPhase = ReloadPhase::Idle;
+            Serial.println("✅ [SystemManager] Configuration reloaded.");
+            return;
+    }
 }
 
 /// <summary>
 /// Executes a single measurement and logging cycle.
-/// Checks for SD card availability, performs Modbus readout, and logs values.
+/// Acquisition continues while the SD card is missing; samples stay in the
+/// staging ring and the card is checked when they are flushed.
 /// Should be called periodically in the main loop.
 /// </summary>
 void SystemManager::runCycle() {
+    if (reloadPhase != ReloadPhase::Idle) {
+        Serial.println("[SystemManager] Cycle skipped, configuration reload in progress.");
+        return;
+    }
     Serial.println("🔁 [SystemManager] Starting run cycle...");
 
-    if (storage.isCardPresent()) {
-        logger.logAll();
+    unsigned long startedMs = millis();
+    uint64_t busyBeforeUs[ConfigManager::kMaxBuses];
+    for (size_t b = 0; b < buses.getBusCount(); ++b) busyBeforeUs[b] = buses.getBus(b)->getBusStats().busyUs;
+    ++cycleCount;
+    TRACE_SCOPE("system.cycle", cycleCount);
+
+    logger.logAll();
+    checkBusLoad(startedMs, busyBeforeUs);
+    storage.pollErrors();
+
+    Serial.println("✅ [SystemManager] Run cycle complete.\n");
+}
+
+/// <summary>
+/// Compares the bus time of the cycle with the polling interval, per bus
+/// (buses run in parallel, each has the whole interval). Utilization is
+/// measured from the previous cycle start to this one, so it also covers burst
+/// capture polling in between.
+/// </summary>
+void SystemManager::checkBusLoad(unsigned long startedMs, const uint64_t* busyBeforeUs) {
+    unsigned long interval = config.getPollingInterval();
+    bool previous = lastCycleMs != 0 && startedMs > lastCycleMs;
+
+    for (size_t b = 0; b < buses.getBusCount(); ++b) {
+        const BusStats& bus = buses.getBus(b)->getBusStats();
+        uint32_t cycleBusUs = static_cast<uint32_t>(bus.busyUs - busyBeforeUs[b]);
+
+        if (previous) {
+            // Start to start: the previous cycle and the idle time after it, over the same span
+            float utilization = (busyBeforeUs[b] - lastBusyUs[b]) / ((startedMs - lastCycleMs) * 1000.0f);
+            Serial.printf("[SystemManager] Bus %u: %.1f ms this cycle, %.1f %% utilization, turnaround %.1f ms (max %.1f ms), %lu failed request(s).\n",
+                          (unsigned)b, cycleBusUs / 1000.0f, utilization * 100.0f, bus.turnaroundUs / 1000.0f,
+                          bus.maxTurnaroundUs / 1000.0f, (unsigned long)bus.failures);
+        }
+        lastBusyUs[b] = busyBeforeUs[b];
+
+        if (cycleBusUs > interval * 1000UL) {
+            Serial.printf("[SystemManager][WARN] Poll cycle took %.1f ms of bus %u time, longer than the %lu ms interval.\n",
+                          cycleBusUs / 1000.0f, (unsigned)b, interval);
+            storage.logError(ErrorCode::Schedule, "Poll cycle overran the polling interval.");
+        }
+
+        // Slave answers slower or faster than modelled: report the updated estimate
+        uint32_t measured = bus.turnaroundUs;
+        uint32_t model = modelTurnaroundUs[b];
+        if (measured > 0 && (measured > model + model / 2 || measured < model / 2)) {
+            modelTurnaroundUs[b] = measured;
+            config.checkSchedule(b, measured, true, false);
+        }
+    }
+    lastCycleMs = startedMs;
+}
+
+/// <summary>
+/// Runs short, incremental background tasks between acquisition cycles.
+/// During a reload one reload phase replaces the tasks that depend on the
+/// configuration.
+/// </summary>
+void SystemManager::serviceIdle() {
+    rtc.discipline();
+    if (reloadPhase != ReloadPhase::Idle) {
+        reloadStep();
     } else {
-        Serial.println("❌ [SystemManager] SD card not detected!");
-        storage.logError("SD card not present.");
+        writeAlarmEvents();
+        writeCapture(false);
+        burst.poll();
+        if (!burst.isCapturing()) {
+            retention.poll();  // Not while an event file is being written
+            compressor.poll();
+        }
     }
+    console.poll();
+}
 
-    Serial.println("✅ [SystemManager] Run cycle complete.\n");
+/// <summary>
+/// Appends one NDJSON line per alarm state change to the alarm log, each
+/// with its own SD write, so the log is current within one loop pass.
+/// </summary>
+void SystemManager::writeAlarmEvents() {
+    AlarmEngine& alarms = config.getAlarms();
+    AlarmEngine::Event event;
+    while (alarms.popEvent(event)) {
+        TimestampFormatter formatter;
+        char time[TimestampFormatter::kMaxLength];
+        formatter.format(event.timestampMs, time, true);
+        const char* state = event.raised ? "raised" : "cleared";
+        const std::string& name = alarms.name(event.rule);
+
+        char value[24];
+        snprintf(value, sizeof(value), "%g", event.value);
+        String line = "{\"timestamp\":\"";
+        line.reserve(line.length() + strlen(time) + name.length() + 64);
+        line += time;
+        line += "\",\"alarm\":";
+        appendJsonString(line, name.c_str());
+        line += ",\"state\":\"";
+        line += state;
+        line += "\",\"value\":";
+        line += isfinite(event.value) ? value : "null";
+        line += '}';
+
+        Serial.printf("🚨 [SystemManager] Alarm %s: %s (value %g)\n", state, name.c_str(), event.value);
+        storage.appendLine(config.getAlarmSettings().logFile, line.c_str());
+    }
+    if (alarms.droppedEvents() > alarmEventsDropped) {
+        alarmEventsDropped = alarms.droppedEvents();
+        Serial.println("[SystemManager][WARN] Alarm events were lost, the event queue was full.");
+        storage.logError(ErrorCode::Generic, "Alarm event queue overflow, state changes lost.");
+    }
+}
+
+/// <summary>
+/// The buffer holds whole cycles only; a failed write keeps them and is
+/// retried after the next flush interval, while new cycles are dropped.
+/// </summary>
+void SystemManager::writeCapture(bool force) {
+    size_t limit = buses.getCaptureLimit();
+    const std::vector<uint8_t>& captured = buses.getCaptured();
+    if (limit == 0 || captured.empty()) return;
+
+    bool half = captured.size() * 2 >= limit;
+    bool due = millis() - lastCaptureWriteMs >= config.getFlushInterval();
+    if (force || half || due) {
+        lastCaptureWriteMs = millis();
+        if (storage.appendBytes(config.getCaptureSettings().file, captured.data(), captured.size())) {
+            buses.clearCaptured();
+        }
+    }
+    if (buses.getCaptureDropped() > captureDropped) {
+        captureDropped = buses.getCaptureDropped();
+        Serial.println("[SystemManager][WARN] RTU capture cycles were lost, the capture buffer was full.");
+        storage.logError(ErrorCode::Generic, "RTU capture buffer overflow, cycles not recorded.");
+    }
 }
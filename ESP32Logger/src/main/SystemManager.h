@@ -4,8 +4,15 @@
 #include "ConfigManager.h"
 #include "RtcManager.h"
 #include "StorageManager.h"
-#include "ModbusManager.h"
+#include "BusPoller.h"
 #include "DataLogger.h"
+#include "StagingRing.h"
+#include "BurstCapture.h"
+#include "LiveStream.h"
+#include "RecentHistory.h"
+#include "SerialConsole.h"
+#include "RetentionManager.h"
+#include "LogCompressor.h"
 
 /// <summary>
 /// Central system controller for managing hardware initialization,
@@ -16,7 +23,7 @@ class SystemManager {
 public:
     /// <summary>
     /// Performs full system initialization including RTC, SD card,
-    /// configuration loading, Modbus setup, and logger instantiation.
+    /// configuration loading, replay of staged samples, Modbus setup, and logger instantiation.
     /// Should be called once inside the `setup()` function.
     /// </summary>
     void setupAll();
@@ -34,6 +41,19 @@ public:
     /// </summary>
     void runCycle();
 
+    /// <summary>
+    /// Performs background housekeeping between cycles (RTC clock discipline,
+    /// alarm event log, burst capture, SD card retention, serial console).
+    /// Must return quickly; call on every loop() iteration.
+    /// </summary>
+    void serviceIdle();
+
+    /// <summary>
+    /// Returns true if burst capture polls the bus between cycles,
+    /// in which case the main loop should not sleep.
+    /// </summary>
+    bool isBurstEnabled() const { return burst.isEnabled(); }
+
     /// <summary>
     /// Accessor for configuration manager (for debugging or testing).
     /// </summary>
@@ -45,17 +65,150 @@ public:
     RtcManager* getRtc() { return &rtc; }
 
     /// <summary>
-    /// Allows manual setup of RTC time via serial terminal.
-    /// Useful when RTC is not properly initialized or has invalid time.
+    /// Accessor for the Modbus manager of bus 0 (console diagnostics).
+    /// </summary>
+    ModbusManager* getModbus() { return buses.getBus(0); }
+
+    /// <summary>
+    /// Accessor for all buses (console diagnostics).
+    /// </summary>
+    BusPoller* getBuses() { return &buses; }
+
+    /// <summary>
+    /// Accessor for the staging ring (console diagnostics).
+    /// </summary>
+    const StagingRing* getStaging() const { return &staging; }
+
+    /// <summary>
+    /// Accessor for the recent history (console, alarms).
+    /// </summary>
+    const RecentHistory* getHistory() const { return &history; }
+
+    /// <summary>
+    /// Accessor for the retention manager (console diagnostics).
     /// </summary>
-    void setupRTCFromSerial();
+    const RetentionManager* getRetention() const { return &retention; }
+
+    /// <summary>
+    /// Accessor for the day file compressor (console diagnostics).
+    /// </summary>
+    const LogCompressor* getCompressor() const { return &compressor; }
+
+    /// <summary>
+    /// Accessor for the storage manager (console trace dump).
+    /// </summary>
+    StorageManager* getStorage() { return &storage; }
+
+    /// <summary>
+    /// Number of acquisition cycles since startup.
+    /// </summary>
+    uint32_t getCycleCount() const { return cycleCount; }
+
+    /// <summary>
+    /// Returns true while a burst event is collected or written;
+    /// the configuration must not be reloaded meanwhile.
+    /// </summary>
+    bool isCapturingBurst() const { return burst.isCapturing(); }
+
+    /// <summary>
+    /// Writes every staged sample to the SD card.
+    /// </summary>
+    /// <returns>True if nothing is left pending</returns>
+    bool flushStaged() { return logger.flushStaged(); }
+
+    /// <summary>
+    /// Starts re-reading config.json and re-initializing the staging ring,
+    /// buses, burst capture and live stream. serviceIdle() runs one phase per
+    /// pass (parse, each bus, discovery, capture), so the loop stays responsive;
+    /// no cycle runs until the last phase is done. Staged samples must be
+    /// flushed first.
+    /// </summary>
+    void beginReload();
+
+    /// <summary>
+    /// Returns true while a reload started by beginReload() is not finished.
+    /// </summary>
+    bool isReloading() const { return reloadPhase != ReloadPhase::Idle; }
 
 private:
+    /// <summary>
+    /// Phase of a configuration reload run by the next serviceIdle().
+    /// </summary>
+    enum class ReloadPhase : uint8_t {
+        Idle,           ///< No reload
+        Parse,          ///< Re-read config.json, re-attach the staging ring
+        Buses,          ///< Open one bus per pass
+        Discovery,      ///< Register discovery and transformer ratios (bus 0)
+        Capture         ///< Alarm output, burst capture, stream, history, retention
+    };
+
     RtcManager rtc;
     ConfigManager config;
     StorageManager storage;
-    ModbusManager modbus;
+    BusPoller buses;
+    StagingRing staging;
     DataLogger logger;
+    BurstCapture burst;
+    LiveStream stream;
+    RecentHistory history;
+    SerialConsole console;
+    RetentionManager retention;
+    LogCompressor compressor;
+
+    uint64_t lastBusyUs[ConfigManager::kMaxBuses] = {};         ///< Bus time accumulated at the previous cycle start
+    unsigned long lastCycleMs = 0;                              ///< Start of the previous cycle (0 = none yet)
+    uint32_t modelTurnaroundUs[ConfigManager::kMaxBuses] = {};  ///< Turnaround of the last schedule estimate
+    uint32_t cycleCount = 0;             ///< Acquisition cycles since startup
+    uint32_t alarmEventsDropped = 0;     ///< Lost alarm events already reported
+    unsigned long lastCaptureWriteMs = 0; ///< Last write of the RTU capture
+    uint32_t captureDropped = 0;         ///< Dropped capture cycles already reported
+    ReloadPhase reloadPhase = ReloadPhase::Idle;  ///< Next phase of a running reload
+    size_t reloadBus = 0;                ///< Next bus to open in ReloadPhase::Buses
+
+    /// <summary>
+    /// Attaches the staging ring for the current register set and replays leftovers.
+    /// </summary>
+    void setupStaging(bool reload);
+
+    /// <summary>
+    /// Modbus lines, register discovery and transformer ratios.
+    /// </summary>
+    void setupBus();
+
+    /// <summary>
+    /// Register discovery, transformer ratios and schedule check on the opened buses.
+    /// </summary>
+    void setupDiscovery();
+
+    /// <summary>
+    /// Runs the current phase of a reload and moves on to the next.
+    /// </summary>
+    void reloadStep();
+
+    /// <summary>
+    /// Alarm output, burst capture, live stream, recent history, SD card retention
+    /// and day file compression.
+    /// </summary>
+    void setupCapture();
+
+    /// <summary>
+    /// Writes queued alarm state changes to the alarm event log.
+    /// </summary>
+    void writeAlarmEvents();
+
+    /// <summary>
+    /// Appends the captured RTU traffic to the capture file once the buffer is
+    /// half full or the flush interval elapsed.
+    /// </summary>
+    /// <param name="force">Write whatever is buffered (before a reload)</param>
+    void writeCapture(bool force);
+
+    /// <summary>
+    /// Reports the measured load of every bus for the cycle that just ran and
+    /// re-evaluates a bus's schedule when its measured turnaround drifts from
+    /// the modelled one.
+    /// </summary>
+    void checkBusLoad(unsigned long startedMs, const uint64_t* busyBeforeUs);
 };
 
 #endif // SYSTEM_MANAGER_H
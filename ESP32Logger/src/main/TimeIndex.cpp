@@ -0,0 +1,112 @@
+#include "TimeIndex.h"
+#include <string.h>
+
+namespace TimeIndex {
+
+static void writeLE(uint8_t* p, uint64_t v, size_t n) {
+    for (size_t i = 0; i < n; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+static uint64_t readLE(const uint8_t* p, size_t n) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+/// <summary>
+/// Bucket start for a timestamp (floor division, also for negative times).
+/// </summary>
+static int64_t bucketOf(int64_t t, uint32_t intervalMs) {
+    int64_t w = intervalMs;
+    int64_t q = t / w;
+    if (t % w < 0) --q;
+    return q * w;
+}
+
+/// <summary>
+/// Writes magic, version, flags and bucket width.
+/// </summary>
+void encodeHeader(uint32_t intervalMs, uint16_t flags, uint8_t out[kHeaderSize]) {
+    memcpy(out, kMagic, sizeof(kMagic));
+    writeLE(out + 4, kVersion, 2);
+    writeLE(out + 6, flags, 2);
+    writeLE(out + 8, intervalMs, 4);
+    writeLE(out + 12, 0, 4);
+}
+
+/// <summary>
+/// Checks magic and version and reads the header fields.
+/// </summary>
+bool decodeHeader(const uint8_t* in, size_t avail, Header& header) {
+    if (avail < kHeaderSize || memcmp(in, kMagic, sizeof(kMagic)) != 0) return false;
+    header.version = static_cast<uint16_t>(readLE(in + 4, 2));
+    header.flags = static_cast<uint16_t>(readLE(in + 6, 2));
+    header.intervalMs = static_cast<uint32_t>(readLE(in + 8, 4));
+    return header.version == kVersion && header.intervalMs > 0;
+}
+
+/// <summary>
+/// Serializes time and offset as two little endian 64-bit values.
+/// </summary>
+void encodeEntry(const Entry& entry, uint8_t out[kEntrySize]) {
+    writeLE(out, static_cast<uint64_t>(entry.timeMs), 8);
+    writeLE(out + 8, entry.offset, 8);
+}
+
+/// <summary>
+/// Reads time and offset.
+/// </summary>
+Entry decodeEntry(const uint8_t in[kEntrySize]) {
+    Entry e;
+    e.timeMs = static_cast<int64_t>(readLE(in, 8));
+    e.offset = readLE(in + 8, 8);
+    return e;
+}
+
+/// <summary>
+/// Binary search for the last entry at or before t.
+/// </summary>
+long findFloor(const Entry* entries, size_t count, int64_t t) {
+    return static_cast<long>(findCeiling(entries, count, t)) - 1;
+}
+
+/// <summary>
+/// Binary search for the first entry after t.
+/// </summary>
+size_t findCeiling(const Entry* entries, size_t count, int64_t t) {
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (entries[mid].timeMs <= t) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void Builder::reset(uint32_t interval) {
+    intervalMs = interval > 0 ? interval : kDefaultIntervalMs;
+    nextBucketMs = INT64_MIN;
+}
+
+void Builder::resume(uint32_t interval, int64_t lastEntryMs) {
+    reset(interval);
+    nextBucketMs = bucketOf(lastEntryMs, intervalMs) + intervalMs;
+}
+
+/// <summary>
+/// Emits an entry for the first record at or after the next bucket boundary.
+/// Records that step back in time never produce an entry, so entries stay sorted.
+/// </summary>
+bool Builder::offer(int64_t timeMs, uint64_t offset, Entry& entry) {
+    if (timeMs < nextBucketMs) return false;
+
+    entry.timeMs = bucketOf(timeMs, intervalMs);
+    entry.offset = offset;
+    nextBucketMs = entry.timeMs + intervalMs;
+    return true;
+}
+
+} // namespace TimeIndex
@@ -0,0 +1,116 @@
+#ifndef TIME_INDEX_H
+#define TIME_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+/// Sparse time index stored next to every log file as "<log file>.idx".
+/// This header has no Arduino dependencies; the logger appends to the index
+/// while flushing records and host-side tools read or rebuild it.
+///
+/// File layout (little endian):
+///   header  [ "RTIX" ] [uint16 version] [uint16 flags] [uint32 interval ms] [uint32 reserved]
+///   entries [int64 time ms] [uint64 byte offset]   (repeated)
+///
+/// An entry states "the first record with a timestamp in the bucket starting at
+/// time ms begins at byte offset". Entries are only written for buckets that
+/// actually contain records, in increasing time order. Records before the first
+/// entry are reached by reading from offset 0, so a partial index (e.g. started
+/// on a legacy file) is still correct, merely less selective.
+/// </summary>
+namespace TimeIndex {
+
+constexpr uint8_t kMagic[4] = { 'R', 'T', 'I', 'X' };
+constexpr uint16_t kVersion = 1;
+constexpr uint16_t kFlagFramed = 0x0001;         ///< Log file uses LogFrame records
+constexpr size_t kHeaderSize = 16;
+constexpr size_t kEntrySize = 16;
+constexpr uint32_t kDefaultIntervalMs = 60000;   ///< One entry per minute of data
+
+/// <summary>
+/// One index entry.
+/// </summary>
+struct Entry {
+    int64_t timeMs;          ///< Bucket start (epoch milliseconds)
+    uint64_t offset;         ///< Byte offset of the first record in that bucket
+};
+
+/// <summary>
+/// Decoded index file header.
+/// </summary>
+struct Header {
+    uint16_t version;
+    uint16_t flags;
+    uint32_t intervalMs;
+};
+
+/// <summary>
+/// Writes the file header.
+/// </summary>
+void encodeHeader(uint32_t intervalMs, uint16_t flags, uint8_t out[kHeaderSize]);
+
+/// <summary>
+/// Validates and decodes the file header.
+/// </summary>
+/// <returns>False if the magic or version does not match</returns>
+bool decodeHeader(const uint8_t* in, size_t avail, Header& header);
+
+/// <summary>
+/// Serializes one entry.
+/// </summary>
+void encodeEntry(const Entry& entry, uint8_t out[kEntrySize]);
+
+/// <summary>
+/// Deserializes one entry.
+/// </summary>
+Entry decodeEntry(const uint8_t in[kEntrySize]);
+
+/// <summary>
+/// Returns the index of the last entry with timeMs <= t, or -1 if there is none
+/// (the caller then starts reading at offset 0).
+/// </summary>
+long findFloor(const Entry* entries, size_t count, int64_t t);
+
+/// <summary>
+/// Returns the index of the first entry with timeMs > t, or count if there is none
+/// (the caller then reads to the end of the file).
+/// </summary>
+size_t findCeiling(const Entry* entries, size_t count, int64_t t);
+
+/// <summary>
+/// Decides which records start a new index bucket.
+/// Fed with every record in file order; shared by the logger and the rebuild tool.
+/// </summary>
+class Builder {
+public:
+    /// <summary>
+    /// Starts a new index.
+    /// </summary>
+    /// <param name="intervalMs">Bucket width in milliseconds</param>
+    void reset(uint32_t intervalMs);
+
+    /// <summary>
+    /// Continues an existing index whose newest entry is known.
+    /// </summary>
+    void resume(uint32_t intervalMs, int64_t lastEntryMs);
+
+    /// <summary>
+    /// Offers a record.
+    /// </summary>
+    /// <param name="timeMs">Record timestamp</param>
+    /// <param name="offset">Byte offset of the record in the log file</param>
+    /// <param name="entry">Receives the new entry</param>
+    /// <returns>True if the record starts a new bucket and entry was filled</returns>
+    bool offer(int64_t timeMs, uint64_t offset, Entry& entry);
+
+    uint32_t interval() const { return intervalMs; }
+
+private:
+    uint32_t intervalMs = kDefaultIntervalMs;
+    int64_t nextBucketMs = INT64_MIN;   ///< Records before this time stay in the current bucket
+};
+
+} // namespace TimeIndex
+
+#endif // TIME_INDEX_H
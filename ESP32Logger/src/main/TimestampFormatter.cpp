@@ -0,0 +1,120 @@
+#include "TimestampFormatter.h"
+#include <string.h>
+
+static const int64_t MS_PER_DAY = 86400000LL;
+
+static void put2(char* p, unsigned v) {
+    p[0] = static_cast<char>('0' + v / 10);
+    p[1] = static_cast<char>('0' + v % 10);
+}
+
+static bool digits(const char* p, size_t n, unsigned& out) {
+    unsigned v = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (p[i] < '0' || p[i] > '9') return false;
+        v = v * 10 + static_cast<unsigned>(p[i] - '0');
+    }
+    out = v;
+    return true;
+}
+
+/// <summary>
+/// Howard Hinnant's days_from_civil algorithm.
+/// </summary>
+int64_t TimestampFormatter::daysFromCivil(int year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(year - era * 400);
+    const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+/// <summary>
+/// Howard Hinnant's civil_from_days algorithm.
+/// </summary>
+void TimestampFormatter::civilFromDays(int64_t days, int& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int>(yoe + era * 400 + (month <= 2));
+}
+
+/// <summary>
+/// Formats epoch milliseconds, reusing the cached date prefix within a day.
+/// </summary>
+size_t TimestampFormatter::format(int64_t epochMs, char* out, bool withMillis) {
+    int64_t day = epochMs >= 0 ? epochMs / MS_PER_DAY : (epochMs - MS_PER_DAY + 1) / MS_PER_DAY;
+    uint32_t msOfDay = static_cast<uint32_t>(epochMs - day * MS_PER_DAY);
+
+    if (day != cachedDay) {
+        int y;
+        unsigned m, d;
+        civilFromDays(day, y, m, d);
+        unsigned uy = static_cast<unsigned>(y) % 10000;
+        put2(datePrefix, uy / 100);
+        put2(datePrefix + 2, uy % 100);
+        datePrefix[4] = '-';
+        put2(datePrefix + 5, m);
+        datePrefix[7] = '-';
+        put2(datePrefix + 8, d);
+        datePrefix[10] = ' ';
+        cachedDay = day;
+    }
+
+    memcpy(out, datePrefix, sizeof(datePrefix));
+    unsigned secOfDay = msOfDay / 1000;
+    put2(out + 11, secOfDay / 3600);
+    out[13] = ':';
+    put2(out + 14, (secOfDay / 60) % 60);
+    out[16] = ':';
+    put2(out + 17, secOfDay % 60);
+
+    size_t len = 19;
+    if (withMillis) {
+        unsigned ms = msOfDay % 1000;
+        out[19] = '.';
+        out[20] = static_cast<char>('0' + ms / 100);
+        put2(out + 21, ms % 100);
+        len = 23;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+/// <summary>
+/// Parses the fixed-layout timestamp written by the logger.
+/// </summary>
+bool TimestampFormatter::parse(const char* s, size_t len, int64_t& epochMs) {
+    if (len < 19 || s[4] != '-' || s[7] != '-' || (s[10] != ' ' && s[10] != 'T') ||
+        s[13] != ':' || s[16] != ':') {
+        return false;
+    }
+
+    unsigned y, mo, d, h, mi, se;
+    if (!digits(s, 4, y) || !digits(s + 5, 2, mo) || !digits(s + 8, 2, d) ||
+        !digits(s + 11, 2, h) || !digits(s + 14, 2, mi) || !digits(s + 17, 2, se)) {
+        return false;
+    }
+    if (mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || se > 60) return false;
+
+    unsigned ms = 0;
+    if (len > 20 && s[19] == '.') {
+        size_t n = 0;
+        unsigned scale = 100;
+        while (20 + n < len && n < 3 && s[20 + n] >= '0' && s[20 + n] <= '9') {
+            ms += static_cast<unsigned>(s[20 + n] - '0') * scale;
+            scale /= 10;
+            ++n;
+        }
+    }
+
+    epochMs = daysFromCivil(static_cast<int>(y), mo, d) * MS_PER_DAY +
+              (static_cast<int64_t>(h) * 3600 + mi * 60 + se) * 1000 + ms;
+    return true;
+}
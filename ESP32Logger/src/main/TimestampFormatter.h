@@ -0,0 +1,54 @@
+#ifndef TIMESTAMP_FORMATTER_H
+#define TIMESTAMP_FORMATTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+/// Converts integer epoch milliseconds to "YYYY-MM-DD HH:MM:SS[.mmm]" and back.
+/// Formatting is incremental: the "YYYY-MM-DD " prefix is cached and only
+/// recomputed when the day changes, the time part is plain digit arithmetic
+/// (no sprintf, no localtime). Epoch values are interpreted in the same zone
+/// the logger keeps its clock in (the RTC's local time stored as UTC).
+///
+/// The class has no Arduino dependencies and is shared with host-side tools.
+/// </summary>
+class TimestampFormatter {
+public:
+    static const size_t kMaxLength = 24;   ///< Longest output including terminator
+
+    /// <summary>
+    /// Formats a timestamp.
+    /// </summary>
+    /// <param name="epochMs">Milliseconds since 1970-01-01 00:00:00</param>
+    /// <param name="out">Destination buffer of at least kMaxLength bytes</param>
+    /// <param name="withMillis">Append ".mmm"</param>
+    /// <returns>Length of the formatted string (without terminator)</returns>
+    size_t format(int64_t epochMs, char* out, bool withMillis);
+
+    /// <summary>
+    /// Parses "YYYY-MM-DD HH:MM:SS" with optional ".f", ".ff" or ".fff" fraction
+    /// (a 'T' separator is accepted as well).
+    /// </summary>
+    /// <param name="s">Input characters (need not be terminated)</param>
+    /// <param name="len">Number of characters</param>
+    /// <param name="epochMs">Receives milliseconds since the epoch</param>
+    /// <returns>True if the input matched the format</returns>
+    static bool parse(const char* s, size_t len, int64_t& epochMs);
+
+    /// <summary>
+    /// Days since 1970-01-01 for a proleptic Gregorian date.
+    /// </summary>
+    static int64_t daysFromCivil(int year, unsigned month, unsigned day);
+
+    /// <summary>
+    /// Proleptic Gregorian date for a number of days since 1970-01-01.
+    /// </summary>
+    static void civilFromDays(int64_t days, int& year, unsigned& month, unsigned& day);
+
+private:
+    int64_t cachedDay = INT64_MIN;   ///< Day number the prefix belongs to
+    char datePrefix[11] = {};        ///< "YYYY-MM-DD " without terminator
+};
+
+#endif // TIMESTAMP_FORMATTER_H
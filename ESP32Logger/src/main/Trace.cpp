@@ -0,0 +1,153 @@
+#include "Trace.h"
+#include <atomic>
+
+namespace Trace {
+
+#if TRACE_EVENTS
+
+static_assert(TRACE_CAPACITY > 0 && (TRACE_CAPACITY & (TRACE_CAPACITY - 1)) == 0,
+              "TRACE_CAPACITY must be a power of two");
+
+/// <summary>
+/// One event. tag is ((sequence + 1) << 2 | phase code), 0 while the slot is
+/// being written; all words are relaxed atomics, as in RecentHistory.
+/// </summary>
+struct Slot {
+    std::atomic<uint32_t> tag{0};
+    std::atomic<uint32_t> timeUs{0};
+    std::atomic<uint32_t> id{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<void*> task{nullptr};
+};
+
+/// <summary>
+/// Copy of a slot taken by the dump.
+/// </summary>
+struct Event {
+    uint32_t timeUs;
+    uint32_t id;
+    const char* name;
+    void* task;
+    char phase;
+};
+
+static Slot ring[TRACE_CAPACITY];
+static std::atomic<uint32_t> head{0};       ///< Sequence of the next event
+static std::atomic<uint32_t> start{0};      ///< Sequence of the oldest event after clear()
+
+static const char kPhases[] = { TraceFormat::kBegin, TraceFormat::kEnd, TraceFormat::kInstant };
+
+static uint32_t tagOf(uint32_t seq, uint32_t code) {
+    return ((seq + 1) << 2) | code;
+}
+
+void record(char phase, const char* name, uint32_t id) {
+    uint32_t code = phase == TraceFormat::kBegin ? 0 : phase == TraceFormat::kEnd ? 1 : 2;
+    uint32_t seq = head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = ring[seq & (TRACE_CAPACITY - 1)];
+
+    slot.tag.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.timeUs.store(static_cast<uint32_t>(micros()), std::memory_order_relaxed);
+    slot.id.store(id, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.task.store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+    slot.tag.store(tagOf(seq, code), std::memory_order_release);
+}
+
+void clear() {
+    start.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Copies the event with the given sequence number.
+/// </summary>
+/// <returns>False if the slot was reused or is being written</returns>
+static bool read(uint32_t seq, Event& event) {
+    const Slot& slot = ring[seq & (TRACE_CAPACITY - 1)];
+    uint32_t tag = slot.tag.load(std::memory_order_acquire);
+    if (tag == 0 || (tag >> 2) != ((seq + 1) & 0x3FFFFFFF) || (tag & 3) == 3) return false;
+
+    event.timeUs = slot.timeUs.load(std::memory_order_relaxed);
+    event.id = slot.id.load(std::memory_order_relaxed);
+    event.name = slot.name.load(std::memory_order_relaxed);
+    event.task = slot.task.load(std::memory_order_relaxed);
+    event.phase = kPhases[tag & 3];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.tag.load(std::memory_order_relaxed) == tag;
+}
+
+bool Dump::begin() {
+    last = head.load(std::memory_order_relaxed);
+    uint32_t oldest = start.load(std::memory_order_relaxed);
+    first = (last - oldest > TRACE_CAPACITY) ? last - TRACE_CAPACITY : oldest;
+    overwritten = first - oldest;
+    index = first;
+    lost = 0;
+    taskCount = 0;
+    stage = Stage::Header;
+    return true;
+}
+
+/// <summary>
+/// Header, then the events oldest first with a task line ahead of the first
+/// event of every task, then "@end". An event overwritten before the dump
+/// reached it is counted as lost.
+/// </summary>
+size_t Dump::next(char* out, size_t size) {
+    switch (stage) {
+        case Stage::Header:
+            stage = Stage::Events;
+            return TraceFormat::formatHeader(last - first, overwritten, out, size);
+        case Stage::Events:
+            while (index != last) {
+                Event event;
+                if (!read(index, event)) {
+                    ++index;
+                    ++lost;
+                    continue;
+                }
+                bool isNew;
+                uint16_t task = taskId(event.task, isNew);
+                if (isNew) return TraceFormat::formatTask(task, pcTaskGetName(static_cast<TaskHandle_t>(event.task)), out, size);
+                ++index;
+                return TraceFormat::formatEvent(event.timeUs, event.phase, task, event.id, event.name, out, size);
+            }
+            stage = Stage::End;
+            // fall through
+        case Stage::End:
+            stage = Stage::Done;
+            return TraceFormat::formatEnd(out, size);
+        default:
+            return 0;
+    }
+}
+
+#else
+
+void record(char, const char*, uint32_t) {}
+void clear() {}
+
+bool Dump::begin() {
+    stage = Stage::Done;
+    return false;
+}
+
+size_t Dump::next(char*, size_t) {
+    return 0;
+}
+
+#endif
+
+uint16_t Dump::taskId(void* task, bool& isNew) {
+    isNew = false;
+    for (size_t i = 0; i < taskCount; ++i) {
+        if (tasks[i] == task) return static_cast<uint16_t>(i + 1);
+    }
+    if (taskCount == kMaxTasks) return 0;
+    tasks[taskCount++] = task;
+    isNew = true;
+    return static_cast<uint16_t>(taskCount);
+}
+
+} // namespace Trace
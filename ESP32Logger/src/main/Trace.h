@@ -0,0 +1,122 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include "TraceFormat.h"
+
+// Trace events are compiled in with -DTRACE_EVENTS=1; with 0 every TRACE_*
+// macro expands to nothing (arguments are not evaluated) and the ring is not
+// allocated. The ring holds the last TRACE_CAPACITY events (power of two,
+// 20 bytes each).
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS 0
+#endif
+#ifndef TRACE_CAPACITY
+#define TRACE_CAPACITY 512
+#endif
+
+/// <summary>
+/// Timeline of what the logger spends its time on: scoped begin/end events
+/// and instant events, each with a name, a numeric id (cycle number, register
+/// address, byte count, ...), the task it ran on and micros().
+///
+/// Events go into a fixed ring that overwrites the oldest. Recording is one
+/// atomic increment and five word stores, lock-free and safe from any task on
+/// either core; names must be string literals, only the pointer is kept.
+/// Every slot carries its sequence number, written last, so a dump running
+/// while events are recorded skips slots that were reused under it instead of
+/// reading torn events.
+///
+/// Use the macros, not the functions, so the calls compile out:
+///   TRACE_SCOPE("sd.flush", bytes);     // begin here, end at the closing brace
+///   TRACE_INSTANT("modbus.fail", address);
+///
+/// A Dump turns the ring into TraceFormat lines for the console
+/// ("trace", "trace save"); rtulog-trace converts them to Chrome trace JSON.
+/// </summary>
+namespace Trace {
+
+/// <summary>
+/// Records one event (TraceFormat::kBegin, kEnd or kInstant).
+/// </summary>
+void record(char phase, const char* name, uint32_t id);
+
+/// <summary>
+/// Drops the recorded events; the next dump starts with events after this call.
+/// </summary>
+void clear();
+
+/// <summary>
+/// Begin event at construction, end event when it goes out of scope.
+/// </summary>
+class Scope {
+public:
+    Scope(const char* name, uint32_t id) : name(name), id(id) { record(TraceFormat::kBegin, name, id); }
+    ~Scope() { record(TraceFormat::kEnd, name, id); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name;
+    uint32_t id;
+};
+
+/// <summary>
+/// Writes the events in the ring as TraceFormat lines, one line per call, so
+/// the console can send them without blocking. Tasks get small ids in order of
+/// first appearance; their names are looked up when the dump reaches them
+/// (the logger never deletes its tasks).
+/// </summary>
+class Dump {
+public:
+    static constexpr size_t kMaxTasks = 15;     ///< More tasks are reported as task 0
+
+    /// <summary>
+    /// Takes the current end of the ring; later events are not dumped.
+    /// </summary>
+    /// <returns>False if tracing is compiled out</returns>
+    bool begin();
+
+    /// <summary>
+    /// Formats the next line.
+    /// </summary>
+    /// <returns>Line length, 0 once the "@end" line was returned</returns>
+    size_t next(char* out, size_t size);
+
+    /// <summary>
+    /// Events that were overwritten while the dump ran.
+    /// </summary>
+    uint32_t getLost() const { return lost; }
+
+private:
+    enum class Stage : uint8_t { Header, Events, End, Done };
+
+    /// <summary>
+    /// Task id of a handle (1..kMaxTasks, 0 once the table is full); isNew is
+    /// set when the handle was just added and its task line is due.
+    /// </summary>
+    uint16_t taskId(void* task, bool& isNew);
+
+    Stage stage = Stage::Done;
+    uint32_t first = 0;                 ///< Sequence of the oldest event to dump
+    uint32_t index = 0;                 ///< Sequence of the next event
+    uint32_t last = 0;                  ///< Sequence after the newest event
+    uint32_t overwritten = 0;           ///< Events lost to the ring before the dump started
+    uint32_t lost = 0;
+    void* tasks[kMaxTasks] = {};
+    size_t taskCount = 0;
+};
+
+} // namespace Trace
+
+#if TRACE_EVENTS
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name, id) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)((name), static_cast<uint32_t>(id))
+#define TRACE_INSTANT(name, id) Trace::record(TraceFormat::kInstant, (name), static_cast<uint32_t>(id))
+#else
+#define TRACE_SCOPE(name, id) ((void)0)
+#define TRACE_INSTANT(name, id) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,78 @@
+#include "TraceFormat.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace TraceFormat {
+
+static size_t finish(int len, size_t size) {
+    return (len < 0 || static_cast<size_t>(len) >= size) ? 0 : static_cast<size_t>(len);
+}
+
+/// <summary>
+/// Copies a name, truncated, with spaces (and other control characters) as '_'.
+/// </summary>
+static void copyName(const char* name, char out[kMaxName]) {
+    size_t n = 0;
+    for (; name && name[n] && n < kMaxName - 1; ++n) {
+        out[n] = (name[n] > ' ' && name[n] <= '~') ? name[n] : '_';
+    }
+    if (n == 0) out[n++] = '?';
+    out[n] = '\0';
+}
+
+size_t formatHeader(uint32_t events, uint32_t overwritten, char* out, size_t size) {
+    return finish(snprintf(out, size, "@trace %u %lu %lu\n", kVersion, (unsigned long)events,
+                           (unsigned long)overwritten), size);
+}
+
+size_t formatTask(uint16_t task, const char* name, char* out, size_t size) {
+    char clean[kMaxName];
+    copyName(name, clean);
+    return finish(snprintf(out, size, "@T %u %s\n", (unsigned)task, clean), size);
+}
+
+size_t formatEvent(uint32_t timeUs, char phase, uint16_t task, uint32_t id, const char* name, char* out, size_t size) {
+    char clean[kMaxName];
+    copyName(name, clean);
+    return finish(snprintf(out, size, "@E %lu %c %u %lu %s\n", (unsigned long)timeUs, phase, (unsigned)task,
+                           (unsigned long)id, clean), size);
+}
+
+size_t formatEnd(char* out, size_t size) {
+    return finish(snprintf(out, size, "@end\n"), size);
+}
+
+static_assert(kMaxName == 32, "The %31s conversions below read kMaxName - 1 characters");
+
+LineType parse(const char* text, Line& line) {
+    line = Line();
+    const char* at = strchr(text, '@');
+    if (!at) return LineType::None;
+
+    unsigned version, task;
+    unsigned long a, b;
+    char phase;
+    int used = 0;
+    if (sscanf(at, "@trace %u %lu %lu", &version, &a, &b) == 3) {
+        if (version != kVersion) return LineType::None;
+        line.events = static_cast<uint32_t>(a);
+        line.overwritten = static_cast<uint32_t>(b);
+        line.type = LineType::Header;
+    } else if (sscanf(at, "@T %u %31s", &task, line.name) == 2) {
+        line.task = static_cast<uint16_t>(task);
+        line.type = LineType::Task;
+    } else if (sscanf(at, "@E %lu %c %u %lu %n", &a, &phase, &task, &b, &used) == 4 && used > 0 &&
+               sscanf(at + used, "%31s", line.name) == 1) {
+        if (phase != kBegin && phase != kEnd && phase != kInstant) return LineType::None;
+        line.timeUs = static_cast<uint32_t>(a);
+        line.phase = phase;
+        line.task = static_cast<uint16_t>(task);
+        line.id = static_cast<uint32_t>(b);
+        line.type = LineType::Event;
+    } else if (strncmp(at, "@end", 4) == 0) {
+        line.type = LineType::End;
+    }
+    return line.type;
+}
+
+} // namespace TraceFormat
@@ -0,0 +1,87 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// <summary>
+/// Text format of a trace dump (see Trace.h). The logger writes it to the
+/// serial console or to a file on the SD card, rtulog-trace turns it into
+/// Chrome trace JSON. This header has no Arduino dependencies.
+///
+/// One line per item, every line starts with '@' so a dump can be cut out of
+/// a serial capture that also holds log output:
+///   @trace <version> <events> <overwritten>    header; overwritten = events lost to the ring
+///   @T <task> <name>                           task id used by the events below
+///   @E <time us> <B|E|i> <task> <id> <name>    begin, end or instant event
+///   @end
+///
+/// Times are micros() of the logger and wrap after 71 minutes; events are in
+/// recording order, so a reader can unwrap them. Names contain no spaces.
+/// </summary>
+namespace TraceFormat {
+
+constexpr unsigned kVersion = 1;
+constexpr size_t kMaxLine = 96;              ///< Longest line including terminator
+constexpr size_t kMaxName = 32;              ///< Longest event or task name including terminator
+
+constexpr char kBegin = 'B';
+constexpr char kEnd = 'E';
+constexpr char kInstant = 'i';
+
+/// <summary>
+/// One line of a dump.
+/// </summary>
+enum class LineType : uint8_t {
+    None,         ///< Not a trace line (other serial output) or malformed
+    Header,
+    Task,
+    Event,
+    End
+};
+
+/// <summary>
+/// Fields of a parsed line; only those of its type are set.
+/// </summary>
+struct Line {
+    LineType type = LineType::None;
+    uint32_t events = 0;              ///< Header
+    uint32_t overwritten = 0;         ///< Header
+    uint32_t timeUs = 0;              ///< Event
+    char phase = 0;                   ///< Event: kBegin, kEnd or kInstant
+    uint16_t task = 0;                ///< Task, Event
+    uint32_t id = 0;                  ///< Event
+    char name[kMaxName] = {};         ///< Task, Event
+};
+
+/// <summary>
+/// Formats the header line. The format functions return the line length
+/// (including the '\n'), 0 if it does not fit.
+/// </summary>
+size_t formatHeader(uint32_t events, uint32_t overwritten, char* out, size_t size);
+
+/// <summary>
+/// Formats a task line.
+/// </summary>
+size_t formatTask(uint16_t task, const char* name, char* out, size_t size);
+
+/// <summary>
+/// Formats an event line.
+/// </summary>
+size_t formatEvent(uint32_t timeUs, char phase, uint16_t task, uint32_t id, const char* name, char* out, size_t size);
+
+/// <summary>
+/// Formats the end line.
+/// </summary>
+size_t formatEnd(char* out, size_t size);
+
+/// <summary>
+/// Parses one line (with or without line terminator). Leading text before the
+/// '@' is skipped, a serial capture may prefix lines with timestamps.
+/// </summary>
+/// <returns>The line type, LineType::None if it is not a valid trace line</returns>
+LineType parse(const char* text, Line& line);
+
+} // namespace TraceFormat
+
+#endif // TRACE_FORMAT_H
@@ -0,0 +1,43 @@
+#include "UartTransport.h"
+
+void UartTransport::begin(HardwareSerial* uart, int pin) {
+    port = uart;
+    deRePin = pin;
+    if (deRePin >= 0) {
+        pinMode(deRePin, OUTPUT);
+        digitalWrite(deRePin, LOW);
+    }
+}
+
+/// <summary>
+/// Enables the driver, sends and waits for the last stop bit (flush) before
+/// switching back to receive, as ModbusMaster's pre/post transmission hooks did.
+/// </summary>
+bool UartTransport::write(const uint8_t* data, size_t len) {
+    if (!port) return false;
+    if (deRePin >= 0) digitalWrite(deRePin, HIGH);
+    size_t written = port->write(data, len);
+    port->flush();
+    if (deRePin >= 0) digitalWrite(deRePin, LOW);
+    return written == len;
+}
+
+int UartTransport::readByte(uint32_t timeoutUs) {
+    if (!port) return -1;
+    uint32_t startUs = micros();
+    for (;;) {
+        if (port->available() > 0) return port->read();
+        uint32_t elapsedUs = micros() - startUs;
+        if (elapsedUs >= timeoutUs) return -1;
+        if (timeoutUs - elapsedUs > 2000) {
+            delay(1);
+        } else {
+            yield();
+        }
+    }
+}
+
+void UartTransport::discardInput() {
+    if (!port) return;
+    while (port->available() > 0) port->read();
+}
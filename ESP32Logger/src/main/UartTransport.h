@@ -0,0 +1,31 @@
+#ifndef UART_TRANSPORT_H
+#define UART_TRANSPORT_H
+
+#include <Arduino.h>
+#include "BusTransport.h"
+
+/// <summary>
+/// RS485 bus on one ESP32 UART with a driver-enable (DE/RE) pin.
+/// Waits sleep in 1 ms steps while more than 2 ms remain, so a bus task
+/// waiting for a slow slave leaves the CPU to the other tasks.
+/// </summary>
+class UartTransport : public BusTransport {
+public:
+    /// <summary>
+    /// Uses an already started UART.
+    /// </summary>
+    /// <param name="port">UART (Serial1 or Serial2)</param>
+    /// <param name="deRePin">Driver enable pin, -1 for auto-direction transceivers</param>
+    void begin(HardwareSerial* port, int deRePin);
+
+    bool write(const uint8_t* data, size_t len) override;
+    int readByte(uint32_t timeoutUs) override;
+    void discardInput() override;
+    uint32_t nowUs() override { return micros(); }
+
+private:
+    HardwareSerial* port = nullptr;
+    int deRePin = -1;
+};
+
+#endif // UART_TRANSPORT_H
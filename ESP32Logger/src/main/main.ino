@@ -5,7 +5,6 @@
 SystemManager systemManager;
 
 unsigned long lastPollTime = 0;
-unsigned long pollInterval = 1000;
 
 /// <summary>
 /// Arduino setup() function.
@@ -13,6 +12,7 @@ unsigned long pollInterval = 1000;
 /// and optionally prints debug information to Serial.
 /// </summary>
 void setup() {
+    Serial.setTxBufferSize(1024); // Room for whole live stream frames (written only if they fit)
     Serial.begin(115200);
     delay(1000); // Short delay to allow Serial to initialize
 
@@ -36,12 +36,17 @@ void setup() {
         Serial.printf("  - Data Bits: %d\n", s.data_bits);
 
         // Show register list
-        auto regs = systemManager.getConfig()->getRegisters();
+        const auto& regs = systemManager.getConfig()->getRegisters();
         Serial.printf("[Debug] Loaded %d register(s):\n", regs.size());
         for (const auto& r : regs) {
             Serial.printf("  - %s [%s] @%d (%s), scaling: %s\n",
                           r.key.c_str(), r.name.c_str(),
-                          r.register_address, r.type.c_str(), r.scaling.c_str());
+                          r.register_address, RegisterMap::typeName(r.dataType),
+                          r.scaleFn ? "(compiled)" : r.scaling.c_str());
+        }
+        for (const auto& r : systemManager.getConfig()->getChannels()) {
+            if (!r.derived) continue;
+            Serial.printf("  - %s [%s] derived: %s\n", r.key.c_str(), r.name.c_str(), r.scaling.c_str());
         }
 
         // Show RTC time
@@ -49,47 +54,27 @@ void setup() {
         Serial.printf("[Debug] RTC Time: %s\n", now.c_str());
     }
 
-    // Set polling interval from config
-    pollInterval = systemManager.getPollingInterval();
-
+    Serial.println("Type 'help' for console commands.");
     Serial.println("=== Setup Complete ===\n");
 }
 
 /// <summary>
 /// Arduino loop() function.
-/// Periodically triggers a data logging cycle and handles serial commands.
+/// Periodically triggers a data logging cycle; the serial console runs
+/// in serviceIdle(). The interval is re-read as a reload may change it.
 /// </summary>
 void loop() {
     unsigned long now = millis();
 
-    checkSerialCommands();
-
-    if (now - lastPollTime >= pollInterval) {
+    if (now - lastPollTime >= systemManager.getPollingInterval()) {
         systemManager.runCycle();
         lastPollTime = now;
     }
 
-    delay(10); // Allow CPU a short rest
-}
-
-/// <summary>
-/// Handles user input via Serial.
-/// Currently supports:
-/// - setrtc → manually updates RTC via Serial terminal
-/// </summary>
-void checkSerialCommands() {
-    static String input = "";
+    systemManager.serviceIdle();
 
-    while (Serial.available() > 0) {
-        char c = Serial.read();
-        if (c == '\n' || c == '\r') {
-            input.trim();
-            if (input.equalsIgnoreCase("setrtc")) {
-                systemManager.setupRTCFromSerial();
-            }
-            input = "";
-        } else {
-            input += c;
-        }
+    // Burst capture polls the bus as fast as it can between cycles
+    if (!systemManager.isBurstEnabled()) {
+        delay(10); // Allow CPU a short rest
     }
 }
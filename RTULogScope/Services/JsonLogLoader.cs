@@ -2,6 +2,7 @@
 using System;
 using System.Data;
 using System.IO;
+using System.Text;
 using System.Windows;
 
 namespace RTULogScope
@@ -24,13 +25,19 @@ namespace RTULogScope
         /// <returns>Populated DataTable, or empty if loading fails</returns>
         public static DataTable Load(string path)
         {
+            // Native parallel parser (rtulog.dll) if deployed, managed parsing otherwise
+            var native = NativeLogParser.TryLoad(path);
+            if (native != null) return native;
+
             var table = new DataTable();
 
             try
             {
-                // Read all lines (each line is a JSON object)
-                var lines = File.ReadAllLines(path);
-                if (lines.Length == 0) return table;
+                // Read all lines (each line is a JSON object), decompressing a ".lz" day file first
+                var bytes = File.ReadAllBytes(path);
+                if (LzLogDecoder.IsCompressed(bytes)) bytes = LzLogDecoder.Decompress(bytes);
+                var lines = Encoding.UTF8.GetString(bytes).Split(new[] { "\r\n", "\n" }, StringSplitOptions.None);
+                if (lines.Length == 0 || string.IsNullOrWhiteSpace(lines[0])) return table;
 
                 // Use the first line to define DataTable columns
                 var firstObj = JObject.Parse(lines[0]);
@@ -0,0 +1,157 @@
+﻿// LzLogDecoder.cs
+// RTULogScope – managed reader for day files the logger compressed ("<day file>.lz").
+// Mirrors LzCodec of the firmware; used when rtulog.dll is not deployed.
+
+using System;
+using System.IO;
+
+namespace RTULogScope
+{
+    /// <summary>
+    /// Decompresses a logger day file (LZSS blocks, see LzCodec.h of the firmware)
+    /// and checks its CRC32 and size against the trailer.
+    /// </summary>
+    public static class LzLogDecoder
+    {
+        private const int HeaderSize = 8;
+        private const int BlockHeaderSize = 4;
+        private const int TrailerSize = 12;
+        private const int WindowBits = 12;
+        private const int BlockSize = 1 << WindowBits;
+        private const int StoredFlag = 0x8000;
+        private const int MinMatch = 3;
+
+        private static readonly uint[] CrcTable = BuildCrcTable();
+
+        /// <summary>
+        /// True if the data starts with a compressed day file header.
+        /// </summary>
+        public static bool IsCompressed(byte[] data)
+        {
+            return data.Length >= HeaderSize && data[0] == 'R' && data[1] == 'T' && data[2] == 'L' && data[3] == 'Z' &&
+                   data[4] == 1 && data[5] == WindowBits;
+        }
+
+        /// <summary>
+        /// Decompresses a whole file.
+        /// </summary>
+        /// <param name="data">File contents</param>
+        /// <returns>The original day file bytes</returns>
+        /// <exception cref="InvalidDataException">The data is truncated or corrupt</exception>
+        public static byte[] Decompress(byte[] data)
+        {
+            if (!IsCompressed(data)) throw new InvalidDataException("Not a compressed log file.");
+
+            var output = new MemoryStream();
+            var window = new byte[2 * BlockSize];
+            int fill = 0;
+            uint crc = 0;
+            int pos = HeaderSize;
+
+            for (;;)
+            {
+                if (data.Length - pos < BlockHeaderSize) throw Corrupt();
+                int rawLength = data[pos] | (data[pos + 1] << 8);
+                int flags = data[pos + 2] | (data[pos + 3] << 8);
+                bool stored = (flags & StoredFlag) != 0;
+                int dataLength = flags & ~StoredFlag;
+                pos += BlockHeaderSize;
+                if (rawLength == 0)
+                {
+                    if (dataLength != 0 || stored) throw Corrupt();
+                    break;
+                }
+                if (rawLength > BlockSize || data.Length - pos < dataLength) throw Corrupt();
+
+                // Same sliding as the encoder: keep the last block's worth of history
+                if (fill + rawLength > window.Length)
+                {
+                    Buffer.BlockCopy(window, BlockSize, window, 0, fill - BlockSize);
+                    fill -= BlockSize;
+                }
+                int start = fill;
+                int end = fill + rawLength;
+
+                if (stored)
+                {
+                    if (dataLength != rawLength) throw Corrupt();
+                    Buffer.BlockCopy(data, pos, window, start, rawLength);
+                }
+                else
+                {
+                    int input = pos;
+                    int inputEnd = pos + dataLength;
+                    int at = start;
+                    int tokens = 0;
+                    int bit = 8;
+                    while (at < end)
+                    {
+                        if (bit == 8)
+                        {
+                            if (input == inputEnd) throw Corrupt();
+                            tokens = data[input++];
+                            bit = 0;
+                        }
+                        if ((tokens & (1 << bit++)) != 0)
+                        {
+                            if (inputEnd - input < 2) throw Corrupt();
+                            int distance = data[input] | ((data[input + 1] & 0x0F) << 8);
+                            int length = (data[input + 1] >> 4) + MinMatch;
+                            input += 2;
+                            if (length == 15 + MinMatch)
+                            {
+                                if (input == inputEnd) throw Corrupt();
+                                length += data[input++];
+                            }
+                            if (distance == 0 || distance > at || length > end - at) throw Corrupt();
+                            for (int i = 0; i < length; i++, at++) window[at] = window[at - distance];
+                        }
+                        else
+                        {
+                            if (input == inputEnd) throw Corrupt();
+                            window[at++] = data[input++];
+                        }
+                    }
+                    if (input != inputEnd) throw Corrupt();
+                }
+
+                crc = Crc32(window, start, rawLength, crc);
+                output.Write(window, start, rawLength);
+                fill = end;
+                pos += dataLength;
+            }
+
+            if (data.Length - pos != TrailerSize) throw Corrupt();
+            uint expectedCrc = BitConverter.ToUInt32(data, pos);
+            ulong rawSize = BitConverter.ToUInt64(data, pos + 4);
+            if (crc != expectedCrc || rawSize != (ulong)output.Length) throw Corrupt();
+            return output.ToArray();
+        }
+
+        private static InvalidDataException Corrupt()
+        {
+            return new InvalidDataException("Compressed log file is truncated or corrupt.");
+        }
+
+        private static uint Crc32(byte[] data, int offset, int length, uint crc)
+        {
+            crc = ~crc;
+            for (int i = offset; i < offset + length; i++)
+                crc = (crc >> 8) ^ CrcTable[(crc ^ data[i]) & 0xFF];
+            return ~crc;
+        }
+
+        private static uint[] BuildCrcTable()
+        {
+            var table = new uint[256];
+            for (uint n = 0; n < 256; n++)
+            {
+                uint c = n;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) != 0 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+            return table;
+        }
+    }
+}
@@ -0,0 +1,155 @@
+﻿// NativeColumnStore.cs
+// RTULogScope – P/Invoke binding to the columnar store of RTULogTools (rtulog.dll).
+// The store is memory-mapped by the native library; columns are copied out only when plotted.
+
+using System;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace RTULogScope
+{
+    /// <summary>
+    /// Read-only access to a memory-mapped columnar log export (.rtc).
+    /// Requires rtulog.dll (built from RTULogTools) next to the executable,
+    /// compiled for the same bitness as the running process.
+    /// </summary>
+    public sealed class NativeColumnStore : IDisposable
+    {
+        private const string Dll = "rtulog";
+        private static readonly DateTime Epoch = new DateTime(1970, 1, 1, 0, 0, 0, DateTimeKind.Unspecified);
+
+        [DllImport(Dll, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr rtulog_last_error();
+
+        [DllImport(Dll, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr rtulog_store_open(byte[] utf8Path);
+
+        [DllImport(Dll, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void rtulog_store_close(IntPtr store);
+
+        [DllImport(Dll, CallingConvention = CallingConvention.Cdecl)]
+        private static extern ulong rtulog_store_rows(IntPtr store);
+
+        [DllImport(Dll, CallingConvention = CallingConvention.Cdecl)]
+        private static extern uint rtulog_store_columns(IntPtr store);
+
+        [DllImport(Dll, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr rtulog_store_column_key(IntPtr store, uint column);
+
+        [DllImport(Dll, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr rtulog_store_column_unit(IntPtr store, uint column);
+
+        [DllImport(Dll, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr rtulog_store_timestamps(IntPtr store);
+
+        [DllImport(Dll, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr rtulog_store_column(IntPtr store, uint column);
+
+        private IntPtr handle;
+
+        /// <summary>
+        /// Number of rows (samples) in the store.
+        /// </summary>
+        public int RowCount { get; }
+
+        /// <summary>
+        /// Register keys in column order.
+        /// </summary>
+        public string[] Keys { get; }
+
+        /// <summary>
+        /// Units in column order.
+        /// </summary>
+        public string[] Units { get; }
+
+        private NativeColumnStore(IntPtr handle)
+        {
+            this.handle = handle;
+            ulong rows = rtulog_store_rows(handle);
+            RowCount = rows > int.MaxValue ? int.MaxValue : (int)rows;
+
+            uint columns = rtulog_store_columns(handle);
+            Keys = new string[columns];
+            Units = new string[columns];
+            for (uint i = 0; i < columns; i++)
+            {
+                Keys[i] = FromUtf8(rtulog_store_column_key(handle, i));
+                Units[i] = FromUtf8(rtulog_store_column_unit(handle, i));
+            }
+        }
+
+        /// <summary>
+        /// Maps a columnar store file.
+        /// </summary>
+        /// <exception cref="InvalidOperationException">The file is missing or not a valid store</exception>
+        public static NativeColumnStore Open(string path)
+        {
+            IntPtr h = rtulog_store_open(ToUtf8(path));
+            if (h == IntPtr.Zero)
+                throw new InvalidOperationException(FromUtf8(rtulog_last_error()));
+            return new NativeColumnStore(h);
+        }
+
+        /// <summary>
+        /// Converts a sample time (epoch milliseconds) to the local DateTime the logger recorded.
+        /// </summary>
+        public static DateTime ToDateTime(long epochMs) => Epoch.AddMilliseconds(epochMs);
+
+        /// <summary>
+        /// Copies all timestamps (epoch milliseconds) out of the mapping.
+        /// </summary>
+        public long[] ReadTimestamps()
+        {
+            var result = new long[RowCount];
+            if (RowCount > 0)
+                Marshal.Copy(rtulog_store_timestamps(Handle), result, 0, RowCount);
+            return result;
+        }
+
+        /// <summary>
+        /// Copies one column out of the mapping (NaN where a sample had no value).
+        /// </summary>
+        public float[] ReadColumn(int column)
+        {
+            var result = new float[RowCount];
+            if (RowCount > 0)
+                Marshal.Copy(rtulog_store_column(Handle, (uint)column), result, 0, RowCount);
+            return result;
+        }
+
+        /// <summary>
+        /// Returns the column index for a key, or -1.
+        /// </summary>
+        public int IndexOf(string key) => Array.IndexOf(Keys, key);
+
+        public void Dispose()
+        {
+            if (handle != IntPtr.Zero)
+            {
+                rtulog_store_close(handle);
+                handle = IntPtr.Zero;
+            }
+        }
+
+        private IntPtr Handle
+        {
+            get
+            {
+                if (handle == IntPtr.Zero) throw new ObjectDisposedException(nameof(NativeColumnStore));
+                return handle;
+            }
+        }
+
+        internal static byte[] ToUtf8(string s) => Encoding.UTF8.GetBytes(s + "\0");
+
+        internal static string FromUtf8(IntPtr p)
+        {
+            if (p == IntPtr.Zero) return string.Empty;
+            int len = 0;
+            while (Marshal.ReadByte(p, len) != 0) len++;
+            var bytes = new byte[len];
+            Marshal.Copy(p, bytes, 0, len);
+            return Encoding.UTF8.GetString(bytes);
+        }
+    }
+}
@@ -0,0 +1,120 @@
+﻿// NativeLogParser.cs
+// RTULogScope – Fast path for opening logs through the parallel parser of RTULogTools (rtulog.dll).
+// Falls back to the managed loaders when the library is not deployed.
+
+using System;
+using System.Data;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace RTULogScope
+{
+    /// <summary>
+    /// Parses NDJSON, framed and CSV logs with the native SIMD parser on all cores
+    /// and fills a DataTable of the same shape JsonLogLoader produces.
+    /// </summary>
+    public static class NativeLogParser
+    {
+        private const string Dll = "rtulog";
+
+        [DllImport(Dll, CallingConvention = CallingConvention.Cdecl)]
+        private static extern long rtulog_parse_probe(byte[] utf8Path, out ulong records, byte[] keys, UIntPtr keysSize);
+
+        [DllImport(Dll, CallingConvention = CallingConvention.Cdecl)]
+        private static extern long rtulog_parse_file(byte[] utf8Path, IntPtr[] keys, uint keyCount,
+                                                     long[] timestamps, IntPtr[] columns, ulong capacity, uint threads);
+
+        // Set once the library turned out to be missing, so later loads skip the attempt
+        private static bool unavailable;
+
+        /// <summary>
+        /// Loads a log file natively.
+        /// Null values become 0.0 as in JsonLogLoader.
+        /// </summary>
+        /// <param name="path">Full path to the log file</param>
+        /// <returns>Populated DataTable, or null if rtulog.dll is unavailable or the file cannot be parsed natively</returns>
+        public static DataTable TryLoad(string path)
+        {
+            if (unavailable) return null;
+
+            try
+            {
+                return Load(path);
+            }
+            catch (Exception ex) when (ex is DllNotFoundException || ex is EntryPointNotFoundException || ex is BadImageFormatException)
+            {
+                unavailable = true;
+                return null;
+            }
+        }
+
+        private static DataTable Load(string path)
+        {
+            byte[] utf8Path = NativeColumnStore.ToUtf8(path);
+
+            // First call sizes the key buffer, second one fills it
+            long keysLength = rtulog_parse_probe(utf8Path, out ulong records, null, UIntPtr.Zero);
+            if (keysLength < 0 || records > int.MaxValue) return null;
+            var keyBuffer = new byte[keysLength + 1];
+            rtulog_parse_probe(utf8Path, out records, keyBuffer, (UIntPtr)keyBuffer.Length);
+
+            string[] keys = keysLength > 0
+                ? Encoding.UTF8.GetString(keyBuffer, 0, (int)keysLength).Split('\n')
+                : new string[0];
+
+            int capacity = (int)records;
+            var timestamps = new long[capacity];
+            var columns = new float[keys.Length][];
+            var handles = new GCHandle[keys.Length * 2];
+            long rows;
+
+            try
+            {
+                var keyPointers = new IntPtr[keys.Length];
+                var columnPointers = new IntPtr[keys.Length];
+                for (int i = 0; i < keys.Length; i++)
+                {
+                    columns[i] = new float[capacity];
+                    handles[2 * i] = GCHandle.Alloc(NativeColumnStore.ToUtf8(keys[i]), GCHandleType.Pinned);
+                    handles[2 * i + 1] = GCHandle.Alloc(columns[i], GCHandleType.Pinned);
+                    keyPointers[i] = handles[2 * i].AddrOfPinnedObject();
+                    columnPointers[i] = handles[2 * i + 1].AddrOfPinnedObject();
+                }
+
+                rows = rtulog_parse_file(utf8Path, keyPointers, (uint)keys.Length, timestamps, columnPointers, (ulong)capacity, 0);
+            }
+            finally
+            {
+                foreach (var h in handles)
+                    if (h.IsAllocated) h.Free();
+            }
+
+            if (rows < 0) return null;
+
+            var table = new DataTable();
+            table.Columns.Add("timestamp", typeof(string));
+            foreach (var key in keys)
+                table.Columns.Add(key, typeof(double));
+
+            table.BeginLoadData();
+            var items = new object[keys.Length + 1];
+            for (int r = 0; r < rows; r++)
+            {
+                DateTime t = NativeColumnStore.ToDateTime(timestamps[r]);
+                items[0] = t.Millisecond != 0
+                    ? t.ToString("yyyy-MM-dd HH:mm:ss.fff")
+                    : t.ToString("yyyy-MM-dd HH:mm:ss");
+
+                for (int c = 0; c < keys.Length; c++)
+                {
+                    float v = columns[c][r];
+                    items[c + 1] = float.IsNaN(v) ? 0.0 : (double)v;
+                }
+                table.Rows.Add(items);
+            }
+            table.EndLoadData();
+
+            return table;
+        }
+    }
+}
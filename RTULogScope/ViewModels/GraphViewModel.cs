@@ -43,11 +43,15 @@ namespace RTULogScope.ViewModels
         // Table holding all loaded measurement data
         private DataTable data;
 
+        // Memory-mapped columnar store (alternative to the DataTable, see LoadColumnStore)
+        private NativeColumnStore store;
+
         /// <summary>
         /// Loads a single CSV file and populates the Measurements collection.
         /// </summary>
         public void LoadCsv(string path)
         {
+            CloseStore();
             data = JsonLogLoader.Load(path);
             Measurements.Clear();
 
@@ -75,6 +79,7 @@ namespace RTULogScope.ViewModels
         /// </summary>
         public void LoadMultipleCsvs(string[] paths)
         {
+            CloseStore();
             var merged = new DataTable();
 
             foreach (var path in paths)
@@ -125,32 +130,52 @@ namespace RTULogScope.ViewModels
             UpdatePlot();
         }
 
+        /// <summary>
+        /// Opens a columnar store exported by rtulog-export (.rtc).
+        /// The file is memory-mapped; no text parsing takes place.
+        /// </summary>
+        public void LoadColumnStore(string path)
+        {
+            CloseStore();
+            store = NativeColumnStore.Open(path);
+            data = null;
+
+            Measurements.Clear();
+            foreach (var key in store.Keys)
+            {
+                var item = new SelectableItem<string>(key);
+                item.SelectionChanged += (_, __) => UpdatePlot();
+                Measurements.Add(item);
+            }
+
+            UpdatePlot();
+        }
+
+        /// <summary>
+        /// Releases the mapped columnar store, if any.
+        /// </summary>
+        private void CloseStore()
+        {
+            store?.Dispose();
+            store = null;
+        }
+
         /// <summary>
         /// Rebuilds the plot and statistics based on selected measurements.
         /// </summary>
         public void UpdatePlot()
         {
+            if (store != null)
+            {
+                UpdatePlotFromStore();
+                return;
+            }
+
             if (data == null) return;
 
             var selected = Measurements.Where(m => m.IsSelected).ToList();
 
-            PlotModel.Series.Clear();
-            PlotModel.Axes.Clear();
-
-            PlotModel.Axes.Add(new DateTimeAxis
-            {
-                Position = AxisPosition.Bottom,
-                Title = "Time",
-                StringFormat = "HH:mm:ss",
-                IsZoomEnabled = true,
-                IsPanEnabled = true
-            });
-
-            PlotModel.Axes.Add(new LinearAxis
-            {
-                Position = AxisPosition.Left,
-                Title = "Value"
-            });
+            ResetAxes();
 
             foreach (var item in selected)
             {
@@ -207,6 +232,77 @@ namespace RTULogScope.ViewModels
             PlotModel.InvalidatePlot(true);
         }
 
+        /// <summary>
+        /// Plots the selected columns of the mapped store. Samples without a value
+        /// (NaN) leave a gap in the line.
+        /// </summary>
+        private void UpdatePlotFromStore()
+        {
+            var selected = Measurements.Where(m => m.IsSelected).ToList();
+            ResetAxes();
+
+            var statLines = new List<string>();
+            double[] times = null;
+
+            foreach (var item in selected)
+            {
+                int column = store.IndexOf(item.Value);
+                if (column < 0) continue;
+
+                if (times == null)
+                    times = store.ReadTimestamps().Select(ms => DateTimeAxis.ToDouble(NativeColumnStore.ToDateTime(ms))).ToArray();
+
+                float[] values = store.ReadColumn(column);
+                var series = new LineSeries { Title = item.Value };
+                double min = double.MaxValue, max = double.MinValue, sum = 0;
+                int count = 0;
+
+                for (int i = 0; i < values.Length; i++)
+                {
+                    double v = values[i];
+                    series.Points.Add(new DataPoint(times[i], v));   // NaN → gap
+                    if (double.IsNaN(v)) continue;
+
+                    min = Math.Min(min, v);
+                    max = Math.Max(max, v);
+                    sum += v;
+                    count++;
+                }
+
+                PlotModel.Series.Add(series);
+                if (count > 0)
+                    statLines.Add($"{item.Value}: Min = {min:F2} | Max = {max:F2} | Avg = {sum / count:F2}");
+            }
+
+            StatsSummary = string.Join("\n", statLines);
+
+            PlotModel.InvalidatePlot(true);
+        }
+
+        /// <summary>
+        /// Clears series and recreates the time and value axes.
+        /// </summary>
+        private void ResetAxes()
+        {
+            PlotModel.Series.Clear();
+            PlotModel.Axes.Clear();
+
+            PlotModel.Axes.Add(new DateTimeAxis
+            {
+                Position = AxisPosition.Bottom,
+                Title = "Time",
+                StringFormat = "HH:mm:ss",
+                IsZoomEnabled = true,
+                IsPanEnabled = true
+            });
+
+            PlotModel.Axes.Add(new LinearAxis
+            {
+                Position = AxisPosition.Left,
+                Title = "Value"
+            });
+        }
+
         /// <summary>
         /// Raises the PropertyChanged event for data binding.
         /// </summary>
@@ -30,7 +30,7 @@ namespace RTULogScope.Views
         {
             var dialog = new OpenFileDialog
             {
-                Filter = "CSV files (*.csv)|*.csv",
+                Filter = "CSV files (*.csv)|*.csv|Compressed day files (*.lz)|*.lz|Columnar store (*.rtc)|*.rtc",
                 InitialDirectory = AppDomain.CurrentDomain.BaseDirectory,
                 Multiselect = true,
                 Title = "Select one or more CSV files"
@@ -40,7 +40,10 @@ namespace RTULogScope.Views
             {
                 try
                 {
-                    ViewModel.LoadMultipleCsvs(dialog.FileNames);
+                    if (string.Equals(Path.GetExtension(dialog.FileNames[0]), ".rtc", StringComparison.OrdinalIgnoreCase))
+                        ViewModel.LoadColumnStore(dialog.FileNames[0]);
+                    else
+                        ViewModel.LoadMultipleCsvs(dialog.FileNames);
 
                     // Set window title based on first loaded file
                     string fileName = Path.GetFileName(dialog.FileNames[0]);
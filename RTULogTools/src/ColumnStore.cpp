@@ -0,0 +1,222 @@
+#include "ColumnStore.h"
+#include "FileUtil.h"
+#include "LogReader.h"
+#include "RecordParser.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+
+using namespace ColumnFormat;
+
+static uint64_t alignUp(uint64_t v) {
+    return (v + kAlignment - 1) & ~static_cast<uint64_t>(kAlignment - 1);
+}
+
+void ColumnStoreWriter::beginRow(int64_t timestampMs) {
+    timestamps.push_back(timestampMs);
+    for (auto& col : data) col.push_back(NAN);
+}
+
+/// <summary>
+/// Looks the key up (adding a column on first sight) and stores the value in the current row.
+/// </summary>
+void ColumnStoreWriter::setValue(const char* key, size_t keyLength, const char* unit, size_t unitLength, float value) {
+    if (timestamps.empty()) return;
+
+    keyScratch.assign(key, keyLength);
+    auto it = columnOf.find(keyScratch);
+    size_t column;
+    if (it == columnOf.end()) {
+        column = keys.size();
+        columnOf.emplace(keyScratch, column);
+        keys.push_back(keyScratch);
+        units.push_back(unit ? std::string(unit, unitLength) : std::string());
+        data.emplace_back(timestamps.size(), NAN);
+    } else {
+        column = it->second;
+    }
+    data[column].back() = value;
+}
+
+/// <summary>
+/// Streams a log file through the record parser into rows.
+/// </summary>
+bool ColumnStoreWriter::addLogFile(const std::string& path) {
+    LogReader reader;
+    if (!reader.open(path)) {
+        lastError = reader.error();
+        return false;
+    }
+
+    std::vector<RecordValue> values;
+    reader.readAll([&](const LogRecord& rec) {
+        int64_t ts;
+        if (!RecordParser::parse(rec.json, rec.length, ts, values)) {
+            skipped++;
+            return true;
+        }
+        beginRow(ts);
+        for (const auto& v : values) setValue(v.key, v.keyLength, v.unit, v.unitLength, v.value);
+        return true;
+    });
+    return true;
+}
+
+/// <summary>
+/// Orders rows by time, then writes header, directory and arrays to a temporary
+/// file that replaces the target only once complete.
+/// </summary>
+bool ColumnStoreWriter::write(const std::string& path) {
+    for (const auto& key : keys) {
+        if (key.size() >= kKeySize) {
+            lastError = "register key too long for column directory: " + key;
+            return false;
+        }
+    }
+
+    if (!std::is_sorted(timestamps.begin(), timestamps.end())) {
+        std::vector<size_t> order(timestamps.size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::stable_sort(order.begin(), order.end(),
+                         [&](size_t a, size_t b) { return timestamps[a] < timestamps[b]; });
+
+        std::vector<int64_t> t(order.size());
+        for (size_t i = 0; i < order.size(); ++i) t[i] = timestamps[order[i]];
+        timestamps.swap(t);
+
+        std::vector<float> tmp(order.size());
+        for (auto& col : data) {
+            for (size_t i = 0; i < order.size(); ++i) tmp[i] = col[order[i]];
+            col.swap(tmp);
+        }
+    }
+
+    const uint64_t rows = timestamps.size();
+    FileHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrderMark = kByteOrderMark;
+    header.rowCount = rows;
+    header.columnCount = static_cast<uint32_t>(keys.size());
+    header.headerSize = sizeof(FileHeader);
+    header.directoryOffset = sizeof(FileHeader);
+    header.timestampOffset = alignUp(header.directoryOffset + keys.size() * sizeof(DirectoryEntry));
+    header.firstMs = rows ? timestamps.front() : 0;
+    header.lastMs = rows ? timestamps.back() : 0;
+
+    std::vector<DirectoryEntry> directory(keys.size());
+    uint64_t offset = alignUp(header.timestampOffset + rows * sizeof(int64_t));
+    for (size_t i = 0; i < keys.size(); ++i) {
+        DirectoryEntry& e = directory[i];
+        std::memset(&e, 0, sizeof(e));
+        std::memcpy(e.key, keys[i].data(), keys[i].size());
+        std::memcpy(e.unit, units[i].data(), std::min(units[i].size(), kUnitSize - 1));
+        e.dataOffset = offset;
+        offset = alignUp(offset + rows * sizeof(float));
+    }
+
+    std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) {
+        lastError = "cannot create " + tmp;
+        return false;
+    }
+
+    static const uint8_t zeros[kAlignment] = {};
+    uint64_t pos = 0;
+    bool ok = true;
+    auto put = [&](const void* p, uint64_t n) {
+        ok = ok && std::fwrite(p, 1, static_cast<size_t>(n), f) == n;
+        pos += n;
+    };
+    auto padTo = [&](uint64_t target) { put(zeros, target - pos); };
+
+    put(&header, sizeof(header));
+    put(directory.data(), directory.size() * sizeof(DirectoryEntry));
+    padTo(header.timestampOffset);
+    put(timestamps.data(), rows * sizeof(int64_t));
+    for (size_t i = 0; i < data.size(); ++i) {
+        padTo(directory[i].dataOffset);
+        put(data[i].data(), rows * sizeof(float));
+    }
+
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok || !FileUtil::commitTemp(tmp, path)) {
+        std::remove(tmp.c_str());
+        lastError = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// Maps the file and checks that every array lies inside it.
+/// </summary>
+bool ColumnStore::open(const std::string& path) {
+    close();
+    if (!file.open(path)) {
+        lastError = "cannot map " + path;
+        return false;
+    }
+
+    const uint8_t* base = file.data();
+    const uint64_t size = file.size();
+    const FileHeader* h = reinterpret_cast<const FileHeader*>(base);
+    if (size < sizeof(FileHeader) || std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 ||
+        h->version != kVersion || h->byteOrderMark != kByteOrderMark || h->headerSize != sizeof(FileHeader)) {
+        lastError = path + " is not a column store (or has an incompatible version)";
+        file.close();
+        return false;
+    }
+
+    bool ok = h->directoryOffset + static_cast<uint64_t>(h->columnCount) * sizeof(DirectoryEntry) <= size &&
+              h->timestampOffset % kAlignment == 0 &&
+              h->timestampOffset + h->rowCount * sizeof(int64_t) <= size;
+    const DirectoryEntry* dir = reinterpret_cast<const DirectoryEntry*>(base + h->directoryOffset);
+    for (uint32_t i = 0; ok && i < h->columnCount; ++i) {
+        ok = dir[i].dataOffset % kAlignment == 0 && dir[i].dataOffset + h->rowCount * sizeof(float) <= size &&
+             std::memchr(dir[i].key, 0, kKeySize) && std::memchr(dir[i].unit, 0, kUnitSize);
+    }
+    if (!ok) {
+        lastError = path + " is truncated or corrupt";
+        file.close();
+        return false;
+    }
+
+    header = h;
+    directory = dir;
+    times = reinterpret_cast<const int64_t*>(base + h->timestampOffset);
+    return true;
+}
+
+void ColumnStore::close() {
+    file.close();
+    header = nullptr;
+    directory = nullptr;
+    times = nullptr;
+}
+
+const char* ColumnStore::columnKey(uint32_t column) const {
+    return column < columnCount() ? directory[column].key : nullptr;
+}
+
+const char* ColumnStore::columnUnit(uint32_t column) const {
+    return column < columnCount() ? directory[column].unit : nullptr;
+}
+
+const float* ColumnStore::column(uint32_t column) const {
+    return column < columnCount() ? reinterpret_cast<const float*>(file.data() + directory[column].dataOffset) : nullptr;
+}
+
+int ColumnStore::findColumn(const char* key) const {
+    for (uint32_t i = 0; i < columnCount(); ++i) {
+        if (std::strcmp(directory[i].key, key) == 0) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+uint64_t ColumnStore::lowerBound(int64_t t) const {
+    return static_cast<uint64_t>(std::lower_bound(times, times + rowCount(), t) - times);
+}
@@ -0,0 +1,145 @@
+#ifndef COLUMN_STORE_H
+#define COLUMN_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "MappedFile.h"
+
+/// <summary>
+/// Columnar, memory-mappable export of logger data (".rtc" files).
+///
+/// Layout (little endian, every array aligned to 64 bytes):
+///   header      64 bytes  magic "RTUCOLS1", version, byte order mark, row/column counts,
+///                         offsets, first/last timestamp
+///   directory   64 bytes per column: key[40] (NUL padded), unit[16], uint64 data offset
+///   timestamps  int64[rows], epoch milliseconds, ascending
+///   columns     float[rows] per column, NAN where a record had no value for the key
+///
+/// Readers map the file and use the arrays in place, nothing is parsed.
+/// </summary>
+namespace ColumnFormat {
+
+constexpr char kMagic[8] = { 'R', 'T', 'U', 'C', 'O', 'L', 'S', '1' };
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kByteOrderMark = 0x01020304;
+constexpr size_t kAlignment = 64;
+constexpr size_t kKeySize = 40;
+constexpr size_t kUnitSize = 16;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint64_t rowCount;
+    uint32_t columnCount;
+    uint32_t headerSize;            ///< sizeof(FileHeader)
+    uint64_t directoryOffset;
+    uint64_t timestampOffset;
+    int64_t firstMs;
+    int64_t lastMs;
+};
+
+struct DirectoryEntry {
+    char key[kKeySize];
+    char unit[kUnitSize];
+    uint64_t dataOffset;
+};
+
+static_assert(sizeof(FileHeader) == 64, "FileHeader must stay 64 bytes");
+static_assert(sizeof(DirectoryEntry) == 64, "DirectoryEntry must stay 64 bytes");
+
+} // namespace ColumnFormat
+
+/// <summary>
+/// Accumulates records in memory and writes a columnar file.
+/// Columns are created on first sight of a key; earlier rows get NAN.
+/// </summary>
+class ColumnStoreWriter {
+public:
+    /// <summary>
+    /// Starts a new row.
+    /// </summary>
+    void beginRow(int64_t timestampMs);
+
+    /// <summary>
+    /// Sets a value of the current row.
+    /// </summary>
+    void setValue(const char* key, size_t keyLength, const char* unit, size_t unitLength, float value);
+
+    /// <summary>
+    /// Adds every record of a log file (NDJSON or framed).
+    /// </summary>
+    /// <returns>False if the file cannot be read (see error())</returns>
+    bool addLogFile(const std::string& path);
+
+    /// <summary>
+    /// Sorts rows by time (stable, skipped if already ordered) and writes the file.
+    /// </summary>
+    /// <returns>False on I/O or format errors (see error())</returns>
+    bool write(const std::string& path);
+
+    size_t rows() const { return timestamps.size(); }
+    size_t columns() const { return keys.size(); }
+    size_t skippedRecords() const { return skipped; }
+    const std::string& error() const { return lastError; }
+
+private:
+    std::vector<int64_t> timestamps;
+    std::vector<std::vector<float>> data;
+    std::vector<std::string> keys;
+    std::vector<std::string> units;
+    std::unordered_map<std::string, size_t> columnOf;
+    std::string keyScratch;
+    size_t skipped = 0;
+    std::string lastError;
+};
+
+/// <summary>
+/// Read-only view of a mapped columnar file.
+/// </summary>
+class ColumnStore {
+public:
+    /// <summary>
+    /// Maps and validates a file.
+    /// </summary>
+    /// <returns>False if the file is missing, truncated or not a column store (see error())</returns>
+    bool open(const std::string& path);
+
+    void close();
+
+    uint64_t rowCount() const { return header ? header->rowCount : 0; }
+    uint32_t columnCount() const { return header ? header->columnCount : 0; }
+    const int64_t* timestamps() const { return times; }
+
+    /// <summary>
+    /// Returns the key, unit and values of a column (nullptr if out of range).
+    /// </summary>
+    const char* columnKey(uint32_t column) const;
+    const char* columnUnit(uint32_t column) const;
+    const float* column(uint32_t column) const;
+
+    /// <summary>
+    /// Finds a column by key.
+    /// </summary>
+    /// <returns>Column index, or -1</returns>
+    int findColumn(const char* key) const;
+
+    /// <summary>
+    /// Returns the first row with timestamp >= t.
+    /// </summary>
+    uint64_t lowerBound(int64_t t) const;
+
+    const std::string& error() const { return lastError; }
+
+private:
+    MappedFile file;
+    const ColumnFormat::FileHeader* header = nullptr;
+    const ColumnFormat::DirectoryEntry* directory = nullptr;
+    const int64_t* times = nullptr;
+    std::string lastError;
+};
+
+#endif // COLUMN_STORE_H
@@ -0,0 +1,293 @@
+#include "FastRecordParser.h"
+#include "RecordParser.h"
+#include "SimdScan.h"
+#include "TimestampFormatter.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static const size_t MAX_FAST_RECORD = 8192;   // Larger records take the scalar path
+
+static const float POW10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+/// <summary>
+/// Plain decimals ("-12.345") with at most 24 significant bits and 10 fraction digits are
+/// exact as mantissa / 10^n, and one IEEE division rounds correctly, so the result equals
+/// from_chars. Everything else (exponents, long mantissas, null) goes to from_chars.
+/// </summary>
+static float parseFloat(const char* a, const char* b) {
+    const char* p = a;
+    bool negative = (p < b && *p == '-');
+    if (negative) ++p;
+
+    uint32_t mantissa = 0;
+    int fraction = -1;
+    const char* digits = p;
+    for (; p < b; ++p) {
+        unsigned d = static_cast<unsigned>(*p - '0');
+        if (d < 10) {
+            mantissa = mantissa * 10 + d;
+            if (mantissa >= (1u << 24)) break;
+            if (fraction >= 0) fraction++;
+        } else if (*p == '.' && fraction < 0) {
+            fraction = 0;
+        } else {
+            break;
+        }
+    }
+    if (p == b && p != digits && fraction != 0 && fraction <= 10 && digits[0] != '.') {
+        float v = static_cast<float>(mantissa);
+        if (fraction > 0) v /= POW10[fraction];
+        return negative ? -v : v;
+    }
+
+    float v;
+    auto r = std::from_chars(a, b, v);
+    return (r.ec == std::errc() && r.ptr == b) ? v : NAN;
+}
+
+KeyMap::KeyMap(const std::vector<std::string>& k) : keys(k) {}
+
+/// <summary>
+/// Checks the cached slot of the position first (one compare), searches the key list on a miss.
+/// </summary>
+int KeyMap::lookup(size_t position, const char* key, size_t length) {
+    if (position < cache.size()) {
+        const Slot& slot = cache[position];
+        const std::string& cached = slot.column >= 0 ? keys[static_cast<size_t>(slot.column)] : slot.unknown;
+        if (slot.valid && cached.size() == length && std::memcmp(cached.data(), key, length) == 0) {
+            return slot.column;
+        }
+    }
+
+    int column = -1;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i].size() == length && std::memcmp(keys[i].data(), key, length) == 0) {
+            column = static_cast<int>(i);
+            break;
+        }
+    }
+    if (position < 1024) {
+        if (position >= cache.size()) cache.resize(position + 1);
+        Slot& slot = cache[position];
+        slot.valid = true;
+        slot.column = column;
+        if (column < 0) slot.unknown.assign(key, length);
+    }
+    return column;
+}
+
+namespace {
+
+/// <summary>
+/// Token positions of one record plus accessors for the stage 2 walk.
+/// </summary>
+struct Tokens {
+    const char* json;
+    size_t length;
+    uint16_t pos[MAX_FAST_RECORD + 1];
+    size_t count;
+
+    char at(size_t t) const { return t < count ? json[pos[t]] : '\0'; }
+
+    /// <summary>
+    /// String whose opening quote is token t and closing quote token t+1
+    /// (no escapes, checked in stage 1). Advances t past both.
+    /// </summary>
+    bool string(size_t& t, const char*& s, size_t& n) const {
+        if (at(t) != '"' || t + 1 >= count) return false;
+        s = json + pos[t] + 1;
+        n = static_cast<size_t>(pos[t + 1] - pos[t] - 1);
+        t += 2;
+        return true;
+    }
+
+    /// <summary>
+    /// Scalar (number, true, false, null) between token t-1 and token t.
+    /// </summary>
+    float number(size_t t) const {
+        const char* a = json + pos[t - 1] + 1;
+        const char* b = t < count ? json + pos[t] : json + length;
+        while (a < b && (*a == ' ' || *a == '\t')) ++a;
+        while (b > a && (b[-1] == ' ' || b[-1] == '\t' || b[-1] == '\r' || b[-1] == '\n')) --b;
+        return parseFloat(a, b);
+    }
+
+    /// <summary>
+    /// Skips the value starting at token t (strings and containers consume tokens, scalars do not).
+    /// </summary>
+    bool skip(size_t& t) const {
+        char c = at(t);
+        if (c == '"') {
+            t += 2;
+            return true;
+        }
+        if (c != '{' && c != '[') return true;
+        int depth = 0;
+        while (t < count) {
+            c = at(t++);
+            if (c == '"') {
+                t++;
+                continue;
+            }
+            if (c == '{' || c == '[') depth++;
+            if ((c == '}' || c == ']') && --depth == 0) return true;
+        }
+        return false;
+    }
+};
+
+bool nameIs(const char* s, size_t n, const char* name, size_t nameLen) {
+    return n == nameLen && std::memcmp(s, name, n) == 0;
+}
+
+/// <summary>
+/// Stage 1: collects structural token positions (every quote, operators outside strings).
+/// Returns false if the record needs the scalar path.
+/// </summary>
+bool tokenize(const char* json, size_t length, Tokens& tk) {
+    if (length > MAX_FAST_RECORD) return false;
+    tk.json = json;
+    tk.length = length;
+    tk.count = 0;
+
+    uint64_t carry = 0;   // All ones while a string spans the block boundary
+    alignas(64) uint8_t tail[SimdScan::kBlockSize];
+
+    for (size_t base = 0; base < length; base += SimdScan::kBlockSize) {
+        const uint8_t* block = reinterpret_cast<const uint8_t*>(json) + base;
+        if (length - base < SimdScan::kBlockSize) {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, length - base);
+            block = tail;
+        }
+
+        SimdScan::BlockMasks m = SimdScan::classify(block);
+        if (m.backslash) return false;
+
+        uint64_t inString = SimdScan::prefixXor(m.quote) ^ carry;
+        carry = static_cast<uint64_t>(0) - (inString >> 63);
+
+        uint64_t bits = (m.op & ~inString) | m.quote;
+        while (bits) {
+#if defined(_MSC_VER)
+            unsigned long i;
+            _BitScanForward64(&i, bits);
+#else
+            unsigned i = static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+            tk.pos[tk.count++] = static_cast<uint16_t>(base + i);
+            bits &= bits - 1;
+        }
+    }
+    return carry == 0;
+}
+
+} // namespace
+
+/// <summary>
+/// Stage 2: walks the token list of one record.
+/// </summary>
+bool FastRecordParser::parse(const char* json, size_t length, int64_t& timestampMs, KeyMap& map,
+                             float* const* columns, size_t row) {
+    thread_local Tokens tk;
+    if (!tokenize(json, length, tk)) return parseFallback(json, length, timestampMs, map, columns, row);
+
+    for (size_t c = 0; c < map.size(); ++c) columns[c][row] = NAN;
+
+    const char* s;
+    size_t n;
+    bool haveTime = false;
+    size_t t = 0;
+    if (tk.at(t++) != '{') return false;
+
+    for (;;) {
+        if (!tk.string(t, s, n) || tk.at(t++) != ':') return false;
+
+        if (nameIs(s, n, "timestamp", 9)) {
+            const char* ts;
+            size_t tsLen;
+            if (!tk.string(t, ts, tsLen) || !TimestampFormatter::parse(ts, tsLen, timestampMs)) return false;
+            haveTime = true;
+        } else if (nameIs(s, n, "values", 6)) {
+            if (tk.at(t++) != '[') return false;
+            size_t position = 0;
+            if (tk.at(t) == ']') {
+                t++;
+            } else {
+                for (;;) {
+                    if (tk.at(t++) != '{') return false;
+                    const char* key = nullptr;
+                    size_t keyLen = 0;
+                    float value = NAN;
+
+                    for (;;) {
+                        if (!tk.string(t, s, n) || tk.at(t++) != ':') return false;
+                        if (nameIs(s, n, "key", 3)) {
+                            if (!tk.string(t, key, keyLen)) return false;
+                        } else if (nameIs(s, n, "value", 5)) {
+                            if (tk.at(t) == '"') {
+                                t += 2;
+                            } else if (tk.at(t) == ',' || tk.at(t) == '}') {
+                                value = tk.number(t);
+                            } else {
+                                return false;
+                            }
+                        } else if (!tk.skip(t)) {
+                            return false;
+                        }
+
+                        char c = tk.at(t++);
+                        if (c == '}') break;
+                        if (c != ',') return false;
+                    }
+
+                    if (key) {
+                        int column = map.lookup(position, key, keyLen);
+                        if (column >= 0) columns[column][row] = value;
+                    }
+                    position++;
+
+                    char c = tk.at(t++);
+                    if (c == ']') break;
+                    if (c != ',') return false;
+                }
+            }
+        } else if (!tk.skip(t)) {
+            return false;
+        }
+
+        char c = tk.at(t++);
+        if (c == '}') return haveTime && t == tk.count;
+        if (c != ',') return false;
+    }
+}
+
+/// <summary>
+/// Scalar path for records with escapes or above the fast size limit.
+/// </summary>
+bool FastRecordParser::parseFallback(const char* json, size_t length, int64_t& timestampMs, KeyMap& map,
+                                     float* const* columns, size_t row) {
+    thread_local std::vector<RecordValue> values;
+    for (size_t c = 0; c < map.size(); ++c) columns[c][row] = NAN;
+    if (!RecordParser::parse(json, length, timestampMs, values)) return false;
+
+    for (size_t i = 0; i < values.size(); ++i) {
+        int column = map.lookup(i, values[i].key, values[i].keyLength);
+        if (column >= 0) columns[column][row] = values[i].value;
+    }
+    return true;
+}
+
+bool FastRecordParser::keysOf(const char* json, size_t length, std::vector<std::string>& keys) {
+    std::vector<RecordValue> values;
+    int64_t ts;
+    if (!RecordParser::parse(json, length, ts, values)) return false;
+    keys.clear();
+    for (const auto& v : values) keys.emplace_back(v.key, v.keyLength);
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef FAST_RECORD_PARSER_H
+#define FAST_RECORD_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Maps record keys to requested output columns.
+/// Records from one logger carry their keys in the same order, so the column
+/// found for each value position is cached and only verified (one compare) on later records.
+/// </summary>
+class KeyMap {
+public:
+    explicit KeyMap(const std::vector<std::string>& keys);
+
+    /// <summary>
+    /// Returns the output column for the key at a value position, or -1 if the key is not requested.
+    /// </summary>
+    int lookup(size_t position, const char* key, size_t length);
+
+    size_t size() const { return keys.size(); }
+
+private:
+    struct Slot {
+        bool valid = false;
+        int column = -1;
+        std::string unknown;     ///< Key text of a cached miss (column -1)
+    };
+
+    std::vector<std::string> keys;
+    std::vector<Slot> cache;
+};
+
+/// <summary>
+/// SIMD parser for the record shape StorageManager writes.
+///
+/// Stage 1 classifies the record 64 bytes at a time (quotes, backslashes and
+/// { } [ ] : , outside strings) into a list of token positions. Stage 2 walks
+/// those tokens for {"timestamp":..,"values":[{"key":..,"value":..,"unit":..},..]}
+/// and stores values straight into caller-provided column arrays. Floats and
+/// timestamps are parsed in place; nothing is allocated per record. Records with
+/// escape sequences or unusual size fall back to RecordParser.
+/// </summary>
+class FastRecordParser {
+public:
+    /// <summary>
+    /// Parses one record into row `row` of the output columns.
+    /// Columns without a value in the record receive NAN.
+    /// </summary>
+    /// <returns>False if the record is malformed or has no valid timestamp</returns>
+    static bool parse(const char* json, size_t length, int64_t& timestampMs, KeyMap& map,
+                      float* const* columns, size_t row);
+
+    /// <summary>
+    /// Returns the keys of a record in order (used to discover the schema).
+    /// </summary>
+    static bool keysOf(const char* json, size_t length, std::vector<std::string>& keys);
+
+private:
+    static bool parseFallback(const char* json, size_t length, int64_t& timestampMs, KeyMap& map,
+                              float* const* columns, size_t row);
+};
+
+#endif // FAST_RECORD_PARSER_H
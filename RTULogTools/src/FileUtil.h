@@ -0,0 +1,68 @@
+#ifndef FILE_UTIL_H
+#define FILE_UTIL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/// <summary>
+/// 64-bit safe stdio helpers shared by the host tools (Windows' long is 32 bits).
+/// </summary>
+namespace FileUtil {
+
+/// <summary>
+/// Seeks to an absolute offset.
+/// </summary>
+inline bool seek(std::FILE* f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(f, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+/// <summary>
+/// Returns the size of an open file and rewinds it.
+/// </summary>
+inline uint64_t sizeOf(std::FILE* f) {
+#ifdef _WIN32
+    _fseeki64(f, 0, SEEK_END);
+    uint64_t size = static_cast<uint64_t>(_ftelli64(f));
+#else
+    fseeko(f, 0, SEEK_END);
+    uint64_t size = static_cast<uint64_t>(ftello(f));
+#endif
+    std::rewind(f);
+    return size;
+}
+
+/// <summary>
+/// Moves a completely written temporary file over its final name.
+/// </summary>
+inline bool commitTemp(const std::string& tmp, const std::string& path) {
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+/// <summary>
+/// Writes a whole buffer to a new file via a temporary name and rename,
+/// so readers never see a half-written file.
+/// </summary>
+inline bool writeAtomically(const std::string& path, const void* data, size_t len) {
+    std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(data, 1, len, f) == len;
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return commitTemp(tmp, path);
+}
+
+} // namespace FileUtil
+
+#endif // FILE_UTIL_H
@@ -0,0 +1,201 @@
+#include "JsonValue.h"
+#include <cstdlib>
+#include <cstring>
+
+static const JsonValue& nullValue() {
+    static const JsonValue value;
+    return value;
+}
+
+/// <summary>
+/// Recursive descent over the text; nesting is limited so a hostile file
+/// cannot exhaust the stack.
+/// </summary>
+class JsonValue::Parser {
+public:
+    explicit Parser(const std::string& s) : p(s.c_str()), begin(s.c_str()), end(s.c_str() + s.size()) {}
+
+    bool document(JsonValue& out, std::string& error) {
+        bool ok = value(out, 0);
+        skipSpace();
+        if (ok && p != end) {
+            ok = false;
+            message = "unexpected data after the document";
+        }
+        if (!ok) error = message + " at byte " + std::to_string(p - begin);
+        return ok;
+    }
+
+private:
+    static constexpr int kMaxDepth = 64;
+
+    const char* p;
+    const char* begin;
+    const char* end;
+    std::string message;
+
+    bool fail(const char* what) {
+        message = what;
+        return false;
+    }
+
+    void skipSpace() {
+        while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+    }
+
+    bool literal(const char* word) {
+        size_t n = std::strlen(word);
+        if (static_cast<size_t>(end - p) < n || std::memcmp(p, word, n) != 0) return fail("invalid literal");
+        p += n;
+        return true;
+    }
+
+    static void appendUtf8(std::string& s, unsigned cp) {
+        if (cp < 0x80) {
+            s += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            s += static_cast<char>(0xC0 | (cp >> 6));
+            s += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            s += static_cast<char>(0xE0 | (cp >> 12));
+            s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            s += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            s += static_cast<char>(0xF0 | (cp >> 18));
+            s += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            s += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool hex4(unsigned& cp) {
+        if (end - p < 4) return fail("truncated \\u escape");
+        cp = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = *p++;
+            cp <<= 4;
+            if (c >= '0' && c <= '9') cp |= c - '0';
+            else if (c >= 'a' && c <= 'f') cp |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') cp |= c - 'A' + 10;
+            else return fail("invalid \\u escape");
+        }
+        return true;
+    }
+
+    bool string(std::string& out) {
+        ++p; // opening quote
+        out.clear();
+        while (p != end && *p != '"') {
+            char c = *p++;
+            if (static_cast<unsigned char>(c) < 0x20) return fail("control character in string");
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (p == end) break;
+            char e = *p++;
+            switch (e) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned cp;
+                    if (!hex4(cp)) return false;
+                    if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                        p += 2;
+                        unsigned low;
+                        if (!hex4(low)) return false;
+                        if (low < 0xDC00 || low > 0xDFFF) return fail("invalid surrogate pair");
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default: return fail("invalid escape");
+            }
+        }
+        if (p == end) return fail("unterminated string");
+        ++p;
+        return true;
+    }
+
+    bool value(JsonValue& out, int depth) {
+        if (depth > kMaxDepth) return fail("nesting too deep");
+        skipSpace();
+        if (p == end) return fail("unexpected end of input");
+
+        switch (*p) {
+            case 'n': out.type = Kind::Null; return literal("null");
+            case 't': out.type = Kind::Bool; out.boolean = true; return literal("true");
+            case 'f': out.type = Kind::Bool; out.boolean = false; return literal("false");
+            case '"': out.type = Kind::String; return string(out.text);
+            case '[': {
+                out.type = Kind::Array;
+                ++p;
+                skipSpace();
+                if (p != end && *p == ']') { ++p; return true; }
+                for (;;) {
+                    out.items.emplace_back();
+                    if (!value(out.items.back(), depth + 1)) return false;
+                    skipSpace();
+                    if (p != end && *p == ',') { ++p; continue; }
+                    if (p != end && *p == ']') { ++p; return true; }
+                    return fail("expected ',' or ']'");
+                }
+            }
+            case '{': {
+                out.type = Kind::Object;
+                ++p;
+                skipSpace();
+                if (p != end && *p == '}') { ++p; return true; }
+                for (;;) {
+                    skipSpace();
+                    if (p == end || *p != '"') return fail("expected member name");
+                    out.keys.emplace_back();
+                    if (!string(out.keys.back())) return false;
+                    skipSpace();
+                    if (p == end || *p != ':') return fail("expected ':'");
+                    ++p;
+                    out.items.emplace_back();
+                    if (!value(out.items.back(), depth + 1)) return false;
+                    skipSpace();
+                    if (p != end && *p == ',') { ++p; continue; }
+                    if (p != end && *p == '}') { ++p; return true; }
+                    return fail("expected ',' or '}'");
+                }
+            }
+            default: {
+                // strtod stops at the terminating NUL of the std::string at the latest
+                char* stop;
+                out.number = std::strtod(p, &stop);
+                if (stop == p) return fail("unexpected character");
+                out.type = Kind::Number;
+                p = stop;
+                return true;
+            }
+        }
+    }
+};
+
+bool JsonValue::parse(const std::string& text, JsonValue& out, std::string& error) {
+    out = JsonValue();
+    return Parser(text).document(out, error);
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const {
+    if (type != Kind::Object) return nullValue();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i] == key) return items[i];
+    }
+    return nullValue();
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+    if (type != Kind::Array || index >= items.size()) return nullValue();
+    return items[index];
+}
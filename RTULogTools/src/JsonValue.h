@@ -0,0 +1,61 @@
+#ifndef JSON_VALUE_H
+#define JSON_VALUE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Small JSON document tree for configuration files read by the host tools
+/// (log records go through the allocation-free RecordParser instead).
+/// Lookups of missing members or indices return a null value, so defaults
+/// can be chained like ArduinoJson's `doc["a"]["b"] | x` on the logger.
+/// </summary>
+class JsonValue {
+public:
+    enum class Kind { Null, Bool, Number, String, Array, Object };
+
+    /// <summary>
+    /// Parses a complete document.
+    /// </summary>
+    /// <param name="text">JSON text</param>
+    /// <param name="out">Receives the root value</param>
+    /// <param name="error">Receives a message with the byte offset on failure</param>
+    /// <returns>False if the text is not valid JSON</returns>
+    static bool parse(const std::string& text, JsonValue& out, std::string& error);
+
+    Kind kind() const { return type; }
+    bool isNull() const { return type == Kind::Null; }
+
+    /// <summary>
+    /// Member of an object (null value if missing or not an object).
+    /// </summary>
+    const JsonValue& operator[](const char* key) const;
+
+    /// <summary>
+    /// Element of an array (null value if out of range or not an array).
+    /// </summary>
+    const JsonValue& operator[](size_t index) const;
+    const JsonValue& operator[](int index) const { return (*this)[static_cast<size_t>(index)]; }
+
+    /// <summary>
+    /// Number of array elements or object members.
+    /// </summary>
+    size_t size() const { return items.size(); }
+
+    double asNumber(double fallback) const { return type == Kind::Number ? number : fallback; }
+    bool asBool(bool fallback) const { return type == Kind::Bool ? boolean : fallback; }
+    std::string asString(const std::string& fallback) const { return type == Kind::String ? text : fallback; }
+
+private:
+    class Parser;
+
+    Kind type = Kind::Null;
+    double number = 0.0;
+    bool boolean = false;
+    std::string text;
+    std::vector<std::string> keys;      ///< Object member names, parallel to items
+    std::vector<JsonValue> items;       ///< Array elements or object member values
+};
+
+#endif // JSON_VALUE_H
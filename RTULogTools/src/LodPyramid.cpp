@@ -0,0 +1,427 @@
+#include "LodPyramid.h"
+#include "FileUtil.h"
+#include "LogReader.h"
+#include "RecordParser.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace LodFormat;
+
+/// <summary>
+/// Floor division that also rounds negative times down.
+/// </summary>
+static int64_t bucketStart(int64_t t, int64_t width) {
+    int64_t q = t / width;
+    if (t % width < 0) --q;
+    return q * width;
+}
+
+static bool byStart(const LodBucket& b, int64_t t) {
+    return b.startMs < t;
+}
+
+static void addToBucket(LodBucket& b, int64_t t, float v) {
+    if (b.count == 0 || t < b.firstMs) { b.firstMs = t; b.first = v; }
+    if (b.count == 0 || t >= b.lastMs) { b.lastMs = t; b.last = v; }
+    if (b.count == 0 || v < b.min) { b.minMs = t; b.min = v; }
+    if (b.count == 0 || v > b.max) { b.maxMs = t; b.max = v; }
+    b.count++;
+}
+
+static void mergeBucket(LodBucket& into, const LodBucket& b) {
+    if (into.count == 0) {
+        int64_t start = into.startMs;
+        into = b;
+        into.startMs = start;
+        return;
+    }
+    if (b.firstMs < into.firstMs) { into.firstMs = b.firstMs; into.first = b.first; }
+    if (b.lastMs >= into.lastMs) { into.lastMs = b.lastMs; into.last = b.last; }
+    if (b.min < into.min) { into.minMs = b.minMs; into.min = b.min; }
+    if (b.max > into.max) { into.maxMs = b.maxMs; into.max = b.max; }
+    into.count += b.count;
+}
+
+static LodBucket emptyBucket(int64_t start) {
+    LodBucket b;
+    std::memset(&b, 0, sizeof(b));
+    b.startMs = start;
+    return b;
+}
+
+int64_t LodPyramid::levelWidthMs(uint32_t level) const {
+    int64_t w = base;
+    for (uint32_t i = 0; i < level; ++i) w *= factor;
+    return w;
+}
+
+int LodPyramid::findSeries(const std::string& key) const {
+    auto it = seriesOf.find(key);
+    return it == seriesOf.end() ? -1 : static_cast<int>(it->second);
+}
+
+void LodPyramid::reset(uint32_t baseMs, uint32_t fanout, bool framed) {
+    base = baseMs > 0 ? baseMs : kDefaultBaseMs;
+    factor = fanout > 1 ? fanout : kDefaultFanout;
+    framedSource = framed;
+    processed = 0;
+    series.clear();
+    seriesOf.clear();
+}
+
+size_t LodPyramid::seriesFor(const char* key, size_t keyLength, const char* unit, size_t unitLength) {
+    keyScratch.assign(key, keyLength);
+    auto it = seriesOf.find(keyScratch);
+    if (it != seriesOf.end()) return it->second;
+
+    size_t index = series.size();
+    series.emplace_back();
+    series.back().key = keyScratch;
+    series.back().unit = unit ? std::string(unit, unitLength) : std::string();
+    seriesOf.emplace(keyScratch, index);
+    return index;
+}
+
+/// <summary>
+/// Adds a sample to its level 0 bucket. Appending in time order is the common case;
+/// samples that step back in time (clock corrections, merged files) are inserted.
+/// </summary>
+void LodPyramid::addSample(Series& s, int64_t timeMs, float value) {
+    std::vector<LodBucket>& level0 = s.levels[0];
+    int64_t start = bucketStart(timeMs, base);
+
+    if (level0.empty() || level0.back().startMs < start) {
+        level0.push_back(emptyBucket(start));
+        addToBucket(level0.back(), timeMs, value);
+    } else if (level0.back().startMs == start) {
+        addToBucket(level0.back(), timeMs, value);
+    } else {
+        auto it = std::lower_bound(level0.begin(), level0.end(), start, byStart);
+        if (it == level0.end() || it->startMs != start) it = level0.insert(it, emptyBucket(start));
+        addToBucket(*it, timeMs, value);
+    }
+    s.dirtyFromMs = std::min(s.dirtyFromMs, start);
+}
+
+/// <summary>
+/// Recomputes the upper levels from the first changed bucket on; everything before stays.
+/// </summary>
+void LodPyramid::rebuildLevels(Series& s) {
+    if (s.dirtyFromMs == INT64_MAX) return;
+
+    for (uint32_t level = 1; level < kLevels; ++level) {
+        int64_t width = levelWidthMs(level);
+        int64_t from = bucketStart(s.dirtyFromMs, width);
+        std::vector<LodBucket>& upper = s.levels[level];
+        const std::vector<LodBucket>& lower = s.levels[level - 1];
+
+        upper.erase(std::lower_bound(upper.begin(), upper.end(), from, byStart), upper.end());
+        for (auto it = std::lower_bound(lower.begin(), lower.end(), from, byStart); it != lower.end(); ++it) {
+            int64_t start = bucketStart(it->startMs, width);
+            if (upper.empty() || upper.back().startMs != start) upper.push_back(emptyBucket(start));
+            mergeBucket(upper.back(), *it);
+        }
+    }
+    s.dirtyFromMs = INT64_MAX;
+}
+
+/// <summary>
+/// Resumes at the processed offset of a valid cache, otherwise starts over.
+/// </summary>
+bool LodPyramid::update(const std::string& logPath, uint32_t baseMs, uint32_t fanout) {
+    LogReader reader;
+    if (!reader.open(logPath)) {
+        lastError = reader.error();
+        return false;
+    }
+
+    const std::string lodPath = cachePath(logPath);
+    bool fresh = !load(lodPath) || base != baseMs || factor != fanout ||
+                 framedSource != reader.isFramed() || processed > reader.fileSize();
+    if (fresh) reset(baseMs, fanout, reader.isFramed());
+    lastError.clear();
+
+    const uint64_t before = processed;
+    std::vector<RecordValue> values;
+    reader.readFrom(processed, [&](const LogRecord& rec) {
+        processed = rec.endOffset;
+        int64_t ts;
+        if (!RecordParser::parse(rec.json, rec.length, ts, values)) return true;
+        for (const auto& v : values) {
+            if (std::isnan(v.value)) continue;
+            size_t index = seriesFor(v.key, v.keyLength, v.unit, v.unitLength);
+            addSample(series[index], ts, v.value);
+        }
+        return true;
+    });
+
+    for (auto& s : series) rebuildLevels(s);
+    return (fresh || processed != before) ? save(lodPath) : true;
+}
+
+bool LodPyramid::save(const std::string& lodPath) {
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrderMark = kByteOrderMark;
+    header.baseMs = base;
+    header.fanout = factor;
+    header.levelCount = kLevels;
+    header.seriesCount = static_cast<uint32_t>(series.size());
+    header.sourceBytes = processed;
+    header.framed = framedSource ? 1 : 0;
+    header.headerSize = sizeof(FileHeader);
+
+    std::vector<uint8_t> out(sizeof(header));
+    std::memcpy(out.data(), &header, sizeof(header));
+
+    std::vector<uint64_t> counts;
+    for (const auto& s : series) {
+        SeriesEntry e;
+        std::memset(&e, 0, sizeof(e));
+        std::memcpy(e.key, s.key.data(), std::min(s.key.size(), kKeySize - 1));
+        std::memcpy(e.unit, s.unit.data(), std::min(s.unit.size(), kUnitSize - 1));
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&e);
+        out.insert(out.end(), p, p + sizeof(e));
+        for (const auto& level : s.levels) counts.push_back(level.size());
+    }
+    const uint8_t* c = reinterpret_cast<const uint8_t*>(counts.data());
+    out.insert(out.end(), c, c + counts.size() * sizeof(uint64_t));
+
+    for (const auto& s : series) {
+        for (const auto& level : s.levels) {
+            const uint8_t* b = reinterpret_cast<const uint8_t*>(level.data());
+            out.insert(out.end(), b, b + level.size() * sizeof(LodBucket));
+        }
+    }
+
+    if (!FileUtil::writeAtomically(lodPath, out.data(), out.size())) {
+        lastError = "cannot write " + lodPath;
+        return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// Reads the whole cache and checks that every count fits the file size.
+/// </summary>
+bool LodPyramid::load(const std::string& lodPath) {
+    reset(kDefaultBaseMs, kDefaultFanout, false);
+
+    std::FILE* f = std::fopen(lodPath.c_str(), "rb");
+    if (!f) {
+        lastError = "cannot open " + lodPath;
+        return false;
+    }
+    std::vector<uint8_t> raw(static_cast<size_t>(FileUtil::sizeOf(f)));
+    size_t got = raw.empty() ? 0 : std::fread(raw.data(), 1, raw.size(), f);
+    std::fclose(f);
+
+    FileHeader header;
+    if (got < sizeof(header)) {
+        lastError = lodPath + ": truncated";
+        return false;
+    }
+    std::memcpy(&header, raw.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.byteOrderMark != kByteOrderMark || header.headerSize != sizeof(FileHeader) ||
+        header.levelCount != kLevels) {
+        lastError = lodPath + ": not a level-of-detail cache of this version";
+        return false;
+    }
+
+    size_t pos = sizeof(header);
+    size_t tableSize = static_cast<size_t>(header.seriesCount) * (sizeof(SeriesEntry) + kLevels * sizeof(uint64_t));
+    if (got - pos < tableSize) {
+        lastError = lodPath + ": truncated";
+        return false;
+    }
+
+    reset(header.baseMs, header.fanout, header.framed != 0);
+    const size_t countsPos = pos + header.seriesCount * sizeof(SeriesEntry);
+    size_t dataPos = countsPos + header.seriesCount * kLevels * sizeof(uint64_t);
+
+    for (uint32_t i = 0; i < header.seriesCount; ++i) {
+        SeriesEntry e;
+        std::memcpy(&e, raw.data() + pos + i * sizeof(SeriesEntry), sizeof(e));
+        e.key[kKeySize - 1] = '\0';
+        e.unit[kUnitSize - 1] = '\0';
+        size_t index = seriesFor(e.key, std::strlen(e.key), e.unit, std::strlen(e.unit));
+
+        for (uint32_t level = 0; level < kLevels; ++level) {
+            uint64_t count;
+            std::memcpy(&count, raw.data() + countsPos + (i * kLevels + level) * sizeof(uint64_t), sizeof(count));
+            if (count > (got - dataPos) / sizeof(LodBucket)) {
+                reset(kDefaultBaseMs, kDefaultFanout, false);
+                lastError = lodPath + ": truncated";
+                return false;
+            }
+            auto& buckets = series[index].levels[level];
+            buckets.resize(static_cast<size_t>(count));
+            std::memcpy(buckets.data(), raw.data() + dataPos, buckets.size() * sizeof(LodBucket));
+            dataPos += buckets.size() * sizeof(LodBucket);
+        }
+    }
+    processed = header.sourceBytes;
+    return true;
+}
+
+bool LodSet::add(const std::string& logPath, uint32_t baseMs, uint32_t fanout) {
+    LodPyramid pyramid;
+    if (!pyramid.update(logPath, baseMs, fanout)) {
+        lastError = pyramid.error();
+        return false;
+    }
+    logs.push_back(logPath);
+    pyramids.push_back(std::move(pyramid));
+    return true;
+}
+
+namespace {
+
+/// <summary>
+/// M4 aggregate of one pixel column.
+/// </summary>
+struct Column {
+    uint32_t count = 0;
+    LodPoint first, last, min, max;
+
+    void add(int64_t t, float v) {
+        if (count == 0 || t < first.timeMs) first = LodPoint{ t, v };
+        if (count == 0 || t >= last.timeMs) last = LodPoint{ t, v };
+        if (count == 0 || v < min.value) min = LodPoint{ t, v };
+        if (count == 0 || v > max.value) max = LodPoint{ t, v };
+        count++;
+    }
+};
+
+/// <summary>
+/// Per-pixel aggregation of one query.
+/// </summary>
+struct Raster {
+    int64_t fromMs;
+    int64_t toMs;
+    double pixelMs;
+    std::vector<Column> columns;
+
+    size_t pixelOf(int64_t t) const {
+        return std::min<size_t>(columns.size() - 1, static_cast<size_t>(static_cast<double>(t - fromMs) / pixelMs));
+    }
+
+    void add(int64_t t, float v) {
+        if (t < fromMs || t > toMs || std::isnan(v)) return;
+        columns[pixelOf(t)].add(t, v);
+    }
+
+    /// <summary>
+    /// True if all samples of the bucket fall into one pixel column inside the range,
+    /// so its four extreme points are exactly what that column needs.
+    /// </summary>
+    bool holds(const LodBucket& b) const {
+        return b.firstMs >= fromMs && b.lastMs <= toMs && pixelOf(b.firstMs) == pixelOf(b.lastMs);
+    }
+};
+
+/// <summary>
+/// Adds a bucket to the raster. Buckets that straddle a pixel edge (or the range end)
+/// are split into their children on the next finer level; at level 0 their time span
+/// is queued for a raw read.
+/// </summary>
+void addBucket(const LodPyramid& pyramid, size_t series, uint32_t level, const LodBucket& b, Raster& raster,
+               std::vector<std::pair<int64_t, int64_t>>& rawSpans) {
+    if (b.lastMs < raster.fromMs || b.firstMs > raster.toMs) return;
+    if (raster.holds(b)) {
+        raster.add(b.firstMs, b.first);
+        raster.add(b.minMs, b.min);
+        raster.add(b.maxMs, b.max);
+        raster.add(b.lastMs, b.last);
+        return;
+    }
+    if (level == 0) {
+        rawSpans.emplace_back(std::max(b.firstMs, raster.fromMs), std::min(b.lastMs, raster.toMs));
+        return;
+    }
+
+    const auto& children = pyramid.buckets(series, level - 1);
+    int64_t end = b.startMs + pyramid.levelWidthMs(level);
+    for (auto it = std::lower_bound(children.begin(), children.end(), b.startMs, byStart);
+         it != children.end() && it->startMs < end; ++it) {
+        addBucket(pyramid, series, level - 1, *it, raster, rawSpans);
+    }
+}
+
+/// <summary>
+/// Feeds the samples of one register inside the given spans (ascending) from a log file.
+/// </summary>
+void addRaw(const std::string& path, const std::string& key, const std::vector<std::pair<int64_t, int64_t>>& spans,
+            Raster& raster) {
+    LogReader reader;
+    if (spans.empty() || !reader.open(path)) return;
+
+    std::vector<RecordValue> values;
+    for (const auto& span : spans) {
+        reader.readRange(span.first, span.second, [&](const LogRecord& rec) {
+            int64_t ts;
+            if (!RecordParser::parse(rec.json, rec.length, ts, values)) return true;
+            for (const auto& v : values) {
+                if (v.keyLength == key.size() && std::memcmp(v.key, key.data(), v.keyLength) == 0) raster.add(ts, v.value);
+            }
+            return true;
+        });
+    }
+}
+
+} // namespace
+
+/// <summary>
+/// Feeds the four extreme points of every bucket that lies within one pixel column into
+/// per-pixel aggregates, refining buckets that straddle a column edge down to the raw
+/// samples, then emits first / min / max / last of each column in time order. The result
+/// is the same as M4 over the raw samples; raw reads are limited to about one level 0
+/// bucket per pixel edge.
+/// </summary>
+std::vector<LodPoint> LodSet::query(const std::string& key, int64_t fromMs, int64_t toMs, uint32_t pixels) const {
+    std::vector<LodPoint> points;
+    if (pixels == 0 || toMs <= fromMs || pyramids.empty()) return points;
+
+    Raster raster{ fromMs, toMs, static_cast<double>(toMs - fromMs) / pixels, std::vector<Column>(pixels) };
+
+    for (size_t i = 0; i < pyramids.size(); ++i) {
+        const LodPyramid& pyramid = pyramids[i];
+        int s = pyramid.findSeries(key);
+        if (s < 0) continue;
+
+        // Coarsest level with buckets no wider than a pixel; below level 0 read raw samples
+        int level = -1;
+        for (uint32_t l = 0; l < pyramid.levelCount(); ++l) {
+            if (static_cast<double>(pyramid.levelWidthMs(l)) <= raster.pixelMs) level = static_cast<int>(l);
+        }
+
+        std::vector<std::pair<int64_t, int64_t>> rawSpans;
+        if (level < 0) {
+            rawSpans.emplace_back(fromMs, toMs);
+        } else {
+            const auto& buckets = pyramid.buckets(static_cast<size_t>(s), static_cast<uint32_t>(level));
+            int64_t width = pyramid.levelWidthMs(static_cast<uint32_t>(level));
+            for (auto it = std::lower_bound(buckets.begin(), buckets.end(), fromMs - width + 1, byStart);
+                 it != buckets.end() && it->startMs <= toMs; ++it) {
+                addBucket(pyramid, static_cast<size_t>(s), static_cast<uint32_t>(level), *it, raster, rawSpans);
+            }
+        }
+        addRaw(logs[i], key, rawSpans, raster);
+    }
+
+    for (const auto& c : raster.columns) {
+        if (c.count == 0) continue;
+        LodPoint p[4] = { c.first, c.min, c.max, c.last };
+        std::stable_sort(p, p + 4, [](const LodPoint& a, const LodPoint& b) { return a.timeMs < b.timeMs; });
+        for (int i = 0; i < 4; ++i) {
+            if (i > 0 && p[i].timeMs == p[i - 1].timeMs && p[i].value == p[i - 1].value) continue;
+            points.push_back(p[i]);
+        }
+    }
+    return points;
+}
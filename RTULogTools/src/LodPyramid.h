@@ -0,0 +1,195 @@
+#ifndef LOD_PYRAMID_H
+#define LOD_PYRAMID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Level-of-detail cache of a log file ("<log file>.lod").
+///
+/// Every register gets a pyramid of time buckets: level 0 buckets are baseMs wide,
+/// each further level is fanout times wider. A bucket keeps first, last, minimum and
+/// maximum sample with their times, so any zoom level can be drawn from
+/// the level whose buckets are narrower than a pixel (M4 aggregation, see LodSet).
+///
+/// Layout (little endian):
+///   header      64 bytes  magic "RTULOD01", version, byte order mark, base width, fanout,
+///                         level count, series count, processed log bytes, framed flag
+///   directory   64 bytes per series: key[40] (NUL padded), unit[16], uint64 reserved
+///   counts      uint64[series * levels], buckets per series and level
+///   buckets     LodBucket[], series by series, level by level, ascending start time
+/// </summary>
+namespace LodFormat {
+
+constexpr char kMagic[8] = { 'R', 'T', 'U', 'L', 'O', 'D', '0', '1' };
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kByteOrderMark = 0x01020304;
+constexpr size_t kKeySize = 40;
+constexpr size_t kUnitSize = 16;
+constexpr uint32_t kLevels = 8;
+constexpr uint32_t kDefaultBaseMs = 10000;
+constexpr uint32_t kDefaultFanout = 8;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t baseMs;
+    uint32_t fanout;
+    uint32_t levelCount;
+    uint32_t seriesCount;
+    uint64_t sourceBytes;           ///< Log bytes already aggregated (resume offset)
+    uint32_t framed;
+    uint32_t headerSize;            ///< sizeof(FileHeader)
+    uint8_t reserved[16];
+};
+
+struct SeriesEntry {
+    char key[kKeySize];
+    char unit[kUnitSize];
+    uint64_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == 64, "FileHeader must stay 64 bytes");
+static_assert(sizeof(SeriesEntry) == 64, "SeriesEntry must stay 64 bytes");
+
+} // namespace LodFormat
+
+/// <summary>
+/// Aggregate of the samples of one register inside one time bucket.
+/// </summary>
+struct LodBucket {
+    int64_t startMs;         ///< Bucket start (multiple of the level width)
+    int64_t firstMs;
+    int64_t lastMs;
+    int64_t minMs;
+    int64_t maxMs;
+    float first;
+    float last;
+    float min;
+    float max;
+    uint32_t count;          ///< Number of samples
+    uint32_t reserved;
+};
+
+static_assert(sizeof(LodBucket) == 64, "LodBucket must stay 64 bytes");
+
+/// <summary>
+/// One point of a decimated series.
+/// </summary>
+struct LodPoint {
+    int64_t timeMs;
+    float value;
+};
+
+/// <summary>
+/// Pyramid of one log file, built from the log and kept in sync with it.
+/// </summary>
+class LodPyramid {
+public:
+    /// <summary>
+    /// Cache file name for a log file.
+    /// </summary>
+    static std::string cachePath(const std::string& logPath) { return logPath + ".lod"; }
+
+    /// <summary>
+    /// Loads the cache of a log file and aggregates whatever was appended to the log since,
+    /// or builds it from scratch if the cache is missing, stale or built with other widths.
+    /// Writes the cache back if anything changed.
+    /// </summary>
+    /// <returns>False if the log cannot be read or the cache cannot be written (see error())</returns>
+    bool update(const std::string& logPath, uint32_t baseMs = LodFormat::kDefaultBaseMs,
+                uint32_t fanout = LodFormat::kDefaultFanout);
+
+    /// <summary>
+    /// Reads a cache file without touching the log.
+    /// </summary>
+    bool load(const std::string& lodPath);
+
+    /// <summary>
+    /// Writes the cache file (temporary file plus rename).
+    /// </summary>
+    bool save(const std::string& lodPath);
+
+    size_t seriesCount() const { return series.size(); }
+    const std::string& key(size_t s) const { return series[s].key; }
+    const std::string& unit(size_t s) const { return series[s].unit; }
+
+    /// <summary>
+    /// Finds a series by register key.
+    /// </summary>
+    /// <returns>Series index, or -1</returns>
+    int findSeries(const std::string& key) const;
+
+    uint32_t levelCount() const { return LodFormat::kLevels; }
+
+    /// <summary>
+    /// Bucket width of a level in milliseconds.
+    /// </summary>
+    int64_t levelWidthMs(uint32_t level) const;
+
+    /// <summary>
+    /// Non-empty buckets of a series at a level, ascending by start time.
+    /// </summary>
+    const std::vector<LodBucket>& buckets(size_t s, uint32_t level) const { return series[s].levels[level]; }
+
+    uint64_t sourceBytes() const { return processed; }
+    const std::string& error() const { return lastError; }
+
+private:
+    struct Series {
+        std::string key;
+        std::string unit;
+        std::vector<LodBucket> levels[LodFormat::kLevels];
+        int64_t dirtyFromMs = INT64_MAX;     ///< Earliest level 0 change since the last rebuild
+    };
+
+    void reset(uint32_t baseMs, uint32_t fanout, bool framed);
+    size_t seriesFor(const char* key, size_t keyLength, const char* unit, size_t unitLength);
+    void addSample(Series& s, int64_t timeMs, float value);
+    void rebuildLevels(Series& s);
+
+    uint32_t base = LodFormat::kDefaultBaseMs;
+    uint32_t factor = LodFormat::kDefaultFanout;
+    bool framedSource = false;
+    uint64_t processed = 0;
+    std::vector<Series> series;
+    std::unordered_map<std::string, size_t> seriesOf;
+    std::string keyScratch;
+    std::string lastError;
+};
+
+/// <summary>
+/// Decimation queries over the pyramids of a set of log files (e.g. the day files of a week).
+/// </summary>
+class LodSet {
+public:
+    /// <summary>
+    /// Adds a log file, updating its cache first.
+    /// </summary>
+    /// <returns>False if the log cannot be read or its cache cannot be written (see error())</returns>
+    bool add(const std::string& logPath, uint32_t baseMs = LodFormat::kDefaultBaseMs,
+             uint32_t fanout = LodFormat::kDefaultFanout);
+
+    /// <summary>
+    /// Returns the points needed to draw one register over [fromMs, toMs] on a plot `pixels`
+    /// wide: per pixel column the first, minimum, maximum and last sample, in time order
+    /// (at most 4 * pixels points, identical to M4 over the raw samples). Buckets crossing a
+    /// pixel edge and ranges shorter than the finest bucket per pixel are read from the logs.
+    /// </summary>
+    std::vector<LodPoint> query(const std::string& key, int64_t fromMs, int64_t toMs, uint32_t pixels) const;
+
+    size_t size() const { return logs.size(); }
+    const LodPyramid& pyramid(size_t i) const { return pyramids[i]; }
+    const std::string& error() const { return lastError; }
+
+private:
+    std::vector<std::string> logs;
+    std::vector<LodPyramid> pyramids;
+    std::string lastError;
+};
+
+#endif // LOD_PYRAMID_H
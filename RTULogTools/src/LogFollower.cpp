@@ -0,0 +1,266 @@
+#include "LogFollower.h"
+#include "FileUtil.h"
+#include "LogFrame.h"
+#include "TimestampFormatter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+static const int kCheckIntervalMs = 250;       ///< Size check cadence without (or besides) inotify
+static const int64_t kLookBackDays = 7;        ///< How far back openFolder() looks for a day file
+
+/// <summary>
+/// Today's day number on the host's local clock, the best guess of the logger's day.
+/// </summary>
+static int64_t hostToday() {
+    std::time_t now = std::time(nullptr);
+    std::tm local;
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    return TimestampFormatter::daysFromCivil(local.tm_year + 1900, static_cast<unsigned>(local.tm_mon + 1),
+                                             static_cast<unsigned>(local.tm_mday));
+}
+
+static uint64_t sizeOnDisk(const std::string& path, bool& exists) {
+    std::error_code ec;
+    uint64_t size = static_cast<uint64_t>(std::filesystem::file_size(path, ec));
+    exists = !ec;
+    return ec ? 0 : size;
+}
+
+/// <summary>
+/// LogFrame::Reader on a stdio file.
+/// </summary>
+class StdioReader : public LogFrame::Reader {
+public:
+    explicit StdioReader(std::FILE* file) : file(file) {}
+
+    bool read(uint64_t offset, uint8_t* out, size_t len) override {
+        return FileUtil::seek(file, offset) && std::fread(out, 1, len, file) == len;
+    }
+
+private:
+    std::FILE* file;
+};
+
+/// <summary>
+/// Offset just past the last complete record, found in the file's tail window
+/// the way the logger's tail recovery does (last line break, last valid frame).
+/// </summary>
+static uint64_t completeEnd(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return 0;
+    uint64_t size = FileUtil::sizeOf(f);
+    uint8_t head[2] = {};
+    if (std::fread(head, 1, sizeof(head), f) != sizeof(head)) {
+        std::fclose(f);
+        return size;
+    }
+
+    std::vector<uint8_t> window;
+    if (head[0] == LogFrame::kMagic0) {
+        StdioReader reader(f);
+        LogFrame::RecoveryResult r = LogFrame::recoverTail(size, reader, window);
+        std::fclose(f);
+        return r.found ? r.validEnd : size;
+    }
+
+    uint64_t start = size > LogFrame::kRecoveryWindow ? size - LogFrame::kRecoveryWindow : 0;
+    window.resize(static_cast<size_t>(size - start));
+    bool ok = FileUtil::seek(f, start) && std::fread(window.data(), 1, window.size(), f) == window.size();
+    std::fclose(f);
+    if (!ok) return size;
+
+    for (size_t i = window.size(); i-- > 0;) {
+        if (window[i] == '\n') return start + i + 1;
+    }
+    return start == 0 ? 0 : size;
+}
+
+LogFollower::LogFollower() {
+#ifdef __linux__
+    notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+LogFollower::~LogFollower() {
+#ifdef __linux__
+    if (notifyFd >= 0) ::close(notifyFd);
+#endif
+}
+
+bool LogFollower::openFile(const std::string& file, bool fromStart) {
+    dayFiles = false;
+    follow(file, 0);
+    position = fromStart ? 0 : completeEnd(file);
+    return true;
+}
+
+bool LogFollower::openFolder(const std::string& folder, const std::string& filenameFormat, bool shardFolders,
+                             bool fromStart) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(folder, ec)) {
+        lastError = folder + " is not a folder";
+        return false;
+    }
+    dayFiles = true;
+    root = folder;
+    if (!root.empty() && root.back() != '/' && root.back() != '\\') root += '/';
+    format = filenameFormat;
+    shards = shardFolders;
+
+    // Today's file, else the newest of the last days (the logger's clock may lag)
+    int64_t today = hostToday();
+    int64_t start = today;
+    for (int64_t d = today + 1; d >= today - kLookBackDays; --d) {
+        bool exists;
+        sizeOnDisk(dayPath(d), exists);
+        if (exists) {
+            start = d;
+            break;
+        }
+    }
+    follow(dayPath(start), start);
+    position = fromStart ? 0 : completeEnd(path);
+    return true;
+}
+
+void LogFollower::follow(const std::string& file, int64_t dayNumber) {
+    reader.close();
+    readerOpen = false;
+    path = file;
+    day = dayNumber;
+    position = 0;
+}
+
+/// <summary>
+/// strftime on the day's civil date; the logger keeps local time in its clock,
+/// so the date is taken as is, without any time zone conversion.
+/// </summary>
+std::string LogFollower::dayPath(int64_t dayNumber) const {
+    int year;
+    unsigned month, mday;
+    TimestampFormatter::civilFromDays(dayNumber, year, month, mday);
+    std::tm tm = {};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = static_cast<int>(month) - 1;
+    tm.tm_mday = static_cast<int>(mday);
+    tm.tm_wday = static_cast<int>(((dayNumber % 7) + 11) % 7);      // 1970-01-01 was a Thursday
+    tm.tm_yday = static_cast<int>(dayNumber - TimestampFormatter::daysFromCivil(year, 1, 1));
+
+    char name[256];
+    size_t len = std::strftime(name, sizeof(name), format.c_str(), &tm);
+    std::string result = root;
+    if (shards) {
+        char shard[16];
+        std::snprintf(shard, sizeof(shard), "%04d/%02u/", year, month);
+        result += shard;
+    }
+    return result + std::string(name, len);
+}
+
+size_t LogFollower::drain(const LogReader::Callback& callback) {
+    bool exists;
+    uint64_t size = sizeOnDisk(path, exists);
+    size_t delivered = 0;
+
+    if (exists && size < position) {
+        // Replaced or cut below what was delivered: read the new content from the start
+        reader.close();
+        readerOpen = false;
+        position = 0;
+        ++restartCount;
+    }
+    if (exists && size > position) {
+        // The format is detected from the first bytes, so open once there are some
+        if (!readerOpen) readerOpen = reader.open(path);
+        if (readerOpen) {
+            reader.refresh();
+            bool stopped = false;
+            reader.readFrom(position, [&](const LogRecord& rec) {
+                position = rec.endOffset;
+                ++delivered;
+                stopped = !callback(rec);
+                return !stopped;
+            });
+            if (stopped || delivered > 0) return delivered;
+        }
+    }
+
+    // Nothing new here: the logger may have moved on to a later day file
+    if (!dayFiles) return delivered;
+    int64_t last = std::max(hostToday() + 1, day + 1);
+    for (int64_t d = day + 1; d <= last; ++d) {
+        std::string next = dayPath(d);
+        sizeOnDisk(next, exists);
+        if (exists) {
+            follow(next, d);
+            return drain(callback);
+        }
+    }
+    return delivered;
+}
+
+#ifdef __linux__
+
+/// <summary>
+/// Watches the folder of the followed file; any event wakes the caller, which
+/// then checks the file itself. The wait is capped so a new shard folder or a
+/// file on a mount without inotify support is still noticed.
+/// </summary>
+void LogFollower::waitForChange(int timeoutMs) {
+    int waitMs = std::min(timeoutMs, kCheckIntervalMs);
+    if (notifyFd < 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
+        return;
+    }
+
+    std::string folder = std::filesystem::path(path).parent_path().string();
+    if (folder.empty()) folder = ".";
+    if (folder != watchedFolder) {
+        if (watch >= 0) inotify_rm_watch(notifyFd, watch);
+        watch = inotify_add_watch(notifyFd, folder.c_str(),
+                                  IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_ATTRIB);
+        watchedFolder = watch >= 0 ? folder : std::string();   // Retried next time (folder may not exist yet)
+    }
+
+    pollfd p = {notifyFd, POLLIN, 0};
+    if (::poll(&p, 1, waitMs) > 0) {
+        char events[4096];
+        while (::read(notifyFd, events, sizeof(events)) > 0) {
+        }
+    }
+}
+
+#else
+
+void LogFollower::waitForChange(int timeoutMs) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeoutMs, kCheckIntervalMs)));
+}
+
+#endif
+
+size_t LogFollower::poll(int timeoutMs, const LogReader::Callback& callback) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        size_t delivered = drain(callback);
+        if (delivered > 0) return delivered;
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) return 0;
+        waitForChange(static_cast<int>(remaining));
+    }
+}
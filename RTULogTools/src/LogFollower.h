@@ -0,0 +1,116 @@
+#ifndef LOG_FOLLOWER_H
+#define LOG_FOLLOWER_H
+
+#include <cstdint>
+#include <string>
+#include "LogReader.h"
+
+/// <summary>
+/// Follows a log file that the logger is still writing (like tail -f) and
+/// delivers only the records appended since the previous call.
+///
+/// The follower keeps the byte offset just past the last complete record; a
+/// half-written line or frame at the end is left alone and read again, in
+/// full, once the rest has arrived. On Linux an inotify watch on the file's
+/// folder wakes it as soon as data is appended; elsewhere (and as a backstop
+/// for network and FUSE mounts) the size is checked every 250 ms.
+///
+/// Given a folder instead of a file it follows the day files the logger
+/// writes into it ("filename_format", optionally in YYYY/MM shard folders):
+/// it starts with today's file (or the newest of the last week) and moves on
+/// to the next existing day file once the current one has been read to the end.
+/// </summary>
+class LogFollower {
+public:
+    LogFollower();
+    ~LogFollower();
+    LogFollower(const LogFollower&) = delete;
+    LogFollower& operator=(const LogFollower&) = delete;
+
+    /// <summary>
+    /// Follows a single file from its current end, or from the start if fromStart is set.
+    /// The file need not exist yet.
+    /// </summary>
+    bool openFile(const std::string& path, bool fromStart = false);
+
+    /// <summary>
+    /// Follows the day files in a log folder.
+    /// </summary>
+    /// <param name="folder">Host path of the logger's output_folder</param>
+    /// <param name="filenameFormat">strftime pattern of the day files (logging.filename_format)</param>
+    /// <param name="shardFolders">Day files are in YYYY/MM sub-folders (logging.shard_folders)</param>
+    /// <param name="fromStart">Deliver the records already in the first file</param>
+    /// <returns>False if the folder does not exist (see error())</returns>
+    bool openFolder(const std::string& folder, const std::string& filenameFormat, bool shardFolders,
+                    bool fromStart = false);
+
+    /// <summary>
+    /// Delivers new records, waiting up to timeoutMs for some to arrive.
+    /// A callback returning false stops delivery; the remaining records come
+    /// with the next call.
+    /// </summary>
+    /// <returns>Number of records delivered (0 on timeout)</returns>
+    size_t poll(int timeoutMs, const LogReader::Callback& callback);
+
+    /// <summary>
+    /// File currently followed.
+    /// </summary>
+    const std::string& currentPath() const { return path; }
+
+    /// <summary>
+    /// Offset just past the last delivered record.
+    /// </summary>
+    uint64_t offset() const { return position; }
+
+    /// <summary>
+    /// Number of times the followed file shrank below the offset (replaced or truncated)
+    /// and was read again from the start.
+    /// </summary>
+    uint64_t restarts() const { return restartCount; }
+
+    const std::string& error() const { return lastError; }
+
+private:
+    /// <summary>
+    /// Delivers the complete records behind the offset, then moves to the next
+    /// day file if the current one has nothing new.
+    /// </summary>
+    size_t drain(const LogReader::Callback& callback);
+
+    /// <summary>
+    /// Switches to another file, starting at offset 0.
+    /// </summary>
+    void follow(const std::string& file, int64_t dayNumber);
+
+    /// <summary>
+    /// Path of the day file for a day number (days since 1970-01-01, logger clock).
+    /// </summary>
+    std::string dayPath(int64_t dayNumber) const;
+
+    /// <summary>
+    /// Blocks until the followed folder changes or timeoutMs passes.
+    /// </summary>
+    void waitForChange(int timeoutMs);
+
+    LogReader reader;
+    bool readerOpen = false;
+    std::string path;
+    uint64_t position = 0;
+    uint64_t restartCount = 0;
+
+    // Day file mode
+    bool dayFiles = false;
+    std::string root;
+    std::string format;
+    bool shards = false;
+    int64_t day = 0;
+
+    // Change notification (inotify descriptor and watch on Linux)
+    int notifyFd = -1;
+    int watch = -1;
+    std::string watchedFolder;
+
+    std::string lastError;
+};
+
+#endif // LOG_FOLLOWER_H
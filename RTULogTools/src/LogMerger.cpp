@@ -0,0 +1,488 @@
+#include "LogMerger.h"
+#include "ColumnStore.h"
+#include "FileUtil.h"
+#include "LogFrame.h"
+#include "LogReader.h"
+#include "RecordParser.h"
+#include "TimestampFormatter.h"
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <queue>
+
+static const size_t TRANSPOSE_BUDGET = 4 << 20;   // Bytes of rows per transpose block (.rtc output)
+
+/// <summary>
+/// Shortest text that reads back as the same float.
+/// </summary>
+static void appendValue(std::string& out, float value) {
+    char buf[32];
+    auto r = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, static_cast<size_t>(r.ptr - buf));
+}
+
+/// <summary>
+/// Timestamp with milliseconds only where the row has them.
+/// </summary>
+static void appendTimestamp(std::string& out, TimestampFormatter& formatter, int64_t timestampMs) {
+    char ts[TimestampFormatter::kMaxLength];
+    size_t len = formatter.format(timestampMs, ts, timestampMs % 1000 != 0);
+    out.append(ts, len);
+}
+
+namespace {
+
+/// <summary>
+/// Logger records, either one per line or framed exactly like StorageManager::appendRecord.
+/// </summary>
+class RecordSink : public MergeSink {
+public:
+    RecordSink(const std::string& p, bool f) : path(p), framed(f) {}
+    ~RecordSink() override {
+        if (!file) return;
+        std::fclose(file);
+        std::remove(tmp.c_str());      // Aborted merge
+    }
+
+    bool begin(const std::vector<std::string>& k, const std::vector<std::string>& u) override {
+        keys = &k;
+        units = &u;
+        tmp = path + ".tmp";
+        file = std::fopen(tmp.c_str(), "wb");
+        if (!file) lastError = "cannot create " + tmp;
+        return file != nullptr;
+    }
+
+    /// <summary>
+    /// Serializes {"timestamp":..,"values":[{"key":..,"value":..,"unit":..},...]}; NaN becomes null.
+    /// </summary>
+    bool row(int64_t timestampMs, const float* values, const uint8_t* present) override {
+        line.clear();
+        line += "{\"timestamp\":\"";
+        appendTimestamp(line, formatter, timestampMs);
+        line += "\",\"values\":[";
+        bool first = true;
+        for (size_t c = 0; c < keys->size(); ++c) {
+            if (!present[c]) continue;
+            line += first ? "{\"key\":\"" : ",{\"key\":\"";
+            first = false;
+            line += (*keys)[c];
+            line += "\",\"value\":";
+            if (std::isfinite(values[c])) {
+                appendValue(line, values[c]);
+            } else {
+                line += "null";
+            }
+            line += ",\"unit\":\"";
+            line += (*units)[c];
+            line += "\"}";
+        }
+        line += "]}";
+
+        if (!framed) {
+            line += '\n';
+            return put(line.data(), line.size());
+        }
+
+        if (line.size() > LogFrame::kMaxPayload) {
+            lastError = "merged record exceeds the frame payload limit";
+            return false;
+        }
+        if (bytesSinceSync >= LogFrame::kSyncInterval) {
+            if (!put(LogFrame::kSyncMarker, LogFrame::kSyncSize)) return false;
+            bytesSinceSync = 0;
+        }
+        uint8_t header[LogFrame::kHeaderSize];
+        uint8_t trailer[LogFrame::kTrailerSize];
+        LogFrame::encodeHeader(static_cast<uint16_t>(line.size()), header);
+        LogFrame::encodeTrailer(header, line.data(), line.size(), trailer);
+        bytesSinceSync += line.size() + LogFrame::kOverhead;
+        return put(header, sizeof(header)) && put(line.data(), line.size()) && put(trailer, sizeof(trailer));
+    }
+
+    bool finish() override {
+        bool ok = std::fclose(file) == 0;
+        file = nullptr;
+        if (!ok || !FileUtil::commitTemp(tmp, path)) {
+            std::remove(tmp.c_str());
+            lastError = "cannot write " + path;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool put(const void* p, size_t n) {
+        if (std::fwrite(p, 1, n, file) == n) return true;
+        lastError = "cannot write " + tmp;
+        return false;
+    }
+
+    std::string path;
+    std::string tmp;
+    bool framed;
+    std::FILE* file = nullptr;
+    const std::vector<std::string>* keys = nullptr;
+    const std::vector<std::string>* units = nullptr;
+    TimestampFormatter formatter;
+    std::string line;
+    uint32_t bytesSinceSync = 0;     // New file: the first frame follows without a marker
+};
+
+/// <summary>
+/// "timestamp,key,..." table; missing and null values are empty cells.
+/// </summary>
+class CsvSink : public MergeSink {
+public:
+    explicit CsvSink(const std::string& p) : path(p) {}
+    ~CsvSink() override {
+        if (!file) return;
+        std::fclose(file);
+        std::remove(tmp.c_str());      // Aborted merge
+    }
+
+    bool begin(const std::vector<std::string>& k, const std::vector<std::string>&) override {
+        keys = &k;
+        tmp = path + ".tmp";
+        file = std::fopen(tmp.c_str(), "wb");
+        if (!file) {
+            lastError = "cannot create " + tmp;
+            return false;
+        }
+        line = "timestamp";
+        for (const auto& key : k) {
+            line += ',';
+            if (key.find_first_of(",\"") == std::string::npos) {
+                line += key;
+                continue;
+            }
+            line += '"';
+            for (char c : key) line += (c == '"') ? "\"\"" : std::string(1, c);
+            line += '"';
+        }
+        line += '\n';
+        return put();
+    }
+
+    bool row(int64_t timestampMs, const float* values, const uint8_t* present) override {
+        line.clear();
+        appendTimestamp(line, formatter, timestampMs);
+        for (size_t c = 0; c < keys->size(); ++c) {
+            line += ',';
+            if (present[c] && std::isfinite(values[c])) appendValue(line, values[c]);
+        }
+        line += '\n';
+        return put();
+    }
+
+    bool finish() override {
+        bool ok = std::fclose(file) == 0;
+        file = nullptr;
+        if (!ok || !FileUtil::commitTemp(tmp, path)) {
+            std::remove(tmp.c_str());
+            lastError = "cannot write " + path;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool put() {
+        if (std::fwrite(line.data(), 1, line.size(), file) == line.size()) return true;
+        lastError = "cannot write " + tmp;
+        return false;
+    }
+
+    std::string path;
+    std::string tmp;
+    std::FILE* file = nullptr;
+    const std::vector<std::string>* keys = nullptr;
+    TimestampFormatter formatter;
+    std::string line;
+};
+
+/// <summary>
+/// Columnar store. The row count is only known at the end, so rows are spooled row by row
+/// (int64 timestamp + float per column) to "<path>.rows.tmp" and transposed into the
+/// column layout in fixed-size blocks by finish().
+/// </summary>
+class ColumnSink : public MergeSink {
+public:
+    explicit ColumnSink(const std::string& p) : path(p) {}
+    ~ColumnSink() override {
+        if (spool) std::fclose(spool);
+        if (!spoolPath.empty()) std::remove(spoolPath.c_str());
+    }
+
+    bool begin(const std::vector<std::string>& k, const std::vector<std::string>& u) override {
+        for (const auto& key : k) {
+            if (key.size() >= ColumnFormat::kKeySize) {
+                lastError = "register key too long for column directory: " + key;
+                return false;
+            }
+        }
+        keys = &k;
+        units = &u;
+        columnCount = k.size();
+        record.resize(sizeof(int64_t) + columnCount * sizeof(float));
+        spoolPath = path + ".rows.tmp";
+        spool = std::fopen(spoolPath.c_str(), "w+b");
+        if (!spool) lastError = "cannot create " + spoolPath;
+        return spool != nullptr;
+    }
+
+    bool row(int64_t timestampMs, const float* values, const uint8_t* present) override {
+        if (rows == 0) firstMs = timestampMs;
+        lastMs = timestampMs;
+        std::memcpy(record.data(), &timestampMs, sizeof(timestampMs));
+        float* cells = reinterpret_cast<float*>(record.data() + sizeof(int64_t));
+        for (size_t c = 0; c < columnCount; ++c) {
+            float v = present[c] ? values[c] : NAN;
+            std::memcpy(cells + c, &v, sizeof(v));
+        }
+        rows++;
+        if (std::fwrite(record.data(), 1, record.size(), spool) == record.size()) return true;
+        lastError = "cannot write " + spoolPath;
+        return false;
+    }
+
+    /// <summary>
+    /// Writes header and directory, then scatters each block of spooled rows into the
+    /// timestamp array and the column arrays.
+    /// </summary>
+    bool finish() override {
+        using namespace ColumnFormat;
+        auto alignUp = [](uint64_t v) { return (v + kAlignment - 1) & ~static_cast<uint64_t>(kAlignment - 1); };
+
+        FileHeader header = {};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.byteOrderMark = kByteOrderMark;
+        header.rowCount = rows;
+        header.columnCount = static_cast<uint32_t>(columnCount);
+        header.headerSize = sizeof(FileHeader);
+        header.directoryOffset = sizeof(FileHeader);
+        header.timestampOffset = alignUp(header.directoryOffset + columnCount * sizeof(DirectoryEntry));
+        header.firstMs = rows ? firstMs : 0;
+        header.lastMs = rows ? lastMs : 0;
+
+        std::vector<DirectoryEntry> directory(columnCount);
+        uint64_t offset = alignUp(header.timestampOffset + rows * sizeof(int64_t));
+        for (size_t i = 0; i < columnCount; ++i) {
+            DirectoryEntry& e = directory[i];
+            std::memset(&e, 0, sizeof(e));
+            std::memcpy(e.key, (*keys)[i].data(), (*keys)[i].size());
+            std::memcpy(e.unit, (*units)[i].data(), std::min((*units)[i].size(), kUnitSize - 1));
+            e.dataOffset = offset;
+            offset = alignUp(offset + rows * sizeof(float));
+        }
+
+        std::string tmp = path + ".tmp";
+        std::FILE* f = std::fopen(tmp.c_str(), "wb");
+        if (!f) {
+            lastError = "cannot create " + tmp;
+            return false;
+        }
+
+        bool ok = std::fwrite(&header, 1, sizeof(header), f) == sizeof(header) &&
+                  std::fwrite(directory.data(), sizeof(DirectoryEntry), columnCount, f) == columnCount;
+
+        // Blocks of whole rows; the gaps between arrays are left to the file system (zeros)
+        const size_t blockRows = std::max<size_t>(1, TRANSPOSE_BUDGET / record.size());
+        std::vector<uint8_t> block(blockRows * record.size());
+        std::vector<int64_t> times(blockRows);
+        std::vector<float> cells(blockRows);
+        ok = ok && std::fflush(spool) == 0 && FileUtil::seek(spool, 0);
+        for (uint64_t first = 0; ok && first < rows; first += blockRows) {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(blockRows, rows - first));
+            ok = std::fread(block.data(), record.size(), n, spool) == n;
+            for (size_t r = 0; ok && r < n; ++r) std::memcpy(&times[r], block.data() + r * record.size(), sizeof(int64_t));
+            ok = ok && FileUtil::seek(f, header.timestampOffset + first * sizeof(int64_t)) &&
+                 std::fwrite(times.data(), sizeof(int64_t), n, f) == n;
+            for (size_t c = 0; ok && c < columnCount; ++c) {
+                for (size_t r = 0; r < n; ++r) {
+                    std::memcpy(&cells[r], block.data() + r * record.size() + sizeof(int64_t) + c * sizeof(float),
+                                sizeof(float));
+                }
+                ok = FileUtil::seek(f, directory[c].dataOffset + first * sizeof(float)) &&
+                     std::fwrite(cells.data(), sizeof(float), n, f) == n;
+            }
+        }
+
+        ok = (std::fclose(f) == 0) && ok;
+        if (!ok || !FileUtil::commitTemp(tmp, path)) {
+            std::remove(tmp.c_str());
+            lastError = "cannot write " + path;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::string path;
+    std::string spoolPath;
+    std::FILE* spool = nullptr;
+    const std::vector<std::string>* keys = nullptr;
+    const std::vector<std::string>* units = nullptr;
+    size_t columnCount = 0;
+    std::vector<uint8_t> record;
+    uint64_t rows = 0;
+    int64_t firstMs = 0;
+    int64_t lastMs = 0;
+};
+
+/// <summary>
+/// Cursor over one input: the current record's parsed values and timestamp.
+/// The values point into the reader's buffer and stay valid until the next advance.
+/// </summary>
+struct Input {
+    LogReader reader;
+    std::vector<RecordValue> values;
+    int64_t timestampMs = INT64_MIN;
+};
+
+} // namespace
+
+std::unique_ptr<MergeSink> MergeSink::create(MergeFormat format, const std::string& path) {
+    switch (format) {
+    case MergeFormat::Ndjson: return std::unique_ptr<MergeSink>(new RecordSink(path, false));
+    case MergeFormat::Framed: return std::unique_ptr<MergeSink>(new RecordSink(path, true));
+    case MergeFormat::Csv: return std::unique_ptr<MergeSink>(new CsvSink(path));
+    case MergeFormat::Columns: return std::unique_ptr<MergeSink>(new ColumnSink(path));
+    }
+    return nullptr;
+}
+
+/// <summary>
+/// Looks the key up, adding a column (with the unit of its first record) on first sight.
+/// </summary>
+size_t LogMerger::columnFor(const char* key, size_t keyLength, const char* unit, size_t unitLength) {
+    keyScratch.assign(key, keyLength);
+    auto it = columnOf.find(keyScratch);
+    if (it != columnOf.end()) return it->second;
+
+    size_t column = keys.size();
+    columnOf.emplace(keyScratch, column);
+    keys.push_back(keyScratch);
+    units.push_back(unit ? std::string(unit, unitLength) : std::string());
+    return column;
+}
+
+bool LogMerger::collectSchema(const std::vector<std::string>& inputs) {
+    std::vector<RecordValue> values;
+    for (const auto& path : inputs) {
+        LogReader reader;
+        if (!reader.open(path)) {
+            lastError = reader.error();
+            return false;
+        }
+        reader.readAll([&](const LogRecord& rec) {
+            int64_t ts;
+            if (RecordParser::parse(rec.json, rec.length, ts, values)) {
+                for (const auto& v : values) columnFor(v.key, v.keyLength, v.unit, v.unitLength);
+            }
+            return true;
+        });
+    }
+    return true;
+}
+
+/// <summary>
+/// Heap merge on (timestamp, input index): all records of the smallest timestamp are
+/// combined into one row, then each contributing input moves on to its next record.
+/// </summary>
+bool LogMerger::merge(const std::vector<std::string>& inputs, const std::string& path, MergeFormat format) {
+    keys.clear();
+    units.clear();
+    columnOf.clear();
+    counters = MergeStats();
+
+    if (MergeSink::needsSchema(format) && !collectSchema(inputs)) return false;
+
+    std::vector<std::unique_ptr<Input>> cursors;
+    for (const auto& in : inputs) {
+        cursors.emplace_back(new Input());
+        if (!cursors.back()->reader.open(in)) {
+            lastError = cursors.back()->reader.error();
+            return false;
+        }
+        cursors.back()->reader.seekRecords(0);
+    }
+
+    // Moves an input to its next usable record; false once it is exhausted
+    auto advance = [&](Input& in) {
+        LogRecord rec;
+        int64_t previous = in.timestampMs;
+        while (in.reader.next(rec)) {
+            counters.records++;
+            int64_t ts;
+            if (!RecordParser::parse(rec.json, rec.length, ts, in.values)) {
+                counters.malformed++;
+            } else if (ts < previous) {
+                counters.outOfOrder++;
+            } else {
+                in.timestampMs = ts;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    using Entry = std::pair<int64_t, size_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        if (advance(*cursors[i])) heap.emplace(cursors[i]->timestampMs, i);
+    }
+
+    std::unique_ptr<MergeSink> sink = MergeSink::create(format, path);
+    if (!sink->begin(keys, units)) {
+        lastError = sink->error();
+        return false;
+    }
+
+    std::vector<float> values;
+    std::vector<uint8_t> present;
+    while (!heap.empty()) {
+        const int64_t t = heap.top().first;
+        present.assign(keys.size(), 0);
+        values.resize(keys.size());
+
+        bool first = true;
+        while (!heap.empty() && heap.top().first == t) {
+            size_t index = heap.top().second;
+            Input& in = *cursors[index];
+            heap.pop();
+            if (!first) counters.duplicates++;
+            first = false;
+
+            for (const auto& v : in.values) {
+                size_t c = columnFor(v.key, v.keyLength, v.unit, v.unitLength);
+                if (c >= present.size()) {
+                    present.resize(c + 1, 0);
+                    values.resize(c + 1);
+                }
+                if (!present[c]) {
+                    values[c] = v.value;
+                    present[c] = 1;
+                }
+            }
+            if (advance(in)) heap.emplace(in.timestampMs, index);
+        }
+
+        if (!sink->row(t, values.data(), present.data())) {
+            lastError = sink->error();
+            return false;
+        }
+        counters.rows++;
+    }
+
+    if (!sink->finish()) {
+        lastError = sink->error();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,99 @@
+#ifndef LOG_MERGER_H
+#define LOG_MERGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Output format of a merge.
+/// </summary>
+enum class MergeFormat {
+    Ndjson,       ///< Logger records, one per line (as StorageManager writes them)
+    Framed,       ///< Logger records in CRC32 frames with sync markers (see LogFrame.h)
+    Csv,          ///< "timestamp,<key>..." header, one row per timestamp, empty cells for missing values
+    Columns       ///< Columnar store (.rtc, see ColumnStore.h)
+};
+
+/// <summary>
+/// Counters of one merge run.
+/// </summary>
+struct MergeStats {
+    uint64_t records = 0;         ///< Records read from all inputs
+    uint64_t rows = 0;            ///< Rows written
+    uint64_t duplicates = 0;      ///< Records folded into a row of the same timestamp
+    uint64_t outOfOrder = 0;      ///< Records older than their predecessor in the same file (dropped)
+    uint64_t malformed = 0;       ///< Records without valid JSON or timestamp (dropped)
+};
+
+/// <summary>
+/// Receives the merged rows. values/present are indexed by column. The key and unit lists
+/// passed to begin() stay owned by the caller and are read on every row: columns are
+/// numbered in order of first sight and may be appended between rows unless the schema
+/// was collected up front.
+/// </summary>
+class MergeSink {
+public:
+    virtual ~MergeSink() = default;
+    virtual bool begin(const std::vector<std::string>& keys, const std::vector<std::string>& units) = 0;
+    virtual bool row(int64_t timestampMs, const float* values, const uint8_t* present) = 0;
+    virtual bool finish() = 0;
+    const std::string& error() const { return lastError; }
+
+    /// <summary>
+    /// Creates the writer for a format. Csv and Columns need the complete key list in begin().
+    /// </summary>
+    static std::unique_ptr<MergeSink> create(MergeFormat format, const std::string& path);
+
+    /// <summary>
+    /// True if the format needs every key before the first row.
+    /// </summary>
+    static bool needsSchema(MergeFormat format) { return format == MergeFormat::Csv || format == MergeFormat::Columns; }
+
+protected:
+    std::string lastError;
+};
+
+/// <summary>
+/// Streaming k-way merge of time-ordered log files (NDJSON or framed, e.g. overlapping
+/// day files from several loggers or re-downloads) into one time-ordered output.
+///
+/// Every input is read through its own LogReader cursor; a min-heap on (timestamp, input)
+/// picks the next record, so memory stays at one read buffer per input and the run is
+/// O(n log k) for n records in k files. Records with the same timestamp become one row
+/// holding the union of their keys; where several carry the same key the earlier input
+/// on the command line wins. Records going backwards in time inside a file are dropped
+/// and counted instead of breaking the output order.
+/// </summary>
+class LogMerger {
+public:
+    /// <summary>
+    /// Merges the inputs into path.
+    /// </summary>
+    /// <returns>False if an input cannot be read or the output cannot be written (see error())</returns>
+    bool merge(const std::vector<std::string>& inputs, const std::string& path, MergeFormat format);
+
+    const MergeStats& stats() const { return counters; }
+    size_t columns() const { return keys.size(); }
+    const std::string& error() const { return lastError; }
+
+private:
+    /// <summary>
+    /// Collects every key and unit of the inputs (one extra read, for Csv and Columns).
+    /// </summary>
+    bool collectSchema(const std::vector<std::string>& inputs);
+
+    size_t columnFor(const char* key, size_t keyLength, const char* unit, size_t unitLength);
+
+    std::vector<std::string> keys;
+    std::vector<std::string> units;
+    std::unordered_map<std::string, size_t> columnOf;
+    std::string keyScratch;
+    MergeStats counters;
+    std::string lastError;
+};
+
+#endif // LOG_MERGER_H
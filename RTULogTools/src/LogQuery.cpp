@@ -0,0 +1,476 @@
+#include "LogQuery.h"
+#include "LogFrame.h"
+#include "LogReader.h"
+#include "LzCodec.h"
+#include "RecordParser.h"
+#include "ThreadPool.h"
+#include "TimestampFormatter.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+// ---------------------------------------------------------------------------
+// QuantileSketch
+
+static const double kGamma = (1.0 + QuantileSketch::kRelativeAccuracy) / (1.0 - QuantileSketch::kRelativeAccuracy);
+static const double kLogGamma = std::log(kGamma);
+static const double kMinMagnitude = 1e-9;     ///< Smaller magnitudes count as zero
+
+int32_t QuantileSketch::indexOf(double magnitude) {
+    return static_cast<int32_t>(std::ceil(std::log(magnitude) / kLogGamma));
+}
+
+/// <summary>
+/// Representative of bin i: the point with equal relative error to both bin edges.
+/// </summary>
+double QuantileSketch::valueOf(int32_t index) {
+    return 2.0 * std::pow(kGamma, index) / (kGamma + 1.0);
+}
+
+void QuantileSketch::Store::extend(int32_t lo, int32_t hi) {
+    if (bins.empty()) {
+        first = std::max(lo, hi - static_cast<int32_t>(kMaxBins) + 1);
+        bins.assign(static_cast<size_t>(hi - first + 1), 0);
+        return;
+    }
+    int32_t last = first + static_cast<int32_t>(bins.size()) - 1;
+    if (lo >= first && hi <= last) return;
+    int32_t newHi = std::max(hi, last);
+    int32_t newLo = std::max(std::min(lo, first), newHi - static_cast<int32_t>(kMaxBins) + 1);
+    std::vector<uint64_t> widened(static_cast<size_t>(newHi - newLo + 1), 0);
+    for (size_t j = 0; j < bins.size(); ++j) {
+        int32_t index = std::max(first + static_cast<int32_t>(j), newLo);
+        widened[static_cast<size_t>(index - newLo)] += bins[j];
+    }
+    bins.swap(widened);
+    first = newLo;
+}
+
+void QuantileSketch::Store::add(int32_t index, uint64_t n) {
+    extend(index, index);
+    index = std::max(index, first);   // Folded into the lowest bin
+    bins[static_cast<size_t>(index - first)] += n;
+    total += n;
+}
+
+void QuantileSketch::add(double value) {
+    double magnitude = std::fabs(value);
+    if (std::isnan(value)) return;
+    if (magnitude < kMinMagnitude) {
+        ++zeros;
+    } else if (value > 0) {
+        positive.add(indexOf(magnitude), 1);
+    } else {
+        negative.add(indexOf(magnitude), 1);
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    zeros += other.zeros;
+    const Store* sources[2] = {&other.positive, &other.negative};
+    Store* targets[2] = {&positive, &negative};
+    for (int s = 0; s < 2; ++s) {
+        const Store& from = *sources[s];
+        if (from.bins.empty()) continue;
+        targets[s]->extend(from.first, from.first + static_cast<int32_t>(from.bins.size()) - 1);
+        for (size_t j = 0; j < from.bins.size(); ++j) {
+            if (from.bins[j]) targets[s]->add(from.first + static_cast<int32_t>(j), from.bins[j]);
+        }
+    }
+}
+
+/// <summary>
+/// Walks the bins from the most negative to the most positive value until the
+/// rank q·(n-1) is passed.
+/// </summary>
+double QuantileSketch::quantile(double q) const {
+    uint64_t n = count();
+    if (n == 0) return NAN;
+    q = std::min(1.0, std::max(0.0, q));
+    uint64_t rank = static_cast<uint64_t>(q * (n - 1));
+    uint64_t seen = 0;
+    for (size_t j = negative.bins.size(); j-- > 0;) {
+        seen += negative.bins[j];
+        if (seen > rank) return -valueOf(negative.first + static_cast<int32_t>(j));
+    }
+    seen += zeros;
+    if (seen > rank) return 0.0;
+    for (size_t j = 0; j < positive.bins.size(); ++j) {
+        seen += positive.bins[j];
+        if (seen > rank) return valueOf(positive.first + static_cast<int32_t>(j));
+    }
+    return NAN;
+}
+
+// ---------------------------------------------------------------------------
+// Aggregate
+
+void Aggregate::add(float value, bool quantiles) {
+    ++count;
+    sum += value;
+    if (value < min) min = value;
+    if (value > max) max = value;
+    if (quantiles) sketch.add(value);
+}
+
+void Aggregate::merge(const Aggregate& other) {
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    sketch.merge(other.sketch);
+}
+
+double Aggregate::quantile(double q) const {
+    if (count == 0) return NAN;
+    if (q <= 0.0) return min;
+    if (q >= 1.0) return max;
+    double v = sketch.quantile(q);
+    return std::isnan(v) ? v : std::min<double>(max, std::max<double>(min, v));
+}
+
+// ---------------------------------------------------------------------------
+// QuerySpec
+
+bool QuerySpec::parseBucket(const std::string& text) {
+    static const struct { const char* name; Bucket bucket; int64_t ms; } names[] = {
+        { "none", Bucket::None, 0 }, { "month", Bucket::Month, 0 }, { "year", Bucket::Year, 0 },
+        { "day", Bucket::Fixed, 86400000 }, { "hour", Bucket::Fixed, 3600000 },
+    };
+    for (const auto& n : names) {
+        if (text == n.name) {
+            bucket = n.bucket;
+            bucketMs = n.ms;
+            return true;
+        }
+    }
+
+    int64_t number = 0;
+    auto r = std::from_chars(text.data(), text.data() + text.size(), number);
+    if (r.ec != std::errc() || number <= 0) return false;
+    std::string unit(r.ptr, text.data() + text.size());
+    int64_t scale = unit == "ms" ? 1 : unit == "s" ? 1000 : unit == "m" ? 60000 : unit == "h" ? 3600000
+                  : unit == "d" ? 86400000 : 0;
+    if (scale == 0) return false;
+    bucket = Bucket::Fixed;
+    bucketMs = number * scale;
+    return true;
+}
+
+int64_t QuerySpec::bucketOf(int64_t timestampMs) const {
+    const int64_t dayMs = 86400000;
+    switch (bucket) {
+        case Bucket::None:
+            return INT64_MIN;
+        case Bucket::Fixed: {
+            int64_t q = timestampMs / bucketMs;
+            if (timestampMs % bucketMs < 0) --q;   // Floor for times before 1970
+            return q * bucketMs;
+        }
+        case Bucket::Month:
+        case Bucket::Year: {
+            int64_t days = timestampMs / dayMs - (timestampMs % dayMs < 0 ? 1 : 0);
+            int year;
+            unsigned month, day;
+            TimestampFormatter::civilFromDays(days, year, month, day);
+            return TimestampFormatter::daysFromCivil(year, bucket == Bucket::Month ? month : 1, 1) * dayMs;
+        }
+    }
+    return INT64_MIN;
+}
+
+// ---------------------------------------------------------------------------
+// LogQuery
+
+/// <summary>
+/// Result of one file. Keys get ids in order of first sight; the record's key
+/// at each position is cached, since every record of a file usually lists
+/// the same keys in the same order.
+/// </summary>
+struct LogQuery::Partial {
+    const QuerySpec* spec = nullptr;
+    std::vector<std::string> keys;
+    std::unordered_map<std::string, int32_t> idOf;        ///< -1 = filtered out
+    std::vector<std::pair<std::string, int32_t>> atPosition;
+    std::map<int64_t, std::vector<Aggregate>> groups;
+    int64_t currentBucket = INT64_MIN;
+    std::vector<Aggregate>* current = nullptr;
+    uint64_t records = 0;
+    uint64_t malformed = 0;
+    bool failed = false;         ///< Cannot be opened or not a logger file
+
+    bool wanted(const char* key, size_t length) const {
+        if (spec->keys.empty()) return true;
+        for (const std::string& k : spec->keys) {
+            if (!k.empty() && k.back() == '*') {
+                if (length >= k.size() - 1 && std::memcmp(key, k.data(), k.size() - 1) == 0) return true;
+            } else if (length == k.size() && std::memcmp(key, k.data(), length) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int32_t resolve(size_t position, const char* key, size_t length) {
+        if (position < atPosition.size()) {
+            const std::string& cached = atPosition[position].first;
+            if (cached.size() == length && std::memcmp(cached.data(), key, length) == 0) {
+                return atPosition[position].second;
+            }
+        } else {
+            atPosition.resize(position + 1);
+        }
+        std::string name(key, length);
+        auto it = idOf.find(name);
+        if (it == idOf.end()) {
+            int32_t id = -1;
+            if (wanted(key, length)) {
+                id = static_cast<int32_t>(keys.size());
+                keys.push_back(name);
+            }
+            it = idOf.emplace(name, id).first;
+        }
+        atPosition[position] = {name, it->second};
+        return it->second;
+    }
+
+    void beginRecord(int64_t timestampMs) {
+        ++records;
+        int64_t bucket = spec->bucketOf(timestampMs);
+        if (!current || bucket != currentBucket) {
+            currentBucket = bucket;
+            current = &groups[bucket];
+        }
+    }
+
+    void value(int32_t id, float v) {
+        if (id < 0 || std::isnan(v)) return;
+        if (current->size() <= static_cast<size_t>(id)) current->resize(keys.size());
+        (*current)[id].add(v, spec->quantiles);
+    }
+};
+
+bool LogQuery::addPath(const std::string& path) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::file_status status = fs::status(path, ec);
+    if (ec || !fs::exists(status)) {
+        lastError = "cannot find " + path;
+        return false;
+    }
+    if (!fs::is_directory(status)) {
+        files.push_back({path, static_cast<uint64_t>(fs::file_size(path, ec)), 0});
+        return true;
+    }
+
+    static const char* const extensions[] = { ".csv", ".log", ".json", ".ndjson", ".txt" };
+    for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        fs::path name = it->path().filename();
+        if (name.extension() == LzCodec::kExtension) name = name.stem();  // Compressed day file
+        std::string ext = name.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        bool logFile = false;
+        for (const char* e : extensions) logFile |= ext == e;
+        if (!logFile || name == "config.json" || name.string().rfind("regmap_", 0) == 0) {
+            continue;
+        }
+        files.push_back({it->path().string(), static_cast<uint64_t>(it->file_size(ec)), 0});
+    }
+    return true;
+}
+
+/// <summary>
+/// NDJSON, framed and compressed day files go through LogReader (time index,
+/// torn records); anything else is read as CSV with a "timestamp" column.
+/// </summary>
+void LogQuery::queryFile(const InputFile& input, const QuerySpec& spec, Partial& out) const {
+    out.spec = &spec;
+    std::FILE* f = std::fopen(input.path.c_str(), "rb");
+    if (!f) {
+        out.failed = true;
+        return;
+    }
+    char head[4096];
+    size_t got = std::fread(head, 1, sizeof(head), f);
+    size_t pos = got >= 3 && std::memcmp(head, "\xEF\xBB\xBF", 3) == 0 ? 3 : 0;
+    while (pos < got && (head[pos] == ' ' || head[pos] == '\r' || head[pos] == '\n' || head[pos] == '\t')) ++pos;
+    bool records = got >= 2 && static_cast<uint8_t>(head[0]) == LogFrame::kMagic0;
+    records |= pos < got && head[pos] == '{';
+    records |= LzCodec::isCompressed(reinterpret_cast<const uint8_t*>(head), got);
+
+    if (records) {
+        std::fclose(f);
+        LogReader reader;
+        if (!reader.open(input.path)) {
+            out.failed = true;
+            return;
+        }
+        std::vector<RecordValue> values;
+        reader.readRange(spec.fromMs, spec.toMs, [&](const LogRecord& rec) {
+            int64_t ts;
+            if (!RecordParser::parse(rec.json, rec.length, ts, values)) {
+                ++out.malformed;
+                return true;
+            }
+            out.beginRecord(ts);
+            for (size_t i = 0; i < values.size(); ++i) {
+                out.value(out.resolve(i, values[i].key, values[i].keyLength), values[i].value);
+            }
+            return true;
+        });
+        return;
+    }
+
+    // CSV: header "timestamp,<key>...", streamed in blocks
+    std::string pending(head + pos, got - pos);
+    std::vector<int32_t> columnIds;
+    size_t timeColumn = SIZE_MAX;
+    bool header = true;
+    auto onLine = [&](const char* line, size_t len) {
+        if (len > 0 && line[len - 1] == '\r') --len;
+        if (len == 0) return;
+        size_t column = 0;
+        size_t valueIndex = 0;
+        int64_t ts = 0;
+        bool timeOk = false;
+        const char* field = line;
+        const char* end = line + len;
+        if (!header) {
+            // Timestamp first, so the bucket is known before the values
+            const char* p = line;
+            for (size_t c = 0; c < timeColumn && p; ++c) {
+                p = static_cast<const char*>(std::memchr(p, ',', end - p));
+                if (p) ++p;
+            }
+            if (p) {
+                const char* e = static_cast<const char*>(std::memchr(p, ',', end - p));
+                timeOk = TimestampFormatter::parse(p, (e ? e : end) - p, ts);
+            }
+            if (!timeOk) {
+                ++out.malformed;
+                return;
+            }
+            if (ts < spec.fromMs || ts > spec.toMs) return;
+            out.beginRecord(ts);
+        }
+        for (;;) {
+            const char* comma = static_cast<const char*>(std::memchr(field, ',', end - field));
+            const char* fieldEnd = comma ? comma : end;
+            size_t n = static_cast<size_t>(fieldEnd - field);
+            if (header) {
+                if (timeColumn == SIZE_MAX && n == 9 && std::memcmp(field, "timestamp", 9) == 0) {
+                    timeColumn = column;
+                } else {
+                    columnIds.push_back(out.resolve(columnIds.size(), field, n));
+                }
+            } else if (column != timeColumn) {
+                if (valueIndex < columnIds.size() && n > 0) {
+                    float v;
+                    auto r = std::from_chars(field, fieldEnd, v);
+                    if (r.ec == std::errc() && r.ptr == fieldEnd) out.value(columnIds[valueIndex], v);
+                }
+                ++valueIndex;
+            }
+            ++column;
+            if (!comma) break;
+            field = comma + 1;
+        }
+        header = false;
+    };
+
+    char block[65536];
+    bool logFile = true;
+    for (;;) {
+        size_t start = 0;
+        size_t nl;
+        while (logFile && (nl = pending.find('\n', start)) != std::string::npos) {
+            onLine(pending.data() + start, nl - start);
+            start = nl + 1;
+            logFile = header || timeColumn != SIZE_MAX;
+        }
+        pending.erase(0, start);
+        size_t n = logFile ? std::fread(block, 1, sizeof(block), f) : 0;
+        if (n == 0) break;
+        pending.append(block, n);
+    }
+    if (logFile && !pending.empty()) onLine(pending.data(), pending.size());
+    std::fclose(f);
+    out.failed = timeColumn == SIZE_MAX;   // Not a logger file
+}
+
+void LogQuery::run(const QuerySpec& spec, unsigned threads) {
+    resultKeys.clear();
+    resultGroups.clear();
+    runStats = QueryStats();
+
+    // Key order follows the path order; the work order is largest file first
+    std::sort(files.begin(), files.end(), [](const InputFile& a, const InputFile& b) { return a.path < b.path; });
+    files.erase(std::unique(files.begin(), files.end(), [](const InputFile& a, const InputFile& b) {
+        return a.path == b.path;
+    }), files.end());
+    for (size_t i = 0; i < files.size(); ++i) files[i].order = i;
+    std::vector<const InputFile*> work;
+    for (const InputFile& f : files) work.push_back(&f);
+    std::stable_sort(work.begin(), work.end(), [](const InputFile* a, const InputFile* b) { return a->size > b->size; });
+
+    std::mutex lock;
+    std::unordered_map<std::string, int32_t> globalId;
+    std::vector<uint64_t> firstSeen;           ///< (file order << 32 | position) per global key
+
+    ThreadPool::shared().parallelFor(work.size(), [&](size_t w) {
+        const InputFile& input = *work[w];
+        Partial partial;
+        queryFile(input, spec, partial);
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (partial.failed) {
+            ++runStats.failedFiles;
+            return;
+        }
+        ++runStats.files;
+        runStats.bytes += input.size;
+        runStats.records += partial.records;
+        runStats.malformed += partial.malformed;
+
+        std::vector<int32_t> mapped(partial.keys.size());
+        for (size_t k = 0; k < partial.keys.size(); ++k) {
+            uint64_t rank = (static_cast<uint64_t>(input.order) << 32) | k;
+            auto it = globalId.find(partial.keys[k]);
+            if (it == globalId.end()) {
+                it = globalId.emplace(partial.keys[k], static_cast<int32_t>(resultKeys.size())).first;
+                resultKeys.push_back(partial.keys[k]);
+                firstSeen.push_back(rank);
+            } else {
+                firstSeen[it->second] = std::min(firstSeen[it->second], rank);
+            }
+            mapped[k] = it->second;
+        }
+        for (auto& group : partial.groups) {
+            std::vector<Aggregate>& total = resultGroups[group.first];
+            if (total.size() < resultKeys.size()) total.resize(resultKeys.size());
+            for (size_t k = 0; k < group.second.size(); ++k) {
+                if (group.second[k].count) total[mapped[k]].merge(group.second[k]);
+            }
+        }
+    }, threads);
+
+    // Renumber keys by first appearance in path order
+    std::vector<size_t> order(resultKeys.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return firstSeen[a] < firstSeen[b]; });
+    std::vector<std::string> keys;
+    for (size_t i : order) keys.push_back(resultKeys[i]);
+    resultKeys.swap(keys);
+    for (auto& group : resultGroups) {
+        std::vector<Aggregate> sorted(resultKeys.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            if (order[i] < group.second.size()) sorted[i] = std::move(group.second[order[i]]);
+        }
+        group.second.swap(sorted);
+    }
+}
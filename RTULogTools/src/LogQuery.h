@@ -0,0 +1,173 @@
+#ifndef LOG_QUERY_H
+#define LOG_QUERY_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Mergeable quantile sketch with 1 % relative accuracy: values are counted
+/// in logarithmically spaced bins (bin i holds magnitudes in (γ^(i-1), γ^i],
+/// γ = 1.01 / 0.99), separately for positive and negative values. Memory is
+/// bounded by kMaxBins per sign; beyond that the smallest magnitudes are
+/// folded into one bin, which only affects quantiles near zero.
+/// </summary>
+class QuantileSketch {
+public:
+    static constexpr double kRelativeAccuracy = 0.01;
+    static constexpr size_t kMaxBins = 2048;
+
+    void add(double value);
+    void merge(const QuantileSketch& other);
+
+    /// <summary>
+    /// Value at quantile q (0..1), NAN if empty.
+    /// </summary>
+    double quantile(double q) const;
+
+    uint64_t count() const { return positive.total + negative.total + zeros; }
+
+private:
+    /// <summary>
+    /// Dense bin counts for indices [first, first + bins.size()).
+    /// </summary>
+    struct Store {
+        int32_t first = 0;
+        std::vector<uint64_t> bins;
+        uint64_t total = 0;
+
+        /// <summary>
+        /// Widens the bin range to [lo, hi], folding bins below the kMaxBins window.
+        /// </summary>
+        void extend(int32_t lo, int32_t hi);
+        void add(int32_t index, uint64_t n);
+    };
+
+    static int32_t indexOf(double magnitude);
+    static double valueOf(int32_t index);
+
+    Store positive;
+    Store negative;              ///< Magnitudes of negative values
+    uint64_t zeros = 0;
+};
+
+/// <summary>
+/// Aggregate of one key in one time bucket. NAN values are not counted.
+/// </summary>
+struct Aggregate {
+    uint64_t count = 0;
+    double sum = 0.0;
+    float min = INFINITY;
+    float max = -INFINITY;
+    QuantileSketch sketch;       ///< Only filled when the query asks for quantiles
+
+    void add(float value, bool quantiles);
+    void merge(const Aggregate& other);
+    double mean() const { return count ? sum / count : NAN; }
+
+    /// <summary>
+    /// Sketch quantile clamped to the exact minimum and maximum.
+    /// </summary>
+    double quantile(double q) const;
+};
+
+/// <summary>
+/// What to aggregate.
+/// </summary>
+struct QuerySpec {
+    enum class Bucket { None, Fixed, Month, Year };
+
+    std::vector<std::string> keys;   ///< Keys to aggregate ("prefix*" matches a prefix); empty = all
+    int64_t fromMs = INT64_MIN;      ///< First timestamp included
+    int64_t toMs = INT64_MAX;        ///< Last timestamp included
+    Bucket bucket = Bucket::None;
+    int64_t bucketMs = 0;            ///< Width of Fixed buckets (aligned to the epoch, days to midnight)
+    bool quantiles = false;          ///< Keep a QuantileSketch per group
+
+    /// <summary>
+    /// Parses a bucket width: "none", "month", "year", "day", "hour", or a number
+    /// with unit ms, s, m, h or d ("15m", "1d").
+    /// </summary>
+    /// <returns>False if the text is not a bucket width</returns>
+    bool parseBucket(const std::string& text);
+
+    /// <summary>
+    /// Start of the bucket holding a timestamp (INT64_MIN for Bucket::None).
+    /// </summary>
+    int64_t bucketOf(int64_t timestampMs) const;
+};
+
+/// <summary>
+/// Counters of one query run.
+/// </summary>
+struct QueryStats {
+    uint64_t files = 0;           ///< Files read
+    uint64_t failedFiles = 0;     ///< Files that could not be opened or are not logger files
+    uint64_t bytes = 0;           ///< Size of the files read
+    uint64_t records = 0;         ///< Records inside the time range
+    uint64_t malformed = 0;       ///< Records or rows that could not be parsed
+};
+
+/// <summary>
+/// Aggregate queries over many log files (NDJSON and framed as StorageManager
+/// writes them, and CSV as exported by rtulog-merge / RTULogScope).
+///
+/// Files are handed to the shared ThreadPool largest first, so the pool's
+/// dynamic index handout keeps every thread busy until the small files at
+/// the end. Each file is streamed into a partial result of its own (one read
+/// buffer plus one Aggregate per bucket and key) which is merged into the
+/// total as soon as the file is done; memory does not grow with the amount of
+/// data, only with the number of buckets and keys. Time-indexed files skip
+/// straight to the requested range.
+/// </summary>
+class LogQuery {
+public:
+    /// <summary>
+    /// Adds a log file, or every log file below a directory (*.csv, *.log,
+    /// *.json, *.ndjson, *.txt; index and cache sidecars are ignored).
+    /// </summary>
+    /// <returns>False if the path does not exist (see error())</returns>
+    bool addPath(const std::string& path);
+
+    /// <summary>
+    /// Runs the query over every added file.
+    /// </summary>
+    /// <param name="spec">Keys, time range, buckets</param>
+    /// <param name="threads">Threads to use (0 = all of the shared pool)</param>
+    void run(const QuerySpec& spec, unsigned threads = 0);
+
+    /// <summary>
+    /// Keys found, in the order they first appear in the (path-sorted) files.
+    /// </summary>
+    const std::vector<std::string>& keys() const { return resultKeys; }
+
+    /// <summary>
+    /// Results per bucket start, one Aggregate per entry of keys() (count 0 = no data).
+    /// </summary>
+    const std::map<int64_t, std::vector<Aggregate>>& groups() const { return resultGroups; }
+
+    const QueryStats& stats() const { return runStats; }
+    size_t fileCount() const { return files.size(); }
+    const std::string& error() const { return lastError; }
+
+private:
+    struct Partial;
+    struct InputFile {
+        std::string path;
+        uint64_t size;
+        size_t order;            ///< Position in path order (decides key order)
+    };
+
+    void queryFile(const InputFile& input, const QuerySpec& spec, Partial& out) const;
+
+    std::vector<InputFile> files;
+    std::vector<std::string> resultKeys;
+    std::map<int64_t, std::vector<Aggregate>> resultGroups;
+    QueryStats runStats;
+    std::string lastError;
+};
+
+#endif // LOG_QUERY_H
@@ -0,0 +1,259 @@
+#include "LogReader.h"
+#include "FileUtil.h"
+#include "LogFrame.h"
+#include "LzCodec.h"
+#include "TimestampFormatter.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+static const size_t CHUNK_SIZE = 1 << 16;
+
+LogReader::~LogReader() {
+    close();
+}
+
+/// <summary>
+/// Opens the file (or its compressed copy), decompresses it if needed,
+/// detects framing from the first bytes and loads the index.
+/// </summary>
+bool LogReader::open(const std::string& path) {
+    close();
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) file = std::fopen((path + LzCodec::kExtension).c_str(), "rb");
+    if (!file) {
+        lastError = "cannot open " + path;
+        return false;
+    }
+    size = FileUtil::sizeOf(file);
+
+    uint8_t head[LogFrame::kSyncSize > LzCodec::kHeaderSize ? LogFrame::kSyncSize : LzCodec::kHeaderSize] = {};
+    size_t got = std::fread(head, 1, sizeof(head), file);
+    if (LzCodec::isCompressed(head, got)) {
+        if (!inflate(path)) return false;
+        got = std::fread(head, 1, sizeof(head), file);
+    }
+    framed = got >= 2 && head[0] == LogFrame::kMagic0 &&
+             (head[1] == LogFrame::kMagic1 || LogFrame::isSyncAt(head, got));
+
+    loadIndex(indexPath(path));
+    return true;
+}
+
+std::string LogReader::indexPath(const std::string& path) {
+    const size_t n = std::strlen(LzCodec::kExtension);
+    bool lz = path.size() > n && path.compare(path.size() - n, n, LzCodec::kExtension) == 0;
+    return (lz ? path.substr(0, path.size() - n) : path) + ".idx";
+}
+
+/// <summary>
+/// Offsets (index, readFrom) then refer to the decompressed data, as on the
+/// logger before compression.
+/// </summary>
+bool LogReader::inflate(const std::string& path) {
+    std::vector<uint8_t> packed(static_cast<size_t>(size));
+    std::rewind(file);
+    bool ok = std::fread(packed.data(), 1, packed.size(), file) == packed.size();
+    std::fclose(file);
+    file = nullptr;
+
+    std::vector<uint8_t> raw;
+    if (!ok || !LzCodec::decompress(packed.data(), packed.size(), raw)) {
+        lastError = path + ": compressed data is truncated or corrupt";
+        close();
+        return false;
+    }
+
+    file = std::tmpfile();
+    if (!file || std::fwrite(raw.data(), 1, raw.size(), file) != raw.size()) {
+        lastError = "cannot create a temporary file for " + path;
+        close();
+        return false;
+    }
+    std::rewind(file);
+    size = raw.size();
+    compressed = true;
+    return true;
+}
+
+uint64_t LogReader::refresh() {
+    if (file) size = FileUtil::sizeOf(file);
+    return size;
+}
+
+void LogReader::close() {
+    if (file) std::fclose(file);
+    file = nullptr;
+    size = 0;
+    compressed = false;
+    have = pos = 0;
+    index.clear();
+}
+
+/// <summary>
+/// Reads the sidecar index. A missing or mismatching index is ignored,
+/// entries beyond the end of the log file (torn tail) are dropped.
+/// </summary>
+void LogReader::loadIndex(const std::string& idxPath) {
+    std::FILE* f = std::fopen(idxPath.c_str(), "rb");
+    if (!f) return;
+
+    std::vector<uint8_t> raw(static_cast<size_t>(FileUtil::sizeOf(f)));
+    size_t got = raw.empty() ? 0 : std::fread(raw.data(), 1, raw.size(), f);
+    std::fclose(f);
+
+    TimeIndex::Header header;
+    if (!TimeIndex::decodeHeader(raw.data(), got, header) ||
+        ((header.flags & TimeIndex::kFlagFramed) != 0) != framed) {
+        return;
+    }
+
+    for (size_t pos = TimeIndex::kHeaderSize; pos + TimeIndex::kEntrySize <= got; pos += TimeIndex::kEntrySize) {
+        TimeIndex::Entry e = TimeIndex::decodeEntry(raw.data() + pos);
+        if (e.offset >= size || (!index.empty() && e.timeMs <= index.back().timeMs)) break;
+        index.push_back(e);
+    }
+}
+
+/// <summary>
+/// Finds "timestamp":"..." and parses the value.
+/// </summary>
+bool LogReader::extractTimestamp(const char* json, size_t length, int64_t& timestampMs) {
+    static const char key[] = "\"timestamp\"";
+    const size_t keyLen = sizeof(key) - 1;
+
+    const char* end = json + length;
+    for (const char* p = json; p + keyLen < end; ++p) {
+        p = static_cast<const char*>(std::memchr(p, '"', static_cast<size_t>(end - p)));
+        if (!p || p + keyLen >= end) return false;
+        if (std::memcmp(p, key, keyLen) != 0) continue;
+
+        const char* v = p + keyLen;
+        while (v < end && (*v == ' ' || *v == ':')) ++v;
+        if (v >= end || *v != '"') return false;
+        ++v;
+        const char* q = static_cast<const char*>(std::memchr(v, '"', static_cast<size_t>(end - v)));
+        return q && TimestampFormatter::parse(v, static_cast<size_t>(q - v), timestampMs);
+    }
+    return false;
+}
+
+/// <summary>
+/// Uses the index to narrow the byte range, then scans and filters by time.
+/// </summary>
+size_t LogReader::readRange(int64_t fromMs, int64_t toMs, const Callback& callback) {
+    if (!file || fromMs > toMs) return 0;
+
+    uint64_t begin = 0;
+    uint64_t end = size;
+    if (!index.empty()) {
+        long first = TimeIndex::findFloor(index.data(), index.size(), fromMs);
+        size_t last = TimeIndex::findCeiling(index.data(), index.size(), toMs);
+        if (first >= 0) begin = index[static_cast<size_t>(first)].offset;
+        if (last < index.size()) end = index[last].offset;
+    }
+    return scan(begin, end, fromMs, toMs, true, callback);
+}
+
+size_t LogReader::readAll(const Callback& callback) {
+    if (!file) return 0;
+    return scan(0, size, INT64_MIN, INT64_MAX, false, callback);
+}
+
+size_t LogReader::readFrom(uint64_t offset, const Callback& callback) {
+    if (!file || offset >= size) return 0;
+    return scan(offset, size, INT64_MIN, INT64_MAX, false, callback);
+}
+
+/// <summary>
+/// Filters the records of [begin, end) by time and delivers them.
+/// </summary>
+size_t LogReader::scan(uint64_t begin, uint64_t end, int64_t fromMs, int64_t toMs, bool filter,
+                       const Callback& callback) {
+    size_t delivered = 0;
+    LogRecord rec;
+    seekRecords(begin, end);
+    while (next(rec)) {
+        if (filter && (rec.timestampMs < fromMs || rec.timestampMs > toMs)) continue;
+        delivered++;
+        if (!callback(rec)) break;
+    }
+    return delivered;
+}
+
+void LogReader::seekRecords(uint64_t begin, uint64_t end) {
+    if (buf.empty()) buf.resize(CHUNK_SIZE + LogFrame::kMaxPayload + LogFrame::kOverhead + LogFrame::kSyncSize);
+    endPos = std::min(end, size);
+    bufOffset = readPos = std::min(begin, endPos);
+    have = pos = 0;
+    atEnd = false;
+    if (file) FileUtil::seek(file, readPos);
+}
+
+/// <summary>
+/// Chunked pull reader. Records may straddle chunk boundaries; the unconsumed
+/// tail of a chunk is moved to the front before the next read.
+/// </summary>
+bool LogReader::next(LogRecord& rec) {
+    if (!file) return false;
+
+    for (;;) {
+        bool needMore = false;
+        while (pos < have) {
+            const uint8_t* payload = nullptr;
+            size_t payloadLen = 0;
+            size_t used = 0;
+
+            if (framed) {
+                used = LogFrame::next(buf.data() + pos, have - pos, &payload, &payloadLen);
+                if (used == 0) {
+                    // Incomplete frame at the chunk end, or corruption: resync one byte further
+                    if (!atEnd && have - pos < LogFrame::kMaxPayload + LogFrame::kOverhead + LogFrame::kSyncSize) {
+                        needMore = true;
+                        break;
+                    }
+                    pos++;
+                    continue;
+                }
+            } else {
+                const uint8_t* nl = static_cast<const uint8_t*>(std::memchr(buf.data() + pos, '\n', have - pos));
+                if (!nl) {
+                    if (!atEnd) {
+                        needMore = true;
+                        break;
+                    }
+                    pos = have;      // Torn last line
+                    break;
+                }
+                payload = buf.data() + pos;
+                payloadLen = static_cast<size_t>(nl - payload);
+                used = payloadLen + 1;
+                if (payloadLen > 0 && payload[payloadLen - 1] == '\r') payloadLen--;
+            }
+
+            rec.json = reinterpret_cast<const char*>(payload);
+            rec.length = payloadLen;
+            rec.offset = bufOffset + static_cast<uint64_t>(payload - buf.data()) - (framed ? LogFrame::kHeaderSize : 0);
+            pos += used;
+            rec.endOffset = bufOffset + pos;
+            if (payloadLen == 0) continue;
+
+            if (!extractTimestamp(rec.json, rec.length, rec.timestampMs)) rec.timestampMs = INT64_MIN;
+            return true;
+        }
+
+        if (atEnd && !needMore) return false;
+
+        // Keep the unconsumed tail and read the next chunk behind it
+        std::memmove(buf.data(), buf.data() + pos, have - pos);
+        have -= pos;
+        bufOffset += pos;
+        pos = 0;
+
+        size_t want = static_cast<size_t>(std::min<uint64_t>(buf.size() - have, endPos - readPos));
+        size_t got = want ? std::fread(buf.data() + have, 1, want, file) : 0;
+        have += got;
+        readPos += got;
+        atEnd = (readPos >= endPos || got == 0);
+    }
+}
@@ -0,0 +1,150 @@
+#ifndef LOG_READER_H
+#define LOG_READER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "TimeIndex.h"
+
+/// <summary>
+/// One record as stored by the logger.
+/// The json pointer is only valid inside the callback it was passed to
+/// (or until the next call of next()).
+/// </summary>
+struct LogRecord {
+    int64_t timestampMs;     ///< Parsed "timestamp" field (epoch milliseconds)
+    const char* json;        ///< Record payload (one JSON object, no line break)
+    size_t length;           ///< Payload length in bytes
+    uint64_t offset;         ///< Byte offset of the record in the log file
+    uint64_t endOffset;      ///< Byte offset just past the record (where reading can resume)
+};
+
+/// <summary>
+/// Streams records from a logger file (plain NDJSON or CRC32-framed, see LogFrame.h).
+/// If a "<file>.idx" time index exists, range queries seek straight to the
+/// first relevant bucket and stop after the last one instead of reading the
+/// whole file. Torn or corrupt records are skipped.
+///
+/// A compressed day file ("<file>.lz", see LzCodec.h) is decompressed into a
+/// temporary file on open() and read like the original; its index is still
+/// "<file>.idx". Opening "<file>" after the logger compressed it opens the
+/// ".lz" instead.
+/// </summary>
+class LogReader {
+public:
+    /// <summary>
+    /// Called for every record; return false to stop reading.
+    /// </summary>
+    using Callback = std::function<bool(const LogRecord&)>;
+
+    LogReader() = default;
+    ~LogReader();
+    LogReader(const LogReader&) = delete;
+    LogReader& operator=(const LogReader&) = delete;
+
+    /// <summary>
+    /// Opens a log file and loads its time index if present.
+    /// </summary>
+    /// <returns>False if the file cannot be opened or fails to decompress (see error())</returns>
+    bool open(const std::string& path);
+
+    /// <summary>
+    /// Closes the file.
+    /// </summary>
+    void close();
+
+    /// <summary>
+    /// Streams records with fromMs <= timestamp <= toMs.
+    /// </summary>
+    /// <returns>Number of records delivered</returns>
+    size_t readRange(int64_t fromMs, int64_t toMs, const Callback& callback);
+
+    /// <summary>
+    /// Streams every record in file order (including records without a parsable timestamp,
+    /// which are delivered with timestampMs = INT64_MIN).
+    /// </summary>
+    /// <returns>Number of records delivered</returns>
+    size_t readAll(const Callback& callback);
+
+    /// <summary>
+    /// Streams every record from a byte offset to the end of the file, e.g. to pick up
+    /// data appended since an earlier pass (resume at the last endOffset).
+    /// </summary>
+    /// <returns>Number of records delivered</returns>
+    size_t readFrom(uint64_t offset, const Callback& callback);
+
+    /// <summary>
+    /// Re-reads the file size, so records appended since open() become readable.
+    /// </summary>
+    /// <returns>The new size</returns>
+    uint64_t refresh();
+
+    /// <summary>
+    /// Positions the pull interface (next()) at a byte offset; records are returned
+    /// until end (or the end of the file). open() does not position it.
+    /// </summary>
+    void seekRecords(uint64_t begin, uint64_t end = UINT64_MAX);
+
+    /// <summary>
+    /// Returns the next record after seekRecords() (json stays valid until the next call).
+    /// Records without a parsable timestamp have timestampMs = INT64_MIN.
+    /// </summary>
+    /// <returns>False at the end of the range</returns>
+    bool next(LogRecord& rec);
+
+    bool isFramed() const { return framed; }
+    bool isCompressed() const { return compressed; }
+    bool hasIndex() const { return !index.empty(); }
+    const std::vector<TimeIndex::Entry>& indexEntries() const { return index; }
+    uint64_t fileSize() const { return size; }
+    const std::string& error() const { return lastError; }
+
+    /// <summary>
+    /// Extracts the "timestamp" field from a record without a full JSON parse.
+    /// </summary>
+    /// <returns>False if the field is missing or malformed</returns>
+    static bool extractTimestamp(const char* json, size_t length, int64_t& timestampMs);
+
+    /// <summary>
+    /// Time index path of a log file ("<file>.idx", also for "<file>.lz").
+    /// </summary>
+    static std::string indexPath(const std::string& path);
+
+private:
+    /// <summary>
+    /// Reads [begin, end) and delivers every complete record inside it (via next()).
+    /// </summary>
+    size_t scan(uint64_t begin, uint64_t end, int64_t fromMs, int64_t toMs, bool filter,
+                const Callback& callback);
+
+    /// <summary>
+    /// Replaces the open compressed file by a temporary file with its contents.
+    /// </summary>
+    /// <returns>False if the compressed data is truncated or corrupt</returns>
+    bool inflate(const std::string& path);
+
+    /// <summary>
+    /// Loads and validates the time index.
+    /// </summary>
+    void loadIndex(const std::string& idxPath);
+
+    std::FILE* file = nullptr;
+    uint64_t size = 0;
+
+    // Pull reader state
+    std::vector<uint8_t> buf;
+    size_t have = 0;                 ///< Valid bytes in buf
+    size_t pos = 0;                  ///< Next unparsed byte in buf
+    uint64_t bufOffset = 0;          ///< File offset of buf[0]
+    uint64_t readPos = 0;            ///< File offset of the next read
+    uint64_t endPos = 0;             ///< End of the requested range
+    bool atEnd = true;
+    bool framed = false;
+    bool compressed = false;         ///< Read from a decompressed temporary copy
+    std::vector<TimeIndex::Entry> index;
+    std::string lastError;
+};
+
+#endif // LOG_READER_H
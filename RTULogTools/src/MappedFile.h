@@ -0,0 +1,56 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Read-only memory mapping of a whole file (mmap on POSIX, a file mapping on Windows).
+/// A compressed day file (see LzCodec.h) is decompressed into memory instead,
+/// so callers see the logger's original bytes either way.
+/// </summary>
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// <summary>
+    /// Maps the file. Empty files cannot be mapped.
+    /// </summary>
+    /// <returns>False if the file cannot be opened or mapped, or fails to decompress</returns>
+    bool open(const std::string& path);
+
+    /// <summary>
+    /// Unmaps the file.
+    /// </summary>
+    void close();
+
+    const uint8_t* data() const { return base; }
+    size_t size() const { return length; }
+    bool isCompressed() const { return !inflated.empty(); }
+
+private:
+    /// <summary>
+    /// Platform part of open(): maps the file as it is.
+    /// </summary>
+    bool map(const std::string& path);
+
+    /// <summary>
+    /// Platform part of close(): releases the mapping.
+    /// </summary>
+    void unmap();
+
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+    std::vector<uint8_t> inflated;      ///< Decompressed contents (base points here)
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,275 @@
+#include "ParallelParser.h"
+#include "FastRecordParser.h"
+#include "LogFrame.h"
+#include "SimdScan.h"
+#include "ThreadPool.h"
+#include "TimestampFormatter.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+static const size_t MIN_CHUNK = 1 << 20;
+
+/// <summary>
+/// Position of the next sync marker at or after pos, or end.
+/// </summary>
+static size_t nextSync(const uint8_t* data, size_t pos, size_t end) {
+    while (pos < end) {
+        const uint8_t* p = static_cast<const uint8_t*>(std::memchr(data + pos, LogFrame::kMagic0, end - pos));
+        if (!p) return end;
+        pos = static_cast<size_t>(p - data);
+        if (LogFrame::isSyncAt(p, end - pos)) return pos;
+        pos++;
+    }
+    return end;
+}
+
+/// <summary>
+/// Walks frames in [pos, end), resyncing byte by byte over damage.
+/// Calls fn(payload, length) for every valid record.
+/// </summary>
+template <typename Fn>
+static void forEachFrame(const uint8_t* data, size_t pos, size_t end, Fn fn) {
+    while (pos < end) {
+        const uint8_t* payload;
+        size_t len;
+        size_t used = LogFrame::next(data + pos, end - pos, &payload, &len);
+        if (used == 0) {
+            pos++;
+            continue;
+        }
+        fn(reinterpret_cast<const char*>(payload), len);
+        pos += used;
+    }
+}
+
+/// <summary>
+/// Calls fn(line, length) for every newline-terminated line in [pos, end).
+/// A final line without a newline is a torn record and is skipped.
+/// </summary>
+template <typename Fn>
+static void forEachLine(const uint8_t* data, size_t pos, size_t end, Fn fn) {
+    while (pos < end) {
+        const uint8_t* nl = static_cast<const uint8_t*>(std::memchr(data + pos, '\n', end - pos));
+        if (!nl) return;
+        size_t len = static_cast<size_t>(nl - data) - pos;
+        const char* line = reinterpret_cast<const char*>(data + pos);
+        if (len > 0 && line[len - 1] == '\r') len--;
+        fn(line, len);
+        pos = static_cast<size_t>(nl - data) + 1;
+    }
+}
+
+/// <summary>
+/// Splits a CSV line; fn(index, field, length) per field.
+/// </summary>
+template <typename Fn>
+static void forEachField(const char* line, size_t len, Fn fn) {
+    size_t index = 0, start = 0;
+    for (size_t i = 0; i <= len; ++i) {
+        if (i == len || line[i] == ',') {
+            const char* f = line + start;
+            size_t n = i - start;
+            while (n > 0 && (*f == ' ' || *f == '"')) { ++f; --n; }
+            while (n > 0 && (f[n - 1] == ' ' || f[n - 1] == '"')) --n;
+            fn(index++, f, n);
+            start = i + 1;
+        }
+    }
+}
+
+bool ParallelParser::open(const std::string& path) {
+    fileKeys.clear();
+    chunks.clear();
+    dataStart = 0;
+    if (!file.open(path)) {
+        lastError = "cannot map " + path + " (missing or empty)";
+        return false;
+    }
+
+    const uint8_t* data = file.data();
+    const size_t size = file.size();
+
+    if (data[0] == LogFrame::kMagic0) {
+        fileFormat = Format::Framed;
+        bool found = false;
+        forEachFrame(data, 0, std::min(size, LogFrame::kRecoveryWindow), [&](const char* rec, size_t len) {
+            if (!found) found = FastRecordParser::keysOf(rec, len, fileKeys);
+        });
+        return true;
+    }
+
+    size_t pos = (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) ? 3 : 0;
+    while (pos < size && (data[pos] == ' ' || data[pos] == '\r' || data[pos] == '\n')) pos++;
+
+    if (pos < size && data[pos] == '{') {
+        fileFormat = Format::Ndjson;
+        bool found = false;
+        forEachLine(data, pos, size, [&](const char* line, size_t len) {
+            if (!found) found = FastRecordParser::keysOf(line, len, fileKeys);
+        });
+        return true;
+    }
+
+    fileFormat = Format::Csv;
+    const uint8_t* nl = static_cast<const uint8_t*>(std::memchr(data + pos, '\n', size - pos));
+    size_t headerEnd = nl ? static_cast<size_t>(nl - data) : size;
+    size_t headerLen = headerEnd - pos;
+    if (headerLen > 0 && data[headerEnd - 1] == '\r') headerLen--;
+    bool hasTime = false;
+    forEachField(reinterpret_cast<const char*>(data + pos), headerLen, [&](size_t index, const char* f, size_t n) {
+        if (!hasTime && n == 9 && std::memcmp(f, "timestamp", 9) == 0) {
+            hasTime = true;
+            csvTimeField = index;
+        } else {
+            fileKeys.emplace_back(f, n);
+        }
+    });
+    if (!hasTime) {
+        lastError = path + ": not a logger file (no JSON records, no CSV timestamp column)";
+        file.close();
+        return false;
+    }
+    dataStart = nl ? headerEnd + 1 : size;
+    return true;
+}
+
+/// <summary>
+/// Cuts the file into roughly equal chunks that start on record boundaries.
+/// </summary>
+void ParallelParser::split(unsigned threads) {
+    const uint8_t* data = file.data();
+    const size_t size = file.size();
+    if (threads == 0) threads = ThreadPool::shared().size();
+
+    size_t target = std::max(MIN_CHUNK, (size - dataStart) / (static_cast<size_t>(threads) * 4) + 1);
+    chunks.clear();
+
+    size_t begin = dataStart;
+    while (begin < size) {
+        size_t end = std::min(size, begin + target);
+        if (end < size) {
+            if (fileFormat == Format::Framed) {
+                end = nextSync(data, end, size);
+            } else {
+                const uint8_t* nl = static_cast<const uint8_t*>(std::memchr(data + end, '\n', size - end));
+                end = nl ? static_cast<size_t>(nl - data) + 1 : size;
+            }
+        }
+        chunks.push_back(Chunk{ begin, end, 0, 0, 0 });
+        begin = end;
+    }
+}
+
+/// <summary>
+/// Upper bound of the records in a chunk: line breaks, or frame magic pairs for framed
+/// files (cheaper than validating every CRC twice; every valid frame starts with one).
+/// </summary>
+uint64_t ParallelParser::countChunk(const Chunk& c) const {
+    const uint8_t* data = file.data();
+    if (fileFormat != Format::Framed) return SimdScan::countByte(data + c.begin, c.end - c.begin, '\n');
+
+    uint64_t n = 0;
+    size_t pos = c.begin;
+    while (pos + 1 < c.end) {
+        const uint8_t* p = static_cast<const uint8_t*>(std::memchr(data + pos, LogFrame::kMagic0, c.end - pos - 1));
+        if (!p) break;
+        pos = static_cast<size_t>(p - data) + 1;
+        if (data[pos] == LogFrame::kMagic1) n++;
+    }
+    return n;
+}
+
+uint64_t ParallelParser::countRecords(unsigned threads) {
+    if (!file.data()) return 0;
+    split(threads);
+    ThreadPool::shared().parallelFor(chunks.size(), [&](size_t i) { chunks[i].records = countChunk(chunks[i]); }, threads);
+
+    uint64_t total = 0;
+    for (auto& c : chunks) {
+        c.outOffset = total;
+        total += c.records;
+    }
+    return total;
+}
+
+/// <summary>
+/// Parses one chunk into its output slice. Failed rows are overwritten by the next record.
+/// </summary>
+uint64_t ParallelParser::parseChunk(const Chunk& c, const std::vector<std::string>& keys,
+                                    const ParseTarget& target) const {
+    const uint8_t* data = file.data();
+    uint64_t row = c.outOffset;
+
+    if (fileFormat == Format::Csv) {
+        std::vector<int> targetOf(fileKeys.size(), -1);     // fileKeys index → output column
+        for (size_t k = 0; k < fileKeys.size(); ++k) {
+            for (size_t j = 0; j < keys.size(); ++j) {
+                if (keys[j] == fileKeys[k]) targetOf[k] = static_cast<int>(j);
+            }
+        }
+
+        forEachLine(data, c.begin, c.end, [&](const char* line, size_t len) {
+            if (len == 0) return;
+            bool ok = false;
+            size_t keyIndex = 0;
+            for (size_t j = 0; j < keys.size(); ++j) target.columns[j][row] = NAN;
+            forEachField(line, len, [&](size_t index, const char* f, size_t n) {
+                if (index == csvTimeField) {
+                    ok = TimestampFormatter::parse(f, n, target.timestamps[row]);
+                    return;
+                }
+                int col = keyIndex < fileKeys.size() ? targetOf[keyIndex] : -1;
+                keyIndex++;
+                if (col < 0) return;
+                float v;
+                auto r = std::from_chars(f, f + n, v);
+                target.columns[col][row] = (n > 0 && r.ec == std::errc() && r.ptr == f + n) ? v : NAN;
+            });
+            if (ok) row++;
+        });
+        return row - c.outOffset;
+    }
+
+    KeyMap map(keys);
+    auto onRecord = [&](const char* rec, size_t len) {
+        if (FastRecordParser::parse(rec, len, target.timestamps[row], map, target.columns, row)) row++;
+    };
+    if (fileFormat == Format::Framed) {
+        forEachFrame(data, c.begin, c.end, onRecord);
+    } else {
+        forEachLine(data, c.begin, c.end, onRecord);
+    }
+    return row - c.outOffset;
+}
+
+int64_t ParallelParser::parse(const std::vector<std::string>& keys, const ParseTarget& target, unsigned threads) {
+    if (!file.data()) {
+        lastError = "no file open";
+        return -1;
+    }
+
+    uint64_t total = countRecords(threads);
+    if (total > target.capacity) {
+        lastError = "output buffers too small: " + std::to_string(total) + " rows needed";
+        return -1;
+    }
+
+    ThreadPool::shared().parallelFor(chunks.size(), [&](size_t i) {
+        chunks[i].valid = parseChunk(chunks[i], keys, target);
+    }, threads);
+
+    // Close the gaps left by records that failed to parse
+    uint64_t rows = 0;
+    for (const auto& c : chunks) {
+        if (c.outOffset != rows && c.valid > 0) {
+            std::memmove(target.timestamps + rows, target.timestamps + c.outOffset, c.valid * sizeof(int64_t));
+            for (size_t j = 0; j < keys.size(); ++j) {
+                std::memmove(target.columns[j] + rows, target.columns[j] + c.outOffset, c.valid * sizeof(float));
+            }
+        }
+        rows += c.valid;
+    }
+    return static_cast<int64_t>(rows);
+}
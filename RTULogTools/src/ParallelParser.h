@@ -0,0 +1,80 @@
+#ifndef PARALLEL_PARSER_H
+#define PARALLEL_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+/// <summary>
+/// Caller-provided output buffers (column-major).
+/// </summary>
+struct ParseTarget {
+    int64_t* timestamps;         ///< capacity entries
+    float* const* columns;       ///< One array of capacity entries per requested key
+    uint64_t capacity;           ///< Rows the buffers can hold
+};
+
+/// <summary>
+/// Parses a whole log file into column buffers on the shared thread pool.
+///
+/// The mapped file is split into chunks at record boundaries (line breaks for
+/// NDJSON and CSV, sync markers for framed files). A first parallel pass counts
+/// the records of each chunk, a second pass parses every chunk straight into
+/// its slice of the output; rows that fail to parse are compacted away at the end.
+/// Supported inputs: NDJSON and framed logs (FastRecordParser) and CSV files with
+/// a "timestamp,key,..." header as loaded by RTULogScope's CsvLoader.
+/// </summary>
+class ParallelParser {
+public:
+    enum class Format { Ndjson, Framed, Csv };
+
+    /// <summary>
+    /// Maps the file and detects its format.
+    /// </summary>
+    bool open(const std::string& path);
+
+    Format format() const { return fileFormat; }
+
+    /// <summary>
+    /// Keys of the first record (NDJSON / framed) or the CSV header.
+    /// </summary>
+    const std::vector<std::string>& keys() const { return fileKeys; }
+
+    /// <summary>
+    /// Upper bound of the number of rows parse() will produce; size the ParseTarget with it.
+    /// </summary>
+    uint64_t countRecords(unsigned threads = 0);
+
+    /// <summary>
+    /// Parses every record, extracting the given keys in the given order.
+    /// </summary>
+    /// <returns>Number of rows written, or -1 (see error())</returns>
+    int64_t parse(const std::vector<std::string>& keys, const ParseTarget& target, unsigned threads = 0);
+
+    const std::string& error() const { return lastError; }
+
+private:
+    struct Chunk {
+        size_t begin;
+        size_t end;
+        uint64_t records;
+        uint64_t outOffset;
+        uint64_t valid;
+    };
+
+    void split(unsigned threads);
+    uint64_t countChunk(const Chunk& c) const;
+    uint64_t parseChunk(const Chunk& c, const std::vector<std::string>& keys, const ParseTarget& target) const;
+
+    MappedFile file;
+    Format fileFormat = Format::Ndjson;
+    size_t dataStart = 0;                ///< First byte after the CSV header
+    size_t csvTimeField = 0;             ///< Index of the CSV "timestamp" column
+    std::vector<std::string> fileKeys;
+    std::vector<Chunk> chunks;
+    std::string lastError;
+};
+
+#endif // PARALLEL_PARSER_H
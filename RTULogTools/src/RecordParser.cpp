@@ -0,0 +1,157 @@
+#include "RecordParser.h"
+#include "TimestampFormatter.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+/// <summary>
+/// Minimal cursor over the record text.
+/// </summary>
+struct Cursor {
+    const char* p;
+    const char* end;
+
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p;
+    }
+
+    bool eat(char c) {
+        skipSpace();
+        if (p < end && *p == c) {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+
+    /// <summary>
+    /// Reads a string token; escapes are kept verbatim (keys and units never contain them).
+    /// </summary>
+    bool string(const char*& s, size_t& len) {
+        if (!eat('"')) return false;
+        s = p;
+        while (p < end && *p != '"') {
+            if (*p == '\\') ++p;
+            ++p;
+        }
+        if (p >= end) return false;
+        len = static_cast<size_t>(p - s);
+        ++p;
+        return true;
+    }
+
+    /// <summary>
+    /// Reads a number or null; anything else yields NAN after being skipped.
+    /// </summary>
+    bool number(float& v) {
+        skipSpace();
+        if (p >= end) return false;
+        if (*p == 'n') {
+            v = NAN;
+            return skip();
+        }
+        auto r = std::from_chars(p, end, v);
+        if (r.ec != std::errc()) {
+            v = NAN;
+            return skip();
+        }
+        p = r.ptr;
+        return true;
+    }
+
+    /// <summary>
+    /// Skips any JSON value.
+    /// </summary>
+    bool skip() {
+        skipSpace();
+        if (p >= end) return false;
+        if (*p == '"') {
+            const char* s;
+            size_t n;
+            return string(s, n);
+        }
+        if (*p == '{' || *p == '[') {
+            int depth = 0;
+            while (p < end) {
+                char c = *p;
+                if (c == '"') {
+                    const char* s;
+                    size_t n;
+                    if (!string(s, n)) return false;
+                    continue;
+                }
+                ++p;
+                if (c == '{' || c == '[') depth++;
+                if ((c == '}' || c == ']') && --depth == 0) return true;
+            }
+            return false;
+        }
+        while (p < end && *p != ',' && *p != '}' && *p != ']') ++p;
+        return true;
+    }
+};
+
+bool keyIs(const char* s, size_t len, const char* name) {
+    size_t n = std::strlen(name);
+    return len == n && std::memcmp(s, name, n) == 0;
+}
+
+bool parseValue(Cursor& c, RecordValue& out) {
+    out = RecordValue{ nullptr, 0, nullptr, 0, NAN };
+    if (!c.eat('{')) return false;
+    if (c.eat('}')) return true;
+    do {
+        const char* name;
+        size_t nameLen;
+        if (!c.string(name, nameLen) || !c.eat(':')) return false;
+        if (keyIs(name, nameLen, "key")) {
+            if (!c.string(out.key, out.keyLength)) return false;
+        } else if (keyIs(name, nameLen, "value")) {
+            if (!c.number(out.value)) return false;
+        } else if (keyIs(name, nameLen, "unit")) {
+            if (!c.string(out.unit, out.unitLength)) return false;
+        } else if (!c.skip()) {
+            return false;
+        }
+    } while (c.eat(','));
+    return c.eat('}') && out.key != nullptr;
+}
+
+} // namespace
+
+bool RecordParser::parse(const char* json, size_t length, int64_t& timestampMs, std::vector<RecordValue>& values) {
+    Cursor c{ json, json + length };
+    bool haveTime = false;
+    values.clear();
+
+    if (!c.eat('{')) return false;
+    if (c.eat('}')) return false;
+    do {
+        const char* name;
+        size_t nameLen;
+        if (!c.string(name, nameLen) || !c.eat(':')) return false;
+
+        if (keyIs(name, nameLen, "timestamp")) {
+            const char* s;
+            size_t n;
+            if (!c.string(s, n) || !TimestampFormatter::parse(s, n, timestampMs)) return false;
+            haveTime = true;
+        } else if (keyIs(name, nameLen, "values")) {
+            if (!c.eat('[')) return false;
+            if (!c.eat(']')) {
+                do {
+                    RecordValue v;
+                    if (!parseValue(c, v)) return false;
+                    values.push_back(v);
+                } while (c.eat(','));
+                if (!c.eat(']')) return false;
+            }
+        } else if (!c.skip()) {
+            return false;
+        }
+    } while (c.eat(','));
+
+    return c.eat('}') && haveTime;
+}
@@ -0,0 +1,38 @@
+#ifndef RECORD_PARSER_H
+#define RECORD_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// One measurement of a parsed record. Strings point into the record text.
+/// </summary>
+struct RecordValue {
+    const char* key;
+    size_t keyLength;
+    const char* unit;        ///< nullptr if the record has no unit
+    size_t unitLength;
+    float value;             ///< NAN for null or non-numeric values
+};
+
+/// <summary>
+/// Parses a single logger record of the shape StorageManager writes:
+///   {"timestamp":"YYYY-MM-DD HH:MM:SS[.mmm]","values":[{"key":..,"value":..,"unit":..},...]}
+/// Member order does not matter and unknown members are skipped. No allocation
+/// beyond the caller's (reused) values vector.
+/// </summary>
+class RecordParser {
+public:
+    /// <summary>
+    /// Parses one record.
+    /// </summary>
+    /// <param name="json">Record text (need not be terminated)</param>
+    /// <param name="length">Length in bytes</param>
+    /// <param name="timestampMs">Receives the timestamp</param>
+    /// <param name="values">Cleared and filled with the measurements</param>
+    /// <returns>False if the record is malformed or has no valid timestamp</returns>
+    static bool parse(const char* json, size_t length, int64_t& timestampMs, std::vector<RecordValue>& values);
+};
+
+#endif // RECORD_PARSER_H
@@ -0,0 +1,125 @@
+#include "ReplayBus.h"
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+bool CaptureFile::load(const std::string& path) {
+    data.clear();
+    cycleList.clear();
+    sessionCount = 0;
+    ignored = 0;
+
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        lastError = "cannot open " + path;
+        return false;
+    }
+    char buf[65536];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) data.append(buf, n);
+    bool ok = !std::ferror(f);
+    std::fclose(f);
+    if (!ok) {
+        lastError = "cannot read " + path;
+        return false;
+    }
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+    size_t pos = 0;
+    RtuCapture::Record record;
+    while (pos < data.size()) {
+        size_t used = RtuCapture::decode(p + pos, data.size() - pos, record);
+        if (used == 0) break;
+        if (pos == 0 && record.type != RtuCapture::Record::Header) break;
+        pos += used;
+
+        if (record.type == RtuCapture::Record::Header) {
+            ++sessionCount;
+        } else if (record.type == RtuCapture::Record::Sample) {
+            cycleList.push_back({record.timestampMs, {}});
+        } else if (!cycleList.empty()) {
+            cycleList.back().transactions.push_back(record.transaction);
+        }
+    }
+    if (sessionCount == 0) {
+        lastError = path + " is not an RTU capture";
+        return false;
+    }
+    ignored = data.size() - pos;
+    if (ignored > 0 && !cycleList.empty()) cycleList.pop_back();   // Torn while appended, may be incomplete
+    return true;
+}
+
+void ReplayBus::begin(uint8_t index, bool recordedSpeed) {
+    bus = index;
+    realTime = recordedSpeed;
+    wallStart = std::chrono::steady_clock::now();
+    clockUs = 0;
+    cycleStartUs = 0;
+    queue.clear();
+    next = 0;
+    current = nullptr;
+    unmatchedCount = skippedCount = 0;
+}
+
+void ReplayBus::startCycle(const CaptureFile::Cycle& cycle, uint64_t gapUs) {
+    skippedCount += queue.size() - next;
+    queue.clear();
+    next = 0;
+    current = nullptr;
+    for (const RtuCapture::Transaction& t : cycle.transactions) {
+        if (t.bus == bus) queue.push_back(&t);
+    }
+    uint64_t startUs = cycleStartUs + gapUs;
+    if (startUs > clockUs) advance(startUs - clockUs);  // A cycle that overran starts late, as on the logger
+    cycleStartUs = clockUs;
+}
+
+/// <summary>
+/// Recorded requests passed over to reach the matching one count as skipped;
+/// a request without any match gets no answer, like a slave that stays silent.
+/// </summary>
+bool ReplayBus::write(const uint8_t* data, size_t len) {
+    current = nullptr;
+    served = 0;
+    sentUs = clockUs;
+    for (size_t i = next; i < queue.size(); ++i) {
+        const RtuCapture::Transaction* t = queue[i];
+        if (t->requestLength == len && std::memcmp(t->request, data, len) == 0) {
+            skippedCount += i - next;
+            next = i + 1;
+            current = t;
+            return true;
+        }
+    }
+    ++unmatchedCount;
+    return true;
+}
+
+uint64_t ReplayBus::arrival(size_t i) const {
+    uint64_t spreadUs = current->lastUs - current->firstUs;
+    uint64_t offsetUs = current->responseLength > 1 ? spreadUs * i / (current->responseLength - 1) : 0;
+    return sentUs + current->firstUs + offsetUs;
+}
+
+int ReplayBus::readByte(uint32_t timeoutUs) {
+    if (current && served < current->responseLength) {
+        uint64_t atUs = arrival(served);
+        if (atUs <= clockUs + timeoutUs) {
+            if (atUs > clockUs) advance(atUs - clockUs);
+            return current->response[served++];
+        }
+    }
+    advance(timeoutUs);
+    return -1;
+}
+
+void ReplayBus::discardInput() {
+    // Bytes already due were received and are dropped; later ones still arrive
+    while (current && served < current->responseLength && arrival(served) <= clockUs) ++served;
+}
+
+void ReplayBus::advance(uint64_t us) {
+    clockUs += us;
+    if (realTime) std::this_thread::sleep_until(wallStart + std::chrono::microseconds(clockUs));
+}
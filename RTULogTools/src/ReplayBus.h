@@ -0,0 +1,123 @@
+#ifndef REPLAY_BUS_H
+#define REPLAY_BUS_H
+
+#include "BusTransport.h"
+#include "RtuCapture.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Capture file of the logger (RtuCapture format) in memory, split into
+/// sample cycles. A torn record at the end (power loss while appending) ends
+/// the file; the cycle it belongs to is dropped, everything before it is kept.
+/// </summary>
+class CaptureFile {
+public:
+    /// <summary>
+    /// One poll cycle: its sample time and the transactions of all buses.
+    /// </summary>
+    struct Cycle {
+        int64_t timestampMs;
+        std::vector<RtuCapture::Transaction> transactions;
+    };
+
+    /// <summary>
+    /// Reads and splits a capture file.
+    /// </summary>
+    /// <returns>False if it cannot be read or does not start with a capture header (see error())</returns>
+    bool load(const std::string& path);
+
+    const std::vector<Cycle>& cycles() const { return cycleList; }
+
+    /// <summary>
+    /// Capture sessions (logger boots and configuration reloads) in the file.
+    /// </summary>
+    size_t sessions() const { return sessionCount; }
+
+    /// <summary>
+    /// Bytes after the last complete record (0 for an intact file).
+    /// </summary>
+    size_t ignoredBytes() const { return ignored; }
+
+    const std::string& error() const { return lastError; }
+
+private:
+    std::string data;                   ///< File contents, the transactions point into it
+    std::vector<Cycle> cycleList;
+    size_t sessionCount = 0;
+    size_t ignored = 0;
+    std::string lastError;
+};
+
+/// <summary>
+/// Bus that answers from a capture instead of a serial line, so the firmware's
+/// RtuMaster and read plan run against recorded meter behaviour.
+///
+/// Each request is matched to the next recorded request of the cycle with the
+/// same bytes; its response bytes then arrive at their recorded delays (spread
+/// evenly between the first and last byte). Time is a virtual bus clock that
+/// waits advance, so the master's timeouts and gap handling, and with them the
+/// output, are the same on every run. At recorded speed the clock is also
+/// kept in step with the wall clock, including the time between cycles.
+/// </summary>
+class ReplayBus : public BusTransport {
+public:
+    /// <summary>
+    /// Prepares the bus.
+    /// </summary>
+    /// <param name="bus">Bus index whose transactions are replayed</param>
+    /// <param name="realTime">Run at recorded speed instead of as fast as possible</param>
+    void begin(uint8_t bus, bool realTime);
+
+    /// <summary>
+    /// Queues the bus's transactions of a cycle. Recorded requests of the
+    /// previous cycle that were never sent count as skipped.
+    /// </summary>
+    /// <param name="cycle">Cycle to answer from</param>
+    /// <param name="gapUs">Bus time since the previous cycle started</param>
+    void startCycle(const CaptureFile::Cycle& cycle, uint64_t gapUs);
+
+    bool write(const uint8_t* data, size_t len) override;
+    int readByte(uint32_t timeoutUs) override;
+    void discardInput() override;
+    uint32_t nowUs() override { return static_cast<uint32_t>(clockUs); }
+
+    /// <summary>
+    /// Requests sent that the capture has no answer for.
+    /// </summary>
+    uint64_t unmatched() const { return unmatchedCount; }
+
+    /// <summary>
+    /// Recorded requests that were not sent in the replay.
+    /// </summary>
+    uint64_t skipped() const { return skippedCount; }
+
+private:
+    /// <summary>
+    /// Moves the virtual clock; at recorded speed sleeps until the wall clock caught up.
+    /// </summary>
+    void advance(uint64_t us);
+
+    /// <summary>
+    /// Virtual time at which response byte i of the current transaction arrives.
+    /// </summary>
+    uint64_t arrival(size_t i) const;
+
+    uint8_t bus = 0;
+    bool realTime = false;
+    std::chrono::steady_clock::time_point wallStart;
+    uint64_t clockUs = 0;               ///< Virtual bus clock
+    uint64_t cycleStartUs = 0;          ///< Clock when the current cycle started
+    std::vector<const RtuCapture::Transaction*> queue;
+    size_t next = 0;                    ///< First queued transaction not matched yet
+    const RtuCapture::Transaction* current = nullptr;   ///< Transaction being answered
+    uint64_t sentUs = 0;                ///< Clock when its request was sent
+    size_t served = 0;                  ///< Response bytes delivered
+    uint64_t unmatchedCount = 0;
+    uint64_t skippedCount = 0;
+};
+
+#endif // REPLAY_BUS_H
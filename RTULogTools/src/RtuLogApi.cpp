@@ -0,0 +1,208 @@
+#include "rtulog.h"
+#include "ColumnStore.h"
+#include "LodPyramid.h"
+#include "LogFollower.h"
+#include "ParallelParser.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct rtulog_store {
+    ColumnStore store;
+};
+
+struct rtulog_follower {
+    LogFollower follower;
+    std::string pending;         ///< Records read but not yet returned (did not fit)
+};
+
+static thread_local std::string lastError;
+
+const char* rtulog_last_error(void) {
+    return lastError.c_str();
+}
+
+int rtulog_convert(const char* const* inputs, size_t inputCount, const char* output) {
+    ColumnStoreWriter writer;
+    for (size_t i = 0; i < inputCount; ++i) {
+        if (!writer.addLogFile(inputs[i])) {
+            lastError = writer.error();
+            return -1;
+        }
+    }
+    if (!writer.write(output)) {
+        lastError = writer.error();
+        return -1;
+    }
+    return 0;
+}
+
+rtulog_store* rtulog_store_open(const char* path) {
+    rtulog_store* s = new rtulog_store();
+    if (!s->store.open(path)) {
+        lastError = s->store.error();
+        delete s;
+        return nullptr;
+    }
+    return s;
+}
+
+void rtulog_store_close(rtulog_store* store) {
+    delete store;
+}
+
+uint64_t rtulog_store_rows(const rtulog_store* store) {
+    return store ? store->store.rowCount() : 0;
+}
+
+uint32_t rtulog_store_columns(const rtulog_store* store) {
+    return store ? store->store.columnCount() : 0;
+}
+
+const char* rtulog_store_column_key(const rtulog_store* store, uint32_t column) {
+    return store ? store->store.columnKey(column) : nullptr;
+}
+
+const char* rtulog_store_column_unit(const rtulog_store* store, uint32_t column) {
+    return store ? store->store.columnUnit(column) : nullptr;
+}
+
+int32_t rtulog_store_find_column(const rtulog_store* store, const char* key) {
+    return store && key ? store->store.findColumn(key) : -1;
+}
+
+const int64_t* rtulog_store_timestamps(const rtulog_store* store) {
+    return store ? store->store.timestamps() : nullptr;
+}
+
+const float* rtulog_store_column(const rtulog_store* store, uint32_t column) {
+    return store ? store->store.column(column) : nullptr;
+}
+
+uint64_t rtulog_store_lower_bound(const rtulog_store* store, int64_t timeMs) {
+    return store ? store->store.lowerBound(timeMs) : 0;
+}
+
+int64_t rtulog_parse_probe(const char* path, uint64_t* records, char* keys, size_t keysSize) {
+    ParallelParser parser;
+    if (!path || !parser.open(path)) {
+        lastError = path ? parser.error() : "no path";
+        return -1;
+    }
+    if (records) *records = parser.countRecords();
+
+    std::string joined;
+    for (const auto& key : parser.keys()) {
+        if (!joined.empty()) joined += '\n';
+        joined += key;
+    }
+    if (keys && keysSize > 0) {
+        size_t n = joined.size() < keysSize ? joined.size() : keysSize - 1;
+        std::memcpy(keys, joined.data(), n);
+        keys[n] = '\0';
+    }
+    return static_cast<int64_t>(joined.size());
+}
+
+int64_t rtulog_parse_file(const char* path, const char* const* keys, uint32_t keyCount,
+                          int64_t* timestamps, float* const* columns, uint64_t capacity,
+                          uint32_t threads) {
+    if (!path || !timestamps || (keyCount > 0 && (!keys || !columns))) {
+        lastError = "invalid argument";
+        return -1;
+    }
+    ParallelParser parser;
+    if (!parser.open(path)) {
+        lastError = parser.error();
+        return -1;
+    }
+
+    std::vector<std::string> wanted(keys, keys + keyCount);
+    int64_t rows = parser.parse(wanted, ParseTarget{ timestamps, columns, capacity }, threads);
+    if (rows < 0) lastError = parser.error();
+    return rows;
+}
+
+int64_t rtulog_lod_query(const char* const* logs, size_t logCount, const char* key,
+                         int64_t fromMs, int64_t toMs, uint32_t pixels,
+                         int64_t* times, float* values, size_t capacity) {
+    if (!logs || !key || !times || !values) {
+        lastError = "invalid argument";
+        return -1;
+    }
+    LodSet set;
+    for (size_t i = 0; i < logCount; ++i) {
+        if (!set.add(logs[i])) {
+            lastError = set.error();
+            return -1;
+        }
+    }
+
+    std::vector<LodPoint> points = set.query(key, fromMs, toMs, pixels);
+    if (points.size() > capacity) {
+        lastError = "output buffers too small: " + std::to_string(points.size()) + " points needed";
+        return -1;
+    }
+    for (size_t i = 0; i < points.size(); ++i) {
+        times[i] = points[i].timeMs;
+        values[i] = points[i].value;
+    }
+    return static_cast<int64_t>(points.size());
+}
+
+rtulog_follower* rtulog_follow_open(const char* path, const char* filenameFormat, int shardFolders) {
+    if (!path) {
+        lastError = "invalid argument";
+        return nullptr;
+    }
+    rtulog_follower* f = new rtulog_follower();
+    bool opened = filenameFormat ? f->follower.openFolder(path, filenameFormat, shardFolders != 0)
+                                 : f->follower.openFile(path);
+    if (!opened) {
+        lastError = f->follower.error();
+        delete f;
+        return nullptr;
+    }
+    return f;
+}
+
+void rtulog_follow_close(rtulog_follower* follower) {
+    delete follower;
+}
+
+int64_t rtulog_follow_read(rtulog_follower* follower, int timeoutMs, char* buf, size_t bufSize) {
+    if (!follower || !buf) {
+        lastError = "invalid argument";
+        return -1;
+    }
+    // A record held back by the previous call goes first
+    size_t used = 0;
+    std::string& pending = follower->pending;
+    if (!pending.empty()) {
+        if (pending.size() > bufSize) {
+            lastError = "buffer too small: " + std::to_string(pending.size()) + " bytes needed";
+            return -1;
+        }
+        std::memcpy(buf, pending.data(), pending.size());
+        used = pending.size();
+        pending.clear();
+    }
+
+    follower->follower.poll(used > 0 ? 0 : timeoutMs, [&](const LogRecord& rec) {
+        if (rec.length + 1 <= bufSize - used) {
+            std::memcpy(buf + used, rec.json, rec.length);
+            used += rec.length;
+            buf[used++] = '\n';
+            return true;
+        }
+        // The first one that does not fit is held back, the rest stays in the file
+        pending.append(rec.json, rec.length);
+        pending += '\n';
+        return false;
+    });
+    if (used == 0 && !pending.empty()) {
+        lastError = "buffer too small: " + std::to_string(pending.size()) + " bytes needed";
+        return -1;
+    }
+    return static_cast<int64_t>(used);
+}
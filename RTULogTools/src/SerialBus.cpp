@@ -0,0 +1,212 @@
+#include "SerialBus.h"
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+SerialBus::~SerialBus() {
+    close();
+}
+
+uint32_t SerialBus::nowUs() {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+#ifdef _WIN32
+
+bool SerialBus::open(const std::string& path, uint32_t baud, uint8_t dataBits, char parity, uint8_t stopBits) {
+    close();
+    std::string name = path;
+    if (name.compare(0, 3, "COM") == 0) name = "\\\\.\\" + name;
+    HANDLE h = CreateFileA(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) {
+        lastError = "cannot open " + path;
+        return false;
+    }
+    handle = h;
+
+    DCB dcb = {};
+    dcb.DCBlength = sizeof(dcb);
+    bool ok = GetCommState(h, &dcb) != 0;
+    dcb.BaudRate = baud;
+    dcb.ByteSize = dataBits;
+    dcb.Parity = parity == 'E' ? EVENPARITY : parity == 'O' ? ODDPARITY : NOPARITY;
+    dcb.StopBits = stopBits == 2 ? TWOSTOPBITS : ONESTOPBIT;
+    dcb.fBinary = TRUE;
+    dcb.fParity = parity == 'E' || parity == 'O';
+    dcb.fOutxCtsFlow = FALSE;
+    dcb.fOutX = dcb.fInX = FALSE;
+    dcb.fDtrControl = DTR_CONTROL_ENABLE;
+    dcb.fRtsControl = RTS_CONTROL_ENABLE;
+    if (!ok || !SetCommState(h, &dcb)) {
+        lastError = "cannot configure " + path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SerialBus::close() {
+    if (handle) CloseHandle(static_cast<HANDLE>(handle));
+    handle = nullptr;
+    bufferPos = bufferLen = 0;
+}
+
+bool SerialBus::write(const uint8_t* data, size_t len) {
+    DWORD put = 0;
+    if (!WriteFile(static_cast<HANDLE>(handle), data, static_cast<DWORD>(len), &put, nullptr) || put != len) return false;
+    return FlushFileBuffers(static_cast<HANDLE>(handle)) != 0;
+}
+
+/// <summary>
+/// ReadFile returns as soon as one byte has arrived (MAXDWORD interval and
+/// multiplier) or after the total timeout.
+/// </summary>
+int SerialBus::readByte(uint32_t timeoutUs) {
+    if (bufferPos < bufferLen) return buffer[bufferPos++];
+    COMMTIMEOUTS timeouts = {};
+    timeouts.ReadIntervalTimeout = MAXDWORD;
+    timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+    timeouts.ReadTotalTimeoutConstant = (timeoutUs + 999) / 1000;
+    if (timeouts.ReadTotalTimeoutConstant == 0) timeouts.ReadTotalTimeoutConstant = 1;
+    DWORD got = 0;
+    if (!SetCommTimeouts(static_cast<HANDLE>(handle), &timeouts) ||
+        !ReadFile(static_cast<HANDLE>(handle), buffer, sizeof(buffer), &got, nullptr) || got == 0) {
+        return -1;
+    }
+    bufferPos = 1;
+    bufferLen = got;
+    return buffer[0];
+}
+
+void SerialBus::discardInput() {
+    bufferPos = bufferLen = 0;
+    if (handle) PurgeComm(static_cast<HANDLE>(handle), PURGE_RXCLEAR);
+}
+
+#else
+
+static speed_t busSpeed(uint32_t baud) {
+    switch (baud) {
+    case 1200: return B1200;
+    case 2400: return B2400;
+    case 4800: return B4800;
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 230400: return B230400;
+    default: return B115200;
+    }
+}
+
+/// <summary>
+/// Terminals (devices and ptys) are switched to raw mode with the given frame
+/// format; reads are non-blocking and wait in poll().
+/// </summary>
+bool SerialBus::open(const std::string& path, uint32_t baud, uint8_t dataBits, char parity, uint8_t stopBits) {
+    close();
+    fd = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        lastError = "cannot open " + path;
+        return false;
+    }
+
+    terminal = isatty(fd) != 0;
+    if (terminal) {
+        termios tio;
+        if (tcgetattr(fd, &tio) != 0) {
+            lastError = "cannot configure " + path;
+            close();
+            return false;
+        }
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cflag &= ~(CSIZE | CSTOPB | PARENB | PARODD);
+        tio.c_cflag |= dataBits == 7 ? CS7 : CS8;
+        if (stopBits == 2) tio.c_cflag |= CSTOPB;
+        if (parity == 'E' || parity == 'O') tio.c_cflag |= PARENB;
+        if (parity == 'O') tio.c_cflag |= PARODD;
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        cfsetispeed(&tio, busSpeed(baud));
+        cfsetospeed(&tio, busSpeed(baud));
+        if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+            lastError = "cannot configure " + path;
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void SerialBus::close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    terminal = false;
+    bufferPos = bufferLen = 0;
+}
+
+/// <summary>
+/// Returns once the frame has left the UART (tcdrain), like the logger's
+/// flush before releasing the driver enable pin.
+/// </summary>
+bool SerialBus::write(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t put = ::write(fd, data, len);
+        if (put < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) {
+                pollfd p = {fd, POLLOUT, 0};
+                ::poll(&p, 1, 100);
+                continue;
+            }
+            return false;
+        }
+        data += put;
+        len -= static_cast<size_t>(put);
+    }
+    if (terminal) tcdrain(fd);
+    return true;
+}
+
+int SerialBus::readByte(uint32_t timeoutUs) {
+    if (bufferPos < bufferLen) return buffer[bufferPos++];
+    if (fd < 0) return -1;
+
+    uint32_t startUs = nowUs();
+    for (;;) {
+        ssize_t got = ::read(fd, buffer, sizeof(buffer));
+        if (got > 0) {
+            bufferPos = 1;
+            bufferLen = static_cast<size_t>(got);
+            return buffer[0];
+        }
+        if (got < 0 && errno != EAGAIN && errno != EINTR) return -1;   // EIO: pty closed
+
+        uint32_t elapsedUs = nowUs() - startUs;
+        if (elapsedUs >= timeoutUs) return -1;
+        pollfd p = {fd, POLLIN, 0};
+        int waitMs = static_cast<int>((timeoutUs - elapsedUs + 999) / 1000);
+        if (::poll(&p, 1, waitMs) < 0 && errno != EINTR) return -1;
+    }
+}
+
+void SerialBus::discardInput() {
+    bufferPos = bufferLen = 0;
+    if (fd < 0) return;
+    if (terminal) tcflush(fd, TCIFLUSH);
+    while (::read(fd, buffer, sizeof(buffer)) > 0) {
+    }
+}
+
+#endif
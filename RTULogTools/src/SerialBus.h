@@ -0,0 +1,50 @@
+#ifndef SERIAL_BUS_H
+#define SERIAL_BUS_H
+
+#include "BusTransport.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// RS485 bus on a PC: a serial device (termios on POSIX, a COM port on Windows)
+/// or a pty, opened read/write with the logger's line settings. USB RS485
+/// adapters switch the driver direction themselves, so write() only waits
+/// until the frame has been sent. Lets the firmware's RtuMaster run on a host.
+/// </summary>
+class SerialBus : public BusTransport {
+public:
+    SerialBus() = default;
+    ~SerialBus() override;
+    SerialBus(const SerialBus&) = delete;
+    SerialBus& operator=(const SerialBus&) = delete;
+
+    /// <summary>
+    /// Opens a device with the given line settings (parity 'N', 'E' or 'O').
+    /// </summary>
+    /// <returns>False if it cannot be opened or configured (see error())</returns>
+    bool open(const std::string& path, uint32_t baud, uint8_t dataBits = 8, char parity = 'N', uint8_t stopBits = 1);
+
+    void close();
+
+    bool write(const uint8_t* data, size_t len) override;
+    int readByte(uint32_t timeoutUs) override;
+    void discardInput() override;
+    uint32_t nowUs() override;
+
+    const std::string& error() const { return lastError; }
+
+private:
+#ifdef _WIN32
+    void* handle = nullptr;
+#else
+    int fd = -1;
+    bool terminal = false;
+#endif
+    uint8_t buffer[256];                ///< Bytes read ahead of readByte()
+    size_t bufferPos = 0;
+    size_t bufferLen = 0;
+    std::string lastError;
+};
+
+#endif // SERIAL_BUS_H
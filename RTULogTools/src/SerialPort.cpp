@@ -0,0 +1,167 @@
+#include "SerialPort.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+SerialPort::~SerialPort() {
+    close();
+}
+
+bool SerialPort::open(const std::string& path, uint32_t baud) {
+    return openMode(path, baud, false);
+}
+
+bool SerialPort::openForWrite(const std::string& path, uint32_t baud) {
+    return openMode(path, baud, true);
+}
+
+#ifdef _WIN32
+
+/// <summary>
+/// COM ports ("COM3", "\\.\COM12") get a DCB and read timeouts; anything else is opened as a file.
+/// </summary>
+bool SerialPort::openMode(const std::string& path, uint32_t baud, bool forWrite) {
+    close();
+    std::string name = path;
+    if (name.compare(0, 3, "COM") == 0) name = "\\\\.\\" + name;
+    HANDLE h = CreateFileA(name.c_str(), forWrite ? GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           forWrite && name.compare(0, 4, "\\\\.\\") != 0 ? CREATE_ALWAYS : OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) {
+        lastError = "cannot open " + path;
+        return false;
+    }
+    handle = h;
+
+    DCB dcb = {};
+    dcb.DCBlength = sizeof(dcb);
+    terminal = GetCommState(h, &dcb) != 0;
+    if (terminal) {
+        dcb.BaudRate = baud;
+        dcb.ByteSize = 8;
+        dcb.Parity = NOPARITY;
+        dcb.StopBits = ONESTOPBIT;
+        dcb.fBinary = TRUE;
+        dcb.fOutxCtsFlow = FALSE;
+        dcb.fOutX = dcb.fInX = FALSE;
+        dcb.fDtrControl = DTR_CONTROL_ENABLE;
+        dcb.fRtsControl = RTS_CONTROL_ENABLE;
+        COMMTIMEOUTS timeouts = {};
+        timeouts.ReadIntervalTimeout = 20;
+        timeouts.ReadTotalTimeoutConstant = 200;
+        if (!SetCommState(h, &dcb) || !SetCommTimeouts(h, &timeouts)) {
+            lastError = "cannot configure " + path;
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void SerialPort::close() {
+    if (handle) CloseHandle(static_cast<HANDLE>(handle));
+    handle = nullptr;
+    terminal = false;
+}
+
+long SerialPort::read(uint8_t* buf, size_t len) {
+    DWORD got = 0;
+    if (!ReadFile(static_cast<HANDLE>(handle), buf, static_cast<DWORD>(len), &got, nullptr)) return -1;
+    if (got == 0 && !terminal) return -1;
+    return static_cast<long>(got);
+}
+
+bool SerialPort::write(const uint8_t* buf, size_t len) {
+    DWORD put = 0;
+    return WriteFile(static_cast<HANDLE>(handle), buf, static_cast<DWORD>(len), &put, nullptr) && put == len;
+}
+
+#else
+
+static speed_t speedFor(uint32_t baud) {
+    switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return B115200;
+    }
+}
+
+/// <summary>
+/// Terminals are switched to raw 8N1 with a 200 ms read timeout (VMIN 0, VTIME 2).
+/// </summary>
+bool SerialPort::openMode(const std::string& path, uint32_t baud, bool forWrite) {
+    close();
+    if (path == "-") {
+        fd = forWrite ? STDOUT_FILENO : STDIN_FILENO;
+        ownsFd = false;
+    } else {
+        fd = ::open(path.c_str(), forWrite ? (O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY) : (O_RDONLY | O_NOCTTY), 0644);
+        ownsFd = true;
+    }
+    if (fd < 0) {
+        lastError = "cannot open " + path;
+        return false;
+    }
+
+    terminal = isatty(fd) != 0;
+    if (terminal) {
+        termios tio;
+        if (tcgetattr(fd, &tio) != 0) {
+            lastError = "cannot configure " + path;
+            close();
+            return false;
+        }
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cflag &= ~(CSTOPB | PARENB);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 2;
+        cfsetispeed(&tio, speedFor(baud));
+        cfsetospeed(&tio, speedFor(baud));
+        if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+            lastError = "cannot configure " + path;
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void SerialPort::close() {
+    if (fd >= 0 && ownsFd) ::close(fd);
+    fd = -1;
+    terminal = false;
+}
+
+long SerialPort::read(uint8_t* buf, size_t len) {
+    ssize_t got = ::read(fd, buf, len);
+    if (got > 0) return static_cast<long>(got);
+    if (got == 0) return terminal ? 0 : -1;     // Timeout on a terminal, end of a file or pipe
+    return errno == EINTR ? 0 : -1;             // Interrupted (Ctrl+C) lets the caller check; EIO: pty closed
+}
+
+bool SerialPort::write(const uint8_t* buf, size_t len) {
+    while (len > 0) {
+        ssize_t put = ::write(fd, buf, len);
+        if (put < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        buf += put;
+        len -= static_cast<size_t>(put);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef SERIAL_PORT_H
+#define SERIAL_PORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// Byte source for stream receivers: a serial device (termios on POSIX, a COM port on
+/// Windows) set to raw 8N1 at a given baud rate, or a plain file / pipe for replays.
+/// Reads wait at most a short timeout, so callers can check for cancellation.
+/// </summary>
+class SerialPort {
+public:
+    SerialPort() = default;
+    ~SerialPort();
+    SerialPort(const SerialPort&) = delete;
+    SerialPort& operator=(const SerialPort&) = delete;
+
+    /// <summary>
+    /// Opens a device or file ("-" = standard input). Baud rate and raw mode are only
+    /// applied to terminals.
+    /// </summary>
+    /// <returns>False if it cannot be opened or configured (see error())</returns>
+    bool open(const std::string& path, uint32_t baud = 115200);
+
+    /// <summary>
+    /// Opens a device or file for writing (used to emit test streams).
+    /// </summary>
+    bool openForWrite(const std::string& path, uint32_t baud = 115200);
+
+    void close();
+
+    /// <summary>
+    /// Reads what is available, waiting up to about 200 ms.
+    /// </summary>
+    /// <returns>Bytes read; 0 on timeout; -1 at the end of a file or if the device went away</returns>
+    long read(uint8_t* buf, size_t len);
+
+    /// <summary>
+    /// Writes all bytes.
+    /// </summary>
+    bool write(const uint8_t* buf, size_t len);
+
+    bool isTerminal() const { return terminal; }
+    const std::string& error() const { return lastError; }
+
+private:
+    bool openMode(const std::string& path, uint32_t baud, bool forWrite);
+
+#ifdef _WIN32
+    void* handle = nullptr;
+#else
+    int fd = -1;
+    bool ownsFd = false;
+#endif
+    bool terminal = false;
+    std::string lastError;
+};
+
+#endif // SERIAL_PORT_H
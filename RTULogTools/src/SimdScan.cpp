@@ -0,0 +1,168 @@
+#include "SimdScan.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_SCAN_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SCAN_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_SCAN_NEON 1
+#endif
+
+namespace SimdScan {
+
+#if defined(SIMD_SCAN_AVX2)
+
+/// <summary>
+/// Quote, backslash and operator masks of 32 bytes. '{' / '[' and '}' / ']' differ only
+/// in bit 5, so OR-ing 0x20 folds the four brackets into two compares; the compares of a
+/// class are combined before the (comparatively expensive) movemask.
+/// </summary>
+static inline void classify32(__m256i v, uint32_t& quote, uint32_t& backslash, uint32_t& op) {
+    __m256i folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i ops = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                        _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+    quote = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))));
+    backslash = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))));
+    op = static_cast<uint32_t>(_mm256_movemask_epi8(ops));
+}
+
+BlockMasks classify(const uint8_t* block) {
+    uint32_t q[2], b[2], o[2];
+    for (int i = 0; i < 2; ++i) {
+        classify32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i)), q[i], b[i], o[i]);
+    }
+    BlockMasks m;
+    m.quote = q[0] | (static_cast<uint64_t>(q[1]) << 32);
+    m.backslash = b[0] | (static_cast<uint64_t>(b[1]) << 32);
+    m.op = o[0] | (static_cast<uint64_t>(o[1]) << 32);
+    return m;
+}
+
+const char* isaName() { return "avx2"; }
+
+#elif defined(SIMD_SCAN_SSE2)
+
+/// <summary>
+/// Same as the AVX2 variant for 16 bytes.
+/// </summary>
+static inline void classify16(__m128i v, uint32_t& quote, uint32_t& backslash, uint32_t& op) {
+    __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i ops = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+    quote = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))));
+    backslash = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+    op = static_cast<uint32_t>(_mm_movemask_epi8(ops));
+}
+
+BlockMasks classify(const uint8_t* block) {
+    BlockMasks m = { 0, 0, 0 };
+    for (int i = 0; i < 4; ++i) {
+        uint32_t q, b, o;
+        classify16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i)), q, b, o);
+        m.quote |= static_cast<uint64_t>(q) << (16 * i);
+        m.backslash |= static_cast<uint64_t>(b) << (16 * i);
+        m.op |= static_cast<uint64_t>(o) << (16 * i);
+    }
+    return m;
+}
+
+const char* isaName() { return "sse2"; }
+
+#elif defined(SIMD_SCAN_NEON)
+
+static inline uint64_t movemask(uint8x16_t v) {
+    // Narrow each 0x00/0xFF byte to a nibble, giving 64 bits for 16 bytes, then pick one bit per nibble
+    uint64_t nibbles = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+    uint64_t r = 0;
+    for (int i = 0; i < 16; ++i) r |= ((nibbles >> (4 * i)) & 1u) << i;
+    return r;
+}
+
+BlockMasks classify(const uint8_t* block) {
+    BlockMasks m = { 0, 0, 0 };
+    for (int i = 0; i < 4; ++i) {
+        uint8x16_t v = vld1q_u8(block + 16 * i);
+        uint8x16_t folded = vorrq_u8(v, vdupq_n_u8(0x20));
+        uint8x16_t ops = vorrq_u8(vorrq_u8(vceqq_u8(folded, vdupq_n_u8('{')), vceqq_u8(folded, vdupq_n_u8('}'))),
+                                  vorrq_u8(vceqq_u8(v, vdupq_n_u8(':')), vceqq_u8(v, vdupq_n_u8(','))));
+        m.quote |= movemask(vceqq_u8(v, vdupq_n_u8('"'))) << (16 * i);
+        m.backslash |= movemask(vceqq_u8(v, vdupq_n_u8('\\'))) << (16 * i);
+        m.op |= movemask(ops) << (16 * i);
+    }
+    return m;
+}
+
+const char* isaName() { return "neon"; }
+
+#else
+
+BlockMasks classify(const uint8_t* block) {
+    BlockMasks m = { 0, 0, 0 };
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        uint64_t bit = uint64_t(1) << i;
+        switch (block[i]) {
+            case '"': m.quote |= bit; break;
+            case '\\': m.backslash |= bit; break;
+            case '{': case '}': case '[': case ']': case ':': case ',': m.op |= bit; break;
+            default: break;
+        }
+    }
+    return m;
+}
+
+const char* isaName() { return "scalar"; }
+
+#endif
+
+/// <summary>
+/// Counts a byte value one vector at a time, scalar for the remainder. Matches are
+/// accumulated in per-byte counters (compare result is -1) and summed every 255 vectors,
+/// which avoids a popcount per vector on CPUs / builds without POPCNT.
+/// </summary>
+size_t countByte(const uint8_t* data, size_t length, uint8_t value) {
+    size_t count = 0;
+    size_t i = 0;
+#if defined(SIMD_SCAN_AVX2)
+    const __m256i k = _mm256_set1_epi8(static_cast<char>(value));
+    while (i + 32 <= length) {
+        __m256i acc = _mm256_setzero_si256();
+        for (int n = 0; n < 255 && i + 32 <= length; ++n, i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(v, k));
+        }
+        __m256i sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+        count += static_cast<size_t>(_mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) +
+                                     _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3));
+    }
+#elif defined(SIMD_SCAN_SSE2)
+    const __m128i k = _mm_set1_epi8(static_cast<char>(value));
+    while (i + 16 <= length) {
+        __m128i acc = _mm_setzero_si128();
+        for (int n = 0; n < 255 && i + 16 <= length; ++n, i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, k));
+        }
+        __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+        count += static_cast<size_t>(_mm_cvtsi128_si32(sums)) +
+                 static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+    }
+#elif defined(SIMD_SCAN_NEON)
+    const uint8x16_t k = vdupq_n_u8(value);
+    for (; i + 16 <= length; i += 16) {
+        uint8x16_t eq = vceqq_u8(vld1q_u8(data + i), k);
+        count += vaddvq_u8(vshrq_n_u8(eq, 7));
+    }
+#endif
+    for (; i < length; ++i) count += (data[i] == value);
+    return count;
+}
+
+} // namespace SimdScan
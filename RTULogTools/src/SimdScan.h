@@ -0,0 +1,56 @@
+#ifndef SIMD_SCAN_H
+#define SIMD_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// SIMD byte classification used by the fast parsers (SSE2 / AVX2 on x86,
+/// NEON on ARM, portable scalar code elsewhere). All functions work on
+/// 64-byte blocks and return one bit per byte, bit i = byte i.
+/// </summary>
+namespace SimdScan {
+
+constexpr size_t kBlockSize = 64;
+
+/// <summary>
+/// Character classes of one 64-byte block.
+/// </summary>
+struct BlockMasks {
+    uint64_t quote;          ///< '"'
+    uint64_t backslash;      ///< '\'
+    uint64_t op;             ///< { } [ ] : ,
+};
+
+/// <summary>
+/// Classifies 64 bytes. The block must be fully readable.
+/// </summary>
+BlockMasks classify(const uint8_t* block);
+
+/// <summary>
+/// Bit i of the result is the XOR of bits 0..i of x (inclusive prefix XOR).
+/// Turns a quote mask into an "inside string" mask.
+/// </summary>
+inline uint64_t prefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/// <summary>
+/// Counts occurrences of a byte.
+/// </summary>
+size_t countByte(const uint8_t* data, size_t length, uint8_t value);
+
+/// <summary>
+/// Name of the instruction set the scanner was compiled for.
+/// </summary>
+const char* isaName();
+
+} // namespace SimdScan
+
+#endif // SIMD_SCAN_H
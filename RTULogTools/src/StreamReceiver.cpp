@@ -0,0 +1,135 @@
+#include "StreamReceiver.h"
+#include "StreamProtocol.h"
+#include <cmath>
+#include <cstring>
+
+using namespace StreamProtocol;
+
+/// <summary>
+/// Reads into a buffer, decodes every complete frame and keeps the partial tail.
+/// </summary>
+bool StreamReceiver::run(SerialPort& port, MergeFormat format, const std::string& path, uint64_t maxSamples,
+                         const std::atomic<bool>& stop) {
+    outputFormat = format;
+    outputPath = path;
+    sink.reset();
+    keyList.clear();
+    unitList.clear();
+    haveSeq = haveDropped = false;
+    counters = StreamStats();
+
+    std::vector<uint8_t> buf(4 * (kMaxPayload + kOverhead));
+    size_t have = 0;
+    bool done = false;
+
+    while (!done && !stop.load()) {
+        long got = port.read(buf.data() + have, buf.size() - have);
+        if (got < 0) break;
+        have += static_cast<size_t>(got);
+
+        size_t pos = 0;
+        while (pos < have) {
+            size_t consumed = 0;
+            Frame frame;
+            DecodeStatus status = decode(buf.data() + pos, have - pos, consumed, frame);
+            if (status == DecodeStatus::NeedMore) break;
+            pos += consumed;
+            if (status == DecodeStatus::Skipped) {
+                counters.skippedBytes += consumed;
+                continue;
+            }
+            counters.frames++;
+            if (!onFrame(frame.payload, frame.length, frame.type, frame.seq)) {
+                if (!counters.schemaChanged) return false;     // Write error, the partial output is discarded
+                done = true;
+                break;
+            }
+            if (maxSamples && counters.samples >= maxSamples) {
+                done = true;
+                break;
+            }
+        }
+        std::memmove(buf.data(), buf.data() + pos, have - pos);
+        have -= pos;
+    }
+
+    if (!sink) {
+        lastError = counters.frames ? "no schema frame received" : "no stream frames received";
+        return false;
+    }
+    if (!sink->finish()) {
+        lastError = sink->error();
+        return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// The first schema opens the output; samples are checked against it and written as rows.
+/// </summary>
+bool StreamReceiver::onFrame(const uint8_t* payload, size_t length, uint8_t type, uint32_t seq) {
+    // Only count forward gaps; a smaller number means the logger restarted
+    if (haveSeq && seq > lastSeq + 1) counters.lostFrames += seq - lastSeq - 1;
+    haveSeq = true;
+    lastSeq = seq;
+
+    if (type == kTypeSchema) {
+        uint32_t hash;
+        uint16_t count;
+        size_t pos;
+        if (!decodeSchemaHeader(payload, length, hash, count, pos)) return true;
+        if (sink) {
+            if (hash == schemaHash) return true;
+            counters.schemaChanged = true;
+            return false;
+        }
+
+        std::vector<std::string> keys, units;
+        for (uint16_t i = 0; i < count; ++i) {
+            const char* key;
+            const char* unit;
+            size_t keyLen, unitLen;
+            if (!decodeSchemaEntry(payload, length, pos, key, keyLen, unit, unitLen)) return true;
+            keys.emplace_back(key, keyLen);
+            units.emplace_back(unit, unitLen);
+        }
+        keyList.swap(keys);
+        unitList.swap(units);
+        schemaHash = hash;
+        values.assign(keyList.size(), NAN);
+        present.assign(keyList.size(), 1);
+
+        sink = MergeSink::create(outputFormat, outputPath);
+        if (!sink->begin(keyList, unitList)) {
+            lastError = sink->error();
+            sink.reset();
+            return false;
+        }
+        return true;
+    }
+
+    SampleHeader header;
+    const uint8_t* raw;
+    if (!sink) {
+        counters.beforeSchema++;
+        return true;
+    }
+    if (!decodeSample(payload, length, header, raw) || header.schemaHash != schemaHash ||
+        header.count != keyList.size()) {
+        counters.malformed++;
+        return true;
+    }
+
+    // Cumulative on the logger; a smaller value means it restarted
+    if (haveDropped) counters.senderDropped += header.dropped >= lastDropped ? header.dropped - lastDropped : header.dropped;
+    haveDropped = true;
+    lastDropped = header.dropped;
+
+    for (size_t i = 0; i < header.count; ++i) values[i] = sampleValue(raw, i);
+    if (!sink->row(header.timestampMs, values.data(), present.data())) {
+        lastError = sink->error();
+        return false;
+    }
+    counters.samples++;
+    return true;
+}
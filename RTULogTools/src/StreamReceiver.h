@@ -0,0 +1,69 @@
+#ifndef STREAM_RECEIVER_H
+#define STREAM_RECEIVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "LogMerger.h"
+#include "SerialPort.h"
+
+/// <summary>
+/// Counters of one receive run.
+/// </summary>
+struct StreamStats {
+    uint64_t frames = 0;            ///< Frames with a valid CRC
+    uint64_t samples = 0;           ///< Sample rows written
+    uint64_t skippedBytes = 0;      ///< Text, noise and corrupt frames between valid frames
+    uint64_t lostFrames = 0;        ///< Gaps in the frame sequence (lost in transit)
+    uint64_t senderDropped = 0;     ///< Samples the logger dropped because the port was busy
+    uint64_t beforeSchema = 0;      ///< Samples received before the first schema frame (ignored)
+    uint64_t malformed = 0;         ///< Sample frames that do not match the schema
+    bool schemaChanged = false;     ///< Stopped because the logger's register set changed
+};
+
+/// <summary>
+/// Decodes the logger's binary live stream (see StreamProtocol.h) into the same outputs
+/// rtulog-merge writes: NDJSON or framed log records, CSV, or a columnar store.
+/// The output starts with the first schema frame; samples before it are skipped.
+/// </summary>
+class StreamReceiver {
+public:
+    /// <summary>
+    /// Receives until the source ends, maxSamples rows were written (0 = no limit),
+    /// stop is set, or the schema changes. The output is completed in every case.
+    /// </summary>
+    /// <returns>False on read or write errors (see error())</returns>
+    bool run(SerialPort& port, MergeFormat format, const std::string& path, uint64_t maxSamples,
+             const std::atomic<bool>& stop);
+
+    const StreamStats& stats() const { return counters; }
+    const std::vector<std::string>& keys() const { return keyList; }
+    const std::string& error() const { return lastError; }
+
+private:
+    /// <summary>
+    /// Handles one valid frame.
+    /// </summary>
+    /// <returns>False if receiving has to stop (write error or schema change)</returns>
+    bool onFrame(const uint8_t* payload, size_t length, uint8_t type, uint32_t seq);
+
+    MergeFormat outputFormat = MergeFormat::Ndjson;
+    std::string outputPath;
+    std::unique_ptr<MergeSink> sink;
+    std::vector<std::string> keyList;
+    std::vector<std::string> unitList;
+    uint32_t schemaHash = 0;
+    bool haveSeq = false;
+    uint32_t lastSeq = 0;
+    bool haveDropped = false;
+    uint32_t lastDropped = 0;
+    std::vector<float> values;
+    std::vector<uint8_t> present;
+    StreamStats counters;
+    std::string lastError;
+};
+
+#endif // STREAM_RECEIVER_H
@@ -0,0 +1,80 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+/// <summary>
+/// Claims indices until the job is exhausted.
+/// </summary>
+void ThreadPool::runJob() {
+    for (;;) {
+        size_t i;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (nextIndex >= jobCount) return;
+            i = nextIndex++;
+        }
+        (*job)(i);
+    }
+}
+
+void ThreadPool::workerLoop(unsigned id) {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            if (id >= jobThreads) continue;
+            busy++;
+        }
+        runJob();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy--;
+        }
+        done.notify_all();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn, unsigned maxThreads) {
+    if (count == 0) return;
+    std::lock_guard<std::mutex> jobLock(jobMutex);
+
+    unsigned threads = maxThreads == 0 || maxThreads > size() ? size() : maxThreads;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        jobCount = count;
+        nextIndex = 0;
+        jobThreads = threads;
+        generation++;
+    }
+    if (threads > 1) wake.notify_all();
+
+    runJob();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return busy == 0 && nextIndex >= jobCount; });
+    job = nullptr;
+}
@@ -0,0 +1,62 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Fixed set of worker threads executing parallel loops.
+/// parallelFor() hands out indices dynamically, so uneven chunks balance out;
+/// the calling thread takes part in the work.
+/// </summary>
+class ThreadPool {
+public:
+    /// <summary>
+    /// Starts the workers (0 = one per hardware thread).
+    /// </summary>
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// <summary>
+    /// Runs fn(i) for every i in [0, count) and returns when all calls finished.
+    /// At most maxThreads threads are used (0 = all).
+    /// </summary>
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn, unsigned maxThreads = 0);
+
+    /// <summary>
+    /// Number of threads including the caller.
+    /// </summary>
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    /// <summary>
+    /// Process-wide pool shared by the library functions.
+    /// </summary>
+    static ThreadPool& shared();
+
+private:
+    void workerLoop(unsigned id);
+    void runJob();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::mutex jobMutex;                       // One parallelFor at a time
+
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    size_t nextIndex = 0;
+    unsigned jobThreads = 0;                   // Workers taking part in the current job
+    unsigned busy = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,190 @@
+#include "TraceExport.h"
+#include "FileUtil.h"
+#include "TraceFormat.h"
+#include <cstdio>
+#include <cstring>
+
+/// <summary>
+/// Appends a JSON string (event and task names are plain, but stay valid JSON regardless).
+/// </summary>
+static void appendString(std::string& out, const std::string& text) {
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out += c;
+    }
+    out += '"';
+}
+
+bool TraceExport::read(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        lastError = "cannot open " + path;
+        return false;
+    }
+    std::string text(static_cast<size_t>(FileUtil::sizeOf(f)), '\0');
+    bool ok = std::fread(&text[0], 1, text.size(), f) == text.size();
+    std::fclose(f);
+    if (!ok) {
+        lastError = "cannot read " + path;
+        return false;
+    }
+
+    uint64_t before = counters.dumps;
+    readText(text.data(), text.size());
+    if (counters.dumps == before) {
+        lastError = "no trace dump (\"@trace\" line) in " + path;
+        return false;
+    }
+    return true;
+}
+
+void TraceExport::readText(const char* text, size_t length) {
+    std::string current;
+    for (size_t i = 0; i < length; ++i) {
+        char c = text[i];
+        if (c != '\n' && c != '\r') {
+            current += c;
+            continue;
+        }
+        if (!current.empty()) line(current.c_str());
+        current.clear();
+    }
+    if (!current.empty()) line(current.c_str());
+    endDump();
+}
+
+/// <summary>
+/// A capture may end in the middle of a dump, or hold the start of one dump
+/// followed by the next: a header or "@end" closes the current dump.
+/// </summary>
+void TraceExport::line(const char* text) {
+    TraceFormat::Line parsed;
+    switch (TraceFormat::parse(text, parsed)) {
+        case TraceFormat::LineType::Header:
+            endDump();
+            inDump = true;
+            ++counters.dumps;
+            counters.overwritten += parsed.overwritten;
+            baseUs = 0;
+            lastUs = 0;
+            prevUs = 0;
+            return;
+
+        case TraceFormat::LineType::Task:
+            if (!inDump) break;
+            tasks.push_back({ static_cast<uint32_t>(counters.dumps), parsed.task, parsed.name });
+            return;
+
+        case TraceFormat::LineType::Event: {
+            if (!inDump) break;
+            // micros() wraps after 2^32 us; events are in recording order, a
+            // step back of more than half the range is a wrap
+            if (parsed.timeUs < prevUs && prevUs - parsed.timeUs > 0x80000000u) baseUs += 0x100000000ull;
+            prevUs = parsed.timeUs;
+            uint64_t timeUs = baseUs + parsed.timeUs;
+            if (timeUs > lastUs) lastUs = timeUs;
+
+            if (open.size() <= parsed.task) open.resize(parsed.task + 1);
+            std::vector<size_t>& stack = open[parsed.task];
+            if (parsed.phase == TraceFormat::kEnd) {
+                if (stack.empty()) {
+                    ++counters.orphans;  // Its begin was overwritten in the ring
+                    return;
+                }
+                stack.pop_back();
+            } else if (parsed.phase == TraceFormat::kBegin) {
+                stack.push_back(events.size());
+            }
+            events.push_back({ timeUs, static_cast<uint32_t>(counters.dumps), parsed.task, parsed.phase, parsed.id,
+                               parsed.name });
+            return;
+        }
+
+        case TraceFormat::LineType::End:
+            endDump();
+            return;
+
+        case TraceFormat::LineType::None:
+            break;
+    }
+
+    const char* at = std::strchr(text, '@');
+    if (at && (std::strncmp(at, "@E ", 3) == 0 || std::strncmp(at, "@T ", 3) == 0 || std::strncmp(at, "@trace", 6) == 0)) {
+        ++counters.malformed;
+    }
+}
+
+/// <summary>
+/// Closes the scopes still open at the end of a dump, innermost first.
+/// </summary>
+void TraceExport::endDump() {
+    if (!inDump) return;
+    inDump = false;
+    for (size_t task = 0; task < open.size(); ++task) {
+        std::vector<size_t>& stack = open[task];
+        while (!stack.empty()) {
+            Event end = events[stack.back()];
+            stack.pop_back();
+            end.timeUs = lastUs;
+            end.phase = TraceFormat::kEnd;
+            events.push_back(end);
+            ++counters.unterminated;
+        }
+    }
+    open.clear();
+    counters.events = events.size();
+}
+
+std::string TraceExport::json() const {
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto begin = [&]() {
+        if (!first) out += ",\n";
+        first = false;
+    };
+
+    for (uint32_t dump = 1; dump <= counters.dumps; ++dump) {
+        begin();
+        out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(dump) +
+               ",\"tid\":0,\"args\":{\"name\":\"RTU logger, dump " + std::to_string(dump) + "\"}}";
+    }
+    for (const Task& task : tasks) {
+        begin();
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + std::to_string(task.dump) +
+               ",\"tid\":" + std::to_string(task.task) + ",\"args\":{\"name\":";
+        appendString(out, task.name);
+        out += "}}";
+    }
+
+    for (const Event& e : events) {
+        begin();
+        out += "{\"name\":";
+        appendString(out, e.name);
+        out += ",\"ph\":\"";
+        out += e.phase;
+        out += "\",\"ts\":" + std::to_string(e.timeUs) + ",\"pid\":" + std::to_string(e.dump) +
+               ",\"tid\":" + std::to_string(e.task);
+        if (e.phase == TraceFormat::kInstant) out += ",\"s\":\"t\"";
+        out += ",\"args\":{\"id\":" + std::to_string(e.id) + "}}";
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+bool TraceExport::write(const std::string& path) {
+    std::string text = json();
+    if (path == "-") {
+        if (std::fwrite(text.data(), 1, text.size(), stdout) != text.size()) {
+            lastError = "cannot write to stdout";
+            return false;
+        }
+        return true;
+    }
+    if (!FileUtil::writeAtomically(path, text.data(), text.size())) {
+        lastError = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
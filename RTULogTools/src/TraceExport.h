@@ -0,0 +1,92 @@
+#ifndef TRACE_EXPORT_H
+#define TRACE_EXPORT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Counters of one conversion.
+/// </summary>
+struct TraceExportStats {
+    uint64_t dumps = 0;           ///< "@trace" headers found
+    uint64_t events = 0;          ///< Events written
+    uint64_t overwritten = 0;     ///< Events the logger's ring had dropped before dumping (from the headers)
+    uint64_t orphans = 0;         ///< End events whose begin was overwritten (dropped)
+    uint64_t unterminated = 0;    ///< Begin events without end, closed at the last event of their dump
+    uint64_t malformed = 0;       ///< Lines starting like trace lines that did not parse
+};
+
+/// <summary>
+/// Converts trace dumps of the logger (TraceFormat lines, see Trace.h of the
+/// firmware) into Chrome trace JSON, for chrome://tracing or ui.perfetto.dev.
+///
+/// Input is a file saved with "trace save" or a capture of the serial port
+/// holding any number of dumps between other output; every dump becomes one
+/// process with a thread per logger task. micros() wrapped around within a
+/// dump is unwrapped, so timestamps are microseconds since the logger booted
+/// (modulo 71 minutes for the first event).
+/// </summary>
+class TraceExport {
+public:
+    /// <summary>
+    /// Reads the dumps in a file.
+    /// </summary>
+    /// <returns>False if the file cannot be read or holds no dump (see error())</returns>
+    bool read(const std::string& path);
+
+    /// <summary>
+    /// Reads the dumps in text already in memory.
+    /// </summary>
+    void readText(const char* text, size_t length);
+
+    /// <summary>
+    /// Writes the events read so far as Chrome trace JSON; "-" writes to stdout.
+    /// </summary>
+    bool write(const std::string& path);
+
+    /// <summary>
+    /// The JSON document write() produces.
+    /// </summary>
+    std::string json() const;
+
+    const TraceExportStats& stats() const { return counters; }
+    const std::string& error() const { return lastError; }
+
+private:
+    /// <summary>
+    /// A converted event.
+    /// </summary>
+    struct Event {
+        uint64_t timeUs;
+        uint32_t dump;
+        uint16_t task;
+        char phase;
+        uint32_t id;
+        std::string name;
+    };
+
+    /// <summary>
+    /// Name of a task of a dump.
+    /// </summary>
+    struct Task {
+        uint32_t dump;
+        uint16_t task;
+        std::string name;
+    };
+
+    void line(const char* text);
+    void endDump();
+
+    std::vector<Event> events;
+    std::vector<Task> tasks;
+    std::vector<std::vector<size_t>> open;    ///< Per task of the current dump: indices of unclosed begin events
+    bool inDump = false;
+    uint32_t prevUs = 0;                      ///< Raw time of the previous event of the dump
+    uint64_t baseUs = 0;                      ///< Added to raw times (wrap-arounds so far)
+    uint64_t lastUs = 0;
+    TraceExportStats counters;
+    std::string lastError;
+};
+
+#endif // TRACE_EXPORT_H
@@ -0,0 +1,103 @@
+#ifndef RTULOG_H
+#define RTULOG_H
+
+/*
+ * C ABI of the RTULogTools library (rtulog.dll / librtulog.so) for the desktop
+ * viewer and other non-C++ callers. All pointers returned for an open store stay
+ * valid until rtulog_store_close(); strings are NUL terminated UTF-8.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#  ifdef RTULOG_BUILD
+#    define RTULOG_API __declspec(dllexport)
+#  else
+#    define RTULOG_API __declspec(dllimport)
+#  endif
+#else
+#  define RTULOG_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rtulog_store rtulog_store;
+typedef struct rtulog_follower rtulog_follower;
+
+/* Returns a description of the last failure on the calling thread. */
+RTULOG_API const char* rtulog_last_error(void);
+
+/* Converts log files (NDJSON or framed) into one columnar store. Returns 0 on success. */
+RTULOG_API int rtulog_convert(const char* const* inputs, size_t inputCount, const char* output);
+
+/* Maps a columnar store. Returns NULL on failure. */
+RTULOG_API rtulog_store* rtulog_store_open(const char* path);
+RTULOG_API void rtulog_store_close(rtulog_store* store);
+
+RTULOG_API uint64_t rtulog_store_rows(const rtulog_store* store);
+RTULOG_API uint32_t rtulog_store_columns(const rtulog_store* store);
+RTULOG_API const char* rtulog_store_column_key(const rtulog_store* store, uint32_t column);
+RTULOG_API const char* rtulog_store_column_unit(const rtulog_store* store, uint32_t column);
+
+/* Returns the column index for a key, or -1. */
+RTULOG_API int32_t rtulog_store_find_column(const rtulog_store* store, const char* key);
+
+/* Epoch milliseconds, ascending, rtulog_store_rows() entries. */
+RTULOG_API const int64_t* rtulog_store_timestamps(const rtulog_store* store);
+
+/* Column values, rtulog_store_rows() entries, NAN where missing. */
+RTULOG_API const float* rtulog_store_column(const rtulog_store* store, uint32_t column);
+
+/* First row with timestamp >= timeMs. */
+RTULOG_API uint64_t rtulog_store_lower_bound(const rtulog_store* store, int64_t timeMs);
+
+/*
+ * Direct parsing of log files (NDJSON, framed or CSV) into caller buffers on all cores,
+ * without an intermediate store. Typical use: probe, allocate capacity rows, parse.
+ */
+
+/* Counts the records of a log file (upper bound of the rows rtulog_parse_file() returns)
+ * and writes the keys of its first record, '\n' separated, into keys (may be NULL).
+ * Returns the length the key list needs (without NUL), or -1 on failure. */
+RTULOG_API int64_t rtulog_parse_probe(const char* path, uint64_t* records, char* keys, size_t keysSize);
+
+/* Parses a log file. timestamps and every columns[i] must hold capacity entries; column i
+ * receives the values of keys[i] (NAN where missing). threads = 0 uses all cores.
+ * Returns the number of rows written, or -1 on failure (e.g. capacity too small). */
+RTULOG_API int64_t rtulog_parse_file(const char* path, const char* const* keys, uint32_t keyCount,
+                                     int64_t* timestamps, float* const* columns, uint64_t capacity,
+                                     uint32_t threads);
+
+/*
+ * Level-of-detail queries for plotting (see LodPyramid.h). The "<log>.lod" cache of every
+ * log is created or brought up to date first. Returns the points needed to draw one
+ * register over [fromMs, toMs] on `pixels` columns (first, min, max and last sample per
+ * column, time ordered); capacity 4 * pixels always suffices. Returns the point count,
+ * or -1 on failure.
+ */
+RTULOG_API int64_t rtulog_lod_query(const char* const* logs, size_t logCount, const char* key,
+                                    int64_t fromMs, int64_t toMs, uint32_t pixels,
+                                    int64_t* times, float* values, size_t capacity);
+
+/*
+ * Live tail of a log the logger is still writing (see LogFollower.h). path is a log file,
+ * or with filenameFormat (logging.filename_format) a log folder whose day files are
+ * followed across midnight. Only records appended after the open are returned.
+ * Returns NULL on failure.
+ */
+RTULOG_API rtulog_follower* rtulog_follow_open(const char* path, const char* filenameFormat, int shardFolders);
+RTULOG_API void rtulog_follow_close(rtulog_follower* follower);
+
+/* Waits up to timeoutMs for new records and copies as many as fit into buf as NDJSON
+ * lines; the others are kept for the next call. Returns the bytes written (0 on timeout),
+ * or -1 on failure (e.g. a record longer than bufSize). */
+RTULOG_API int64_t rtulog_follow_read(rtulog_follower* follower, int timeoutMs, char* buf, size_t bufSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTULOG_H */
@@ -0,0 +1,112 @@
+// rtulog-alarm-test: host test of the firmware's alarm rules across configuration reloads
+// (AlarmEngine::compile). The rules are compiled against a channel list, then reloaded the
+// way ConfigManager does it: with fewer channels, with the channels reordered, and without
+// config.json (no rules). A rule must never read a channel index beyond the new list: the
+// sample buffer is longer than the channel list and its tail holds values that would raise
+// every rule, so a stale index shows up as an alarm.
+//
+// Usage: rtulog-alarm-test
+
+#include "AlarmEngine.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+const float kOutside = 1e9f;        // Raises every rule of the test
+const size_t kSlack = 8;            // Values past the end of the channel list
+
+int failures = 0;
+
+void check(bool condition, const char* step, const char* what) {
+    if (condition) return;
+    std::fprintf(stderr, "rtulog-alarm-test: %s: %s\n", step, what);
+    ++failures;
+}
+
+AlarmEngine::Definition above(const char* key, float limit, bool output) {
+    AlarmEngine::Definition d;
+    d.key = key;
+    d.above = limit;
+    d.output = output;
+    return d;
+}
+
+/// <summary>
+/// Evaluates one sample: the channels hold their given values, the slack
+/// behind them kOutside. Returns the number of state changes.
+/// </summary>
+size_t evaluate(AlarmEngine& engine, int64_t timestampMs, const std::vector<float>& channelValues) {
+    std::vector<float> buffer(channelValues);
+    buffer.resize(channelValues.size() + kSlack, kOutside);
+    return engine.evaluate(timestampMs, buffer.data());
+}
+
+/// <summary>
+/// Empties the event queue, returns the number of events.
+/// </summary>
+size_t drain(AlarmEngine& engine) {
+    AlarmEngine::Event event;
+    size_t count = 0;
+    while (engine.popEvent(event)) ++count;
+    return count;
+}
+
+} // namespace
+
+int main(int argc, char**) {
+    if (argc > 1) {
+        std::fprintf(stderr, "Usage: rtulog-alarm-test\n");
+        return 2;
+    }
+
+    AlarmEngine engine;
+    const std::vector<AlarmEngine::Definition> rules = {
+        above("U1", 250, false), above("P", 5000, true), above("E", 100, false), above("F", 60, false)
+    };
+
+    // First load: 6 channels, every rule compiles; raise the ones on P and E
+    const char* step = "first load";
+    std::vector<std::string> keys = { "U1", "U2", "U3", "P", "F", "E" };
+    check(engine.compile(keys, rules) == rules.size(), step, "not every rule compiled");
+    check(evaluate(engine, 1000, { 230, 230, 230, 6000, 50, 200 }) == 2, step, "expected two alarms raised");
+    check(engine.outputActive(), step, "output not driven by the raised rule");
+    drain(engine);
+
+    // Reload with 3 channels: the rules on P, E and F are gone, their state too
+    step = "reload with fewer channels";
+    keys = { "U1", "U2", "U3" };
+    check(engine.compile(keys, rules) == 1, step, "only the rule on U1 should compile");
+    check(engine.status(1) == AlarmEngine::Status::UnknownKey && engine.status(2) == AlarmEngine::Status::UnknownKey &&
+          engine.status(3) == AlarmEngine::Status::UnknownKey, step, "rules on removed channels not reported");
+    check(engine.activeCount() == 0 && !engine.outputActive(), step, "state of the old table survived");
+    check(evaluate(engine, 2000, { 230, 230, 230 }) == 0, step, "a rule read past the channel list");
+    check(drain(engine) == 0, step, "events after the reload");
+    check(evaluate(engine, 3000, { 260, 230, 230 }) == 1 && engine.isActive(0), step, "rule on U1 did not raise");
+    drain(engine);
+
+    // Reload with the channels reordered: each rule follows its key
+    step = "reload with reordered channels";
+    keys = { "E", "F", "U1", "P" };
+    check(engine.compile(keys, rules) == rules.size(), step, "not every rule compiled");
+    check(evaluate(engine, 4000, { 200, 50, 230, 1000 }) == 1 && engine.isActive(2) && !engine.isActive(0), step,
+          "a rule watched the index of the previous load");
+    drain(engine);
+
+    // Reload without config.json: only the compiled register map, no alarm section
+    step = "reload without rules";
+    keys = { "U1" };
+    check(engine.compile(keys, std::vector<AlarmEngine::Definition>()) == 0 && engine.ruleCount() == 0, step,
+          "rules of the previous load survived");
+    check(evaluate(engine, 5000, { kOutside }) == 0 && drain(engine) == 0, step, "an alarm without rules");
+
+    // Reload with no channels at all
+    step = "reload with no channels";
+    check(engine.compile(std::vector<std::string>(), rules) == 0, step, "a rule compiled without channels");
+    check(evaluate(engine, 6000, {}) == 0, step, "a rule read past the channel list");
+
+    if (failures) return 1;
+    std::printf("OK\n");
+    return 0;
+}
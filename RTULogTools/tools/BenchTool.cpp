@@ -0,0 +1,211 @@
+// rtulog-bench: measures the parallel SIMD parser against the sequential
+// LogReader + RecordParser path on the same file and checks both give the same rows.
+//
+// Usage: rtulog-bench [-t max_threads] <log file>
+//        rtulog-bench --synth <records> <out.log>     writes a logger-shaped NDJSON test file
+
+#include "FileUtil.h"
+#include "LogReader.h"
+#include "ParallelParser.h"
+#include "RecordParser.h"
+#include "SimdScan.h"
+#include "ThreadPool.h"
+#include "TimestampFormatter.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+/// <summary>
+/// Column-major result of one parser run.
+/// </summary>
+struct Table {
+    std::vector<int64_t> timestamps;
+    std::vector<std::vector<float>> columns;
+    size_t rows = 0;
+};
+
+/// <summary>
+/// Writes records in the exact shape StorageManager::serializeRecord produces.
+/// </summary>
+static bool synthesize(const char* path, unsigned long records) {
+    static const char* const keys[] = { "voltage_l1", "voltage_l2", "voltage_l3", "current_l1",
+                                        "current_l2", "current_l3", "power_total", "frequency" };
+    static const char* const units[] = { "V", "V", "V", "A", "A", "A", "kW", "Hz" };
+
+    std::FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+
+    int64_t t = 1735689600000;      // 2025-01-01 00:00:00
+    TimestampFormatter formatter;
+    char ts[TimestampFormatter::kMaxLength];
+    for (unsigned long i = 0; i < records; ++i, t += 1000) {
+        formatter.format(t, ts, false);
+        std::fprintf(f, "{\"timestamp\":\"%s\",\"values\":[", ts);
+        for (size_t k = 0; k < 8; ++k) {
+            double v = 230.0 + 10.0 * std::sin(0.001 * static_cast<double>(i) + static_cast<double>(k));
+            if (k >= 3) v /= 20.0;
+            if (i % 997 == k) {
+                std::fprintf(f, "%s{\"key\":\"%s\",\"value\":null,\"unit\":\"%s\"}", k ? "," : "", keys[k], units[k]);
+            } else {
+                std::fprintf(f, "%s{\"key\":\"%s\",\"value\":%.3f,\"unit\":\"%s\"}", k ? "," : "", keys[k], v, units[k]);
+            }
+        }
+        std::fputs("]}\n", f);
+    }
+    return std::fclose(f) == 0;
+}
+
+/// <summary>
+/// Sequential reference: LogReader scan plus the generic record parser.
+/// </summary>
+static bool parseSequential(const char* path, const std::vector<std::string>& keys, Table& out) {
+    LogReader reader;
+    if (!reader.open(path)) {
+        std::fprintf(stderr, "rtulog-bench: %s\n", reader.error().c_str());
+        return false;
+    }
+
+    out = Table();
+    out.columns.resize(keys.size());
+    std::vector<RecordValue> values;
+    reader.readAll([&](const LogRecord& rec) {
+        int64_t ts;
+        if (!RecordParser::parse(rec.json, rec.length, ts, values)) return true;
+        out.timestamps.push_back(ts);
+        for (auto& col : out.columns) col.push_back(NAN);
+        for (const auto& v : values) {
+            for (size_t j = 0; j < keys.size(); ++j) {
+                if (keys[j].size() == v.keyLength && std::memcmp(keys[j].data(), v.key, v.keyLength) == 0) {
+                    out.columns[j].back() = v.value;
+                    break;
+                }
+            }
+        }
+        return true;
+    });
+    out.rows = out.timestamps.size();
+    return true;
+}
+
+/// <summary>
+/// Parallel parser run with a fixed thread count.
+/// </summary>
+static bool parseParallel(const char* path, const std::vector<std::string>& keys, unsigned threads, Table& out) {
+    ParallelParser parser;
+    if (!parser.open(path)) {
+        std::fprintf(stderr, "rtulog-bench: %s\n", parser.error().c_str());
+        return false;
+    }
+
+    uint64_t capacity = parser.countRecords(threads);
+    out.timestamps.assign(capacity, 0);
+    out.columns.assign(keys.size(), std::vector<float>(capacity));
+    std::vector<float*> columns;
+    for (auto& col : out.columns) columns.push_back(col.data());
+
+    int64_t rows = parser.parse(keys, ParseTarget{ out.timestamps.data(), columns.data(), capacity }, threads);
+    if (rows < 0) {
+        std::fprintf(stderr, "rtulog-bench: %s\n", parser.error().c_str());
+        return false;
+    }
+    out.rows = static_cast<size_t>(rows);
+    return true;
+}
+
+/// <summary>
+/// Row-by-row comparison; NaN equals NaN.
+/// </summary>
+static bool sameRows(const Table& a, const Table& b) {
+    if (a.rows != b.rows) return false;
+    for (size_t r = 0; r < a.rows; ++r) {
+        if (a.timestamps[r] != b.timestamps[r]) return false;
+        for (size_t c = 0; c < a.columns.size(); ++c) {
+            float x = a.columns[c][r], y = b.columns[c][r];
+            if (!(x == y || (std::isnan(x) && std::isnan(y)))) return false;
+        }
+    }
+    return true;
+}
+
+static void report(const char* label, double seconds, uint64_t bytes, size_t rows) {
+    std::printf("%-22s %8.1f ms %9.1f MB/s %12.0f records/s\n", label, seconds * 1000.0,
+                static_cast<double>(bytes) / seconds / 1e6, static_cast<double>(rows) / seconds);
+}
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    if (argc == 4 && std::strcmp(argv[1], "--synth") == 0) {
+        unsigned long records = std::strtoul(argv[2], nullptr, 10);
+        if (!synthesize(argv[3], records)) {
+            std::fprintf(stderr, "rtulog-bench: cannot write %s\n", argv[3]);
+            return 1;
+        }
+        std::printf("%s: %lu record(s)\n", argv[3], records);
+        return 0;
+    }
+
+    unsigned maxThreads = ThreadPool::shared().size();
+    int first = 1;
+    if (argc > 3 && std::strcmp(argv[1], "-t") == 0) {
+        maxThreads = static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10));
+        first = 3;
+    }
+    if (argc != first + 1 || maxThreads == 0) {
+        std::fprintf(stderr, "Usage: rtulog-bench [-t max_threads] <log file>\n"
+                             "       rtulog-bench --synth <records> <out.log>\n");
+        return 2;
+    }
+    const char* path = argv[first];
+
+    ParallelParser probe;
+    if (!probe.open(path)) {
+        std::fprintf(stderr, "rtulog-bench: %s\n", probe.error().c_str());
+        return 1;
+    }
+    const std::vector<std::string> keys = probe.keys();
+    uint64_t bytes = 0;
+    if (std::FILE* f = std::fopen(path, "rb")) {
+        bytes = FileUtil::sizeOf(f);
+        std::fclose(f);
+    }
+    std::printf("%s: %.1f MB, %zu key(s), SIMD %s, %u thread(s) available\n", path,
+                static_cast<double>(bytes) / 1e6, keys.size(), SimdScan::isaName(), ThreadPool::shared().size());
+
+    Table reference;
+    Clock::time_point start = Clock::now();
+    if (!parseSequential(path, keys, reference)) return 1;
+    report("LogReader+RecordParser", secondsSince(start), bytes, reference.rows);
+
+    std::vector<unsigned> counts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2) counts.push_back(threads);
+    counts.push_back(maxThreads);
+
+    bool allSame = true;
+    for (unsigned threads : counts) {
+        Table result;
+        start = Clock::now();
+        if (!parseParallel(path, keys, threads, result)) return 1;
+        double seconds = secondsSince(start);
+
+        char label[32];
+        std::snprintf(label, sizeof(label), "parallel x%u", threads);
+        report(label, seconds, bytes, result.rows);
+
+        if (!sameRows(reference, result)) {
+            std::printf("  MISMATCH: %zu row(s) vs %zu reference row(s)\n", result.rows, reference.rows);
+            allSame = false;
+        }
+    }
+
+    std::printf("%zu row(s), results %s\n", reference.rows, allSame ? "identical" : "DIFFER");
+    return allSame ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+// rtulog-export: converts log files (NDJSON or framed) into one memory-mappable
+// columnar store (.rtc), rows ordered by time.
+//
+// Usage: rtulog-export -o <output.rtc> <log file>...
+
+#include "ColumnStore.h"
+#include <cstdio>
+#include <cstring>
+
+int main(int argc, char** argv) {
+    if (argc < 4 || std::strcmp(argv[1], "-o") != 0) {
+        std::fprintf(stderr, "Usage: rtulog-export -o <output.rtc> <log file>...\n");
+        return 2;
+    }
+
+    ColumnStoreWriter writer;
+    for (int i = 3; i < argc; ++i) {
+        if (!writer.addLogFile(argv[i])) {
+            std::fprintf(stderr, "rtulog-export: %s\n", writer.error().c_str());
+            return 1;
+        }
+    }
+
+    if (!writer.write(argv[2])) {
+        std::fprintf(stderr, "rtulog-export: %s\n", writer.error().c_str());
+        return 1;
+    }
+
+    std::printf("%s: %zu row(s), %zu column(s)", argv[2], writer.rows(), writer.columns());
+    if (writer.skippedRecords()) std::printf(", %zu malformed record(s) skipped", writer.skippedRecords());
+    std::printf("\n");
+    return 0;
+}
@@ -0,0 +1,132 @@
+// rtulog-follow: prints the records a logger appends to its log as they arrive, like
+// tail -f, from a card image, a network share or a copy kept up to date by rsync.
+// Given the log folder it follows the day files across midnight, using the day file
+// name pattern from the logger's config.json (or -n) and its YYYY/MM shard folders.
+//
+// Usage: rtulog-follow [-c config.json] [-n filename_format] [--flat] [--from-start]
+//                      <log file|log folder>
+
+#include "JsonValue.h"
+#include "LogFollower.h"
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+static std::atomic<bool> stopRequested(false);
+
+static void onSignal(int) {
+    stopRequested = true;
+}
+
+static int usage() {
+    std::fprintf(stderr, "Usage: rtulog-follow [-c config.json] [-n filename_format] [--flat] [--from-start]\n"
+                         "                     <log file|log folder>\n"
+                         "       -c:           take filename_format and shard_folders from the logger config\n"
+                         "       -n:           day file name pattern (default: data_%%Y%%m%%d.csv)\n"
+                         "       --flat:       day files are not in YYYY/MM folders\n"
+                         "       --from-start: print the records already in the first file too\n");
+    return 2;
+}
+
+static bool readFile(const char* path, std::string& out) {
+    std::FILE* f = std::fopen(path, "rb");
+    if (!f) return false;
+    char buf[65536];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    bool ok = !std::ferror(f);
+    std::fclose(f);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    // Defaults as in the firmware's ConfigManager
+    std::string filenameFormat = "data_%Y%m%d.csv";
+    bool shardFolders = true;
+    bool fromStart = false;
+    int first = 1;
+    while (first < argc && argv[first][0] == '-') {
+        if (std::strcmp(argv[first], "--flat") == 0) {
+            shardFolders = false;
+            ++first;
+            continue;
+        }
+        if (std::strcmp(argv[first], "--from-start") == 0) {
+            fromStart = true;
+            ++first;
+            continue;
+        }
+        if (first + 1 >= argc) return usage();
+        const char* value = argv[first + 1];
+        if (std::strcmp(argv[first], "-n") == 0) {
+            filenameFormat = value;
+        } else if (std::strcmp(argv[first], "-c") == 0) {
+            std::string text;
+            JsonValue doc;
+            std::string error;
+            if (!readFile(value, text)) {
+                std::fprintf(stderr, "rtulog-follow: cannot read %s\n", value);
+                return 1;
+            }
+            if (!JsonValue::parse(text, doc, error)) {
+                std::fprintf(stderr, "rtulog-follow: %s: %s\n", value, error.c_str());
+                return 1;
+            }
+            const JsonValue& logging = doc["logging"];
+            filenameFormat = logging["filename_format"].asString(filenameFormat);
+            shardFolders = logging["shard_folders"].asBool(shardFolders);
+        } else {
+            return usage();
+        }
+        first += 2;
+    }
+    if (first + 1 != argc) return usage();
+
+    const char* target = argv[first];
+    std::error_code ec;
+    bool folder = std::filesystem::is_directory(target, ec);
+    LogFollower follower;
+    if (!(folder ? follower.openFolder(target, filenameFormat, shardFolders, fromStart)
+                 : follower.openFile(target, fromStart))) {
+        std::fprintf(stderr, "rtulog-follow: %s\n", follower.error().c_str());
+        return 1;
+    }
+
+    std::string current = follower.currentPath();
+    uint64_t restarts = 0;
+    uint64_t records = 0;
+    std::fprintf(stderr, "rtulog-follow: following %s\n", current.c_str());
+
+    // Reported from the callback too, so the note comes before the new file's records
+    auto reportSwitch = [&]() {
+        if (follower.currentPath() != current) {
+            current = follower.currentPath();
+            std::fflush(stdout);
+            std::fprintf(stderr, "rtulog-follow: now following %s\n", current.c_str());
+        }
+        if (follower.restarts() != restarts) {
+            restarts = follower.restarts();
+            std::fflush(stdout);
+            std::fprintf(stderr, "rtulog-follow: %s was replaced, reading it from the start\n", current.c_str());
+        }
+    };
+    while (!stopRequested) {
+        follower.poll(500, [&](const LogRecord& rec) {
+            reportSwitch();
+            std::fwrite(rec.json, 1, rec.length, stdout);
+            std::fputc('\n', stdout);
+            ++records;
+            return !stopRequested;
+        });
+        std::fflush(stdout);
+        reportSwitch();
+    }
+    std::fprintf(stderr, "rtulog-follow: %llu record(s)\n", static_cast<unsigned long long>(records));
+    return 0;
+}
@@ -0,0 +1,229 @@
+// rtulog-history-stress: host stress test of the firmware's RecentHistory seqlock.
+// One writer pushes samples as fast as it can while reader threads query latest,
+// latestSample, lastN and extent. Every value is a function of its sample number
+// and the timestamps are evenly spaced, so each result can be checked on its own:
+// a snapshot that mixes two pushes, a torn timestamp or a stale tree node fails.
+//
+// Usage: rtulog-history-stress [seconds] [readers] [capacity]
+
+#include "RecentHistory.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const uint16_t kChannels = 4;
+const int64_t kBaseMs = 1751500000000;  // Sample k is at kBaseMs + k * kStepMs
+const int64_t kStepMs = 10;
+
+/// <summary>
+/// Value of a channel in sample k: scattered, so the extents depend on the
+/// whole range, and exact as a float. Channel 1 is NAN in every 97th sample.
+/// </summary>
+float valueOf(uint64_t k, uint16_t channel) {
+    if (channel == 1 && k % 97 == 0) return NAN;
+    return static_cast<float>((k * 7919 + channel * 104729) % 65536) + channel * 0.25f;
+}
+
+bool same(float a, float b) {
+    return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+/// <summary>
+/// Sample number of a timestamp, false if it is not on the grid.
+/// </summary>
+bool sampleOf(int64_t timestampMs, uint64_t& k) {
+    if (timestampMs < kBaseMs || (timestampMs - kBaseMs) % kStepMs != 0) return false;
+    k = static_cast<uint64_t>((timestampMs - kBaseMs) / kStepMs);
+    return true;
+}
+
+/// <summary>
+/// Query counters of one reader (ok = answered and checked, gaveUp = kMaxAttempts hit).
+/// </summary>
+struct Counters {
+    uint64_t ok[4] = {};
+    uint64_t gaveUp[4] = {};
+    uint64_t errors = 0;
+};
+
+enum Query { Latest, LatestSample, LastN, Extent };
+const char* const kQueryNames[] = { "latest", "latestSample", "lastN", "extent" };
+
+std::atomic<bool> stop{false};
+std::atomic<uint64_t> pushed{0};
+std::mutex reportMutex;
+
+void fail(Counters& counters, const char* query, const char* what, long long detail) {
+    if (++counters.errors > 5) return;
+    std::lock_guard<std::mutex> lock(reportMutex);
+    std::fprintf(stderr, "rtulog-history-stress: %s: %s (%lld)\n", query, what, detail);
+}
+
+void reader(const RecentHistory& history, unsigned seed, Counters& counters) {
+    std::mt19937 random(seed);
+    std::vector<RecentHistory::Point> points(history.capacity());
+    float values[kChannels];
+    uint64_t newest = 0;                // Latest sample seen, must never go back
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        uint16_t channel = static_cast<uint16_t>(random() % kChannels);
+        switch (random() % 4) {
+            case Latest: {
+                RecentHistory::Point point;
+                uint64_t k;
+                if (!history.latest(channel, point)) {
+                    if (pushed.load() > 0) ++counters.gaveUp[Latest];
+                    break;
+                }
+                if (!sampleOf(point.timestampMs, k)) fail(counters, "latest", "timestamp off the grid", point.timestampMs);
+                else if (!same(point.value, valueOf(k, channel))) fail(counters, "latest", "value of another sample", static_cast<long long>(k));
+                else if (k < newest) fail(counters, "latest", "went back in time", static_cast<long long>(k));
+                else {
+                    newest = k;
+                    ++counters.ok[Latest];
+                }
+                break;
+            }
+
+            case LatestSample: {
+                int64_t timestampMs;
+                uint64_t k;
+                if (!history.latestSample(timestampMs, values)) {
+                    if (pushed.load() > 0) ++counters.gaveUp[LatestSample];
+                    break;
+                }
+                if (!sampleOf(timestampMs, k)) {
+                    fail(counters, "latestSample", "timestamp off the grid", timestampMs);
+                    break;
+                }
+                bool consistent = true;
+                for (uint16_t c = 0; c < kChannels; ++c) consistent = consistent && same(values[c], valueOf(k, c));
+                if (!consistent) fail(counters, "latestSample", "values of different samples", static_cast<long long>(k));
+                else if (k < newest) fail(counters, "latestSample", "went back in time", static_cast<long long>(k));
+                else {
+                    newest = k;
+                    ++counters.ok[LatestSample];
+                }
+                break;
+            }
+
+            case LastN: {
+                size_t n = 1 + random() % points.size();
+                size_t count = history.lastN(channel, n, points.data());
+                if (count == 0) {
+                    if (pushed.load() > 0) ++counters.gaveUp[LastN];
+                    break;
+                }
+                uint64_t first;
+                bool consistent = count <= n && sampleOf(points[0].timestampMs, first);
+                for (size_t i = 0; consistent && i < count; ++i) {
+                    consistent = points[i].timestampMs == kBaseMs + static_cast<int64_t>(first + i) * kStepMs &&
+                                 same(points[i].value, valueOf(first + i, channel));
+                }
+                if (!consistent) fail(counters, "lastN", "points not consecutive or of other samples", static_cast<long long>(count));
+                else if (first + count - 1 < newest) fail(counters, "lastN", "went back in time", static_cast<long long>(first));
+                else {
+                    newest = first + count - 1;
+                    ++counters.ok[LastN];
+                }
+                break;
+            }
+
+            case Extent: {
+                // A range around the held samples, sometimes reaching past either end
+                uint64_t top = pushed.load();
+                uint64_t span = history.capacity() + history.capacity() / 4;
+                int64_t to = kBaseMs + static_cast<int64_t>(top - random() % (top < span ? top + 1 : span)) * kStepMs;
+                int64_t from = to - static_cast<int64_t>(random() % span) * kStepMs - static_cast<int64_t>(random() % kStepMs);
+                if (random() % 8 == 0) to = INT64_MAX;
+                RecentHistory::Extent extent;
+                if (!history.extent(channel, from, to, extent)) {
+                    ++counters.gaveUp[Extent];      // Or the range held no sample
+                    break;
+                }
+                uint64_t first, last;
+                if (!sampleOf(extent.firstMs, first) || !sampleOf(extent.lastMs, last) || last < first ||
+                    extent.firstMs < from || extent.lastMs > to || extent.samples != last - first + 1) {
+                    fail(counters, "extent", "bounds or sample count inconsistent", static_cast<long long>(extent.samples));
+                    break;
+                }
+                float min = NAN, max = NAN;
+                for (uint64_t k = first; k <= last; ++k) {
+                    float v = valueOf(k, channel);
+                    if (std::isnan(v)) continue;
+                    if (std::isnan(min) || v < min) min = v;
+                    if (std::isnan(max) || v > max) max = v;
+                }
+                if (!same(extent.min, min) || !same(extent.max, max)) fail(counters, "extent", "min/max not those of its samples", static_cast<long long>(first));
+                else ++counters.ok[Extent];
+                break;
+            }
+        }
+    }
+}
+
+int usage() {
+    std::fprintf(stderr, "Usage: rtulog-history-stress [seconds] [readers] [capacity]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 5;
+    int readers = argc > 2 ? std::atoi(argv[2]) : 3;
+    size_t wanted = argc > 3 ? static_cast<size_t>(std::strtoul(argv[3], nullptr, 10)) : 1024;
+    if (seconds <= 0 || readers < 1 || wanted < 2) return usage();
+
+    RecentHistory history;
+    if (history.begin(RecentHistory::bytesPerSample(kChannels) * wanted * 2, wanted, kChannels) == 0) {
+        std::fprintf(stderr, "rtulog-history-stress: cannot allocate %zu samples\n", wanted);
+        return 1;
+    }
+
+    std::vector<Counters> counters(static_cast<size_t>(readers));
+    std::vector<std::thread> threads;
+    for (int i = 0; i < readers; ++i) threads.emplace_back(reader, std::cref(history), 1000u + i, std::ref(counters[i]));
+
+    auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    float values[kChannels];
+    for (uint64_t k = 0; ; ++k) {
+        if ((k & 1023) == 0 && std::chrono::steady_clock::now() >= end) break;
+        for (uint16_t c = 0; c < kChannels; ++c) values[c] = valueOf(k, c);
+        history.push(kBaseMs + static_cast<int64_t>(k) * kStepMs, values);
+        pushed.store(k + 1, std::memory_order_relaxed);
+    }
+    stop = true;
+    for (std::thread& t : threads) t.join();
+
+    Counters sum;
+    for (const Counters& c : counters) {
+        for (int q = 0; q < 4; ++q) {
+            sum.ok[q] += c.ok[q];
+            sum.gaveUp[q] += c.gaveUp[q];
+        }
+        sum.errors += c.errors;
+    }
+
+    std::printf("%llu pushes into %zu slots, %d reader(s), %u retries\n", static_cast<unsigned long long>(pushed.load()),
+                history.capacity(), readers, history.retries());
+    bool starved = false;
+    for (int q = 0; q < 4; ++q) {   // For extent "gave up" includes ranges without samples
+        std::printf("  %-13s %10llu checked  %8llu gave up\n", kQueryNames[q], static_cast<unsigned long long>(sum.ok[q]),
+                    static_cast<unsigned long long>(sum.gaveUp[q]));
+        starved = starved || sum.ok[q] == 0;
+    }
+    if (starved) std::fprintf(stderr, "rtulog-history-stress: a query type was never answered, nothing was checked\n");
+    if (sum.errors) std::fprintf(stderr, "rtulog-history-stress: %llu inconsistent snapshot(s)\n", static_cast<unsigned long long>(sum.errors));
+    if (sum.errors || starved) return 1;
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,75 @@
+// rtulog-index: (re)builds the "<log file>.idx" time index for existing log files,
+// e.g. files written by firmware without index support. For a compressed
+// "<log file>.lz" the index is written as "<log file>.idx".
+//
+// Usage: rtulog-index [-i interval_ms] <log file>...
+
+#include "FileUtil.h"
+#include "LogReader.h"
+#include "TimeIndex.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+/// <summary>
+/// Scans one log file and writes its index next to it.
+/// </summary>
+static bool buildIndex(const char* path, uint32_t intervalMs) {
+    LogReader reader;
+    if (!reader.open(path)) {
+        std::fprintf(stderr, "rtulog-index: %s\n", reader.error().c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> out(TimeIndex::kHeaderSize);
+    TimeIndex::encodeHeader(intervalMs, reader.isFramed() ? TimeIndex::kFlagFramed : 0, out.data());
+
+    TimeIndex::Builder builder;
+    builder.reset(intervalMs);
+    size_t entries = 0, untimed = 0;
+
+    size_t records = reader.readAll([&](const LogRecord& rec) {
+        TimeIndex::Entry entry;
+        if (rec.timestampMs == INT64_MIN) {
+            untimed++;
+        } else if (builder.offer(rec.timestampMs, rec.offset, entry)) {
+            uint8_t raw[TimeIndex::kEntrySize];
+            TimeIndex::encodeEntry(entry, raw);
+            out.insert(out.end(), raw, raw + sizeof(raw));
+            entries++;
+        }
+        return true;
+    });
+
+    std::string idxPath = LogReader::indexPath(path);
+    if (!FileUtil::writeAtomically(idxPath, out.data(), out.size())) {
+        std::fprintf(stderr, "rtulog-index: cannot write %s\n", idxPath.c_str());
+        return false;
+    }
+
+    std::printf("%s: %zu record(s)%s, %zu index entr%s\n", path, records,
+                reader.isFramed() ? " (framed)" : "", entries, entries == 1 ? "y" : "ies");
+    if (untimed) std::printf("  %zu record(s) without a parsable timestamp\n", untimed);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint32_t intervalMs = TimeIndex::kDefaultIntervalMs;
+    int first = 1;
+
+    if (argc > 2 && std::strcmp(argv[1], "-i") == 0) {
+        intervalMs = static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10));
+        first = 3;
+    }
+    if (first >= argc || intervalMs == 0) {
+        std::fprintf(stderr, "Usage: rtulog-index [-i interval_ms] <log file>...\n");
+        return 2;
+    }
+
+    int failed = 0;
+    for (int i = first; i < argc; ++i) {
+        if (!buildIndex(argv[i], intervalMs)) failed++;
+    }
+    return failed ? 1 : 0;
+}
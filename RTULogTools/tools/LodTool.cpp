@@ -0,0 +1,85 @@
+// rtulog-lod: builds or updates the level-of-detail caches ("<log file>.lod") of log
+// files, or prints the decimated points of one register for a plot of a given width.
+//
+// Usage: rtulog-lod [-b base_ms] [-f fanout] <log file>...
+//        rtulog-lod -q <key> "<from>" "<to>" <pixels> <log file>...
+
+#include "LodPyramid.h"
+#include "TimestampFormatter.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static int usage() {
+    std::fprintf(stderr, "Usage: rtulog-lod [-b base_ms] [-f fanout] <log file>...\n"
+                         "       rtulog-lod -q <key> \"<from>\" \"<to>\" <pixels> <log file>...\n"
+                         "       times as YYYY-MM-DD HH:MM:SS[.mmm]\n");
+    return 2;
+}
+
+/// <summary>
+/// Prints "timestamp,value" lines for one register.
+/// </summary>
+static int query(int argc, char** argv) {
+    int64_t fromMs, toMs;
+    if (argc < 7 || !TimestampFormatter::parse(argv[3], std::strlen(argv[3]), fromMs) ||
+        !TimestampFormatter::parse(argv[4], std::strlen(argv[4]), toMs)) {
+        return usage();
+    }
+    uint32_t pixels = static_cast<uint32_t>(std::strtoul(argv[5], nullptr, 10));
+    if (pixels == 0) return usage();
+
+    LodSet set;
+    for (int i = 6; i < argc; ++i) {
+        if (!set.add(argv[i])) {
+            std::fprintf(stderr, "rtulog-lod: %s\n", set.error().c_str());
+            return 1;
+        }
+    }
+
+    TimestampFormatter formatter;
+    char ts[TimestampFormatter::kMaxLength];
+    std::vector<LodPoint> points = set.query(argv[2], fromMs, toMs, pixels);
+    for (const auto& p : points) {
+        formatter.format(p.timeMs, ts, true);
+        std::printf("%s,%g\n", ts, static_cast<double>(p.value));
+    }
+    std::fprintf(stderr, "rtulog-lod: %zu point(s)\n", points.size());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "-q") == 0) return query(argc, argv);
+
+    uint32_t baseMs = LodFormat::kDefaultBaseMs;
+    uint32_t fanout = LodFormat::kDefaultFanout;
+    int first = 1;
+    while (first + 1 < argc && argv[first][0] == '-') {
+        if (std::strcmp(argv[first], "-b") == 0) {
+            baseMs = static_cast<uint32_t>(std::strtoul(argv[first + 1], nullptr, 10));
+        } else if (std::strcmp(argv[first], "-f") == 0) {
+            fanout = static_cast<uint32_t>(std::strtoul(argv[first + 1], nullptr, 10));
+        } else {
+            return usage();
+        }
+        first += 2;
+    }
+    if (first >= argc || baseMs == 0 || fanout < 2) return usage();
+
+    int failed = 0;
+    for (int i = first; i < argc; ++i) {
+        LodPyramid pyramid;
+        if (!pyramid.update(argv[i], baseMs, fanout)) {
+            std::fprintf(stderr, "rtulog-lod: %s\n", pyramid.error().c_str());
+            failed++;
+            continue;
+        }
+        size_t buckets = 0;
+        for (size_t s = 0; s < pyramid.seriesCount(); ++s) {
+            for (uint32_t l = 0; l < pyramid.levelCount(); ++l) buckets += pyramid.buckets(s, l).size();
+        }
+        std::printf("%s: %zu series, %zu bucket(s), %llu log byte(s) aggregated\n", argv[i],
+                    pyramid.seriesCount(), buckets, static_cast<unsigned long long>(pyramid.sourceBytes()));
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,65 @@
+// rtulog-merge: merges time-ordered log files (e.g. overlapping day files) into one
+// time-ordered output in constant memory. Records with the same timestamp become one row.
+//
+// Usage: rtulog-merge [-f ndjson|framed|csv|rtc] -o <output> <log file>...
+
+#include "LogMerger.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static int usage() {
+    std::fprintf(stderr, "Usage: rtulog-merge [-f ndjson|framed|csv|rtc] -o <output> <log file>...\n"
+                         "       default format: rtc for *.rtc outputs, ndjson otherwise\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    const char* output = nullptr;
+    const char* formatName = nullptr;
+    int first = 1;
+    while (first + 1 < argc && argv[first][0] == '-') {
+        if (std::strcmp(argv[first], "-o") == 0) {
+            output = argv[first + 1];
+        } else if (std::strcmp(argv[first], "-f") == 0) {
+            formatName = argv[first + 1];
+        } else {
+            return usage();
+        }
+        first += 2;
+    }
+    if (!output || first >= argc) return usage();
+
+    // Logger day files are named *.csv but hold NDJSON, so the extension only picks .rtc
+    MergeFormat format = MergeFormat::Ndjson;
+    size_t outLen = std::strlen(output);
+    if (!formatName) {
+        if (outLen > 4 && std::strcmp(output + outLen - 4, ".rtc") == 0) format = MergeFormat::Columns;
+    } else if (std::strcmp(formatName, "framed") == 0) {
+        format = MergeFormat::Framed;
+    } else if (std::strcmp(formatName, "csv") == 0) {
+        format = MergeFormat::Csv;
+    } else if (std::strcmp(formatName, "rtc") == 0) {
+        format = MergeFormat::Columns;
+    } else if (std::strcmp(formatName, "ndjson") != 0) {
+        return usage();
+    }
+
+    std::vector<std::string> inputs(argv + first, argv + argc);
+    LogMerger merger;
+    if (!merger.merge(inputs, output, format)) {
+        std::fprintf(stderr, "rtulog-merge: %s\n", merger.error().c_str());
+        return 1;
+    }
+
+    const MergeStats& s = merger.stats();
+    std::printf("%s: %llu row(s), %zu column(s) from %llu record(s) in %zu file(s)", output,
+                static_cast<unsigned long long>(s.rows), merger.columns(),
+                static_cast<unsigned long long>(s.records), inputs.size());
+    if (s.duplicates) std::printf(", %llu duplicate(s) folded", static_cast<unsigned long long>(s.duplicates));
+    if (s.outOfOrder) std::printf(", %llu out-of-order record(s) dropped", static_cast<unsigned long long>(s.outOfOrder));
+    if (s.malformed) std::printf(", %llu malformed record(s) skipped", static_cast<unsigned long long>(s.malformed));
+    std::printf("\n");
+    return 0;
+}
@@ -0,0 +1,538 @@
+// rtulog-poll: polls the registers of a logger config.json from a PC, one thread per
+// RS485 bus, with the firmware's RtuMaster, read planner and scaling. Every cycle starts
+// all buses on the same tick and writes one NDJSON record as the logger does (same order,
+// derived channels and serializer).
+// With --slave it answers read requests on a serial device or pty, so the parallel
+// polling can be tested without meters. -r records the raw traffic as an RTU capture
+// (the format the logger writes with "capture" enabled); --replay polls from such a
+// capture instead of serial devices, at recorded speed or with --fast as fast as
+// possible, using the recorded sample times, so runs are repeatable byte for byte.
+//
+// Usage: rtulog-poll [-i interval_ms] [-n samples] [-o output] [-r capture] <config.json> <bus 0 device> [bus 1 device]...
+//        rtulog-poll --replay capture [--fast] [-n samples] [-o output] <config.json>
+//        rtulog-poll --slave [-s slave_id] [-b baud] [-d delay_ms] <device>
+
+#include "CaptureTransport.h"
+#include "DerivedProgram.h"
+#include "JsonValue.h"
+#include "LogFrame.h"
+#include "RecordWriter.h"
+#include "RegisterMap.h"
+#include "ReplayBus.h"
+#include "RtuMaster.h"
+#include "ScaleExpression.h"
+#include "SerialBus.h"
+#include "TimestampFormatter.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const size_t kRecordBufferBytes = 65536;   // Per bus and cycle with -r
+
+static std::atomic<bool> stopRequested(false);
+
+static void onSignal(int) {
+    stopRequested = true;
+}
+
+static int usage() {
+    std::fprintf(stderr, "Usage: rtulog-poll [-i interval_ms] [-n samples] [-o output] [-r capture] <config.json> <bus 0 device> [bus 1 device]...\n"
+                         "       rtulog-poll --replay capture [--fast] [-n samples] [-o output] <config.json>\n"
+                         "       rtulog-poll --slave [-s slave_id] [-b baud] [-d delay_ms] <device>\n"
+                         "       default interval: the config's interval_ms\n");
+    return 2;
+}
+
+static bool readFile(const char* path, std::string& out) {
+    std::FILE* f = std::fopen(path, "rb");
+    if (!f) return false;
+    char buf[65536];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    bool ok = !std::ferror(f);
+    std::fclose(f);
+    return ok;
+}
+
+/// <summary>
+/// One value of a record, in the logger's order: the registers as listed in
+/// the config, then the derived channels (computed, no bus).
+/// </summary>
+struct Channel {
+    std::string key;
+    std::string unit;
+    size_t bus;
+    size_t index;         ///< In the bus's register list
+};
+
+struct Register {
+    std::string key;
+    std::string unit;
+    uint16_t address;
+    RegisterMap::Type type;
+    uint8_t words;
+    ScaleExpression scale;
+};
+
+/// <summary>
+/// One RS485 bus: its line, master, read plan and registers. Buses from 1 on
+/// run in their own thread, which reads whenever the cycle counter advances.
+/// The master talks to the serial port (through the recorder) or to a replay.
+/// </summary>
+struct Bus {
+    BusTiming::Line line;
+    uint8_t slaveId = 1;
+    SerialBus port;
+    CaptureTransport capture;
+    ReplayBus replay;
+    BusTransport* transport = nullptr;
+    RtuMaster master;
+    std::vector<Register> registers;
+    std::vector<RegisterMap::Block> blocks;
+    std::vector<RegisterMap::Slot> slots;
+    std::vector<float> values;
+    uint32_t failed = 0;
+    uint32_t elapsedUs = 0;
+};
+
+static void parseLine(const JsonValue& comm, Bus& bus) {
+    bus.slaveId = static_cast<uint8_t>(comm["modbus_id"].asNumber(1));
+    bus.line.baud = static_cast<uint32_t>(comm["baudrate"].asNumber(9600));
+    bus.line.dataBits = static_cast<uint8_t>(comm["data_bits"].asNumber(8));
+    bus.line.parity = comm["parity"].asString("N").c_str()[0];
+    bus.line.stopBits = static_cast<uint8_t>(comm["stop_bits"].asNumber(1));
+}
+
+/// <summary>
+/// Reads every block of the bus's plan; values of failed blocks are NAN.
+/// </summary>
+static void pollBus(Bus& bus, int addressOffset, float vtr, float ctr) {
+    uint32_t startedUs = bus.transport->nowUs();   // Bus time: recorded time in a replay
+    bus.failed = 0;
+    uint16_t words[RegisterMap::kMaxBlockWords];
+    for (const RegisterMap::Block& block : bus.blocks) {
+        uint8_t result = bus.master.readHoldingRegisters(static_cast<uint16_t>(block.address - addressOffset),
+                                                         block.count, words);
+        for (uint16_t i = 0; i < block.slotCount; ++i) {
+            const RegisterMap::Slot& slot = bus.slots[block.firstSlot + i];
+            const Register& reg = bus.registers[slot.reg];
+            bus.values[slot.reg] = result == RtuMaster::kSuccess
+                                       ? reg.scale.evaluate(RegisterMap::decode(reg.type, words + slot.offset), vtr, ctr)
+                                       : NAN;
+        }
+        if (result != RtuMaster::kSuccess) ++bus.failed;
+    }
+    bus.elapsedUs = bus.transport->nowUs() - startedUs;
+}
+
+/// <summary>
+/// Answers function 0x03 requests for its slave id with register value =
+/// address (low 16 bits); other functions get Illegal Function. Bytes that do
+/// not form a valid request are skipped one at a time until one does.
+/// </summary>
+static int slave(const char* device, uint8_t slaveId, uint32_t baud, uint32_t delayMs) {
+    SerialBus port;
+    if (!port.open(device, baud)) {
+        std::fprintf(stderr, "rtulog-poll: %s\n", port.error().c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "rtulog-poll: answering as slave %u on %s\n", slaveId, device);
+
+    uint8_t request[8];
+    size_t have = 0;
+    uint64_t answered = 0;
+    while (!stopRequested) {
+        int c = port.readByte(200000);
+        if (c < 0) {
+            have = 0;   // Line idle: a partial frame is dropped
+            continue;
+        }
+        request[have++] = static_cast<uint8_t>(c);
+        if (have < sizeof(request)) continue;
+
+        uint16_t crc = RtuMaster::crc16(request, 6);
+        if (request[6] != static_cast<uint8_t>(crc) || request[7] != static_cast<uint8_t>(crc >> 8)) {
+            std::memmove(request, request + 1, --have);
+            continue;
+        }
+        have = 0;
+        if (request[0] != slaveId) continue;
+
+        uint16_t address = static_cast<uint16_t>((request[2] << 8) | request[3]);
+        uint16_t count = static_cast<uint16_t>((request[4] << 8) | request[5]);
+        std::vector<uint8_t> response = {slaveId, request[1]};
+        if (request[1] != 0x03) {
+            response[1] |= 0x80;
+            response.push_back(RtuMaster::kIllegalFunction);
+        } else if (count == 0 || count > 125) {
+            response[1] |= 0x80;
+            response.push_back(RtuMaster::kIllegalDataValue);
+        } else {
+            response.push_back(static_cast<uint8_t>(2 * count));
+            for (uint16_t i = 0; i < count; ++i) {
+                uint16_t value = static_cast<uint16_t>(address + i);
+                response.push_back(static_cast<uint8_t>(value >> 8));
+                response.push_back(static_cast<uint8_t>(value));
+            }
+        }
+        crc = RtuMaster::crc16(response.data(), response.size());
+        response.push_back(static_cast<uint8_t>(crc));
+        response.push_back(static_cast<uint8_t>(crc >> 8));
+
+        if (delayMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        if (!port.write(response.data(), response.size())) {
+            std::fprintf(stderr, "rtulog-poll: write to %s failed\n", device);
+            return 1;
+        }
+        ++answered;
+    }
+    std::fprintf(stderr, "rtulog-poll: %llu request(s) answered\n", static_cast<unsigned long long>(answered));
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    bool slaveMode = false;
+    bool fast = false;
+    const char* output = nullptr;
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    long intervalMs = 0;
+    long samples = 0;
+    long slaveId = 1;
+    long baud = 9600;
+    long delayMs = 0;
+    int first = 1;
+    while (first < argc && argv[first][0] == '-') {
+        if (std::strcmp(argv[first], "--slave") == 0) {
+            slaveMode = true;
+            ++first;
+            continue;
+        }
+        if (std::strcmp(argv[first], "--fast") == 0) {
+            fast = true;
+            ++first;
+            continue;
+        }
+        if (first + 1 >= argc) return usage();
+        char* end = nullptr;
+        long number = std::strtol(argv[first + 1], &end, 10);
+        bool numeric = *end == '\0' && number >= 0;
+        if (std::strcmp(argv[first], "-o") == 0) {
+            output = argv[first + 1];
+        } else if (std::strcmp(argv[first], "-r") == 0) {
+            recordPath = argv[first + 1];
+        } else if (std::strcmp(argv[first], "--replay") == 0) {
+            replayPath = argv[first + 1];
+        } else if (std::strcmp(argv[first], "-i") == 0 && numeric && number > 0) {
+            intervalMs = number;
+        } else if (std::strcmp(argv[first], "-n") == 0 && numeric) {
+            samples = number;
+        } else if (std::strcmp(argv[first], "-s") == 0 && numeric && number >= 1 && number <= 247) {
+            slaveId = number;
+        } else if (std::strcmp(argv[first], "-b") == 0 && numeric && number > 0) {
+            baud = number;
+        } else if (std::strcmp(argv[first], "-d") == 0 && numeric) {
+            delayMs = number;
+        } else {
+            return usage();
+        }
+        first += 2;
+    }
+    if (slaveMode) {
+        if (first + 1 != argc) return usage();
+        return slave(argv[first], static_cast<uint8_t>(slaveId), static_cast<uint32_t>(baud),
+                     static_cast<uint32_t>(delayMs));
+    }
+    if (replayPath ? (argc - first != 1 || recordPath) : (argc - first < 2 || fast)) return usage();
+
+    const char* configPath = argv[first];
+    std::string text;
+    if (!readFile(configPath, text)) {
+        std::fprintf(stderr, "rtulog-poll: cannot read %s\n", configPath);
+        return 1;
+    }
+    JsonValue doc;
+    std::string error;
+    if (!JsonValue::parse(text, doc, error)) {
+        std::fprintf(stderr, "rtulog-poll: %s: %s\n", configPath, error.c_str());
+        return 1;
+    }
+
+    CaptureFile capture;
+    if (replayPath) {
+        if (!capture.load(replayPath)) {
+            std::fprintf(stderr, "rtulog-poll: %s\n", capture.error().c_str());
+            return 1;
+        }
+        std::fprintf(stderr, "rtulog-poll: replaying %zu cycle(s) of %s (%zu session(s))%s\n",
+                     capture.cycles().size(), replayPath, capture.sessions(), fast ? ", as fast as possible" : "");
+        if (capture.ignoredBytes() > 0) {
+            std::fprintf(stderr, "rtulog-poll: %s: %zu byte(s) at the end are not a complete record, ignored\n",
+                         replayPath, capture.ignoredBytes());
+        }
+    }
+
+    // Buses: "communication" plus the "buses" entries, one device argument each (all of them in a replay)
+    size_t busCount = replayPath ? 1 + doc["buses"].size() : static_cast<size_t>(argc - first - 1);
+    std::vector<std::unique_ptr<Bus>> buses;
+    for (size_t b = 0; b < busCount; ++b) {
+        buses.emplace_back(new Bus());
+        const JsonValue& comm = b == 0 ? doc["communication"] : doc["buses"][b - 1];
+        if (comm.isNull()) {
+            std::fprintf(stderr, "rtulog-poll: %s has no settings for bus %zu\n", configPath, b);
+            return 1;
+        }
+        parseLine(comm, *buses[b]);
+    }
+    const JsonValue& comm = doc["communication"];
+    int addressOffset = comm["addressing_mode"].asString("0-based") == "1-based" ? 1 : 0;
+    uint16_t maxGap = static_cast<uint16_t>(comm["max_block_gap"].asNumber(0));
+    float vtr = static_cast<float>(doc["transformers"]["VTR"].asNumber(1));
+    float ctr = static_cast<float>(doc["transformers"]["CTR"].asNumber(1));
+    // Record format and derived channels follow the config's interval, as on the logger
+    long configIntervalMs = static_cast<long>(doc["logging"]["interval_ms"].asNumber(1000));
+    bool timestampMillis = doc["logging"]["timestamp_millis"].asBool(configIntervalMs < 1000);
+    if (intervalMs == 0) intervalMs = configIntervalMs;
+
+    std::vector<Channel> channels;
+    const JsonValue& regs = doc["registers"];
+    for (size_t i = 0; i < regs.size(); ++i) {
+        const JsonValue& r = regs[i];
+        Register reg;
+        reg.key = r["key"].asString("");
+        reg.unit = r["unit"].asString("");
+        double address = r["register"].asNumber(-1);
+        size_t b = static_cast<size_t>(r["bus"].asNumber(0));
+        if (reg.key.empty() || address < addressOffset || address > 65535) {
+            std::fprintf(stderr, "rtulog-poll: register %zu needs a key and an address, skipped\n", i);
+            continue;
+        }
+        if (!RegisterMap::parseType(r["type"].asString("UINT16").c_str(), reg.type)) {
+            std::fprintf(stderr, "rtulog-poll: register '%s' has an unknown type, read as UINT16 (as the logger does)\n",
+                         reg.key.c_str());
+            reg.type = RegisterMap::Type::Uint16;
+        }
+        if (b >= busCount) {
+            std::fprintf(stderr, "rtulog-poll: register '%s' is on bus %zu, which has no device, skipped\n",
+                         reg.key.c_str(), b);
+            continue;
+        }
+        reg.address = static_cast<uint16_t>(address);
+        reg.words = RegisterMap::wordCount(reg.type);
+        double length = r["length"].asNumber(reg.words);
+        if (length > reg.words && length <= RegisterMap::kMaxBlockWords) reg.words = static_cast<uint8_t>(length);
+        reg.scale.compile(r["scaling"].asString("").c_str());
+        channels.push_back({ reg.key, reg.unit, b, buses[b]->registers.size() });
+        buses[b]->registers.push_back(std::move(reg));
+    }
+    size_t registerCount = channels.size();
+
+    // Derived channels, computed behind the register values by the firmware's program
+    DerivedProgram derived;
+    std::vector<std::string> inputKeys;
+    std::vector<DerivedProgram::Definition> definitions;
+    for (const Channel& c : channels) inputKeys.push_back(c.key);
+    const JsonValue& defs = doc["derived"];
+    for (size_t i = 0; i < defs.size(); ++i) {
+        channels.push_back({ defs[i]["key"].asString(""), defs[i]["unit"].asString(""), 0, 0 });
+        definitions.push_back({ channels.back().key, defs[i]["expression"].asString("") });
+    }
+    derived.compile(inputKeys, definitions, DerivedProgram::kGapIntervals * static_cast<uint32_t>(configIntervalMs));
+    for (size_t i = 0; i < definitions.size(); ++i) {
+        if (derived.status(i) == DerivedProgram::Status::Ok) continue;
+        std::fprintf(stderr, "rtulog-poll: derived channel '%s': %s, values will be null\n", definitions[i].key.c_str(),
+                     DerivedProgram::statusName(derived.status(i)));
+    }
+    std::vector<float> values(channels.size(), NAN);
+
+    for (size_t b = 0; b < busCount; ++b) {
+        Bus& bus = *buses[b];
+        std::vector<RegisterMap::Span> spans;
+        for (const Register& reg : bus.registers) spans.push_back({reg.address, reg.words});
+        RegisterMap::plan(spans, maxGap, bus.blocks, bus.slots);
+        bus.values.assign(bus.registers.size(), NAN);
+
+        const char* device = replayPath ? "capture" : argv[first + 1 + b];
+        if (replayPath) {
+            bus.replay.begin(static_cast<uint8_t>(b), !fast);
+            bus.transport = &bus.replay;
+        } else {
+            if (!bus.port.open(device, bus.line.baud, bus.line.dataBits, bus.line.parity, bus.line.stopBits)) {
+                std::fprintf(stderr, "rtulog-poll: %s\n", bus.port.error().c_str());
+                return 1;
+            }
+            bus.capture.begin(&bus.port, static_cast<uint8_t>(b), recordPath ? kRecordBufferBytes : 0);
+            bus.transport = &bus.capture;
+        }
+        bus.master.begin(bus.transport, bus.slaveId, bus.line);
+        std::fprintf(stderr, "rtulog-poll: bus %zu on %s, slave %u, %u baud %u%c%u, %zu register(s) in %zu request(s)\n",
+                     b, device, bus.slaveId, bus.line.baud, bus.line.dataBits, bus.line.parity, bus.line.stopBits,
+                     bus.registers.size(), bus.blocks.size());
+    }
+
+    std::FILE* out = stdout;
+    if (output && !(out = std::fopen(output, "wb"))) {
+        std::fprintf(stderr, "rtulog-poll: cannot create %s\n", output);
+        return 1;
+    }
+    std::FILE* record = nullptr;
+    if (recordPath) {
+        uint8_t header[RtuCapture::kHeaderSize];
+        RtuCapture::encodeHeader(header);
+        if (!(record = std::fopen(recordPath, "wb")) || std::fwrite(header, 1, sizeof(header), record) != sizeof(header)) {
+            std::fprintf(stderr, "rtulog-poll: cannot create %s\n", recordPath);
+            return 1;
+        }
+    }
+
+    // Bus threads wait for the next cycle number, the main thread reads bus 0
+    std::mutex lock;
+    std::condition_variable start, done;
+    uint64_t cycle = 0;
+    size_t pending = 0;
+    bool quit = false;
+    std::vector<std::thread> threads;
+    for (size_t b = 1; b < busCount; ++b) {
+        threads.emplace_back([&, b]() {
+            uint64_t seen = 0;
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    start.wait(guard, [&]() { return quit || cycle != seen; });
+                    if (quit) return;
+                    seen = cycle;
+                }
+                pollBus(*buses[b], addressOffset, vtr, ctr);
+                std::lock_guard<std::mutex> guard(lock);
+                if (--pending == 0) done.notify_one();
+            }
+        });
+    }
+
+    TimestampFormatter formatter;
+    char line[LogFrame::kMaxPayload];
+    std::vector<uint8_t> recorded;
+    auto next = std::chrono::steady_clock::now();
+    auto runStarted = next;
+    uint64_t pollTotalUs = 0;
+    uint64_t pollMaxUs = 0;
+    size_t cycleIndex = 0;
+    int64_t timestampMs = 0;
+    long written = 0;
+    while (!stopRequested && (samples == 0 || written < samples)) {
+        if (replayPath) {
+            // Recorded sample time; the replay buses wait out the interval themselves
+            if (cycleIndex == capture.cycles().size()) break;
+            const CaptureFile::Cycle& c = capture.cycles()[cycleIndex++];
+            uint64_t gapUs = cycleIndex > 1 && c.timestampMs > timestampMs ? (c.timestampMs - timestampMs) * 1000ULL : 0;
+            timestampMs = c.timestampMs;
+            for (const auto& bus : buses) bus->replay.startCycle(c, gapUs);
+        } else {
+            std::this_thread::sleep_until(next);
+            next += std::chrono::milliseconds(intervalMs);
+            timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            if (record) {
+                for (const auto& bus : buses) bus->capture.setRecording(true);
+            }
+        }
+        auto pollStarted = std::chrono::steady_clock::now();
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            pending = busCount - 1;
+            ++cycle;
+        }
+        start.notify_all();
+        pollBus(*buses[0], addressOffset, vtr, ctr);
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            done.wait(guard, [&]() { return pending == 0; });
+        }
+        uint64_t pollUs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - pollStarted).count());
+        pollTotalUs += pollUs;
+        if (pollUs > pollMaxUs) pollMaxUs = pollUs;
+
+        if (record) {
+            // Sample record, then the transactions bus by bus, as the logger writes them
+            recorded.assign(RtuCapture::kSampleSize, 0);
+            RtuCapture::encodeSample(timestampMs, recorded.data());
+            bool complete = true;
+            for (const auto& bus : buses) {
+                bus->capture.setRecording(false);
+                complete = complete && !bus->capture.overflowed();
+                bus->capture.take(recorded);
+            }
+            if (!complete) std::fprintf(stderr, "rtulog-poll: cycle too large for the capture buffer, records lost\n");
+            if (std::fwrite(recorded.data(), 1, recorded.size(), record) != recorded.size()) {
+                std::fprintf(stderr, "rtulog-poll: write to %s failed\n", recordPath);
+                return 1;
+            }
+        }
+
+        for (size_t c = 0; c < registerCount; ++c) values[c] = buses[channels[c].bus]->values[channels[c].index];
+        if (channels.size() > registerCount) derived.run(timestampMs, values.data());
+
+        char timestamp[TimestampFormatter::kMaxLength];
+        formatter.format(timestampMs, timestamp, timestampMillis);
+        RecordWriter writer(line, sizeof(line), timestamp);
+        for (size_t c = 0; c < channels.size(); ++c) writer.add(channels[c].key.c_str(), values[c], channels[c].unit.c_str());
+        size_t length = writer.finish();
+        if (length == 0) {
+            std::fprintf(stderr, "rtulog-poll: %s: record over %zu bytes, skipped (as the logger does)\n", timestamp,
+                         sizeof(line));
+            continue;
+        }
+        line[length++] = '\n';
+        std::fwrite(line, 1, length, out);
+        std::fflush(out);
+        ++written;
+
+        if (replayPath && fast) continue;   // Per-cycle report would dominate the run time
+        std::fprintf(stderr, "rtulog-poll: %s", timestamp);
+        uint32_t slowestUs = 0;
+        for (size_t b = 0; b < busCount; ++b) {
+            std::fprintf(stderr, "  bus %zu: %.1f ms, %u failed", b, buses[b]->elapsedUs / 1000.0,
+                         buses[b]->failed);
+            if (buses[b]->elapsedUs > slowestUs) slowestUs = buses[b]->elapsedUs;
+        }
+        std::fprintf(stderr, "  (cycle %.1f ms)\n", slowestUs / 1000.0);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        quit = true;
+    }
+    start.notify_all();
+    for (std::thread& t : threads) t.join();
+    if (out != stdout) std::fclose(out);
+    if (record) std::fclose(record);
+    std::fprintf(stderr, "rtulog-poll: %ld sample(s)\n", written);
+    if (replayPath && written > 0) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStarted).count();
+        unsigned long long unmatched = 0, skipped = 0;
+        for (const auto& bus : buses) {
+            unmatched += bus->replay.unmatched();
+            skipped += bus->replay.skipped();
+        }
+        std::fprintf(stderr, "rtulog-poll: %.3f s, %.0f samples/s, poll %.1f us mean / %.1f us max, "
+                             "%llu request(s) without recorded answer, %llu recorded request(s) not sent\n",
+                     seconds, written / seconds, static_cast<double>(pollTotalUs) / written,
+                     static_cast<double>(pollMaxUs), unmatched, skipped);
+    }
+    return 0;
+}
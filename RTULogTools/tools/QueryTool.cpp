@@ -0,0 +1,179 @@
+// rtulog-query: aggregate queries (count, min, max, mean, sum, approximate percentiles) over a
+// directory of log files, grouped by time bucket and key, e.g. the daily maximum
+// current per phase of a quarter. Files are processed in parallel and merged into
+// one CSV table.
+//
+// Usage: rtulog-query [-k keys] [-a aggregates] [-b bucket] [--from time] [--to time] [-j threads]
+//                     <log file|directory>...
+
+#include "LogQuery.h"
+#include "TimestampFormatter.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static int usage() {
+    std::fprintf(stderr, "Usage: rtulog-query [-k keys] [-a aggregates] [-b bucket] [--from time] [--to time] [-j threads]\n"
+                         "                    <log file|directory>...\n"
+                         "       keys:       comma separated, \"prefix*\" matches a prefix (default: all)\n"
+                         "       aggregates: comma separated count, min, max, mean, sum, pNN (e.g. p95, p99.9)\n"
+                         "                   (default: count,min,max,mean); percentiles are approximate,\n"
+                         "                   within +/-1 %% of the exact value (quantile sketch)\n"
+                         "       bucket:     none, hour, day, month, year or a width like 15m, 6h, 7d (default: none)\n"
+                         "       time:       YYYY-MM-DD HH:MM:SS[.mmm]\n");
+    return 2;
+}
+
+static std::vector<std::string> split(const char* text) {
+    std::vector<std::string> parts;
+    std::string part;
+    for (const char* p = text;; ++p) {
+        if (*p == ',' || *p == '\0') {
+            if (!part.empty()) parts.push_back(part);
+            part.clear();
+            if (*p == '\0') break;
+        } else {
+            part += *p;
+        }
+    }
+    return parts;
+}
+
+struct Column {
+    enum class Kind { Count, Min, Max, Mean, Sum, Quantile } kind;
+    double q;
+};
+
+static bool parseColumns(const char* text, std::vector<Column>& columns, std::vector<std::string>& names) {
+    for (const std::string& name : split(text)) {
+        Column c = {Column::Kind::Count, 0.0};
+        if (name == "count") {
+            c.kind = Column::Kind::Count;
+        } else if (name == "min") {
+            c.kind = Column::Kind::Min;
+        } else if (name == "max") {
+            c.kind = Column::Kind::Max;
+        } else if (name == "mean") {
+            c.kind = Column::Kind::Mean;
+        } else if (name == "sum") {
+            c.kind = Column::Kind::Sum;
+        } else if (name.size() > 1 && name[0] == 'p') {
+            char* end;
+            double percent = std::strtod(name.c_str() + 1, &end);
+            if (*end || percent < 0 || percent > 100) return false;
+            c.kind = Column::Kind::Quantile;
+            c.q = percent / 100.0;
+        } else {
+            return false;
+        }
+        columns.push_back(c);
+        if (c.kind == Column::Kind::Quantile) {
+            // The header says the percentiles are approximate: "p95 (+/-1%)"
+            char label[64];
+            std::snprintf(label, sizeof(label), "%s (+/-%g%%)", name.c_str(), QuantileSketch::kRelativeAccuracy * 100);
+            names.push_back(label);
+        } else {
+            names.push_back(name);
+        }
+    }
+    return !columns.empty();
+}
+
+static bool parseTime(const char* text, int64_t& ms) {
+    return TimestampFormatter::parse(text, std::strlen(text), ms);
+}
+
+int main(int argc, char** argv) {
+    QuerySpec spec;
+    std::vector<Column> columns;
+    std::vector<std::string> columnNames;
+    unsigned threads = 0;
+    const char* aggregates = "count,min,max,mean";
+    int first = 1;
+    while (first + 1 < argc && argv[first][0] == '-') {
+        const char* option = argv[first];
+        const char* value = argv[first + 1];
+        if (std::strcmp(option, "-k") == 0) {
+            spec.keys = split(value);
+        } else if (std::strcmp(option, "-a") == 0) {
+            aggregates = value;
+        } else if (std::strcmp(option, "-b") == 0) {
+            if (!spec.parseBucket(value)) return usage();
+        } else if (std::strcmp(option, "--from") == 0) {
+            if (!parseTime(value, spec.fromMs)) return usage();
+        } else if (std::strcmp(option, "--to") == 0) {
+            if (!parseTime(value, spec.toMs)) return usage();
+        } else if (std::strcmp(option, "-j") == 0) {
+            char* end;
+            long n = std::strtol(value, &end, 10);
+            if (*end || n < 0) return usage();
+            threads = static_cast<unsigned>(n);
+        } else {
+            return usage();
+        }
+        first += 2;
+    }
+    if (first >= argc || !parseColumns(aggregates, columns, columnNames)) return usage();
+    for (const Column& c : columns) spec.quantiles |= c.kind == Column::Kind::Quantile;
+
+    LogQuery query;
+    for (int i = first; i < argc; ++i) {
+        if (!query.addPath(argv[i])) {
+            std::fprintf(stderr, "rtulog-query: %s\n", query.error().c_str());
+            return 1;
+        }
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    query.run(spec, threads);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    // Bucket labels as wide as the bucket: 2025-07, 2025-07-03, 2025-07-03 14:15:00
+    size_t labelLength = 19;
+    if (spec.bucket == QuerySpec::Bucket::Year) labelLength = 4;
+    if (spec.bucket == QuerySpec::Bucket::Month) labelLength = 7;
+    if (spec.bucket == QuerySpec::Bucket::Fixed && spec.bucketMs % 86400000 == 0) labelLength = 10;
+
+    std::printf("bucket,key");
+    for (const std::string& name : columnNames) std::printf(",%s", name.c_str());
+    std::printf("\n");
+
+    TimestampFormatter formatter;
+    const std::vector<std::string>& keys = query.keys();
+    for (const auto& group : query.groups()) {
+        char label[TimestampFormatter::kMaxLength] = "all";
+        if (spec.bucket != QuerySpec::Bucket::None) {
+            formatter.format(group.first, label, false);
+            label[labelLength] = '\0';
+        }
+        for (size_t k = 0; k < group.second.size(); ++k) {
+            const Aggregate& a = group.second[k];
+            if (a.count == 0) continue;
+            std::printf("%s,%s", label, keys[k].c_str());
+            for (const Column& c : columns) {
+                switch (c.kind) {
+                    case Column::Kind::Count: std::printf(",%llu", static_cast<unsigned long long>(a.count)); break;
+                    case Column::Kind::Min: std::printf(",%.7g", a.min); break;
+                    case Column::Kind::Max: std::printf(",%.7g", a.max); break;
+                    case Column::Kind::Mean: std::printf(",%.7g", a.mean()); break;
+                    case Column::Kind::Sum: std::printf(",%.9g", a.sum); break;
+                    case Column::Kind::Quantile: std::printf(",%.6g", a.quantile(c.q)); break;
+                }
+            }
+            std::printf("\n");
+        }
+    }
+
+    const QueryStats& stats = query.stats();
+    std::fprintf(stderr, "rtulog-query: %llu file(s), %.1f MB, %llu record(s) in %.2f s (%.1f MB/s)",
+                 static_cast<unsigned long long>(stats.files), stats.bytes / 1e6,
+                 static_cast<unsigned long long>(stats.records), seconds,
+                 seconds > 0 ? stats.bytes / 1e6 / seconds : 0.0);
+    if (stats.malformed) std::fprintf(stderr, ", %llu malformed", static_cast<unsigned long long>(stats.malformed));
+    if (stats.failedFiles) std::fprintf(stderr, ", %llu unreadable file(s)", static_cast<unsigned long long>(stats.failedFiles));
+    std::fprintf(stderr, "\n");
+    return 0;
+}
@@ -0,0 +1,174 @@
+// rtulog-recovery-test: host test of the firmware's framed log tail recovery
+// (LogFrame::findValidEnd / LogFrame::recoverTail). Files are written the way
+// StorageManager writes them (a sync marker once kSyncInterval bytes were written),
+// then torn in different ways; the recovered end must be the end of the last intact
+// frame, or just past the newest sync marker when only torn data follows it.
+//
+// Usage: rtulog-recovery-test
+
+#include "LogFrame.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+/// <summary>
+/// Framed log file in memory, written like StorageManager::appendRecord().
+/// </summary>
+class TestFile : public LogFrame::Reader {
+public:
+    /// <summary>
+    /// Appends one record (sync marker first when due), returns its frame offset.
+    /// </summary>
+    size_t frame(size_t payloadLen) {
+        sync();
+        size_t offset = bytes.size();
+        std::vector<uint8_t> payload(payloadLen);
+        for (size_t i = 0; i < payloadLen; ++i) payload[i] = static_cast<uint8_t>('a' + (offset + i) % 26);
+        uint8_t header[LogFrame::kHeaderSize], trailer[LogFrame::kTrailerSize];
+        LogFrame::encodeHeader(static_cast<uint16_t>(payloadLen), header);
+        LogFrame::encodeTrailer(header, payload.data(), payloadLen, trailer);
+        bytes.insert(bytes.end(), header, header + sizeof(header));
+        bytes.insert(bytes.end(), payload.begin(), payload.end());
+        bytes.insert(bytes.end(), trailer, trailer + sizeof(trailer));
+        sinceSync += payloadLen + LogFrame::kOverhead;
+        return offset;
+    }
+
+    /// <summary>
+    /// Writes the sync marker if one is due, returns the offset it would start at.
+    /// </summary>
+    size_t sync() {
+        size_t offset = bytes.size();
+        if (sinceSync >= LogFrame::kSyncInterval) {
+            bytes.insert(bytes.end(), LogFrame::kSyncMarker, LogFrame::kSyncMarker + LogFrame::kSyncSize);
+            sinceSync = 0;
+        }
+        return offset;
+    }
+
+    /// <summary>
+    /// Appends the first bytes of a frame that was never completed.
+    /// </summary>
+    void tornFrame(size_t payloadLen, size_t keep) {
+        size_t offset = frame(payloadLen);
+        bytes.resize(offset + keep);
+    }
+
+    /// <summary>
+    /// Appends bytes that are no frame and no sync marker (unwritten clusters).
+    /// </summary>
+    void garbage(size_t count) { bytes.insert(bytes.end(), count, 0x00); }
+
+    bool read(uint64_t offset, uint8_t* out, size_t len) override {
+        if (failReads || offset + len > bytes.size()) return false;
+        std::memcpy(out, bytes.data() + offset, len);
+        return true;
+    }
+
+    std::vector<uint8_t> bytes;
+    size_t sinceSync = 0;               ///< A new file starts without a sync marker
+    bool failReads = false;
+};
+
+int failures = 0;
+
+void check(bool condition, const char* test, const char* what) {
+    if (condition) return;
+    std::fprintf(stderr, "rtulog-recovery-test: %s: %s\n", test, what);
+    ++failures;
+}
+
+LogFrame::RecoveryResult recover(TestFile& file) {
+    std::vector<uint8_t> window;
+    return LogFrame::recoverTail(file.bytes.size(), file, window);
+}
+
+/// <summary>
+/// Writes frames until the next one starts with a sync marker.
+/// </summary>
+void fillToSync(TestFile& file, size_t payloadLen) {
+    while (file.sinceSync < LogFrame::kSyncInterval) file.frame(payloadLen);
+}
+
+} // namespace
+
+int main(int argc, char**) {
+    if (argc > 1) {
+        std::fprintf(stderr, "Usage: rtulog-recovery-test\n");
+        return 2;
+    }
+
+    {
+        const char* test = "intact file";
+        TestFile file;
+        for (int i = 0; i < 200; ++i) file.frame(300);
+        LogFrame::RecoveryResult r = recover(file);
+        check(r.found && r.validEnd == file.bytes.size(), test, "end is not the file end");
+    }
+
+    {
+        const char* test = "torn last frame";
+        TestFile file;
+        for (int i = 0; i < 200; ++i) file.frame(300);
+        size_t end = file.bytes.size();
+        file.tornFrame(300, 100);
+        LogFrame::RecoveryResult r = recover(file);
+        check(r.found && r.validEnd == end, test, "end is not after the last intact frame");
+    }
+
+    {
+        const char* test = "torn frame in a file without sync marker";
+        TestFile file;
+        for (int i = 0; i < 5; ++i) file.frame(200);
+        size_t end = file.bytes.size();
+        file.tornFrame(200, 50);
+        LogFrame::RecoveryResult r = recover(file);
+        check(r.found && r.validEnd == end && r.lastSync == 0, test, "end is not after the last intact frame");
+    }
+
+    {
+        // The newest sync marker is followed by a torn frame and a long torn tail,
+        // which pushes the sync marker before it out of the first window
+        const char* test = "torn last frame with one sync marker in the window";
+        TestFile file;
+        for (int i = 0; i < 60; ++i) file.frame(300);
+        fillToSync(file, 300);
+        size_t newestSync = file.sync();
+        file.tornFrame(300, 120);
+        file.garbage(10000);
+
+        uint64_t windowStart = file.bytes.size() - LogFrame::kRecoveryWindow;
+        LogFrame::RecoveryResult first = LogFrame::findValidEnd(file.bytes.data() + windowStart,
+                                                                LogFrame::kRecoveryWindow, windowStart);
+        check(!first.found, test, "setup: the first window already verifies (older sync marker inside)");
+
+        LogFrame::RecoveryResult r = recover(file);
+        check(r.found, test, "no resume point found");
+        check(r.validEnd == newestSync + LogFrame::kSyncSize, test, "end is not just past the newest sync marker");
+        check(r.lastSync == newestSync && r.frames == 0, test, "last sync marker or frame count wrong");
+    }
+
+    {
+        const char* test = "torn tail longer than the widest window";
+        TestFile file;
+        for (int i = 0; i < 60; ++i) file.frame(300);
+        file.garbage(LogFrame::kMaxRecoveryWindow);
+        LogFrame::RecoveryResult r = recover(file);
+        check(!r.found && !r.readFailed, test, "a resume point inside unframed data");
+    }
+
+    {
+        const char* test = "read failure";
+        TestFile file;
+        for (int i = 0; i < 60; ++i) file.frame(300);
+        file.failReads = true;
+        LogFrame::RecoveryResult r = recover(file);
+        check(!r.found && r.readFailed, test, "read failure not reported");
+    }
+
+    if (failures) return 1;
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,312 @@
+// rtulog-regmap: turns a logger config.json into CompiledConfig.h, a flash-resident
+// register map for fixed deployments: constexpr register table, generated scaling
+// functions, typed decoders and a precomputed block read plan. The firmware uses it
+// while the card carries the same config.json (compared by CRC32) or none at all.
+//
+// Usage: rtulog-regmap [-g max_gap] [-r regmap_cache.json] -o <CompiledConfig.h> <config.json>
+
+#include "FileUtil.h"
+#include "JsonValue.h"
+#include "LogFrame.h"
+#include "RegisterMap.h"
+#include "ScaleExpression.h"
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+static int usage() {
+    std::fprintf(stderr, "Usage: rtulog-regmap [-g max_gap] [-r regmap_cache.json] -o <CompiledConfig.h> <config.json>\n"
+                         "       max_gap: unused registers a block read may span (default 0)\n"
+                         "       -r: discovery cache from the card (/config/regmap_*.json); short gaps\n"
+                         "           inside readable ranges are then read through\n");
+    return 2;
+}
+
+struct Entry {
+    std::string key;
+    std::string unit;
+    uint16_t address;
+    RegisterMap::Type type;
+    uint8_t words;
+    size_t scale;            ///< Index of the shared scaling function
+};
+
+/// <summary>
+/// C string literal; bytes outside printable ASCII become octal escapes.
+/// </summary>
+static std::string quote(const std::string& s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20 || c >= 0x7F) {
+            char esc[5];
+            std::snprintf(esc, sizeof(esc), "\\%03o", c);
+            out += esc;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out + "\"";
+}
+
+/// <summary>
+/// Float literal that reads back as exactly the same float.
+/// </summary>
+static std::string floatLiteral(float v) {
+    char buf[32];
+    std::string s(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+    if (s.find_first_of(".eEn") == std::string::npos) s += ".0";
+    return s + "f";
+}
+
+/// <summary>
+/// Rebuilds C++ infix code from the compiled postfix program, with explicit
+/// parentheses so the evaluation order (and rounding) matches ScaleExpression.
+/// </summary>
+static std::string toCpp(const ScaleExpression& expr, bool used[3]) {
+    using Kind = ScaleExpression::Op::Kind;
+    struct Term {
+        std::string code;
+        bool compound;
+    };
+    std::vector<Term> stack;
+    auto operand = [](const Term& t) { return t.compound ? "(" + t.code + ")" : t.code; };
+
+    for (const ScaleExpression::Op& op : expr.ops()) {
+        switch (op.kind) {
+            case Kind::Const: stack.push_back({floatLiteral(op.value), false}); break;
+            case Kind::Val: stack.push_back({"val", false}); used[0] = true; break;
+            case Kind::Vtr: stack.push_back({"VTR", false}); used[1] = true; break;
+            case Kind::Ctr: stack.push_back({"CTR", false}); used[2] = true; break;
+            case Kind::Neg: stack.back() = {"-" + operand(stack.back()), true}; break;
+            default: {
+                Term b = stack.back();
+                stack.pop_back();
+                Term a = stack.back();
+                if (op.kind == Kind::Div) {
+                    stack.back() = {"ScaleExpression::divide(" + a.code + ", " + b.code + ")", false};
+                } else {
+                    const char* sym = op.kind == Kind::Add ? " + " : op.kind == Kind::Sub ? " - " : " * ";
+                    stack.back() = {operand(a) + sym + operand(b), true};
+                }
+            }
+        }
+    }
+    return stack.back().code;
+}
+
+static bool readFile(const char* path, std::string& out) {
+    std::FILE* f = std::fopen(path, "rb");
+    if (!f) return false;
+    char buf[65536];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    bool ok = !std::ferror(f);
+    std::fclose(f);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    const char* output = nullptr;
+    const char* rangesPath = nullptr;
+    long maxGap = 0;
+    int first = 1;
+    while (first + 1 < argc && argv[first][0] == '-') {
+        if (std::strcmp(argv[first], "-o") == 0) {
+            output = argv[first + 1];
+        } else if (std::strcmp(argv[first], "-r") == 0) {
+            rangesPath = argv[first + 1];
+        } else if (std::strcmp(argv[first], "-g") == 0) {
+            char* end;
+            maxGap = std::strtol(argv[first + 1], &end, 10);
+            if (*end || maxGap < 0 || maxGap > RegisterMap::kMaxBlockWords) return usage();
+        } else {
+            return usage();
+        }
+        first += 2;
+    }
+    if (!output || first + 1 != argc) return usage();
+    const char* input = argv[first];
+
+    std::string text;
+    if (!readFile(input, text)) {
+        std::fprintf(stderr, "rtulog-regmap: cannot read %s\n", input);
+        return 1;
+    }
+    JsonValue doc;
+    std::string error;
+    if (!JsonValue::parse(text, doc, error)) {
+        std::fprintf(stderr, "rtulog-regmap: %s: %s\n", input, error.c_str());
+        return 1;
+    }
+
+    // Registers; identical formulas share one generated function
+    const JsonValue& regs = doc["registers"];
+    if (regs.kind() != JsonValue::Kind::Array || regs.size() == 0) {
+        std::fprintf(stderr, "rtulog-regmap: %s has no registers\n", input);
+        return 1;
+    }
+    std::vector<Entry> entries;
+    std::vector<std::string> scaleCode;
+    std::vector<std::string> scaleParams;
+    std::map<std::string, size_t> scaleIndex;
+    for (size_t i = 0; i < regs.size(); ++i) {
+        const JsonValue& r = regs[i];
+        if (r["bus"].asNumber(0) != 0) {
+            // The compiled map covers bus 0 only; other buses keep their JSON registers
+            std::fprintf(stderr, "rtulog-regmap: register '%s' is on bus %g, skipped\n",
+                         r["key"].asString("").c_str(), r["bus"].asNumber(0));
+            continue;
+        }
+        Entry e;
+        e.key = r["key"].asString("");
+        e.unit = r["unit"].asString("");
+        double address = r["register"].asNumber(-1);
+        std::string typeName = r["type"].asString("UINT16");
+        std::string scaling = r["scaling"].asString("");
+        if (e.key.empty() || address < 0 || address > 65535) {
+            std::fprintf(stderr, "rtulog-regmap: register %zu needs a key and a register address 0..65535\n", i);
+            return 1;
+        }
+        e.address = static_cast<uint16_t>(address);
+        if (!RegisterMap::parseType(typeName.c_str(), e.type)) {
+            std::fprintf(stderr, "rtulog-regmap: register '%s' has unknown type '%s'\n", e.key.c_str(), typeName.c_str());
+            return 1;
+        }
+        e.words = RegisterMap::wordCount(e.type);
+        double length = r["length"].asNumber(e.words);
+        if (length > e.words && length <= RegisterMap::kMaxBlockWords) e.words = static_cast<uint8_t>(length);
+
+        ScaleExpression expr;
+        if (!expr.compile(scaling.c_str())) {
+            std::fprintf(stderr, "rtulog-regmap: register '%s' has an invalid scaling expression '%s'\n",
+                         e.key.c_str(), scaling.c_str());
+            return 1;
+        }
+        bool used[3] = {false, false, false};
+        std::string code = toCpp(expr, used);
+        auto it = scaleIndex.find(code);
+        if (it == scaleIndex.end()) {
+            it = scaleIndex.emplace(code, scaleCode.size()).first;
+            scaleCode.push_back(code);
+            scaleParams.push_back(std::string(used[0] ? "float val" : "float /*val*/") +
+                                  (used[1] ? ", float VTR" : ", float /*VTR*/") +
+                                  (used[2] ? ", float CTR" : ", float /*CTR*/"));
+        }
+        e.scale = it->second;
+        entries.push_back(e);
+    }
+
+    // Readable ranges found by the logger's register discovery
+    std::vector<RegisterMap::Range> ranges;
+    if (rangesPath) {
+        std::string cacheText;
+        JsonValue cache;
+        if (!readFile(rangesPath, cacheText) || !JsonValue::parse(cacheText, cache, error)) {
+            std::fprintf(stderr, "rtulog-regmap: cannot read discovery cache %s %s\n", rangesPath, error.c_str());
+            return 1;
+        }
+        const JsonValue& list = cache["ranges"];
+        for (size_t i = 0; i < list.size(); ++i) {
+            double address = list[i][0].asNumber(-1);
+            double count = list[i][1].asNumber(0);
+            if (address < 0 || count < 1 || address + count > 65536) continue;
+            ranges.push_back({static_cast<uint16_t>(address), static_cast<uint16_t>(count)});
+        }
+    }
+
+    std::vector<RegisterMap::Span> spans;
+    for (const Entry& e : entries) spans.push_back({e.address, e.words});
+    std::vector<RegisterMap::Block> blocks;
+    std::vector<RegisterMap::Slot> slots;
+    RegisterMap::plan(spans, static_cast<uint16_t>(maxGap), blocks, slots, ranges.empty() ? nullptr : &ranges);
+
+    const JsonValue& comm = doc["communication"];
+    const JsonValue& trans = doc["transformers"];
+    std::string parity = comm["parity"].asString("N");
+    const char* inputName = std::strrchr(input, '/');
+    inputName = inputName ? inputName + 1 : input;
+
+    std::string out;
+    char line[512];
+    auto emit = [&](const char* fmt, auto... args) {
+        std::snprintf(line, sizeof(line), fmt, args...);
+        out += line;
+    };
+
+    emit("// Generated by rtulog-regmap from %s - do not edit.\n", inputName);
+    out += "// Regenerate after changing the configuration; delete this file to read the\n"
+           "// register list from the card's config.json only.\n\n"
+           "#ifndef COMPILED_CONFIG_H\n#define COMPILED_CONFIG_H\n\n"
+           "#include \"RegisterMap.h\"\n#include \"ScaleExpression.h\"\n\n"
+           "namespace CompiledConfig {\n\n";
+    emit("/// CRC32 of the config.json this map was generated from\n"
+         "constexpr uint32_t kSourceCrc = 0x%08lXUL;\n\n",
+         static_cast<unsigned long>(LogFrame::crc32(text.data(), text.size())));
+
+    out += "// Used when the card has no config.json\n";
+    emit("constexpr uint8_t kSlaveId = %d;\n", static_cast<int>(comm["modbus_id"].asNumber(1)));
+    emit("constexpr long kBaudrate = %ld;\n", static_cast<long>(comm["baudrate"].asNumber(9600)));
+    emit("constexpr char kParity = '%c';\n", parity.empty() ? 'N' : parity[0]);
+    emit("constexpr uint8_t kStopBits = %d;\n", static_cast<int>(comm["stop_bits"].asNumber(1)));
+    emit("constexpr uint8_t kDataBits = %d;\n", static_cast<int>(comm["data_bits"].asNumber(8)));
+    emit("constexpr bool kAddressOffset = %s;\n",
+         comm["addressing_mode"].asString("0-based") == "1-based" ? "true" : "false");
+    emit("constexpr float kVTR = %s;\n", floatLiteral(static_cast<float>(trans["VTR"].asNumber(1))).c_str());
+    emit("constexpr float kCTR = %s;\n", floatLiteral(static_cast<float>(trans["CTR"].asNumber(1))).c_str());
+    emit("constexpr uint16_t kVTRRegister = %d;\n", static_cast<int>(trans["VTR_register"].asNumber(0)));
+    emit("constexpr uint16_t kCTRRegister = %d;\n\n", static_cast<int>(trans["CTR_register"].asNumber(0)));
+
+    out += "// Scaling formulas\n";
+    for (size_t i = 0; i < scaleCode.size(); ++i) {
+        emit("inline float scale%zu(%s) { return ", i, scaleParams[i].c_str());
+        out += scaleCode[i] + "; }\n";
+    }
+
+    out += "\n// Block decoders: one function per read, writing out[register index]\n";
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        emit("inline void decodeBlock%zu(const uint16_t* w, float VTR, float CTR, float* out) {\n", b);
+        for (uint16_t s = 0; s < blocks[b].slotCount; ++s) {
+            const RegisterMap::Slot& slot = slots[blocks[b].firstSlot + s];
+            const Entry& e = entries[slot.reg];
+            emit("    out[%u] = scale%zu(RegisterMap::Decoder<RegisterMap::Type::%s>::decode(w + %u), VTR, CTR);",
+                 slot.reg, e.scale, RegisterMap::typeName(e.type), slot.offset);
+            out += " // " + e.key + "\n";
+        }
+        out += "}\n";
+    }
+
+    out += "\nconstexpr RegisterMap::Register kRegisters[] = {\n";
+    for (const Entry& e : entries) {
+        emit("    {%s, %s, %u, RegisterMap::Type::%s, &scale%zu},\n", quote(e.key).c_str(), quote(e.unit).c_str(),
+             e.address, RegisterMap::typeName(e.type), e.scale);
+    }
+    out += "};\n\nconstexpr RegisterMap::Block kBlocks[] = {\n";
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        emit("    {%u, %u, %u, %u, &decodeBlock%zu},\n", blocks[b].address, blocks[b].count, blocks[b].firstSlot,
+             blocks[b].slotCount, b);
+    }
+    out += "};\n\nconstexpr RegisterMap::Slot kSlots[] = {\n";
+    for (const RegisterMap::Slot& s : slots) emit("    {%u, %u},\n", s.reg, s.offset);
+    out += "};\n\n";
+    emit("constexpr size_t kRegisterCount = %zu;\n", entries.size());
+    emit("constexpr size_t kBlockCount = %zu;\n", blocks.size());
+    emit("constexpr size_t kSlotCount = %zu;\n", slots.size());
+    emit("constexpr uint16_t kMaxBlockGap = %ld;\n\n", maxGap);
+    out += "} // namespace CompiledConfig\n\n#endif // COMPILED_CONFIG_H\n";
+
+    if (!FileUtil::writeAtomically(output, out.data(), out.size())) {
+        std::fprintf(stderr, "rtulog-regmap: cannot write %s\n", output);
+        return 1;
+    }
+    std::printf("%s: %zu register(s) in %zu block read(s), %zu scaling function(s), source CRC %08lX\n", output,
+                entries.size(), blocks.size(), scaleCode.size(),
+                static_cast<unsigned long>(LogFrame::crc32(text.data(), text.size())));
+    return 0;
+}
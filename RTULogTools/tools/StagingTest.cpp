@@ -0,0 +1,148 @@
+// rtulog-staging-test: host test of the firmware's staging ring flush (StagingRing::drain).
+// A simulated card with a small write buffer fails write-outs at random, samples that
+// never serialize are mixed in, and resets are simulated by attaching a new ring to the
+// same memory. After every round the card must hold each sample at most once, in order,
+// and at the end every sample that was neither skipped nor overwritten must be on it.
+//
+// Usage: rtulog-staging-test [rounds] [seed]
+
+#include "StagingRing.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+
+/// <summary>
+/// Card with a write buffer like StorageManager's: a sample for another day or
+/// one that does not fit writes the buffer out first, a failed write-out drops
+/// the buffer (the samples stay staged).
+/// </summary>
+class FakeCard : public StagingRing::Sink {
+public:
+    FakeCard(size_t bufferLimit, std::mt19937& random) : limit(bufferLimit), random(random) {}
+
+    Result write(const StagingRing::Sample& sample) override {
+        if (sample.values[0] < 0) {                             // "Does not serialize"
+            skipped.insert(sample.seq);
+            return Result::Skipped;
+        }
+        int64_t day = sample.timestampMs / 86400000;
+        if (!buffer.empty() && (day != bufferDay || buffer.size() >= limit) && !writeOut()) return Result::Failed;
+        bufferDay = day;
+        buffer.push_back(sample.seq);
+        return Result::Buffered;
+    }
+
+    bool flush() override { return buffer.empty() || writeOut(); }
+
+    uint32_t writeCount() const override { return writes; }
+
+    double failureRate = 0;
+    std::vector<uint32_t> card;         ///< Sequence numbers on the card, in write order
+    std::set<uint32_t> skipped;         ///< Sequence numbers handed in but never writable
+
+private:
+    bool writeOut() {
+        bool ok = std::uniform_real_distribution<double>(0, 1)(random) >= failureRate;
+        if (ok) {
+            card.insert(card.end(), buffer.begin(), buffer.end());
+            ++writes;
+        }
+        buffer.clear();
+        return ok;
+    }
+
+    size_t limit;
+    std::mt19937& random;
+    std::vector<uint32_t> buffer;
+    int64_t bufferDay = 0;
+    uint32_t writes = 0;
+};
+
+int failures = 0;
+
+void check(bool condition, const char* what, unsigned round) {
+    if (condition) return;
+    std::fprintf(stderr, "rtulog-staging-test: round %u: %s\n", round, what);
+    ++failures;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned rounds = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 2000;
+    unsigned seed = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 1;
+    if (rounds == 0) {
+        std::fprintf(stderr, "Usage: rtulog-staging-test [rounds] [seed]\n");
+        return 2;
+    }
+
+    std::mt19937 random(seed);
+    const uint16_t valueCount = 4;
+    std::vector<uint64_t> region(1024);          // 8 KB, like RTC slow memory
+    StagingRing ring;
+    ring.attach(region.data(), region.size() * sizeof(uint64_t), valueCount, 0x1234);
+    FakeCard card(8, random);
+
+    uint32_t pushed = 0, resets = 0, failedDrains = 0;
+    uint32_t overwritten = 0;                    // dropped() counts since attach, summed over resets
+    int64_t timeMs = 1751500000000;              // Crosses midnight every few hundred samples
+
+    for (unsigned round = 1; round <= rounds; ++round) {
+        unsigned samples = std::uniform_int_distribution<unsigned>(0, 40)(random);
+        for (unsigned i = 0; i < samples; ++i) {
+            float values[valueCount] = { 1, 2, 3, 4 };
+            if (std::uniform_int_distribution<int>(0, 50)(random) == 0) values[0] = -1;
+            timeMs += 300000;
+            ring.push(timeMs, values);
+            ++pushed;
+        }
+
+        if (std::uniform_int_distribution<int>(0, 10)(random) == 0) {
+            StagingRing restored;                // Reset: a new instance on the same memory
+            check(restored.attach(region.data(), region.size() * sizeof(uint64_t), valueCount, 0x1234) ==
+                      StagingRing::AttachResult::Restored, "ring not restored after reset", round);
+            check(restored.pending() == ring.pending(), "pending samples changed across reset", round);
+            overwritten += ring.dropped();
+            ring = restored;
+            ++resets;
+        }
+
+        card.failureRate = std::uniform_real_distribution<double>(0, 0.5)(random);
+        StagingRing::DrainStats stats;
+        bool ok = ring.drain(card, stats);
+        if (!ok) ++failedDrains;
+        check(!ok || ring.pending() == 0, "drain succeeded with samples left", round);
+
+        for (size_t i = 1; i < card.card.size(); ++i) {
+            if (card.card[i] <= card.card[i - 1]) {
+                check(false, "sample written twice or out of order", round);
+                break;
+            }
+        }
+        if (failures) return 1;
+    }
+
+    card.failureRate = 0;
+    StagingRing::DrainStats stats;
+    check(ring.drain(card, stats), "final drain failed", rounds);
+
+    std::set<uint32_t> onCard(card.card.begin(), card.card.end());
+    uint32_t missing = 0;
+    for (uint32_t seq = 1; seq <= pushed; ++seq) {
+        if (!onCard.count(seq) && !card.skipped.count(seq)) ++missing;
+    }
+    for (uint32_t seq : card.skipped) check(onCard.count(seq) == 0, "skipped sample on the card", rounds);
+    overwritten += ring.dropped();
+    // A skipped sample can also be overwritten before the mark passes it, so
+    // dropped() may count a few of the skipped ones too
+    check(missing <= overwritten, "samples lost other than overwritten by the ring", rounds);
+
+    std::printf("%u round(s): %u sample(s), %zu on the card, %zu skipped, %u overwritten, %u failed drain(s), %u reset(s)%s\n",
+                rounds, pushed, card.card.size(), card.skipped.size(), overwritten, failedDrains, resets,
+                failures ? "" : ", OK");
+    return failures ? 1 : 0;
+}
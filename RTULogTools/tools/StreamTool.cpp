@@ -0,0 +1,196 @@
+// rtulog-stream: records the logger's binary live stream from a serial port (or a
+// captured file) into NDJSON, framed, CSV or columnar output. With --emit it replays a
+// log file as the logger would stream it, e.g. into one end of a pty for testing.
+//
+// Usage: rtulog-stream [-f ndjson|framed|csv|rtc] [-b baud] [-n samples] -o <output> <device|file|->
+//        rtulog-stream --emit [-b baud] [-i interval_ms] <log file> <device|file|->
+
+#include "LogFrame.h"
+#include "LogReader.h"
+#include "RecordParser.h"
+#include "SerialPort.h"
+#include "StreamProtocol.h"
+#include "StreamReceiver.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static std::atomic<bool> stopRequested(false);
+
+static void onSignal(int) {
+    stopRequested = true;
+}
+
+static int usage() {
+    std::fprintf(stderr, "Usage: rtulog-stream [-f ndjson|framed|csv|rtc] [-b baud] [-n samples] -o <output> <device|file|->\n"
+                         "       rtulog-stream --emit [-b baud] [-i interval_ms] <log file> <device|file|->\n");
+    return 2;
+}
+
+/// <summary>
+/// Streams the records of a log file with the encoder the firmware uses.
+/// The first valid record defines the register list; the schema is repeated every 64 samples.
+/// </summary>
+static int emit(const char* logPath, const char* target, uint32_t baud, unsigned long intervalMs) {
+    LogReader reader;
+    if (!reader.open(logPath)) {
+        std::fprintf(stderr, "rtulog-stream: %s\n", reader.error().c_str());
+        return 1;
+    }
+    SerialPort port;
+    if (!port.openForWrite(target, baud)) {
+        std::fprintf(stderr, "rtulog-stream: %s\n", port.error().c_str());
+        return 1;
+    }
+
+    std::vector<std::string> keys, units;
+    std::unordered_map<std::string, size_t> columnOf;
+    uint32_t hash = 0;
+    std::vector<float> values;
+    std::vector<RecordValue> parsed;
+    std::vector<uint8_t> payload(StreamProtocol::kMaxPayload);
+    std::vector<uint8_t> frame(StreamProtocol::kMaxPayload + StreamProtocol::kOverhead);
+    uint32_t seq = 0;
+    uint64_t samples = 0;
+    bool ok = true;
+
+    auto send = [&](uint8_t type, size_t length) {
+        size_t size = StreamProtocol::encodeFrame(type, seq++, payload.data(), length, frame.data());
+        ok = ok && size > 0 && port.write(frame.data(), size);
+    };
+
+    reader.readAll([&](const LogRecord& rec) {
+        int64_t ts;
+        if (!RecordParser::parse(rec.json, rec.length, ts, parsed)) return true;
+
+        if (keys.empty()) {
+            for (const auto& v : parsed) {
+                keys.emplace_back(v.key, v.keyLength);
+                units.emplace_back(v.unit ? std::string(v.unit, v.unitLength) : std::string());
+                columnOf.emplace(keys.back(), keys.size() - 1);
+                hash = LogFrame::crc32(keys.back().c_str(), keys.back().size() + 1, hash);
+            }
+            if (keys.empty() || keys.size() > StreamProtocol::kMaxValues) {
+                ok = false;
+                return false;
+            }
+            values.resize(keys.size());
+        }
+
+        if (samples % 64 == 0) {
+            std::vector<const char*> k, u;
+            for (size_t i = 0; i < keys.size(); ++i) {
+                k.push_back(keys[i].c_str());
+                u.push_back(units[i].c_str());
+            }
+            size_t len = StreamProtocol::encodeSchema(hash, k.data(), u.data(), static_cast<uint16_t>(keys.size()),
+                                                      payload.data(), payload.size());
+            if (len == 0) ok = false;
+            send(StreamProtocol::kTypeSchema, len);
+        }
+
+        std::fill(values.begin(), values.end(), NAN);
+        for (const auto& v : parsed) {
+            auto it = columnOf.find(std::string(v.key, v.keyLength));
+            if (it != columnOf.end()) values[it->second] = v.value;
+        }
+        StreamProtocol::SampleHeader header = { hash, 0, ts, static_cast<uint16_t>(keys.size()) };
+        send(StreamProtocol::kTypeSample, StreamProtocol::encodeSample(header, values.data(), payload.data(), payload.size()));
+        samples++;
+
+        if (intervalMs) std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+        return ok && !stopRequested;
+    });
+
+    if (!ok) {
+        std::fprintf(stderr, "rtulog-stream: cannot stream %s to %s\n", logPath, target);
+        return 1;
+    }
+    std::fprintf(stderr, "%s: %llu sample(s) streamed, %zu value(s) each\n", target, static_cast<unsigned long long>(samples),
+                keys.size());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    bool emitMode = argc > 1 && std::strcmp(argv[1], "--emit") == 0;
+    const char* output = nullptr;
+    const char* formatName = nullptr;
+    uint32_t baud = 115200;
+    unsigned long maxSamples = 0;
+    unsigned long intervalMs = 0;
+    int first = emitMode ? 2 : 1;
+    while (first + 1 < argc && argv[first][0] == '-' && argv[first][1] != '\0') {
+        if (std::strcmp(argv[first], "-o") == 0 && !emitMode) {
+            output = argv[first + 1];
+        } else if (std::strcmp(argv[first], "-f") == 0 && !emitMode) {
+            formatName = argv[first + 1];
+        } else if (std::strcmp(argv[first], "-n") == 0 && !emitMode) {
+            maxSamples = std::strtoul(argv[first + 1], nullptr, 10);
+        } else if (std::strcmp(argv[first], "-i") == 0 && emitMode) {
+            intervalMs = std::strtoul(argv[first + 1], nullptr, 10);
+        } else if (std::strcmp(argv[first], "-b") == 0) {
+            baud = static_cast<uint32_t>(std::strtoul(argv[first + 1], nullptr, 10));
+        } else {
+            return usage();
+        }
+        first += 2;
+    }
+
+    if (emitMode) {
+        if (argc != first + 2) return usage();
+        return emit(argv[first], argv[first + 1], baud, intervalMs);
+    }
+    if (!output || argc != first + 1) return usage();
+
+    MergeFormat format = MergeFormat::Ndjson;
+    size_t outLen = std::strlen(output);
+    if (!formatName) {
+        if (outLen > 4 && std::strcmp(output + outLen - 4, ".rtc") == 0) format = MergeFormat::Columns;
+    } else if (std::strcmp(formatName, "framed") == 0) {
+        format = MergeFormat::Framed;
+    } else if (std::strcmp(formatName, "csv") == 0) {
+        format = MergeFormat::Csv;
+    } else if (std::strcmp(formatName, "rtc") == 0) {
+        format = MergeFormat::Columns;
+    } else if (std::strcmp(formatName, "ndjson") != 0) {
+        return usage();
+    }
+
+    SerialPort port;
+    if (!port.open(argv[first], baud)) {
+        std::fprintf(stderr, "rtulog-stream: %s\n", port.error().c_str());
+        return 1;
+    }
+    if (port.isTerminal()) std::fprintf(stderr, "rtulog-stream: receiving from %s, Ctrl+C to stop\n", argv[first]);
+
+    StreamReceiver receiver;
+    bool ok = receiver.run(port, format, output, maxSamples, stopRequested);
+    const StreamStats& s = receiver.stats();
+    if (!ok) {
+        std::fprintf(stderr, "rtulog-stream: %s\n", receiver.error().c_str());
+        return 1;
+    }
+
+    std::printf("%s: %llu sample(s), %zu value(s) each, %llu frame(s)", output,
+                static_cast<unsigned long long>(s.samples), receiver.keys().size(),
+                static_cast<unsigned long long>(s.frames));
+    if (s.lostFrames) std::printf(", %llu frame(s) lost", static_cast<unsigned long long>(s.lostFrames));
+    if (s.senderDropped) std::printf(", %llu sample(s) dropped by the logger", static_cast<unsigned long long>(s.senderDropped));
+    if (s.skippedBytes) std::printf(", %llu byte(s) of text/noise skipped", static_cast<unsigned long long>(s.skippedBytes));
+    if (s.beforeSchema) std::printf(", %llu sample(s) before the first schema", static_cast<unsigned long long>(s.beforeSchema));
+    if (s.malformed) std::printf(", %llu malformed sample(s)", static_cast<unsigned long long>(s.malformed));
+    std::printf("\n");
+    if (s.schemaChanged) std::printf("stopped: the logger's register set changed\n");
+    return 0;
+}
@@ -0,0 +1,46 @@
+// rtulog-trace: converts trace dumps of the logger ("trace" on the serial console,
+// or /trace.txt written by "trace save") into Chrome trace JSON for chrome://tracing
+// or ui.perfetto.dev. A serial capture may hold several dumps between other output.
+//
+// Usage: rtulog-trace [-o <output.json>] <dump or serial capture>
+
+#include "TraceExport.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+static int usage() {
+    std::fprintf(stderr, "Usage: rtulog-trace [-o <output.json>] <dump or serial capture>\n"
+                         "       default output: <input>.json, \"-o -\" writes to stdout\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    std::string output;
+    int first = 1;
+    if (argc > 2 && std::strcmp(argv[1], "-o") == 0) {
+        output = argv[2];
+        first = 3;
+    }
+    if (first + 1 != argc || argv[first][0] == '-') return usage();
+    std::string input = argv[first];
+    if (output.empty()) output = input + ".json";
+
+    TraceExport exporter;
+    if (!exporter.read(input) || !exporter.write(output)) {
+        std::fprintf(stderr, "rtulog-trace: %s\n", exporter.error().c_str());
+        return 1;
+    }
+
+    const TraceExportStats& s = exporter.stats();
+    std::fprintf(stderr, "%s: %llu event(s) from %llu dump(s)", output == "-" ? "stdout" : output.c_str(),
+                 static_cast<unsigned long long>(s.events), static_cast<unsigned long long>(s.dumps));
+    if (s.overwritten) std::fprintf(stderr, ", %llu older event(s) were overwritten on the logger",
+                                    static_cast<unsigned long long>(s.overwritten));
+    if (s.orphans) std::fprintf(stderr, ", %llu end event(s) without begin dropped", static_cast<unsigned long long>(s.orphans));
+    if (s.unterminated) std::fprintf(stderr, ", %llu open scope(s) closed at the end",
+                                     static_cast<unsigned long long>(s.unterminated));
+    if (s.malformed) std::fprintf(stderr, ", %llu malformed line(s) skipped", static_cast<unsigned long long>(s.malformed));
+    std::fprintf(stderr, "\n");
+    return 0;
+}